@@ -1,26 +1,82 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <limits.h>
 #include <string.h>
 #include <unistd.h>
+#include <ctype.h>
+#include <locale.h>
+#include <math.h>
 #include <ncurses.h>
 #include <time.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <signal.h>
+#include <errno.h>
+#include <getopt.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <sys/ioctl.h>
+#include <sys/types.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <netdb.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <net/if.h>
+#include <ifaddrs.h>
+#include <arpa/inet.h>
+#include <sys/utsname.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#if defined(__APPLE__)
+#include <net/route.h>
+#include <sys/event.h>
+#include <libproc.h>
+#include <sys/proc_info.h>
 #include <mach/mach.h>
 #include <mach/vm_statistics.h>
 #include <mach/mach_types.h>
 #include <mach/mach_init.h>
 #include <mach/mach_host.h>
+#include <mach/processor_info.h>
 #include <sys/mount.h>
 #include <sys/sysctl.h>
-#include <sys/types.h>
-#include <sys/resource.h>
-#include <mach/processor_info.h>
-#include <mach/mach_host.h>
-#include <sys/time.h>
+#include <IOKit/IOKitLib.h>
+#include <IOKit/IOBSD.h>
+#include <IOKit/storage/IOBlockStorageDriver.h>
+#elif defined(__linux__)
+#include <dirent.h>
+#include <sys/vfs.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <sys/syscall.h>
+#include <sys/timerfd.h>
+#include <sys/signalfd.h>
+#include <sys/inotify.h>
+#else
+#error "Plataforma no soportada: se requiere macOS o Linux"
+#endif
 
 // Macros para MIN y MAX
 #define MIN(a, b) (((a) < (b)) ? (a) : (b))
 #define MAX(a, b) (((a) > (b)) ? (a) : (b))
 
+// Llamadas al sistema (por hilo) y procesos hijos (de todo el proceso) del propio monitor.
+// Los recolectores envuelven cada llamada; --bench informa el costo de cada uno.
+static _Thread_local unsigned long long syscall_count = 0;
+static _Atomic unsigned long long fork_count = 0;
+#define COUNT_SYSCALL(call) (syscall_count++, (call))
+#define COUNT_FORK(call) ((void)atomic_fetch_add_explicit(&fork_count, 1, memory_order_relaxed), syscall_count++, (call))
+
 // Estructura para almacenar información de memoria
 typedef struct
 {
@@ -36,944 +92,10502 @@ typedef struct
     double swap_percentage;
 } MemoryInfo;
 
-// Función para obtener información de memoria en macOS
-int get_memory_info(MemoryInfo *mem_info)
+// Contadores acumulados de paginación (/proc/vmstat en Linux, vm_statistics64 en macOS).
+// El nivel de swap dice poco de un problema en curso: las tasas lo muestran enseguida.
+typedef enum
 {
-    mach_port_t mach_port = mach_host_self();
-    vm_size_t page_size;
-    vm_statistics64_data_t vm_stat;
-    mach_msg_type_number_t host_size = sizeof(vm_statistics64_data_t) / sizeof(natural_t);
-
-    // Obtener el tamaño de página
-    if (host_page_size(mach_port, &page_size) != KERN_SUCCESS)
-    {
-        return -1;
-    }
-
-    // Obtener estadísticas de memoria virtual
-    if (host_statistics64(mach_port, HOST_VM_INFO64, (host_info64_t)&vm_stat, &host_size) != KERN_SUCCESS)
-    {
-        return -1;
-    }
-
-    // Obtener memoria total del sistema
-    int mib[2];
-    size_t length;
-    uint64_t total_memory;
-
-    mib[0] = CTL_HW;
-    mib[1] = HW_MEMSIZE;
-    length = sizeof(uint64_t);
-
-    if (sysctl(mib, 2, &total_memory, &length, NULL, 0) != 0)
-    {
-        return -1;
-    }
-
-    mem_info->total_ram = total_memory;
-    mem_info->free_ram = (unsigned long long)vm_stat.free_count * page_size;
-    mem_info->inactive_ram = (unsigned long long)vm_stat.inactive_count * page_size;
-    mem_info->wired_ram = (unsigned long long)vm_stat.wire_count * page_size;
-    mem_info->compressed_ram = (unsigned long long)vm_stat.compressor_page_count * page_size;
-
-    // Calcular memoria usada (activa + wired + compressed)
-    mem_info->used_ram = ((unsigned long long)vm_stat.active_count +
-                          (unsigned long long)vm_stat.wire_count +
-                          (unsigned long long)vm_stat.compressor_page_count) *
-                         page_size;
+    VM_SWAP_IN,        // Páginas leídas de la swap
+    VM_SWAP_OUT,       // Páginas escritas a la swap
+    VM_MAJOR_FAULTS,   // Fallos que esperaron una lectura de disco
+    VM_MINOR_FAULTS,   // Fallos resueltos sin E/S
+    VM_PAGE_OUTS,      // Páginas de archivo escritas para liberar memoria (macOS)
+    VM_PAGE_SCANS,     // Páginas examinadas por kswapd y por el reclamo directo
+    VM_DIRECT_RECLAIM, // Asignaciones que tuvieron que reclamar memoria por su cuenta
+    VM_COMPACT_STALLS, // Asignaciones demoradas compactando memoria
+    VM_THP_ALLOC,      // Páginas enormes transparentes asignadas o colapsadas
+    VM_THP_SPLIT,      // Páginas enormes transparentes divididas
+    VM_COMPRESSIONS,   // Páginas comprimidas (zswap en Linux, compresor en macOS)
+    VM_DECOMPRESSIONS,
+    VM_COUNTERS
+} VmCounter;
 
-    mem_info->ram_percentage = (double)mem_info->used_ram / mem_info->total_ram * 100.0;
-
-    // Obtener información de swap (más complejo en macOS)
-    struct xsw_usage vmusage;
-    size_t size = sizeof(vmusage);
-    if (sysctlbyname("vm.swapusage", &vmusage, &size, NULL, 0) == 0)
-    {
-        mem_info->swap_total = vmusage.xsu_total;
-        mem_info->swap_used = vmusage.xsu_used;
-        mem_info->swap_percentage = mem_info->swap_total > 0 ? (double)mem_info->swap_used / mem_info->swap_total * 100.0 : 0.0;
-    }
-    else
-    {
-        mem_info->swap_total = 0;
-        mem_info->swap_used = 0;
-        mem_info->swap_percentage = 0.0;
-    }
+#define VM_UNKNOWN ULLONG_MAX // El sistema no informa ese contador
 
-    return 0;
-}
+typedef struct
+{
+    unsigned long long value[VM_COUNTERS];
+} VmCounters;
 
-// Función para convertir bytes a formato legible
-void format_bytes(unsigned long long bytes, char *buffer)
+// Contadores acumulados de CPU (en ticks) para calcular el uso por diferencia
+typedef struct
 {
-    const char *units[] = {"B", "KB", "MB", "GB", "TB"};
-    int unit = 0;
-    double size = bytes;
+    unsigned long long total;
+    unsigned long long idle;
+} CpuTicks;
 
-    while (size >= 1024 && unit < 4)
-    {
-        size /= 1024;
-        unit++;
-    }
+#define CPU_MAX_CORES 256
 
-    sprintf(buffer, "%.2f %s", size, units[unit]);
-}
+typedef enum
+{
+    CORE_USER, // user + nice
+    CORE_SYSTEM,
+    CORE_IDLE,
+    CORE_IOWAIT,
+    CORE_IRQ, // irq + softirq
+    CORE_STEAL,
+    CORE_STATES
+} CoreState;
 
-// Función para dibujar una barra de progreso
-void draw_progress_bar(int y, int x, int width, double percentage, const char *label)
+// Ticks acumulados por núcleo, un arreglo por estado (SoA): las restas entre dos
+// lecturas recorren memoria contigua y el compilador las vectoriza
+typedef struct
 {
-    int filled = (int)(percentage * width / 100);
+    int count;
+    unsigned long long ticks[CORE_STATES][CPU_MAX_CORES];
+    CpuTicks all; // Todos los núcleos juntos: la misma lectura da el uso total
+} CpuCoreTicks;
 
-    mvprintw(y, x, "%s: [", label);
+// Porcentaje de cada estado por núcleo entre dos lecturas
+typedef struct
+{
+    int count;
+    float pct[CORE_STATES][CPU_MAX_CORES];
+    float busy[CPU_MAX_CORES]; // user + system + irq + steal
+} CpuCoreUsage;
 
-    // Determinar color basado en el porcentaje
-    int active_color_pair = 1; // Verde por defecto
-    if (has_colors())
+// Sin ramas en el bucle interno para que se vectorice; un contador que retrocede
+// (núcleo desconectado y vuelto a conectar) cuenta como cero
+void cpu_core_usage(const CpuCoreTicks *prev, const CpuCoreTicks *cur, CpuCoreUsage *out)
+{
+    int n = MIN(prev->count, cur->count);
+    float delta[CORE_STATES][CPU_MAX_CORES];
+    float total[CPU_MAX_CORES];
+    for (int c = 0; c < n; c++)
+        total[c] = 0;
+    for (int st = 0; st < CORE_STATES; st++)
     {
-        if (percentage > 80)
-        {
-            active_color_pair = 3; // Rojo para uso alto
-        }
-        else if (percentage > 60)
+        const unsigned long long *a = prev->ticks[st];
+        const unsigned long long *b = cur->ticks[st];
+        for (int c = 0; c < n; c++)
         {
-            active_color_pair = 2; // Amarillo para uso medio
+            // Entre dos lecturas la diferencia cabe en 32 bits; con signo detecta el retroceso
+            int d = (int)(b[c] - a[c]);
+            d = d < 0 ? 0 : d;
+            delta[st][c] = (float)d;
+            total[c] += (float)d;
         }
-        attron(COLOR_PAIR(active_color_pair));
-    }
-
-    // Dibujar la parte llena de la barra
-    for (int i = 0; i < filled; i++)
-    {
-        mvaddch(y, x + strlen(label) + 3 + i, ACS_BLOCK); // Usar ACS_BLOCK para un relleno más sólido
-    }
-
-    if (has_colors())
-    {
-        attroff(COLOR_PAIR(active_color_pair));
     }
+    for (int c = 0; c < n; c++)
+        total[c] = total[c] > 0 ? 100.0f / total[c] : 0.0f;
+    for (int st = 0; st < CORE_STATES; st++)
+        for (int c = 0; c < n; c++)
+            out->pct[st][c] = delta[st][c] * total[c];
+    for (int c = 0; c < n; c++)
+        out->busy[c] = out->pct[CORE_USER][c] + out->pct[CORE_SYSTEM][c] + out->pct[CORE_IRQ][c] + out->pct[CORE_STEAL][c];
+    out->count = n;
+}
 
-    for (int i = filled; i < width; i++)
-    {
-        mvaddch(y, x + strlen(label) + 3 + i, '-');
-    }
+#define NET_MAX_INTERFACES 16
 
-    printw("] %.1f%%", percentage); // printw continúa desde la posición actual del cursor
-}
+// Contadores acumulados de una interfaz de red
+typedef struct
+{
+    char name[IFNAMSIZ];
+    unsigned int flags; // IFF_UP, IFF_LOOPBACK...
+    unsigned long long rx_bytes;
+    unsigned long long tx_bytes;
+    unsigned long long rx_packets;
+    unsigned long long tx_packets;
+    unsigned long long rx_errors;
+    unsigned long long tx_errors;
+    unsigned long long rx_dropped;
+    unsigned long long tx_dropped;
+} NetIfCounters;
 
-// Función para dibujar un gráfico de uso de memoria tipo Ecualizador
-void draw_memory_graph(int start_y, int start_x, MemoryInfo *history_data, int capacity, int oldest_buffer_idx, int current_data_count)
+// Estructura para almacenar datos de red
+typedef struct
 {
-    int graph_height = 10;
-    int graph_on_screen_width = COLS - start_x - 2; // Ancho disponible, -1 para eje Y, -1 para margen derecho
-    if (graph_on_screen_width < 1)
-        graph_on_screen_width = 1;
+    unsigned long long rx_bytes; // Suma de todas las interfaces salvo loopback
+    unsigned long long tx_bytes;
+    int counter_bits;            // Ancho de los contadores del backend (32 o 64)
+    int count;
+    int overflow;                // Interfaces agrupadas en la última entrada por no entrar
+    unsigned int overflow_hash;  // Cambia cuando cambia cuáles son
+    NetIfCounters ifaces[NET_MAX_INTERFACES];
+} NetStats;
 
-    int effective_num_points_to_draw = MIN(current_data_count, graph_on_screen_width);
-    if (effective_num_points_to_draw <= 0)
-        return;
+#define NET_OVERFLOW_NAME "(otras)"
 
-    mvprintw(start_y - 1, start_x, "Historial RAM (Ecualizador - %d segs):", effective_num_points_to_draw);
+static unsigned int net_name_hash(unsigned int h, const char *name)
+{
+    for (; *name; name++)
+        h = (h ^ (unsigned char)*name) * 16777619u;
+    return h ^ 0xff; // Separador entre nombres
+}
 
-    // Dibujar Eje Y
-    for (int y_offset = 0; y_offset < graph_height; ++y_offset)
+// Agrega una interfaz. En un equipo con muchas (veth de contenedores) las que no entran
+// se suman en una última entrada NET_OVERFLOW_NAME para no perder tráfico en los totales;
+// el loopback que no entra se descarta.
+static void net_stats_add(NetStats *stats, const NetIfCounters *c)
+{
+    if (stats->count < NET_MAX_INTERFACES)
     {
-        mvaddch(start_y + y_offset, start_x - 1, ACS_VLINE);
+        stats->ifaces[stats->count++] = *c;
+        return;
     }
-    // Dibujar Eje X
-    for (int x_offset = 0; x_offset < effective_num_points_to_draw; ++x_offset)
+    NetIfCounters *other = &stats->ifaces[NET_MAX_INTERFACES - 1];
+    if (!stats->overflow)
     {
-        mvaddch(start_y + graph_height, start_x + x_offset, ACS_HLINE);
+        // La última interfaz pasa a ser la primera del grupo
+        stats->overflow = 1;
+        stats->overflow_hash = net_name_hash(2166136261u, other->name);
+        if (other->flags & IFF_LOOPBACK)
+            memset(other, 0, sizeof(*other));
+        snprintf(other->name, sizeof(other->name), "%s", NET_OVERFLOW_NAME);
+        other->flags = IFF_UP;
     }
-    mvaddch(start_y + graph_height, start_x - 1, ACS_LLCORNER); // Esquina
+    if (c->flags & IFF_LOOPBACK)
+        return;
+    stats->overflow++;
+    stats->overflow_hash = net_name_hash(stats->overflow_hash, c->name);
+    other->rx_bytes += c->rx_bytes;
+    other->tx_bytes += c->tx_bytes;
+    other->rx_packets += c->rx_packets;
+    other->tx_packets += c->tx_packets;
+    other->rx_errors += c->rx_errors;
+    other->tx_errors += c->tx_errors;
+    other->rx_dropped += c->rx_dropped;
+    other->tx_dropped += c->tx_dropped;
+}
 
-    double max_ram_percentage = 100.0;
+// --- TABLA DE PROCESOS ---
 
-    // Determinar el índice del primer dato a leer del buffer para el gráfico
-    int first_buffer_idx_for_render = (oldest_buffer_idx + (current_data_count - effective_num_points_to_draw) + capacity) % capacity;
+#define PROC_NAME_LEN 32
+#define PROC_TABLE_INITIAL_CAPACITY 1024
+#define PROC_MEM_UNKNOWN ULLONG_MAX // El backend no informa ese valor
 
-    for (int screen_col_idx = 0; screen_col_idx < effective_num_points_to_draw; ++screen_col_idx)
-    {
-        int actual_history_buffer_idx = (first_buffer_idx_for_render + screen_col_idx) % capacity;
-        double current_percentage = history_data[actual_history_buffer_idx].ram_percentage;
+// Desglose de memoria de un proceso. RSS cuenta entera cada página compartida; PSS la
+// reparte entre los procesos que la mapean; USS es solo lo privado (lo que se libera al
+// terminar el proceso).
+typedef struct
+{
+    unsigned long long rss;
+    unsigned long long pss;
+    unsigned long long uss;
+    unsigned long long swap;
+} ProcMemory;
 
-        if (history_data[actual_history_buffer_idx].total_ram == 0 && current_percentage == 0.0)
-        {
-            current_percentage = 0.0; // Dato no inicializado, tratar como 0%
-        }
+// Un proceso conocido. Los datos fijos (nombre, uid, padre, inicio) se leen una sola vez
+// cuando aparece el PID; en las pasadas siguientes solo se refrescan los contadores.
+typedef struct
+{
+    int pid;                        // 0 = casilla libre
+    int ppid;
+    unsigned int uid;
+    char state;                     // Estado al estilo ps: R, S, D, Z, T, I...
+    char name[PROC_NAME_LEN];
+    unsigned long long cpu_time_ns; // Tiempo de CPU acumulado (usuario + sistema)
+    unsigned long long rss_bytes;
+    unsigned long long io_bytes;    // E/S de disco acumulada (lectura + escritura), solo si want_io
+    unsigned long long start_ms;    // Inicio del proceso en ms desde epoch
+    unsigned int generation;        // Última pasada en la que se vio el PID
+    int has_prev;                   // Hay una pasada anterior con la que calcular deltas
+    unsigned long long prev_cpu_time_ns;
+    unsigned long long prev_io_bytes;
+    float cpu_pct;                  // %CPU del último intervalo (100% = un núcleo)
+    float io_rate;                  // bytes/s del último intervalo
+    ProcMemory mem;                 // Detalle de memoria, solo con el orden PSS
+    unsigned long long mem_ns;      // Última lectura del detalle (0 = nunca)
+    int mem_denied;                 // La última lectura falló (permisos o proceso de kernel)
+} ProcEntry;
 
-        int plot_x = start_x + screen_col_idx;
-        int bar_pixel_height = (int)(current_percentage / max_ram_percentage * graph_height);
-        bar_pixel_height = MAX(0, MIN(graph_height, bar_pixel_height)); // Asegurar que esté dentro de los límites 0..graph_height
+// Tabla hash con direccionamiento abierto indexada por PID, persistente entre pasadas
+typedef struct
+{
+    ProcEntry *slots;
+    unsigned int capacity; // Potencia de 2
+    unsigned int count;
+    unsigned int generation;
+    int want_io;                     // Leer contadores de E/S (cuesta una lectura más por proceso)
+    unsigned long long last_scan_ns; // Instante monotónico de la última pasada
+    unsigned int mem_cursor;         // Próxima casilla del recorrido por turno del detalle de memoria
+} ProcTable;
 
-        // Dibujar la barra vertical para la columna actual
-        for (int h_row_in_graph = 0; h_row_in_graph < graph_height; ++h_row_in_graph)
-        {
-            // h_row_in_graph = 0 es la fila superior del área del gráfico
-            // h_row_in_graph = graph_height - 1 es la fila inferior del área del gráfico
-            int current_screen_y = start_y + h_row_in_graph;
+typedef struct
+{
+    int total;
+    int system;
+    int user;
+    int background;
+} ProcessStats;
 
-            // La barra se llena desde abajo hacia arriba.
-            // Si h_row_in_graph es mayor o igual a (graph_height - bar_pixel_height), está dentro de la barra.
-            if (h_row_in_graph >= (graph_height - bar_pixel_height))
-            {
-                mvaddch(current_screen_y, plot_x, ACS_BLOCK); // Carácter para la barra
-            }
-            else
-            {
-                mvaddch(current_screen_y, plot_x, ' '); // Espacio vacío encima de la barra
-            }
-        }
-    }
+static unsigned int proc_hash(int pid, unsigned int mask)
+{
+    return ((unsigned int)pid * 2654435761u) & mask;
 }
 
-// Función para obtener el número de CPUs
-int get_cpu_count()
+static int proc_table_init(ProcTable *table, unsigned int capacity)
 {
-    int cpu_count;
-    size_t size = sizeof(cpu_count);
-    if (sysctlbyname("hw.ncpu", &cpu_count, &size, NULL, 0) == 0)
-    {
-        return cpu_count;
-    }
-    return 1;
+    table->slots = calloc(capacity, sizeof(ProcEntry));
+    table->capacity = capacity;
+    table->count = 0;
+    table->generation = 0;
+    table->want_io = 0;
+    table->last_scan_ns = 0;
+    table->mem_cursor = 0;
+    return table->slots ? 0 : -1;
 }
 
-// Función para obtener el uptime del sistema
-double get_uptime()
+static void proc_table_free(ProcTable *table)
 {
-    struct timeval boottime;
-    size_t size = sizeof(boottime);
-    if (sysctlbyname("kern.boottime", &boottime, &size, NULL, 0) == 0)
-    {
-        time_t now;
-        time(&now);
-        return (double)(now - boottime.tv_sec) / 3600.0; // En horas
-    }
-    return 0.0;
+    free(table->slots);
+    table->slots = NULL;
+    table->capacity = table->count = 0;
 }
 
-#define HISTORY_CAPACITY 60
-#define CPU_HISTORY_CAPACITY 60
-#define CPU_HEATMAP_WIDTH 12
-
-// Función para obtener el uso de CPU (promedio de todos los núcleos)
-double get_cpu_usage()
+static int proc_table_grow(ProcTable *table)
 {
-    static uint64_t last_total = 0, last_idle = 0;
-    host_cpu_load_info_data_t cpuinfo;
-    mach_msg_type_number_t count = HOST_CPU_LOAD_INFO_COUNT;
-    if (host_statistics(mach_host_self(), HOST_CPU_LOAD_INFO, (host_info_t)&cpuinfo, &count) != KERN_SUCCESS)
+    ProcTable bigger;
+    if (proc_table_init(&bigger, table->capacity * 2) != 0)
+        return -1;
+    for (unsigned int i = 0; i < table->capacity; i++)
     {
-        return 0.0;
+        if (table->slots[i].pid == 0)
+            continue;
+        unsigned int mask = bigger.capacity - 1;
+        unsigned int j = proc_hash(table->slots[i].pid, mask);
+        while (bigger.slots[j].pid != 0)
+            j = (j + 1) & mask;
+        bigger.slots[j] = table->slots[i];
     }
-    uint64_t total = 0;
-    for (int i = 0; i < CPU_STATE_MAX; i++)
-        total += cpuinfo.cpu_ticks[i];
-    uint64_t idle = cpuinfo.cpu_ticks[CPU_STATE_IDLE];
+    bigger.count = table->count;
+    bigger.generation = table->generation;
+    bigger.want_io = table->want_io;
+    bigger.last_scan_ns = table->last_scan_ns;
+    bigger.mem_cursor = 0; // Las casillas se redistribuyen: el recorrido vuelve a empezar
+    free(table->slots);
+    *table = bigger;
+    return 0;
+}
 
-    double usage = 0.0;
-    if (last_total != 0)
+// Mientras no se leen, los contadores de E/S quedan viejos: al volver a leerlos se
+// descarta la pasada anterior para no calcular una tasa contra ellos
+static void proc_table_set_want_io(ProcTable *table, int want_io)
+{
+    if (want_io && !table->want_io)
     {
-        uint64_t diff_total = total - last_total;
-        uint64_t diff_idle = idle - last_idle;
-        if (diff_total > 0)
+        for (unsigned int i = 0; i < table->capacity; i++)
         {
-            usage = 100.0 * (diff_total - diff_idle) / diff_total;
+            table->slots[i].has_prev = 0;
+            table->slots[i].prev_io_bytes = 0;
         }
     }
-    last_total = total;
-    last_idle = idle;
-    return usage;
+    table->want_io = want_io;
 }
 
-// Dibuja histograma de memoria con barras ▓ rojas y coordenadas verdes
-void draw_memory_histogram(int start_y, int start_x, MemoryInfo *history_data, int capacity, int oldest_buffer_idx, int current_data_count)
+// Busca un PID y lo inserta si no existe (*is_new = 1). Devuelve NULL sin memoria.
+static ProcEntry *proc_table_upsert(ProcTable *table, int pid, int *is_new)
 {
-    int graph_height = 10;
-    int graph_width = MIN(current_data_count, COLS - start_x - 10);
-    if (graph_width <= 0)
-        return;
-
-    mvprintw(start_y - 1, start_x, "Histograma RAM (%%):");
-
-    // Eje Y y coordenadas verdes
-    for (int y = 0; y < graph_height; ++y)
-    {
-        if (has_colors())
-            attron(COLOR_PAIR(5));
-        mvprintw(start_y + y, start_x - 5, "%3d%%", (graph_height - y) * 10);
-        if (has_colors())
-            attroff(COLOR_PAIR(5));
-    }
-
-    // Barras ▓ rojas
-    for (int i = 0; i < graph_width; ++i)
+    if ((table->count + 1) * 2 > table->capacity && proc_table_grow(table) != 0)
+        return NULL;
+    unsigned int mask = table->capacity - 1;
+    unsigned int i = proc_hash(pid, mask);
+    while (table->slots[i].pid != 0)
     {
-        int idx = (oldest_buffer_idx + (current_data_count - graph_width) + i + capacity) % capacity;
-        double perc = history_data[idx].ram_percentage;
-        int bar_height = (int)(perc / 100.0 * graph_height);
-        for (int y = 0; y < graph_height; ++y)
+        if (table->slots[i].pid == pid)
         {
-            if (y >= graph_height - bar_height)
-            {
-                if (has_colors())
-                    attron(COLOR_PAIR(3));
-                mvaddch(start_y + y, start_x + i, 'X');
-                if (has_colors())
-                    attroff(COLOR_PAIR(3));
-            }
-            else
-            {
-                mvaddch(start_y + y, start_x + i, ' ');
-            }
+            *is_new = 0;
+            return &table->slots[i];
         }
+        i = (i + 1) & mask;
     }
+    memset(&table->slots[i], 0, sizeof(ProcEntry));
+    table->slots[i].pid = pid;
+    table->count++;
+    *is_new = 1;
+    return &table->slots[i];
 }
 
-// Dibuja mapa de calor de CPU
-void draw_cpu_heatmap(int y, int x, double *cpu_history, int count)
+// Borrado con desplazamiento hacia atrás: no deja lápidas que alarguen las búsquedas
+static void proc_table_remove_at(ProcTable *table, unsigned int i)
 {
-    mvprintw(y - 1, x, "CPU Heatmap (últimos %d segs):", count);
-    for (int i = 0; i < count; ++i)
+    unsigned int mask = table->capacity - 1;
+    unsigned int j = i;
+    for (;;)
     {
-        double usage = cpu_history[i];
-        char symbol = ' ';
-        int color = 1;
-        if (usage < 40)
-        {
-            symbol = ' ';
-            color = 1; // Verde
-        }
-        else if (usage < 75)
-        {
-            symbol = '#';
-            color = 2; // Amarillo
-        }
-        else
+        j = (j + 1) & mask;
+        if (table->slots[j].pid == 0)
+            break;
+        unsigned int home = proc_hash(table->slots[j].pid, mask);
+        // Mover j a i solo si su posición ideal no queda entre i (exclusive) y j (inclusive)
+        if ((j > i && (home <= i || home > j)) || (j < i && (home <= i && home > j)))
         {
-            symbol = '@';
-            color = 3; // Rojo
+            table->slots[i] = table->slots[j];
+            i = j;
         }
-        if (has_colors())
-            attron(COLOR_PAIR(color));
-        printw("[%c]", symbol);
-        if (has_colors())
-            attroff(COLOR_PAIR(color));
     }
+    table->slots[i].pid = 0;
+    table->count--;
 }
 
-// --- AGREGADOS PARA TEMPERATURA Y RED ---
-// Obtener temperatura del CPU usando powermetrics (requiere sudo)
-double get_cpu_temperature()
+// Elimina los procesos que no aparecieron en la última pasada
+// El recorrido empieza en una casilla vacía: así ningún grupo de colisiones cruza el
+// punto de partida y cada desplazamiento trae a la casilla actual una entrada que todavía
+// no se revisó, nunca una del tramo ya recorrido después de dar la vuelta.
+static void proc_table_sweep(ProcTable *table)
 {
-    FILE *fp = popen("sudo powermetrics --samplers smc | grep -m1 'CPU die temperature' | awk '{print $4}'", "r");
-    if (!fp)
-        return -1;
-    double temp = -1;
-    fscanf(fp, "%lf", &temp);
-    pclose(fp);
-    return temp;
+    unsigned int mask = table->capacity - 1;
+    unsigned int start = 0;
+    while (start < table->capacity && table->slots[start].pid != 0)
+        start++;
+    if (start == table->capacity)
+        start = 0; // No pasa: la tabla se agranda antes de llenarse a la mitad
+    unsigned int visited = 0;
+    while (visited < table->capacity)
+    {
+        unsigned int i = (start + visited) & mask;
+        if (table->slots[i].pid != 0 && table->slots[i].generation != table->generation)
+            proc_table_remove_at(table, i); // Revisar de nuevo la casilla: pudo llegar otra entrada
+        else
+            visited++;
+    }
 }
 
-// Obtener temperatura del GPU usando powermetrics (requiere sudo, puede no estar disponible)
-double get_gpu_temperature()
-{
-    FILE *fp = popen("sudo powermetrics --samplers smc | grep -m1 'GPU die temperature' | awk '{print $4}'", "r");
-    if (!fp)
-        return -1;
-    double temp = -1;
-    fscanf(fp, "%lf", &temp);
-    pclose(fp);
-    return temp;
-}
+// --- DISCOS ---
 
-// Estructura para almacenar datos de red
+#define DISK_MAX_DEVICES 32
+#define DISK_MAX_MOUNTS 16
+#define DISK_UNKNOWN ~0ULL // Contador que el backend no ofrece
+#define DISK_PANEL_MOUNTS 4 // Montajes que entran en el panel
+
+// Contadores acumulados de un dispositivo de bloques
 typedef struct
 {
-    unsigned long long rx_bytes;
-    unsigned long long tx_bytes;
-} NetStats;
+    char name[32];
+    unsigned int major, minor; // 0:0 si el backend no los usa (macOS)
+    unsigned long long reads;  // Operaciones completadas
+    unsigned long long writes;
+    unsigned long long read_bytes;
+    unsigned long long write_bytes;
+    unsigned long long read_ms; // Tiempo acumulado de las operaciones
+    unsigned long long write_ms;
+    unsigned long long busy_ms;  // Tiempo con alguna operación en curso, o DISK_UNKNOWN
+    unsigned long long queue_ms; // Tiempo ponderado por la cola, o DISK_UNKNOWN
+} DiskIoCounters;
 
-// Obtener bytes de red usando netstat
-void get_net_stats(NetStats *stats)
+typedef struct
 {
-    FILE *fp = popen("netstat -ib | awk 'NR>1 && $1!=\"lo0\" {rx+=$7; tx+=$10} END {print rx, tx}'", "r");
-    if (!fp)
-    {
-        stats->rx_bytes = 0;
-        stats->tx_bytes = 0;
-        return;
-    }
-    fscanf(fp, "%llu %llu", &stats->rx_bytes, &stats->tx_bytes);
-    pclose(fp);
-}
+    int count;
+    DiskIoCounters devices[DISK_MAX_DEVICES];
+} DiskIoStats;
 
-// Dibuja barra de red
-void draw_network_bar(int y, int x, double value, double max_value, const char *label, int color_pair)
+// Un sistema de archivos montado sobre un dispositivo real
+typedef struct
 {
-    int width = 30;
+    char mount_point[64];
+    char device[32]; // sda1, nvme0n1p2, disk3s1
+    char fstype[16];
+    unsigned int major, minor;
+    unsigned long long total;
+    unsigned long long used;
+    unsigned long long free;
+    double percent_used;
+} MountEntry;
+
+typedef struct
+{
+    int count;
+    MountEntry mounts[DISK_MAX_MOUNTS];
+} MountList;
+
+// Espacio al estilo df: el porcentaje se calcula sobre lo que puede usar un usuario común
+static void mount_entry_fill(MountEntry *m, unsigned long long blocks, unsigned long long bfree, unsigned long long bavail, unsigned long long bsize)
+{
+    m->total = blocks * bsize;
+    m->free = bavail * bsize;
+    m->used = (blocks - bfree) * bsize;
+    m->percent_used = m->used + m->free > 0 ? (double)m->used / (m->used + m->free) * 100.0 : 0.0;
+}
+
+// --- PRESIÓN (PSI) ---
+
+// Tiempo que las tareas pasaron esperando CPU, memoria o E/S. "some": al menos una
+// tarea demorada; "full": todas las tareas no ociosas a la vez.
+typedef enum
+{
+    PSI_CPU,
+    PSI_MEMORY,
+    PSI_IO,
+    PSI_RESOURCES
+} PressureResource;
+
+static const char *const psi_names[PSI_RESOURCES] = {"cpu", "memory", "io"};
+
+typedef struct
+{
+    double avg10, avg60, avg300; // % del tiempo en demora
+    unsigned long long total_us; // Demora acumulada
+} PressureLine;
+
+typedef struct
+{
+    PressureLine some, full;
+} PressureEntry;
+
+typedef struct
+{
+    int valid;        // Hay /proc/pressure
+    int cgroup_valid; // Hay archivos *.pressure del cgroup observado con --cgroup o del propio
+    PressureEntry sys[PSI_RESOURCES];
+    PressureEntry cgroup[PSI_RESOURCES];
+} PressureStats;
+
+// --- FRECUENCIA DE CPU ---
+
+// La frecuencia nominal no dice nada de la real: un núcleo limitado por temperatura o
+// por el gobernador trabaja más lento con el mismo porcentaje de ocupación.
+
+#define CPU_FREQ_PACKAGES 8
+#define CPU_FREQ_UNKNOWN ULLONG_MAX // Contador que el sistema no informa
+#define CPU_GOVERNOR_LEN 24
+
+// Lectura cruda por núcleo: los contadores son acumulados
+typedef struct
+{
+    int count;
+    unsigned int cur_khz[CPU_MAX_CORES];             // La que informa cpufreq; 0 si no se conoce
+    unsigned long long core_throttle[CPU_MAX_CORES]; // Veces que el núcleo se limitó por temperatura
+    signed char package[CPU_MAX_CORES];              // Índice en package_throttle, -1 si no se sabe
+    int package_count;
+    unsigned long long package_throttle[CPU_FREQ_PACKAGES];
+    char governor[CPU_GOVERNOR_LEN]; // Del núcleo 0; "" si no se conoce
+} CpuFreqStats;
+
+// Frecuencia efectiva entre dos lecturas
+typedef struct
+{
+    int count;                     // 0 si el sistema no informa frecuencias
+    float mhz[CPU_MAX_CORES];      // NAN si no se conoce
+    float throttle[CPU_MAX_CORES]; // Límites térmicos por segundo (del núcleo y de su paquete); NAN sin contadores
+    double avg_mhz;                // Media de los núcleos conocidos; 0 si ninguno
+    double min_mhz, max_mhz;
+    double throttle_rate;          // Suma de todos los núcleos; NAN sin contadores
+    unsigned long long core_throttle_total;    // Acumulados, CPU_FREQ_UNKNOWN sin contadores
+    unsigned long long package_throttle_total;
+    char governor[CPU_GOVERNOR_LEN];
+} CpuFreqUsage;
+
+// --- NUMA ---
+
+// En un equipo con varios nodos NUMA el porcentaje de RAM global esconde un nodo lleno
+// mientras otro está ocioso: el kernel empieza a asignar memoria remota (numa_miss)
+// antes de que el total se vea alto.
+
+#define NUMA_MAX_NODES 8
+
+typedef struct
+{
+    int id;                     // N de /sys/devices/system/node/nodeN
+    int cpu_count;
+    unsigned long long total;   // Bytes
+    unsigned long long free;
+    unsigned long long file;    // Caché de archivos
+    unsigned long long anon;    // Memoria anónima
+    unsigned long long numa_miss;    // Páginas que se quisieron en otro nodo y cayeron en este
+    unsigned long long numa_foreign; // Páginas que se quisieron en este nodo y cayeron en otro
+} NumaNodeCounters;
+
+typedef struct
+{
+    int count;                          // 0 si el sistema no informa nodos
+    signed char cpu_node[CPU_MAX_CORES]; // Índice en nodes de cada núcleo, -1 si no se sabe
+    NumaNodeCounters nodes[NUMA_MAX_NODES];
+} NumaStats;
+
+// --- CGROUP (MODO CONTENEDOR) ---
+
+// Con --cgroup la memoria y el CPU se miden contra el cgroup v2 observado y sus
+// límites, no contra el equipo: dentro de un contenedor son los números que importan.
+
+#define CGROUP_CHILD_MAX 16
+#define CGROUP_NAME_LEN 48
+#define CGROUP_PATH_LEN 256
+#define CGROUP_UNLIMITED ULLONG_MAX // "max" en memory.max, io.max, ...
+
+// Contadores crudos de un cgroup; los de E/S suman todos los dispositivos
+typedef struct
+{
+    char name[CGROUP_NAME_LEN]; // Hijo relativo al cgroup observado; "" para él mismo
+    unsigned long long memory_current;
+    unsigned long long cpu_usage_us, cpu_user_us, cpu_system_us;
+    unsigned long long nr_periods, nr_throttled, throttled_us;
+    unsigned long long io_rbytes, io_wbytes, io_rios, io_wios;
+} CgroupCounters;
+
+enum
+{
+    CGROUP_IO_RBPS,
+    CGROUP_IO_WBPS,
+    CGROUP_IO_RIOPS,
+    CGROUP_IO_WIOPS,
+    CGROUP_IO_LIMITS
+};
+
+// Límites y estado del cgroup observado
+typedef struct
+{
+    int valid;
+    int has_memory, has_swap, has_cpu, has_io; // Controladores habilitados para el cgroup
+    char path[CGROUP_PATH_LEN];                // Dentro de la jerarquía v2
+    unsigned long long memory_max, memory_high;
+    unsigned long long swap_current, swap_max;
+    unsigned long long anon, file, kernel, inactive_file; // memory.stat
+    double cpu_limit; // Núcleos: cuota de cpu.max o, sin cuota, los de cpuset.cpus.effective
+    int cpu_quota;
+    unsigned long long io_max[CGROUP_IO_LIMITS]; // Sumados por dispositivo; CGROUP_UNLIMITED sin límite
+} CgroupInfo;
+
+typedef struct
+{
+    CgroupInfo info;
+    CgroupCounters self;
+    int child_count; // Los CGROUP_CHILD_MAX hijos con más memoria
+    int child_total; // Todos los hijos directos
+    CgroupCounters children[CGROUP_CHILD_MAX];
+} CgroupStats;
+
+// --- SENSORES ---
+
+// Temperaturas, ventiladores y potencia. Cada backend los enumera una vez al abrirse
+// (hwmon/thermal en Linux, SMC en macOS) y después solo los lee: sin procesos externos
+// ni sudo. La descripción queda fija en sensor_set; cada muestra lleva solo los valores.
+
+#define SENSOR_MAX 256
+#define SENSOR_LABEL_LEN 24
+
+typedef enum
+{
+    SENSOR_TEMP,  // °C
+    SENSOR_FAN,   // RPM
+    SENSOR_POWER, // W
+} SensorKind;
+
+typedef struct
+{
+    SensorKind kind;
+    char chip[16];                // Controlador: coretemp, k10temp, nvme, acpitz, SMC...
+    char label[SENSOR_LABEL_LEN]; // "Package id 0", "Core 3", "Tctl", "fan1"...
+    int package;                  // Paquete físico, -1 si no corresponde
+    int core;                     // Núcleo físico dentro del paquete, -1 si no corresponde
+    int fd;                       // Linux: archivo *_input abierto
+    double scale;                 // Linux: factor a °C, RPM o W
+    unsigned int smc_key;         // macOS: clave SMC de cuatro caracteres
+    unsigned int smc_type;
+    unsigned int smc_size;
+} Sensor;
+
+typedef struct
+{
+    int count;
+    Sensor sensors[SENSOR_MAX];
+    int cpu_main;                  // Sensor que representa al CPU, -1 si no hay
+    int cpu_sensor[CPU_MAX_CORES]; // Sensor del núcleo de cada CPU lógica, -1 si no se conoce
+} SensorSet;
+
+typedef struct
+{
+    int count;
+    float value[SENSOR_MAX]; // NAN si la lectura falló
+} SensorReadings;
+
+// Se llena al abrir el recolector y después solo se lee (desde cualquier hilo)
+static SensorSet sensor_set;
+
+static Sensor *sensor_add(SensorSet *set, SensorKind kind, const char *chip, const char *label)
+{
+    if (set->count == SENSOR_MAX)
+        return NULL;
+    Sensor *sn = &set->sensors[set->count++];
+    memset(sn, 0, sizeof(*sn));
+    sn->kind = kind;
+    snprintf(sn->chip, sizeof(sn->chip), "%s", chip);
+    snprintf(sn->label, sizeof(sn->label), "%s", label);
+    sn->package = sn->core = -1;
+    sn->fd = -1;
+    return sn;
+}
+
+static void sensor_set_reset(SensorSet *set)
+{
+    set->count = 0;
+    set->cpu_main = -1;
+    for (int c = 0; c < CPU_MAX_CORES; c++)
+        set->cpu_sensor[c] = -1;
+}
+
+// Interfaz de recolección: cada plataforma aporta un backend que se elige al compilar.
+// open() reserva los recursos una sola vez (puertos, descriptores) para que cada
+// muestra cueste solo unas pocas llamadas al sistema.
+typedef struct
+{
+    const char *name;
+    int (*open)(void);
+    int (*read_memory)(MemoryInfo *mem_info);
+    int (*read_vmstat)(VmCounters *vm);
+    int (*read_cpu_ticks)(CpuTicks *ticks);
+    int (*read_cpu_cores)(CpuCoreTicks *cores);
+    int (*read_cpu_freq)(CpuFreqStats *stats); // -1 si no hay cpufreq ni límites térmicos
+    int (*read_net)(NetStats *stats);
+    int (*scan_processes)(ProcTable *table);
+    int (*read_proc_memory)(int pid, ProcMemory *mem); // Más caro que el escaneo: se dosifica
+    int (*read_sensors)(SensorReadings *out); // Sensores enumerados en open()
+    int (*read_disk_io)(DiskIoStats *stats);
+    int (*read_mounts)(MountList *mounts); // La tabla de montajes se relee solo si cambió
+    int (*read_pressure)(PressureStats *stats); // -1 si el sistema no informa presión
+    int (*watch_pressure)(int *fds, int max);   // Disparadores de presión para poll() con POLLPRI
+    int (*read_cgroup)(CgroupStats *stats);     // -1 fuera del modo contenedor
+    int (*read_numa)(NumaStats *stats);         // -1 si el sistema no informa nodos
+    void (*close)(void);
+} Collector;
+
+// Completa los porcentajes derivados a partir de los valores absolutos
+static void memory_info_finish(MemoryInfo *mem_info)
+{
+    mem_info->ram_percentage = mem_info->total_ram > 0 ? (double)mem_info->used_ram / mem_info->total_ram * 100.0 : 0.0;
+    mem_info->swap_percentage = mem_info->swap_total > 0 ? (double)mem_info->swap_used / mem_info->swap_total * 100.0 : 0.0;
+}
+
+#if defined(__APPLE__)
+
+// --- BACKEND MACH (macOS) ---
+
+static mach_port_t mach_host_port = MACH_PORT_NULL;
+static vm_size_t mach_page_size = 0;
+static uint64_t mach_total_memory = 0;
+
+// SMC (System Management Controller) a través de IOKit: el mismo canal que usa
+// powermetrics, pero sin privilegios. Las estructuras replican las del driver AppleSMC.
+#define SMC_KERNEL_INDEX 2
+#define SMC_CMD_READ_BYTES 5
+#define SMC_CMD_READ_KEYINFO 9
+
+typedef struct
+{
+    unsigned char major, minor, build, reserved;
+    unsigned short release;
+} SmcVersion;
+
+typedef struct
+{
+    unsigned short version, length;
+    unsigned int cpu_limit, gpu_limit, mem_limit;
+} SmcPLimit;
+
+typedef struct
+{
+    unsigned int data_size;
+    unsigned int data_type;
+    unsigned char data_attributes;
+} SmcKeyInfo;
+
+typedef struct
+{
+    unsigned int key;
+    SmcVersion vers;
+    SmcPLimit p_limit;
+    SmcKeyInfo key_info;
+    unsigned char result;
+    unsigned char status;
+    unsigned char data8;
+    unsigned int data32;
+    unsigned char bytes[32];
+} SmcParam;
+
+static io_connect_t mach_smc = 0;
+
+static unsigned int smc_code(const char *s)
+{
+    return ((unsigned int)s[0] << 24) | ((unsigned int)s[1] << 16) | ((unsigned int)s[2] << 8) | (unsigned int)s[3];
+}
+
+static int smc_call(SmcParam *in, SmcParam *out)
+{
+    size_t out_size = sizeof(*out);
+    memset(out, 0, sizeof(*out));
+    if (COUNT_SYSCALL(IOConnectCallStructMethod(mach_smc, SMC_KERNEL_INDEX, in, sizeof(*in), out, &out_size)) != kIOReturnSuccess)
+        return -1;
+    return out->result == 0 ? 0 : -1;
+}
+
+static int smc_key_info(unsigned int key, unsigned int *type, unsigned int *size)
+{
+    SmcParam in, out;
+    memset(&in, 0, sizeof(in));
+    in.key = key;
+    in.data8 = SMC_CMD_READ_KEYINFO;
+    if (smc_call(&in, &out) != 0 || out.key_info.data_size == 0 || out.key_info.data_size > sizeof(out.bytes))
+        return -1;
+    *type = out.key_info.data_type;
+    *size = out.key_info.data_size;
+    return 0;
+}
+
+// Decodifica los tipos numéricos que usan temperaturas, ventiladores y potencia
+static float smc_read_value(const Sensor *sn)
+{
+    SmcParam in, out;
+    memset(&in, 0, sizeof(in));
+    in.key = sn->smc_key;
+    in.key_info.data_size = sn->smc_size;
+    in.data8 = SMC_CMD_READ_BYTES;
+    if (smc_call(&in, &out) != 0)
+        return NAN;
+    const unsigned char *b = out.bytes;
+    if (sn->smc_type == smc_code("sp78"))
+        return (float)(short)((b[0] << 8) | b[1]) / 256.0f;
+    if (sn->smc_type == smc_code("fpe2"))
+        return (float)((b[0] << 8) | b[1]) / 4.0f;
+    if (sn->smc_type == smc_code("flt ") && sn->smc_size == 4)
+    {
+        float f;
+        memcpy(&f, b, sizeof(f));
+        return f;
+    }
+    if (sn->smc_type == smc_code("ui8 "))
+        return b[0];
+    if (sn->smc_type == smc_code("ui16"))
+        return (float)((b[0] << 8) | b[1]);
+    return NAN;
+}
+
+static void mach_sensor_probe(SensorSet *set, const char *key, SensorKind kind, const char *label, int core)
+{
+    unsigned int type, size;
+    if (smc_key_info(smc_code(key), &type, &size) != 0)
+        return;
+    Sensor *sn = sensor_add(set, kind, "SMC", label);
+    if (!sn)
+        return;
+    sn->smc_key = smc_code(key);
+    sn->smc_type = type;
+    sn->smc_size = size;
+    if (core >= 0)
+        sn->package = 0, sn->core = core;
+    if (set->cpu_main < 0 && kind == SENSOR_TEMP && (key[1] == 'C' || key[1] == 'p'))
+        set->cpu_main = set->count - 1;
+}
+
+// Las claves cambian según el modelo: se prueban las conocidas y se guardan las que existen.
+// Las de CPU van primero, en orden de preferencia para la temperatura principal: TC* en
+// Intel y Tp* (núcleos de rendimiento y eficiencia) en Apple M1/M2. Los M3 y posteriores
+// usan otras claves que no se conocen aquí y quedan sin temperatura principal.
+static void mach_open_sensors(SensorSet *set)
+{
+    static const struct
+    {
+        const char *key;
+        SensorKind kind;
+        const char *label;
+    } keys[] = {
+        {"TC0D", SENSOR_TEMP, "CPU die"},
+        {"TC0E", SENSOR_TEMP, "CPU die 2"},
+        {"TC0P", SENSOR_TEMP, "CPU proximidad"},
+        {"TCXC", SENSOR_TEMP, "CPU PECI"},
+        {"Tp01", SENSOR_TEMP, "CPU rendimiento"},
+        {"Tp05", SENSOR_TEMP, "CPU rendimiento 2"},
+        {"Tp09", SENSOR_TEMP, "CPU eficiencia"},
+        {"Tp0T", SENSOR_TEMP, "CPU eficiencia 2"},
+        {"TG0D", SENSOR_TEMP, "GPU die"},
+        {"TG0P", SENSOR_TEMP, "GPU proximidad"},
+        {"TB0T", SENSOR_TEMP, "Batería"},
+        {"PCPC", SENSOR_POWER, "CPU paquete"},
+        {"PSTR", SENSOR_POWER, "Sistema"},
+    };
+    sensor_set_reset(set);
+    io_service_t service = IOServiceGetMatchingService(MACH_PORT_NULL, IOServiceMatching("AppleSMC"));
+    if (!service)
+        return;
+    kern_return_t kr = IOServiceOpen(service, mach_task_self(), 0, &mach_smc);
+    IOObjectRelease(service);
+    if (kr != KERN_SUCCESS)
+    {
+        mach_smc = 0;
+        return;
+    }
+    for (size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); i++)
+        mach_sensor_probe(set, keys[i].key, keys[i].kind, keys[i].label, -1);
+    for (int c = 0; c < 32; c++)
+    {
+        char key[8], label[SENSOR_LABEL_LEN];
+        snprintf(key, sizeof(key), "TC%XC", c);
+        snprintf(label, sizeof(label), "Core %d", c);
+        mach_sensor_probe(set, key, SENSOR_TEMP, label, c);
+    }
+    for (int f = 0; f < 4; f++)
+    {
+        char key[8], label[SENSOR_LABEL_LEN];
+        snprintf(key, sizeof(key), "F%dAc", f);
+        snprintf(label, sizeof(label), "Ventilador %d", f);
+        mach_sensor_probe(set, key, SENSOR_FAN, label, -1);
+    }
+}
+
+static int mach_read_sensors(SensorReadings *out)
+{
+    for (int i = 0; i < sensor_set.count; i++)
+        out->value[i] = smc_read_value(&sensor_set.sensors[i]);
+    out->count = sensor_set.count;
+    return 0;
+}
+
+// Los valores estáticos (puerto, tamaño de página, memoria total) se consultan una vez
+static int mach_collector_open(void)
+{
+    mach_host_port = mach_host_self();
+
+    // Obtener el tamaño de página
+    if (host_page_size(mach_host_port, &mach_page_size) != KERN_SUCCESS)
+    {
+        return -1;
+    }
+
+    // Obtener memoria total del sistema
+    int mib[2] = {CTL_HW, HW_MEMSIZE};
+    size_t length = sizeof(mach_total_memory);
+    if (sysctl(mib, 2, &mach_total_memory, &length, NULL, 0) != 0)
+    {
+        return -1;
+    }
+
+    // Sin SMC (máquina virtual, permisos) el monitor sigue funcionando sin sensores
+    mach_open_sensors(&sensor_set);
+    return 0;
+}
+
+static int mach_read_memory(MemoryInfo *mem_info)
+{
+    vm_statistics64_data_t vm_stat;
+    mach_msg_type_number_t host_size = sizeof(vm_statistics64_data_t) / sizeof(natural_t);
+
+    // Obtener estadísticas de memoria virtual
+    if (COUNT_SYSCALL(host_statistics64(mach_host_port, HOST_VM_INFO64, (host_info64_t)&vm_stat, &host_size)) != KERN_SUCCESS)
+    {
+        return -1;
+    }
+
+    mem_info->total_ram = mach_total_memory;
+    mem_info->free_ram = (unsigned long long)vm_stat.free_count * mach_page_size;
+    mem_info->inactive_ram = (unsigned long long)vm_stat.inactive_count * mach_page_size;
+    mem_info->wired_ram = (unsigned long long)vm_stat.wire_count * mach_page_size;
+    mem_info->compressed_ram = (unsigned long long)vm_stat.compressor_page_count * mach_page_size;
+
+    // Calcular memoria usada (activa + wired + compressed)
+    mem_info->used_ram = ((unsigned long long)vm_stat.active_count +
+                          (unsigned long long)vm_stat.wire_count +
+                          (unsigned long long)vm_stat.compressor_page_count) *
+                         mach_page_size;
+
+    // Obtener información de swap (más complejo en macOS)
+    struct xsw_usage vmusage;
+    size_t size = sizeof(vmusage);
+    if (COUNT_SYSCALL(sysctlbyname("vm.swapusage", &vmusage, &size, NULL, 0)) == 0)
+    {
+        mem_info->swap_total = vmusage.xsu_total;
+        mem_info->swap_used = vmusage.xsu_used;
+    }
+    else
+    {
+        mem_info->swap_total = 0;
+        mem_info->swap_used = 0;
+    }
+
+    memory_info_finish(mem_info);
+    return 0;
+}
+
+// vm_statistics64 no distingue escaneos, reclamo directo, compactación ni THP. Las
+// lecturas de páginas (pageins) son los fallos que esperaron al disco.
+static int mach_read_vmstat(VmCounters *vm)
+{
+    vm_statistics64_data_t vm_stat;
+    mach_msg_type_number_t host_size = sizeof(vm_statistics64_data_t) / sizeof(natural_t);
+    if (COUNT_SYSCALL(host_statistics64(mach_host_port, HOST_VM_INFO64, (host_info64_t)&vm_stat, &host_size)) != KERN_SUCCESS)
+        return -1;
+    for (int i = 0; i < VM_COUNTERS; i++)
+        vm->value[i] = VM_UNKNOWN;
+    vm->value[VM_SWAP_IN] = vm_stat.swapins;
+    vm->value[VM_SWAP_OUT] = vm_stat.swapouts;
+    vm->value[VM_MAJOR_FAULTS] = vm_stat.pageins;
+    vm->value[VM_MINOR_FAULTS] = vm_stat.faults - MIN(vm_stat.faults, vm_stat.pageins);
+    vm->value[VM_PAGE_OUTS] = vm_stat.pageouts;
+    vm->value[VM_COMPRESSIONS] = vm_stat.compressions;
+    vm->value[VM_DECOMPRESSIONS] = vm_stat.decompressions;
+    return 0;
+}
+
+static int mach_read_cpu_ticks(CpuTicks *ticks)
+{
+    host_cpu_load_info_data_t cpuinfo;
+    mach_msg_type_number_t count = HOST_CPU_LOAD_INFO_COUNT;
+    if (COUNT_SYSCALL(host_statistics(mach_host_port, HOST_CPU_LOAD_INFO, (host_info_t)&cpuinfo, &count)) != KERN_SUCCESS)
+    {
+        return -1;
+    }
+    ticks->total = 0;
+    for (int i = 0; i < CPU_STATE_MAX; i++)
+        ticks->total += cpuinfo.cpu_ticks[i];
+    ticks->idle = cpuinfo.cpu_ticks[CPU_STATE_IDLE];
+    return 0;
+}
+
+// Mach solo distingue user, nice, system e idle por procesador
+static int mach_read_cpu_cores(CpuCoreTicks *cores)
+{
+    natural_t cpu_count;
+    processor_info_array_t info;
+    mach_msg_type_number_t info_count;
+    if (COUNT_SYSCALL(host_processor_info(mach_host_port, PROCESSOR_CPU_LOAD_INFO, &cpu_count, &info, &info_count)) != KERN_SUCCESS)
+    {
+        return -1;
+    }
+    const processor_cpu_load_info_data_t *load = (const processor_cpu_load_info_data_t *)info;
+    int n = MIN((int)cpu_count, CPU_MAX_CORES);
+    for (int c = 0; c < n; c++)
+    {
+        cores->ticks[CORE_USER][c] = load[c].cpu_ticks[CPU_STATE_USER] + load[c].cpu_ticks[CPU_STATE_NICE];
+        cores->ticks[CORE_SYSTEM][c] = load[c].cpu_ticks[CPU_STATE_SYSTEM];
+        cores->ticks[CORE_IDLE][c] = load[c].cpu_ticks[CPU_STATE_IDLE];
+        cores->ticks[CORE_IOWAIT][c] = 0;
+        cores->ticks[CORE_IRQ][c] = 0;
+        cores->ticks[CORE_STEAL][c] = 0;
+    }
+    cores->count = n;
+    cores->all.total = cores->all.idle = 0;
+    for (int c = 0; c < n; c++)
+    {
+        for (int st = 0; st < CORE_STATES; st++)
+            cores->all.total += cores->ticks[st][c];
+        cores->all.idle += cores->ticks[CORE_IDLE][c];
+    }
+    COUNT_SYSCALL(vm_deallocate(mach_task_self(), (vm_address_t)info, info_count * sizeof(integer_t)));
+    return 0;
+}
+
+// Contadores por interfaz desde getifaddrs: las entradas AF_LINK traen un if_data
+// con contadores de 32 bits, por eso se informa counter_bits = 32
+static int mach_read_net(NetStats *stats)
+{
+    struct ifaddrs *ifap;
+    if (COUNT_SYSCALL(getifaddrs(&ifap)) != 0)
+    {
+        return -1;
+    }
+    stats->count = stats->overflow = 0;
+    stats->counter_bits = 32;
+    for (struct ifaddrs *ifa = ifap; ifa; ifa = ifa->ifa_next)
+    {
+        if (!ifa->ifa_addr || ifa->ifa_addr->sa_family != AF_LINK || !ifa->ifa_data)
+            continue;
+        const struct if_data *data = (const struct if_data *)ifa->ifa_data;
+        NetIfCounters c;
+        snprintf(c.name, sizeof(c.name), "%s", ifa->ifa_name);
+        c.flags = ifa->ifa_flags;
+        c.rx_bytes = data->ifi_ibytes;
+        c.tx_bytes = data->ifi_obytes;
+        c.rx_packets = data->ifi_ipackets;
+        c.tx_packets = data->ifi_opackets;
+        c.rx_errors = data->ifi_ierrors;
+        c.tx_errors = data->ifi_oerrors;
+        c.rx_dropped = data->ifi_iqdrops;
+        c.tx_dropped = 0;
+        net_stats_add(stats, &c);
+    }
+    freeifaddrs(ifap);
+    return 0;
+}
+
+static mach_timebase_info_data_t mach_timebase;
+
+// Enumera con proc_listpids; la información BSD (nombre, uid, inicio) solo se pide
+// para PIDs nuevos y en el resto se refresca PROC_PIDTASKINFO (CPU y memoria)
+static int mach_scan_processes(ProcTable *table)
+{
+    static pid_t *pids = NULL;
+    static int pids_capacity = 0;
+
+    int needed = COUNT_SYSCALL(proc_listpids(PROC_ALL_PIDS, 0, NULL, 0)) / (int)sizeof(pid_t) + 64;
+    if (needed > pids_capacity)
+    {
+        pid_t *grown = realloc(pids, needed * sizeof(pid_t));
+        if (!grown)
+            return -1;
+        pids = grown;
+        pids_capacity = needed;
+    }
+    int count = COUNT_SYSCALL(proc_listpids(PROC_ALL_PIDS, 0, pids, pids_capacity * sizeof(pid_t))) / (int)sizeof(pid_t);
+    if (count <= 0)
+        return -1;
+    if (mach_timebase.denom == 0)
+        mach_timebase_info(&mach_timebase);
+
+    table->generation++;
+    for (int i = 0; i < count; i++)
+    {
+        if (pids[i] <= 0)
+            continue;
+        int is_new;
+        ProcEntry *e = proc_table_upsert(table, pids[i], &is_new);
+        if (!e)
+            return -1;
+
+        if (is_new)
+        {
+            struct proc_bsdinfo bsd;
+            if (COUNT_SYSCALL(proc_pidinfo(pids[i], PROC_PIDTBSDINFO, 0, &bsd, sizeof(bsd))) == (int)sizeof(bsd))
+            {
+                snprintf(e->name, sizeof(e->name), "%s", bsd.pbi_name[0] ? bsd.pbi_name : bsd.pbi_comm);
+                e->uid = bsd.pbi_uid;
+                e->ppid = bsd.pbi_ppid;
+                e->start_ms = (unsigned long long)bsd.pbi_start_tvsec * 1000 + bsd.pbi_start_tvusec / 1000;
+            }
+        }
+
+        struct proc_taskinfo ti;
+        if (COUNT_SYSCALL(proc_pidinfo(pids[i], PROC_PIDTASKINFO, 0, &ti, sizeof(ti))) == (int)sizeof(ti))
+        {
+            // Los tiempos vienen en unidades de mach_absolute_time
+            e->cpu_time_ns = (ti.pti_total_user + ti.pti_total_system) * mach_timebase.numer / mach_timebase.denom;
+            e->rss_bytes = ti.pti_resident_size;
+            e->state = ti.pti_numrunning > 0 ? 'R' : 'S';
+        }
+        if (table->want_io)
+        {
+            struct rusage_info_v2 ru;
+            if (COUNT_SYSCALL(proc_pid_rusage(pids[i], RUSAGE_INFO_V2, (rusage_info_t *)&ru)) == 0)
+                e->io_bytes = ru.ri_diskio_bytesread + ru.ri_diskio_byteswritten;
+        }
+        e->generation = table->generation;
+    }
+    proc_table_sweep(table);
+    return 0;
+}
+
+// macOS no calcula PSS ni expone la swap por proceso sin el puerto de la tarea
+// (task_for_pid exige privilegios). proc_pid_rusage da la huella física, que es la
+// memoria que el kernel le atribuye al proceso: se muestra como USS.
+static int mach_read_proc_memory(int pid, ProcMemory *mem)
+{
+    struct rusage_info_v2 ru;
+    if (COUNT_SYSCALL(proc_pid_rusage(pid, RUSAGE_INFO_V2, (rusage_info_t *)&ru)) != 0)
+        return -1;
+    mem->rss = ru.ri_resident_size;
+    mem->pss = PROC_MEM_UNKNOWN;
+    mem->uss = ru.ri_phys_footprint;
+    mem->swap = PROC_MEM_UNKNOWN;
+    return 0;
+}
+
+static unsigned long long cf_dict_ull(CFDictionaryRef dict, CFStringRef key)
+{
+    unsigned long long value = 0;
+    CFNumberRef number = CFDictionaryGetValue(dict, key);
+    if (number)
+        CFNumberGetValue(number, kCFNumberSInt64Type, &value);
+    return value;
+}
+
+// Estadísticas de cada IOBlockStorageDriver; el nombre BSD sale del IOMedia hijo.
+// IOKit no expone tiempo activo ni cola: quedan como DISK_UNKNOWN.
+static int mach_read_disk_io(DiskIoStats *stats)
+{
+    io_iterator_t drivers;
+    if (COUNT_SYSCALL(IOServiceGetMatchingServices(MACH_PORT_NULL, IOServiceMatching("IOBlockStorageDriver"), &drivers)) != KERN_SUCCESS)
+        return -1;
+    stats->count = 0;
+    io_registry_entry_t driver;
+    while ((driver = IOIteratorNext(drivers)) != 0)
+    {
+        io_registry_entry_t media = 0;
+        CFDictionaryRef st = COUNT_SYSCALL(IORegistryEntryCreateCFProperty(driver, CFSTR(kIOBlockStorageDriverStatisticsKey), kCFAllocatorDefault, 0));
+        CFStringRef bsd = NULL;
+        if (st && COUNT_SYSCALL(IORegistryEntryGetChildEntry(driver, kIOServicePlane, &media)) == KERN_SUCCESS)
+            bsd = COUNT_SYSCALL(IORegistryEntryCreateCFProperty(media, CFSTR(kIOBSDNameKey), kCFAllocatorDefault, 0));
+        if (st && bsd && stats->count < DISK_MAX_DEVICES)
+        {
+            DiskIoCounters *d = &stats->devices[stats->count];
+            memset(d, 0, sizeof(*d));
+            if (CFStringGetCString(bsd, d->name, sizeof(d->name), kCFStringEncodingUTF8))
+            {
+                d->reads = cf_dict_ull(st, CFSTR(kIOBlockStorageDriverStatisticsReadsKey));
+                d->writes = cf_dict_ull(st, CFSTR(kIOBlockStorageDriverStatisticsWritesKey));
+                d->read_bytes = cf_dict_ull(st, CFSTR(kIOBlockStorageDriverStatisticsBytesReadKey));
+                d->write_bytes = cf_dict_ull(st, CFSTR(kIOBlockStorageDriverStatisticsBytesWrittenKey));
+                d->read_ms = cf_dict_ull(st, CFSTR(kIOBlockStorageDriverStatisticsTotalReadTimeKey)) / 1000000;
+                d->write_ms = cf_dict_ull(st, CFSTR(kIOBlockStorageDriverStatisticsTotalWriteTimeKey)) / 1000000;
+                d->busy_ms = d->queue_ms = DISK_UNKNOWN;
+                stats->count++;
+            }
+        }
+        if (bsd)
+            CFRelease(bsd);
+        if (st)
+            CFRelease(st);
+        if (media)
+            IOObjectRelease(media);
+        IOObjectRelease(driver);
+    }
+    IOObjectRelease(drivers);
+    return 0;
+}
+
+// getfsstat trae la lista y el espacio de todos los montajes en una sola llamada,
+// así que no hace falta esperar un aviso de cambios como en Linux
+static int mach_read_mounts(MountList *mounts)
+{
+    static struct statfs fs[64];
+    int n = COUNT_SYSCALL(getfsstat(fs, sizeof(fs), MNT_NOWAIT));
+    if (n < 0)
+        return -1;
+    mounts->count = 0;
+    for (int i = 0; i < n && mounts->count < DISK_MAX_MOUNTS; i++)
+    {
+        // Los volúmenes de sistema ocultos (VM, Preboot, Update) llevan MNT_DONTBROWSE
+        if (!(fs[i].f_flags & MNT_LOCAL) || (fs[i].f_flags & MNT_DONTBROWSE) || strncmp(fs[i].f_mntfromname, "/dev/", 5) != 0)
+            continue;
+        MountEntry *m = &mounts->mounts[mounts->count++];
+        memset(m, 0, sizeof(*m));
+        snprintf(m->mount_point, sizeof(m->mount_point), "%s", fs[i].f_mntonname);
+        snprintf(m->device, sizeof(m->device), "%s", fs[i].f_mntfromname + 5);
+        snprintf(m->fstype, sizeof(m->fstype), "%s", fs[i].f_fstypename);
+        mount_entry_fill(m, fs[i].f_blocks, fs[i].f_bfree, fs[i].f_bavail, fs[i].f_bsize);
+    }
+    return 0;
+}
+
+// macOS no tiene PSI: el panel de presión no aparece
+static int mach_read_pressure(PressureStats *stats)
+{
+    stats->valid = stats->cgroup_valid = 0;
+    return -1;
+}
+
+static int mach_watch_pressure(int *fds, int max)
+{
+    (void)fds;
+    (void)max;
+    return 0;
+}
+
+static int mach_read_cgroup(CgroupStats *stats)
+{
+    stats->info.valid = 0;
+    return -1;
+}
+
+// macOS no expone la frecuencia de cada núcleo sin privilegios (powermetrics usa una
+// interfaz privada); queda la nominal de hw.cpufrequency en el panel de CPU
+static int mach_read_cpu_freq(CpuFreqStats *stats)
+{
+    stats->count = 0;
+    return -1;
+}
+
+// Los Mac son UMA: un solo nodo, que ya es el panel de RAM
+static int mach_read_numa(NumaStats *stats)
+{
+    stats->count = 0;
+    return -1;
+}
+
+static void mach_collector_close(void)
+{
+    if (mach_smc)
+        IOServiceClose(mach_smc);
+    mach_smc = 0;
+    mach_port_deallocate(mach_task_self(), mach_host_port);
+    mach_host_port = MACH_PORT_NULL;
+}
+
+static const Collector mach_collector = {
+    "macOS",
+    mach_collector_open,
+    mach_read_memory,
+    mach_read_vmstat,
+    mach_read_cpu_ticks,
+    mach_read_cpu_cores,
+    mach_read_cpu_freq,
+    mach_read_net,
+    mach_scan_processes,
+    mach_read_proc_memory,
+    mach_read_sensors,
+    mach_read_disk_io,
+    mach_read_mounts,
+    mach_read_pressure,
+    mach_watch_pressure,
+    mach_read_cgroup,
+    mach_read_numa,
+    mach_collector_close,
+};
+
+static const Collector *collector = &mach_collector;
+
+#elif defined(__linux__)
+
+// --- BACKEND /proc (Linux) ---
+
+#define PROC_READ_BUFSIZE 8192
+
+// Lee un archivo de /proc ya abierto desde el inicio; /proc regenera el contenido en cada pread
+static ssize_t read_proc_fd(int fd, char *buf, size_t buflen)
+{
+    ssize_t n = COUNT_SYSCALL(pread(fd, buf, buflen - 1, 0));
+    if (n < 0)
+        return -1;
+    buf[n] = '\0';
+    return n;
+}
+
+// Recorre líneas "Clave: valor" y guarda en values[i] el número que sigue a keys[i].
+// Un solo pase sobre el buffer, sin fscanf ni búsquedas repetidas.
+static void parse_key_values(const char *buf, const char *const *keys, unsigned long long *values, int nkeys)
+{
+    const char *line = buf;
+    while (*line)
+    {
+        const char *sep = line;
+        while (*sep && *sep != ':' && *sep != ' ' && *sep != '\n')
+            sep++;
+        size_t key_len = sep - line;
+        for (int i = 0; i < nkeys; i++)
+        {
+            if (strncmp(line, keys[i], key_len) == 0 && keys[i][key_len] == '\0')
+            {
+                values[i] = strtoull(*sep ? sep + 1 : sep, NULL, 10);
+                break;
+            }
+        }
+        const char *next = strchr(sep, '\n');
+        if (!next)
+            break;
+        line = next + 1;
+    }
+}
+
+static int linux_meminfo_fd = -1;
+static int linux_stat_fd = -1;
+static int linux_swaps_fd = -1;
+static int linux_vmstat_fd = -1;
+static int linux_netdev_fd = -1;
+static int linux_diskstats_fd = -1;
+static int linux_mountinfo_fd = -1;
+static int linux_mounts_parsed = 0;
+static int linux_netlink_fd = -1;
+static unsigned int linux_netlink_seq = 0;
+static int linux_proc_dir_fd = -1;
+static long linux_clk_tck = 100;
+static long linux_page_size = 4096;
+static unsigned long long linux_boot_time_ms = 0;
+static const char *linux_proc_root = "/proc"; // --proc-root / --sys-root: árbol de prueba
+static const char *linux_sysfs_root = "/sys";
+
+// Lee un archivo chico de sysfs de una vez (nombre, etiqueta, topología) sin el salto final
+static int read_sysfs_line(const char *path, char *buf, size_t len)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+    ssize_t n = read(fd, buf, len - 1);
+    close(fd);
+    if (n <= 0)
+        return -1;
+    buf[n] = '\0';
+    buf[strcspn(buf, "\n")] = '\0';
+    return 0;
+}
+
+// Orden estable dentro de un controlador: tipo, núcleo y etiqueta (readdir no garantiza orden)
+static int sensor_compare(const void *a, const void *b)
+{
+    const Sensor *x = a, *y = b;
+    if (x->kind != y->kind)
+        return (int)x->kind - (int)y->kind;
+    if (x->core != y->core)
+        return x->core - y->core;
+    return strcmp(x->label, y->label);
+}
+
+// Agrega los sensores de un directorio hwmon: tempN_input, fanN_input y powerN_input
+// (o powerN_average). Los archivos quedan abiertos para leerlos con pread.
+static void linux_open_hwmon_dir(SensorSet *set, const char *dir, const char *chip)
+{
+    DIR *d = opendir(dir);
+    if (!d)
+        return;
+    int first = set->count;
+    int package = -1;
+    struct dirent *de;
+    while ((de = readdir(d)) != NULL)
+    {
+        char type[8], suffix[16];
+        int index;
+        if (sscanf(de->d_name, "%7[a-z]%d_%15s", type, &index, suffix) != 3)
+            continue;
+
+        SensorKind kind;
+        double scale;
+        if (strcmp(type, "temp") == 0 && strcmp(suffix, "input") == 0)
+            kind = SENSOR_TEMP, scale = 0.001; // miligrados
+        else if (strcmp(type, "fan") == 0 && strcmp(suffix, "input") == 0)
+            kind = SENSOR_FAN, scale = 1;
+        else if (strcmp(type, "power") == 0 && (strcmp(suffix, "input") == 0 || strcmp(suffix, "average") == 0))
+            kind = SENSOR_POWER, scale = 0.000001; // microvatios
+        else
+            continue;
+
+        // Una ruta truncada abriría otro archivo: esos sensores se saltean
+        char path[PATH_MAX], label[SENSOR_LABEL_LEN];
+        if (kind == SENSOR_POWER && strcmp(suffix, "average") == 0)
+        {
+            if (snprintf(path, sizeof(path), "%s/power%d_input", dir, index) >= (int)sizeof(path))
+                continue;
+            if (access(path, R_OK) == 0)
+                continue; // Se prefiere la lectura instantánea
+        }
+        if (snprintf(path, sizeof(path), "%s/%s%d_label", dir, type, index) >= (int)sizeof(path) ||
+            read_sysfs_line(path, label, sizeof(label)) != 0)
+            snprintf(label, sizeof(label), "%s%d", type, index);
+
+        if (snprintf(path, sizeof(path), "%s/%s", dir, de->d_name) >= (int)sizeof(path))
+            continue;
+        int fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            continue;
+        Sensor *sn = sensor_add(set, kind, chip, label);
+        if (!sn)
+        {
+            close(fd);
+            break;
+        }
+        sn->fd = fd;
+        sn->scale = scale;
+        sscanf(label, "Package id %d", &package);
+        sscanf(label, "Core %d", &sn->core);
+    }
+    closedir(d);
+    qsort(set->sensors + first, set->count - first, sizeof(Sensor), sensor_compare);
+
+    // coretemp tiene un hwmon por paquete: "Package id N" identifica a todos sus núcleos
+    if (package >= 0)
+        for (int i = first; i < set->count; i++)
+            set->sensors[i].package = package;
+}
+
+// Prioridad de un sensor como temperatura principal del CPU (0 = no es del CPU)
+static int linux_cpu_sensor_score(const Sensor *sn)
+{
+    if (sn->kind != SENSOR_TEMP)
+        return 0;
+    if (strcmp(sn->chip, "coretemp") == 0 && strncmp(sn->label, "Package", 7) == 0)
+        return 100;
+    if (strcmp(sn->chip, "k10temp") == 0 || strcmp(sn->chip, "zenpower") == 0)
+        return strcmp(sn->label, "Tdie") == 0 ? 95 : strcmp(sn->label, "Tctl") == 0 ? 90 : 50;
+    if (strcmp(sn->chip, "x86_pkg_temp") == 0)
+        return 80;
+    if (strstr(sn->chip, "cpu"))
+        return 70;
+    if (strcmp(sn->chip, "acpitz") == 0)
+        return 10;
+    return 0;
+}
+
+// Enumera /sys/class/hwmon; si no aporta temperaturas, /sys/class/thermal. Después asocia
+// cada CPU lógica con el sensor de su núcleo físico (coretemp) usando la topología.
+static void linux_open_sensors(SensorSet *set)
+{
+    sensor_set_reset(set);
+    char path[PATH_MAX], name[32];
+
+    snprintf(path, sizeof(path), "%s/class/hwmon", linux_sysfs_root);
+    DIR *d = opendir(path);
+    while (d)
+    {
+        struct dirent *de = readdir(d);
+        if (!de)
+            break;
+        if (strncmp(de->d_name, "hwmon", 5) != 0)
+            continue;
+        snprintf(path, sizeof(path), "%s/class/hwmon/%s/name", linux_sysfs_root, de->d_name);
+        if (read_sysfs_line(path, name, sizeof(name)) != 0)
+            snprintf(name, sizeof(name), "%.31s", de->d_name);
+        snprintf(path, sizeof(path), "%s/class/hwmon/%s", linux_sysfs_root, de->d_name);
+        linux_open_hwmon_dir(set, path, name);
+    }
+    if (d)
+        closedir(d);
+
+    int have_temps = 0;
+    for (int i = 0; i < set->count; i++)
+        have_temps |= set->sensors[i].kind == SENSOR_TEMP;
+    if (!have_temps)
+    {
+        snprintf(path, sizeof(path), "%s/class/thermal", linux_sysfs_root);
+        d = opendir(path);
+        while (d)
+        {
+            struct dirent *de = readdir(d);
+            if (!de)
+                break;
+            if (strncmp(de->d_name, "thermal_zone", 12) != 0)
+                continue;
+            snprintf(path, sizeof(path), "%s/class/thermal/%s/type", linux_sysfs_root, de->d_name);
+            if (read_sysfs_line(path, name, sizeof(name)) != 0)
+                continue;
+            snprintf(path, sizeof(path), "%s/class/thermal/%s/temp", linux_sysfs_root, de->d_name);
+            int fd = open(path, O_RDONLY | O_CLOEXEC);
+            if (fd < 0)
+                continue;
+            Sensor *sn = sensor_add(set, SENSOR_TEMP, name, de->d_name);
+            if (!sn)
+            {
+                close(fd);
+                break;
+            }
+            sn->fd = fd;
+            sn->scale = 0.001;
+        }
+        if (d)
+            closedir(d);
+    }
+
+    int best = 0;
+    for (int i = 0; i < set->count; i++)
+    {
+        int score = linux_cpu_sensor_score(&set->sensors[i]);
+        if (score > best)
+            best = score, set->cpu_main = i;
+    }
+
+    for (int cpu = 0; cpu < CPU_MAX_CORES; cpu++)
+    {
+        char value[16];
+        snprintf(path, sizeof(path), "%s/devices/system/cpu/cpu%d/topology/core_id", linux_sysfs_root, cpu);
+        if (read_sysfs_line(path, value, sizeof(value)) != 0)
+            break;
+        int core_id = atoi(value);
+        snprintf(path, sizeof(path), "%s/devices/system/cpu/cpu%d/topology/physical_package_id", linux_sysfs_root, cpu);
+        int package_id = read_sysfs_line(path, value, sizeof(value)) == 0 ? atoi(value) : 0;
+        for (int i = 0; i < set->count; i++)
+        {
+            const Sensor *sn = &set->sensors[i];
+            if (sn->kind == SENSOR_TEMP && sn->core == core_id && sn->package == package_id)
+            {
+                set->cpu_sensor[cpu] = i;
+                break;
+            }
+        }
+    }
+}
+
+static int linux_read_sensors(SensorReadings *out)
+{
+    char buf[32];
+    for (int i = 0; i < sensor_set.count; i++)
+    {
+        const Sensor *sn = &sensor_set.sensors[i];
+        ssize_t n = COUNT_SYSCALL(pread(sn->fd, buf, sizeof(buf) - 1, 0));
+        if (n <= 0)
+        {
+            out->value[i] = NAN;
+            continue;
+        }
+        buf[n] = '\0';
+        out->value[i] = (float)(strtoll(buf, NULL, 10) * sn->scale);
+    }
+    out->count = sensor_set.count;
+    return 0;
+}
+
+// cgroup v2. Con --cgroup se observa un cgroup (por defecto el propio): sus archivos se
+// abren una vez y se releen con pread. Con --cgroup-children también se abren los de
+// cada hijo directo, y la lista se vuelve a armar solo cuando inotify avisa que se creó
+// o se borró un subdirectorio.
+static const char *linux_cgroup_arg = NULL; // --cgroup: ruta dentro de la jerarquía, "" = el propio
+static int linux_cgroup_children = 0;       // --cgroup-children
+
+// Los hijos solo abren los primeros CG_CHILD_FILES
+enum
+{
+    CG_MEMORY_CURRENT,
+    CG_CPU_STAT,
+    CG_IO_STAT,
+    CG_CHILD_FILES,
+    CG_MEMORY_MAX = CG_CHILD_FILES,
+    CG_MEMORY_HIGH,
+    CG_MEMORY_STAT,
+    CG_SWAP_CURRENT,
+    CG_SWAP_MAX,
+    CG_CPU_MAX,
+    CG_IO_MAX,
+    CG_FILES
+};
+
+static const char *const cgroup_files[CG_FILES] = {
+    [CG_MEMORY_CURRENT] = "memory.current",
+    [CG_CPU_STAT] = "cpu.stat",
+    [CG_IO_STAT] = "io.stat",
+    [CG_MEMORY_MAX] = "memory.max",
+    [CG_MEMORY_HIGH] = "memory.high",
+    [CG_MEMORY_STAT] = "memory.stat",
+    [CG_SWAP_CURRENT] = "memory.swap.current",
+    [CG_SWAP_MAX] = "memory.swap.max",
+    [CG_CPU_MAX] = "cpu.max",
+    [CG_IO_MAX] = "io.max",
+};
+
+static const char *const cgroup_cpu_keys[] = {"usage_usec", "user_usec", "system_usec", "nr_periods", "nr_throttled", "throttled_usec"};
+static const char *const cgroup_io_keys[CGROUP_IO_LIMITS] = {"rbytes", "wbytes", "rios", "wios"};
+static const char *const cgroup_io_max_keys[CGROUP_IO_LIMITS] = {"rbps", "wbps", "riops", "wiops"};
+
+typedef struct
+{
+    char name[CGROUP_NAME_LEN];
+    int fd[CG_FILES]; // -1 si el controlador no está habilitado
+} LinuxCgroup;
+
+static int linux_cgroup_dir_fd = -1;
+static char linux_cgroup_path[CGROUP_PATH_LEN];
+// Todos los hijos directos quedan con memory.current abierto; cpu.stat e io.stat solo los
+// que están entre los CGROUP_CHILD_MAX con más memoria, así el costo no crece con ellos
+typedef struct
+{
+    LinuxCgroup cg;
+    char dir[NAME_MAX + 1]; // cg.name puede venir truncado
+    unsigned long long memory;
+} LinuxCgroupKid;
+
+static LinuxCgroup linux_cgroup;
+static LinuxCgroupKid *linux_cgroup_kids;
+static int linux_cgroup_kid_count = 0;
+static int linux_cgroup_kid_capacity = 0;
+static int linux_cgroup_inotify_fd = -1;
+static int linux_cgroup_cpus = 0; // cpuset.cpus.effective
+
+// Ruta del cgroup v2 propio según self/cgroup ("0::/ruta")
+static int linux_self_cgroup(char *out, size_t len)
+{
+    char buf[1024];
+    int fd = openat(linux_proc_dir_fd, "self/cgroup", O_RDONLY | O_CLOEXEC);
+    ssize_t n = fd >= 0 ? read_proc_fd(fd, buf, sizeof(buf)) : -1;
+    if (fd >= 0)
+        close(fd);
+    if (n < 0)
+        return -1;
+    const char *line = strstr(buf, "0::");
+    if (!line || (line != buf && line[-1] != '\n'))
+        return -1;
+    snprintf(out, len, "%.*s", (int)strcspn(line + 3, "\n"), line + 3);
+    return 0;
+}
+
+// Directorio de un cgroup v2 dado por su ruta dentro de la jerarquía, montada sola (v2
+// puro) o en unified (híbrido). Solo cuenta si tiene cgroup.controllers.
+static int linux_open_cgroup_dir(const char *cgroup, char *path, size_t len)
+{
+    static const char *const mounts[] = {"fs/cgroup", "fs/cgroup/unified"};
+    for (size_t m = 0; m < sizeof(mounts) / sizeof(mounts[0]); m++)
+    {
+        snprintf(path, len, "%s/%s%s", linux_sysfs_root, mounts[m], strcmp(cgroup, "/") == 0 ? "" : cgroup);
+        int fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd >= 0 && faccessat(fd, "cgroup.controllers", F_OK, 0) == 0)
+            return fd;
+        if (fd >= 0)
+            close(fd);
+    }
+    return -1;
+}
+
+// Lista de CPUs ("0-3,8,10-11"): devuelve cuántas hay y, si owner no es NULL, anota
+// value en owner[cpu] para cada una
+static int cpu_list_count(const char *list, signed char *owner, int value)
+{
+    int count = 0;
+    while (*list && *list != '\n')
+    {
+        char *end;
+        long lo = strtol(list, &end, 10), hi = lo;
+        if (end == list)
+            break;
+        if (*end == '-')
+            hi = strtol(end + 1, &end, 10);
+        count += hi - lo + 1;
+        for (long c = MAX(lo, 0); owner && c <= hi && c < CPU_MAX_CORES; c++)
+            owner[c] = (signed char)value;
+        list = *end == ',' ? end + 1 : end;
+    }
+    return count;
+}
+
+static void linux_cgroup_files_open(int dir_fd, LinuxCgroup *cg, int nfiles)
+{
+    for (int f = 0; f < CG_FILES; f++)
+        cg->fd[f] = f < nfiles ? openat(dir_fd, cgroup_files[f], O_RDONLY | O_CLOEXEC) : -1;
+}
+
+static void linux_cgroup_files_close(LinuxCgroup *cg)
+{
+    for (int f = 0; f < CG_FILES; f++)
+    {
+        if (cg->fd[f] >= 0)
+            close(cg->fd[f]);
+        cg->fd[f] = -1;
+    }
+}
+
+static void linux_cgroup_scan_children(void)
+{
+    for (int i = 0; i < linux_cgroup_kid_count; i++)
+        linux_cgroup_files_close(&linux_cgroup_kids[i].cg);
+    linux_cgroup_kid_count = 0;
+
+    int fd = openat(linux_cgroup_dir_fd, ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    DIR *dir = fd >= 0 ? fdopendir(fd) : NULL;
+    if (!dir)
+    {
+        if (fd >= 0)
+            close(fd);
+        return;
+    }
+    struct dirent *de;
+    while ((de = readdir(dir)))
+    {
+        if (de->d_type != DT_DIR || de->d_name[0] == '.')
+            continue;
+        if (linux_cgroup_kid_count == linux_cgroup_kid_capacity)
+        {
+            int capacity = linux_cgroup_kid_capacity ? linux_cgroup_kid_capacity * 2 : 32;
+            LinuxCgroupKid *kids = realloc(linux_cgroup_kids, (size_t)capacity * sizeof(*kids));
+            if (!kids)
+                break;
+            linux_cgroup_kids = kids;
+            linux_cgroup_kid_capacity = capacity;
+        }
+        int kid_fd = openat(linux_cgroup_dir_fd, de->d_name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (kid_fd < 0)
+            continue;
+        LinuxCgroupKid *kid = &linux_cgroup_kids[linux_cgroup_kid_count++];
+        snprintf(kid->dir, sizeof(kid->dir), "%s", de->d_name);
+        snprintf(kid->cg.name, sizeof(kid->cg.name), "%.*s", CGROUP_NAME_LEN - 1, de->d_name);
+        linux_cgroup_files_open(kid_fd, &kid->cg, CG_MEMORY_CURRENT + 1);
+        kid->memory = 0;
+        close(kid_fd);
+    }
+    closedir(dir);
+}
+
+// --cgroup: sin un cgroup v2 que observar el modo contenedor no arranca
+static int linux_open_cgroup(void)
+{
+    if (!linux_cgroup_arg)
+        return 0;
+    if (*linux_cgroup_arg)
+        snprintf(linux_cgroup_path, sizeof(linux_cgroup_path), "%s", linux_cgroup_arg);
+    else if (linux_self_cgroup(linux_cgroup_path, sizeof(linux_cgroup_path)) != 0)
+    {
+        fprintf(stderr, "No se encontró el cgroup v2 propio en %s/self/cgroup\n", linux_proc_root);
+        return -1;
+    }
+    char path[PATH_MAX];
+    linux_cgroup_dir_fd = linux_open_cgroup_dir(linux_cgroup_path, path, sizeof(path));
+    if (linux_cgroup_dir_fd < 0)
+    {
+        fprintf(stderr, "No hay un cgroup v2 %s bajo %s/fs/cgroup\n", linux_cgroup_path, linux_sysfs_root);
+        return -1;
+    }
+    linux_cgroup_files_open(linux_cgroup_dir_fd, &linux_cgroup, CG_FILES);
+
+    char buf[256];
+    int fd = openat(linux_cgroup_dir_fd, "cpuset.cpus.effective", O_RDONLY | O_CLOEXEC);
+    linux_cgroup_cpus = fd >= 0 && read_proc_fd(fd, buf, sizeof(buf)) > 0 ? cpu_list_count(buf, NULL, 0) : 0;
+    if (fd >= 0)
+        close(fd);
+    if (linux_cgroup_cpus <= 0)
+        linux_cgroup_cpus = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (linux_cgroup_children)
+    {
+        linux_cgroup_inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (linux_cgroup_inotify_fd >= 0 && inotify_add_watch(linux_cgroup_inotify_fd, path, IN_CREATE | IN_DELETE | IN_ONLYDIR) < 0)
+        {
+            close(linux_cgroup_inotify_fd);
+            linux_cgroup_inotify_fd = -1;
+        }
+        linux_cgroup_scan_children();
+    }
+    return 0;
+}
+
+// memory.current, memory.max, ...: un número o "max"
+static int linux_cgroup_read_value(int fd, unsigned long long *value)
+{
+    char buf[64];
+    if (fd < 0 || read_proc_fd(fd, buf, sizeof(buf)) <= 0)
+        return -1;
+    *value = strncmp(buf, "max", 3) == 0 ? CGROUP_UNLIMITED : strtoull(buf, NULL, 10);
+    return 0;
+}
+
+// Líneas "8:0 rbytes=1 wbytes=2 ..." de io.stat e io.max: suma cada clave sobre todos los
+// dispositivos. En io.max "max" no suma; una clave sin ningún límite queda en
+// CGROUP_UNLIMITED.
+static void linux_cgroup_parse_io(const char *buf, const char *const *keys, unsigned long long *sum, int limits)
+{
+    for (int k = 0; k < CGROUP_IO_LIMITS; k++)
+        sum[k] = limits ? CGROUP_UNLIMITED : 0;
+    const char *tok = buf + strspn(buf, " \n");
+    while (*tok)
+    {
+        size_t len = strcspn(tok, " \n");
+        const char *eq = memchr(tok, '=', len);
+        for (int k = 0; eq && k < CGROUP_IO_LIMITS; k++)
+        {
+            if ((size_t)(eq - tok) != strlen(keys[k]) || strncmp(tok, keys[k], eq - tok) != 0 || strncmp(eq + 1, "max", 3) == 0)
+                continue;
+            unsigned long long v = strtoull(eq + 1, NULL, 10);
+            sum[k] = sum[k] == CGROUP_UNLIMITED ? v : sum[k] + v;
+        }
+        tok += len;
+        tok += strspn(tok, " \n");
+    }
+}
+
+static void linux_cgroup_read_counters(const LinuxCgroup *cg, CgroupCounters *c)
+{
+    char buf[PROC_READ_BUFSIZE];
+    memset(c, 0, sizeof(*c));
+    snprintf(c->name, sizeof(c->name), "%s", cg->name);
+    linux_cgroup_read_value(cg->fd[CG_MEMORY_CURRENT], &c->memory_current);
+
+    unsigned long long cpu[6] = {0};
+    if (cg->fd[CG_CPU_STAT] >= 0 && read_proc_fd(cg->fd[CG_CPU_STAT], buf, sizeof(buf)) > 0)
+        parse_key_values(buf, cgroup_cpu_keys, cpu, 6);
+    c->cpu_usage_us = cpu[0];
+    c->cpu_user_us = cpu[1];
+    c->cpu_system_us = cpu[2];
+    c->nr_periods = cpu[3];
+    c->nr_throttled = cpu[4];
+    c->throttled_us = cpu[5];
+
+    unsigned long long io[CGROUP_IO_LIMITS] = {0};
+    if (cg->fd[CG_IO_STAT] >= 0 && read_proc_fd(cg->fd[CG_IO_STAT], buf, sizeof(buf)) >= 0)
+        linux_cgroup_parse_io(buf, cgroup_io_keys, io, 0);
+    c->io_rbytes = io[0];
+    c->io_wbytes = io[1];
+    c->io_rios = io[2];
+    c->io_wios = io[3];
+}
+
+static int compare_cgroup_kid_memory(const void *a, const void *b)
+{
+    unsigned long long x = ((const LinuxCgroupKid *)a)->memory, y = ((const LinuxCgroupKid *)b)->memory;
+    return x > y ? -1 : x < y;
+}
+
+// Lee memory.current de todos los hijos, los ordena de mayor a menor y completa los
+// contadores de los primeros CGROUP_CHILD_MAX. cpu.stat e io.stat se abren al entrar
+// en ese grupo y se cierran al salir.
+static void linux_cgroup_read_children(CgroupStats *stats)
+{
+    for (int i = 0; i < linux_cgroup_kid_count; i++)
+    {
+        LinuxCgroupKid *kid = &linux_cgroup_kids[i];
+        kid->memory = 0;
+        linux_cgroup_read_value(kid->cg.fd[CG_MEMORY_CURRENT], &kid->memory);
+    }
+    qsort(linux_cgroup_kids, linux_cgroup_kid_count, sizeof(LinuxCgroupKid), compare_cgroup_kid_memory);
+
+    stats->child_total = linux_cgroup_kid_count;
+    stats->child_count = MIN(linux_cgroup_kid_count, CGROUP_CHILD_MAX);
+    for (int i = 0; i < linux_cgroup_kid_count; i++)
+    {
+        LinuxCgroupKid *kid = &linux_cgroup_kids[i];
+        for (int f = CG_MEMORY_CURRENT + 1; f < CG_CHILD_FILES; f++)
+        {
+            if (i >= CGROUP_CHILD_MAX && kid->cg.fd[f] >= 0)
+            {
+                close(kid->cg.fd[f]);
+                kid->cg.fd[f] = -1;
+            }
+            else if (i < CGROUP_CHILD_MAX && kid->cg.fd[f] < 0)
+            {
+                char path[NAME_MAX + 32];
+                snprintf(path, sizeof(path), "%s/%s", kid->dir, cgroup_files[f]);
+                kid->cg.fd[f] = openat(linux_cgroup_dir_fd, path, O_RDONLY | O_CLOEXEC);
+            }
+        }
+        if (i < CGROUP_CHILD_MAX)
+            linux_cgroup_read_counters(&kid->cg, &stats->children[i]);
+    }
+}
+
+static int linux_read_cgroup(CgroupStats *stats)
+{
+    if (linux_cgroup_dir_fd < 0)
+    {
+        stats->info.valid = 0;
+        return -1;
+    }
+    // Hijos creados o borrados desde la muestra anterior
+    char events[4096];
+    if (linux_cgroup_inotify_fd >= 0 && read(linux_cgroup_inotify_fd, events, sizeof(events)) > 0)
+    {
+        while (read(linux_cgroup_inotify_fd, events, sizeof(events)) > 0)
+            ;
+        linux_cgroup_scan_children();
+    }
+
+    const LinuxCgroup *cg = &linux_cgroup;
+    CgroupInfo *info = &stats->info;
+    info->valid = 1;
+    snprintf(info->path, sizeof(info->path), "%s", linux_cgroup_path);
+    info->has_memory = cg->fd[CG_MEMORY_CURRENT] >= 0;
+    info->has_swap = cg->fd[CG_SWAP_CURRENT] >= 0;
+    info->has_cpu = cg->fd[CG_CPU_STAT] >= 0;
+    info->has_io = cg->fd[CG_IO_STAT] >= 0;
+    linux_cgroup_read_counters(cg, &stats->self);
+
+    info->memory_max = info->memory_high = info->swap_max = CGROUP_UNLIMITED;
+    info->swap_current = 0;
+    linux_cgroup_read_value(cg->fd[CG_MEMORY_MAX], &info->memory_max);
+    linux_cgroup_read_value(cg->fd[CG_MEMORY_HIGH], &info->memory_high);
+    linux_cgroup_read_value(cg->fd[CG_SWAP_CURRENT], &info->swap_current);
+    linux_cgroup_read_value(cg->fd[CG_SWAP_MAX], &info->swap_max);
+
+    // "kernel" existe desde Linux 5.18; antes se arma con sus partes
+    static const char *const stat_keys[] = {"anon", "file", "kernel", "inactive_file", "slab", "kernel_stack", "pagetables", "percpu"};
+    unsigned long long mem[8] = {0};
+    mem[2] = CGROUP_UNLIMITED;
+    char buf[PROC_READ_BUFSIZE];
+    if (cg->fd[CG_MEMORY_STAT] >= 0 && read_proc_fd(cg->fd[CG_MEMORY_STAT], buf, sizeof(buf)) > 0)
+        parse_key_values(buf, stat_keys, mem, 8);
+    info->anon = mem[0];
+    info->file = mem[1];
+    info->kernel = mem[2] != CGROUP_UNLIMITED ? mem[2] : mem[4] + mem[5] + mem[6] + mem[7];
+    info->inactive_file = mem[3];
+
+    // cpu.max: "cuota período" o "max período"
+    info->cpu_quota = 0;
+    info->cpu_limit = linux_cgroup_cpus;
+    if (cg->fd[CG_CPU_MAX] >= 0 && read_proc_fd(cg->fd[CG_CPU_MAX], buf, sizeof(buf)) > 0 && strncmp(buf, "max", 3) != 0)
+    {
+        char *end;
+        double quota = strtod(buf, &end), period = strtod(end, NULL);
+        if (quota > 0 && period > 0)
+        {
+            info->cpu_quota = 1;
+            info->cpu_limit = MIN(quota / period, (double)linux_cgroup_cpus);
+        }
+    }
+
+    for (int k = 0; k < CGROUP_IO_LIMITS; k++)
+        info->io_max[k] = CGROUP_UNLIMITED;
+    if (cg->fd[CG_IO_MAX] >= 0 && read_proc_fd(cg->fd[CG_IO_MAX], buf, sizeof(buf)) >= 0)
+        linux_cgroup_parse_io(buf, cgroup_io_max_keys, info->io_max, 1);
+
+    linux_cgroup_read_children(stats);
+    return 0;
+}
+
+static void linux_close_cgroup(void)
+{
+    linux_cgroup_files_close(&linux_cgroup);
+    for (int i = 0; i < linux_cgroup_kid_count; i++)
+        linux_cgroup_files_close(&linux_cgroup_kids[i].cg);
+    free(linux_cgroup_kids);
+    linux_cgroup_kids = NULL;
+    linux_cgroup_kid_count = linux_cgroup_kid_capacity = 0;
+    if (linux_cgroup_inotify_fd >= 0)
+        close(linux_cgroup_inotify_fd);
+    if (linux_cgroup_dir_fd >= 0)
+        close(linux_cgroup_dir_fd);
+    linux_cgroup_inotify_fd = linux_cgroup_dir_fd = -1;
+}
+
+// Frecuencia: scaling_cur_freq y los contadores de thermal_throttle de cada núcleo quedan
+// abiertos. En x86 el kernel ya calcula scaling_cur_freq con APERF/MPERF (la media real
+// desde la lectura anterior), así que leer el MSR aparte no agrega nada y pide root.
+static int linux_freq_cur_fd[CPU_MAX_CORES];
+static int linux_freq_throttle_fd[CPU_MAX_CORES];
+static int linux_freq_package_fd[CPU_FREQ_PACKAGES];
+static int linux_freq_governor_fd = -1;
+static CpuFreqStats linux_freq_topology; // count, package y package_count
+
+static unsigned int linux_read_khz(const char *path)
+{
+    char buf[32];
+    return read_sysfs_line(path, buf, sizeof(buf)) == 0 ? (unsigned int)strtoul(buf, NULL, 10) : 0;
+}
+
+static void linux_open_cpu_freq(void)
+{
+    CpuFreqStats *topo = &linux_freq_topology;
+    char path[PATH_MAX], buf[32];
+    int package_ids[CPU_FREQ_PACKAGES];
+    memset(topo, 0, sizeof(*topo));
+    memset(topo->package, -1, sizeof(topo->package));
+    for (int c = 0; c < CPU_MAX_CORES; c++)
+        linux_freq_cur_fd[c] = linux_freq_throttle_fd[c] = -1;
+    for (int p = 0; p < CPU_FREQ_PACKAGES; p++)
+        linux_freq_package_fd[p] = -1;
+
+    int opened = 0;
+    for (int c = 0; c < CPU_MAX_CORES; c++)
+    {
+        snprintf(path, sizeof(path), "%s/devices/system/cpu/cpu%d", linux_sysfs_root, c);
+        if (access(path, F_OK) != 0)
+            continue; // Núcleo inexistente o hueco en la numeración
+        topo->count = c + 1;
+
+        snprintf(path, sizeof(path), "%s/devices/system/cpu/cpu%d/cpufreq/scaling_cur_freq", linux_sysfs_root, c);
+        linux_freq_cur_fd[c] = open(path, O_RDONLY | O_CLOEXEC);
+        snprintf(path, sizeof(path), "%s/devices/system/cpu/cpu%d/thermal_throttle/core_throttle_count", linux_sysfs_root, c);
+        linux_freq_throttle_fd[c] = open(path, O_RDONLY | O_CLOEXEC);
+
+        // El contador de paquete es el mismo para todos sus núcleos: se abre una vez por paquete
+        snprintf(path, sizeof(path), "%s/devices/system/cpu/cpu%d/topology/physical_package_id", linux_sysfs_root, c);
+        if (read_sysfs_line(path, buf, sizeof(buf)) == 0)
+        {
+            int id = atoi(buf), p = 0;
+            while (p < topo->package_count && package_ids[p] != id)
+                p++;
+            if (p == topo->package_count && p < CPU_FREQ_PACKAGES)
+            {
+                package_ids[p] = id;
+                snprintf(path, sizeof(path), "%s/devices/system/cpu/cpu%d/thermal_throttle/package_throttle_count", linux_sysfs_root, c);
+                linux_freq_package_fd[p] = open(path, O_RDONLY | O_CLOEXEC);
+                topo->package_count++;
+            }
+            if (p < topo->package_count)
+                topo->package[c] = (signed char)p;
+        }
+        opened |= linux_freq_cur_fd[c] >= 0 || linux_freq_throttle_fd[c] >= 0;
+    }
+    snprintf(path, sizeof(path), "%s/devices/system/cpu/cpu0/cpufreq/scaling_governor", linux_sysfs_root);
+    linux_freq_governor_fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (!opened)
+        topo->count = 0;
+}
+
+// Un número en texto de un archivo de sysfs ya abierto; CPU_FREQ_UNKNOWN si no se puede leer
+static unsigned long long linux_read_sysfs_ull(int fd)
+{
+    char buf[32];
+    if (fd < 0 || read_proc_fd(fd, buf, sizeof(buf)) <= 0)
+        return CPU_FREQ_UNKNOWN;
+    return strtoull(buf, NULL, 10);
+}
+
+static int linux_read_cpu_freq(CpuFreqStats *stats)
+{
+    const CpuFreqStats *topo = &linux_freq_topology;
+    if (topo->count == 0)
+    {
+        stats->count = 0;
+        return -1;
+    }
+    for (int c = 0; c < topo->count; c++)
+    {
+        unsigned long long khz = linux_read_sysfs_ull(linux_freq_cur_fd[c]);
+        stats->cur_khz[c] = khz == CPU_FREQ_UNKNOWN ? 0 : (unsigned int)khz;
+        stats->core_throttle[c] = linux_read_sysfs_ull(linux_freq_throttle_fd[c]);
+        stats->package[c] = topo->package[c];
+    }
+    for (int p = 0; p < topo->package_count; p++)
+        stats->package_throttle[p] = linux_read_sysfs_ull(linux_freq_package_fd[p]);
+    stats->package_count = topo->package_count;
+    stats->governor[0] = '\0';
+    char buf[CPU_GOVERNOR_LEN];
+    if (linux_freq_governor_fd >= 0 && read_proc_fd(linux_freq_governor_fd, buf, sizeof(buf)) > 0)
+    {
+        buf[strcspn(buf, "\n")] = '\0';
+        snprintf(stats->governor, sizeof(stats->governor), "%s", buf);
+    }
+    stats->count = topo->count;
+    return 0;
+}
+
+static void linux_close_cpu_freq(void)
+{
+    for (int c = 0; c < linux_freq_topology.count; c++)
+    {
+        if (linux_freq_cur_fd[c] >= 0)
+            close(linux_freq_cur_fd[c]);
+        if (linux_freq_throttle_fd[c] >= 0)
+            close(linux_freq_throttle_fd[c]);
+    }
+    for (int p = 0; p < linux_freq_topology.package_count; p++)
+        if (linux_freq_package_fd[p] >= 0)
+            close(linux_freq_package_fd[p]);
+    if (linux_freq_governor_fd >= 0)
+        close(linux_freq_governor_fd);
+    linux_freq_governor_fd = -1;
+    linux_freq_topology.count = linux_freq_topology.package_count = 0;
+}
+
+// NUMA: meminfo y numastat de cada nodo quedan abiertos; la lista de CPUs de cada nodo
+// no cambia mientras corre el monitor y se lee una sola vez
+static int linux_numa_meminfo_fd[NUMA_MAX_NODES];
+static int linux_numa_numastat_fd[NUMA_MAX_NODES];
+static NumaStats linux_numa_topology; // id, cpu_count y cpu_node
+
+static int compare_int(const void *a, const void *b)
+{
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+#define NUMA_SCAN_NODES 1024 // MAX_NUMNODES del kernel
+
+static void linux_open_numa(void)
+{
+    NumaStats *topo = &linux_numa_topology;
+    char path[PATH_MAX], buf[1024];
+    memset(topo, 0, sizeof(*topo));
+    memset(topo->cpu_node, -1, sizeof(topo->cpu_node));
+    snprintf(path, sizeof(path), "%s/devices/system/node", linux_sysfs_root);
+    DIR *dir = opendir(path);
+    if (!dir)
+        return;
+    // readdir no devuelve los nodos en orden: se leen todos y se quedan los de menor id
+    int ids[NUMA_SCAN_NODES], found = 0;
+    struct dirent *de;
+    while ((de = readdir(dir)) != NULL && found < NUMA_SCAN_NODES)
+    {
+        if (strncmp(de->d_name, "node", 4) != 0 || !isdigit((unsigned char)de->d_name[4]))
+            continue;
+        ids[found++] = atoi(de->d_name + 4);
+    }
+    closedir(dir);
+    qsort(ids, found, sizeof(int), compare_int);
+    topo->count = MIN(found, NUMA_MAX_NODES);
+    for (int i = 0; i < topo->count; i++)
+        topo->nodes[i].id = ids[i];
+
+    for (int i = 0; i < topo->count; i++)
+    {
+        NumaNodeCounters *n = &topo->nodes[i];
+        snprintf(path, sizeof(path), "%s/devices/system/node/node%d/cpulist", linux_sysfs_root, n->id);
+        if (read_sysfs_line(path, buf, sizeof(buf)) == 0)
+            n->cpu_count = cpu_list_count(buf, topo->cpu_node, i);
+        snprintf(path, sizeof(path), "%s/devices/system/node/node%d/meminfo", linux_sysfs_root, n->id);
+        linux_numa_meminfo_fd[i] = open(path, O_RDONLY | O_CLOEXEC);
+        snprintf(path, sizeof(path), "%s/devices/system/node/node%d/numastat", linux_sysfs_root, n->id);
+        linux_numa_numastat_fd[i] = open(path, O_RDONLY | O_CLOEXEC);
+    }
+}
+
+// Las líneas de meminfo de un nodo llevan el prefijo "Node N "
+static void linux_numa_parse_meminfo(const char *buf, NumaNodeCounters *n)
+{
+    static const char *const keys[] = {"MemTotal", "MemFree", "FilePages", "AnonPages"};
+    unsigned long long kb[4] = {0};
+    for (const char *line = buf; *line;)
+    {
+        const char *key = line;
+        if (strncmp(key, "Node ", 5) == 0)
+        {
+            key += 5;
+            while (isdigit((unsigned char)*key))
+                key++;
+            while (*key == ' ')
+                key++;
+        }
+        size_t key_len = strcspn(key, ":\n");
+        for (int i = 0; i < 4; i++)
+        {
+            if (strncmp(key, keys[i], key_len) == 0 && keys[i][key_len] == '\0' && key[key_len] == ':')
+            {
+                kb[i] = strtoull(key + key_len + 1, NULL, 10);
+                break;
+            }
+        }
+        const char *next = strchr(key, '\n');
+        if (!next)
+            break;
+        line = next + 1;
+    }
+    n->total = kb[0] * 1024;
+    n->free = kb[1] * 1024;
+    n->file = kb[2] * 1024;
+    n->anon = kb[3] * 1024;
+}
+
+static int linux_read_numa(NumaStats *stats)
+{
+    static const char *const numastat_keys[] = {"numa_miss", "numa_foreign"};
+    const NumaStats *topo = &linux_numa_topology;
+    char buf[PROC_READ_BUFSIZE];
+    if (topo->count == 0)
+    {
+        stats->count = 0;
+        return -1;
+    }
+    memcpy(stats->cpu_node, topo->cpu_node, sizeof(stats->cpu_node));
+    for (int i = 0; i < topo->count; i++)
+    {
+        NumaNodeCounters *n = &stats->nodes[i];
+        *n = topo->nodes[i];
+        if (read_proc_fd(linux_numa_meminfo_fd[i], buf, sizeof(buf)) > 0)
+            linux_numa_parse_meminfo(buf, n);
+        unsigned long long counters[2] = {0};
+        if (read_proc_fd(linux_numa_numastat_fd[i], buf, sizeof(buf)) > 0)
+            parse_key_values(buf, numastat_keys, counters, 2);
+        n->numa_miss = counters[0];
+        n->numa_foreign = counters[1];
+    }
+    stats->count = topo->count;
+    return 0;
+}
+
+static void linux_close_numa(void)
+{
+    for (int i = 0; i < linux_numa_topology.count; i++)
+    {
+        if (linux_numa_meminfo_fd[i] >= 0)
+            close(linux_numa_meminfo_fd[i]);
+        if (linux_numa_numastat_fd[i] >= 0)
+            close(linux_numa_numastat_fd[i]);
+    }
+    linux_numa_topology.count = 0;
+}
+
+// Presión: /proc/pressure y los *.pressure del cgroup v2, abiertos una vez.
+// Los disparadores se abren aparte: un descriptor con disparador ya no sirve para leer.
+static int linux_psi_fd[PSI_RESOURCES] = {-1, -1, -1};
+static int linux_cgpsi_fd[PSI_RESOURCES] = {-1, -1, -1};
+static int linux_psi_trigger_fd[PSI_RESOURCES] = {-1, -1, -1};
+static int linux_psi_triggers = -1; // -1: todavía no se intentó registrarlos
+
+// Umbral de cada disparador: demora "some" dentro de una ventana de 1 s
+static const unsigned int psi_trigger_stall_us[PSI_RESOURCES] = {
+    [PSI_CPU] = 500000,
+    [PSI_MEMORY] = 100000,
+    [PSI_IO] = 200000,
+};
+
+// Abre los archivos de presión del cgroup observado con --cgroup o, si no, del cgroup
+// v2 al que pertenece el monitor. El cgroup raíz no los tiene: su presión es la del
+// sistema.
+static void linux_open_cgroup_pressure(void)
+{
+    char cgroup[CGROUP_PATH_LEN], path[PATH_MAX], name[32];
+    int dir_fd = linux_cgroup_dir_fd;
+    if (dir_fd < 0 && linux_self_cgroup(cgroup, sizeof(cgroup)) == 0 && strcmp(cgroup, "/") != 0)
+        dir_fd = linux_open_cgroup_dir(cgroup, path, sizeof(path));
+    if (dir_fd < 0)
+        return;
+    for (int r = 0; r < PSI_RESOURCES; r++)
+    {
+        snprintf(name, sizeof(name), "%s.pressure", psi_names[r]);
+        linux_cgpsi_fd[r] = openat(dir_fd, name, O_RDONLY | O_CLOEXEC);
+    }
+    if (dir_fd != linux_cgroup_dir_fd)
+        close(dir_fd);
+}
+
+static void linux_open_pressure(void)
+{
+    char path[64];
+    for (int r = 0; r < PSI_RESOURCES; r++)
+    {
+        snprintf(path, sizeof(path), "pressure/%s", psi_names[r]);
+        linux_psi_fd[r] = openat(linux_proc_dir_fd, path, O_RDONLY | O_CLOEXEC);
+    }
+    linux_open_cgroup_pressure();
+}
+
+// "some avg10=0.00 avg60=0.00 avg300=0.00 total=0" y la misma línea con "full"
+static int linux_parse_pressure(int fd, PressureEntry *e)
+{
+    char buf[256];
+    memset(e, 0, sizeof(*e));
+    if (fd < 0 || read_proc_fd(fd, buf, sizeof(buf)) <= 0)
+        return -1;
+    for (const char *line = buf; line && *line;)
+    {
+        PressureLine *pl = strncmp(line, "some ", 5) == 0 ? &e->some : strncmp(line, "full ", 5) == 0 ? &e->full : NULL;
+        if (pl)
+            sscanf(line + 5, "avg10=%lf avg60=%lf avg300=%lf total=%llu", &pl->avg10, &pl->avg60, &pl->avg300, &pl->total_us);
+        line = strchr(line, '\n');
+        if (line)
+            line++;
+    }
+    return 0;
+}
+
+static int linux_read_pressure(PressureStats *stats)
+{
+    stats->valid = stats->cgroup_valid = 1;
+    for (int r = 0; r < PSI_RESOURCES; r++)
+    {
+        stats->valid &= linux_parse_pressure(linux_psi_fd[r], &stats->sys[r]) == 0;
+        stats->cgroup_valid &= linux_parse_pressure(linux_cgpsi_fd[r], &stats->cgroup[r]) == 0;
+    }
+    return stats->valid ? 0 : -1;
+}
+
+// Registra un disparador por recurso; el kernel marca el descriptor con POLLPRI cuando
+// la demora supera el umbral dentro de la ventana. Sin privilegios la ventana tiene que
+// ser múltiplo de 2 s: se reintenta así con el umbral escalado.
+static int linux_watch_pressure(int *fds, int max)
+{
+    if (linux_psi_triggers < 0)
+    {
+        linux_psi_triggers = 0;
+        for (int r = 0; r < PSI_RESOURCES && strcmp(linux_proc_root, "/proc") == 0; r++)
+        {
+            char path[64], trigger[48];
+            snprintf(path, sizeof(path), "/proc/pressure/%s", psi_names[r]);
+            for (unsigned int window_us = 1000000; window_us <= 2000000 && linux_psi_trigger_fd[r] < 0; window_us += 1000000)
+            {
+                int fd = open(path, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+                if (fd < 0)
+                    break;
+                int len = snprintf(trigger, sizeof(trigger), "some %u %u", psi_trigger_stall_us[r] * (window_us / 1000000), window_us);
+                if (write(fd, trigger, len + 1) < 0)
+                    close(fd);
+                else
+                    linux_psi_trigger_fd[r] = fd;
+            }
+        }
+    }
+    int n = 0;
+    for (int r = 0; r < PSI_RESOURCES && n < max; r++)
+        if (linux_psi_trigger_fd[r] >= 0)
+            fds[n++] = linux_psi_trigger_fd[r];
+    linux_psi_triggers = n;
+    return n;
+}
+
+static void linux_close_pressure(void)
+{
+    for (int r = 0; r < PSI_RESOURCES; r++)
+    {
+        int *fds[] = {&linux_psi_fd[r], &linux_cgpsi_fd[r], &linux_psi_trigger_fd[r]};
+        for (size_t i = 0; i < sizeof(fds) / sizeof(fds[0]); i++)
+        {
+            if (*fds[i] >= 0)
+                close(*fds[i]);
+            *fds[i] = -1;
+        }
+    }
+    linux_psi_triggers = -1;
+}
+
+static int linux_collector_open(void)
+{
+    linux_proc_dir_fd = open(linux_proc_root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    linux_meminfo_fd = openat(linux_proc_dir_fd, "meminfo", O_RDONLY | O_CLOEXEC);
+    linux_stat_fd = openat(linux_proc_dir_fd, "stat", O_RDONLY | O_CLOEXEC);
+    linux_swaps_fd = openat(linux_proc_dir_fd, "swaps", O_RDONLY | O_CLOEXEC);
+    linux_vmstat_fd = openat(linux_proc_dir_fd, "vmstat", O_RDONLY | O_CLOEXEC);
+    linux_netdev_fd = openat(linux_proc_dir_fd, "net/dev", O_RDONLY | O_CLOEXEC);
+    linux_diskstats_fd = openat(linux_proc_dir_fd, "diskstats", O_RDONLY | O_CLOEXEC);
+    linux_mountinfo_fd = openat(linux_proc_dir_fd, "self/mountinfo", O_RDONLY | O_CLOEXEC);
+    linux_mounts_parsed = 0;
+    linux_clk_tck = sysconf(_SC_CLK_TCK);
+    linux_page_size = sysconf(_SC_PAGESIZE);
+
+    // Socket rtnetlink para volcar los contadores de todas las interfaces en una sola petición.
+    // Con un árbol de prueba las interfaces salen de su net/dev, no del kernel.
+    linux_netlink_fd = strcmp(linux_proc_root, "/proc") == 0 ? socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE) : -1;
+    if (linux_netlink_fd >= 0)
+    {
+        struct sockaddr_nl local = {0};
+        local.nl_family = AF_NETLINK;
+        if (bind(linux_netlink_fd, (struct sockaddr *)&local, sizeof(local)) != 0)
+        {
+            close(linux_netlink_fd);
+            linux_netlink_fd = -1;
+        }
+    }
+    // btime: arranque del sistema en segundos epoch, para convertir el inicio de cada proceso
+    char buf[PROC_READ_BUFSIZE];
+    if (linux_stat_fd >= 0 && read_proc_fd(linux_stat_fd, buf, sizeof(buf)) > 0)
+    {
+        char *btime = strstr(buf, "\nbtime ");
+        if (btime)
+            linux_boot_time_ms = strtoull(btime + 7, NULL, 10) * 1000;
+    }
+
+    // Sin sensores (contenedor, máquina virtual) ni PSI el monitor sigue funcionando
+    linux_open_sensors(&sensor_set);
+    if (linux_open_cgroup() != 0)
+        return -1;
+    linux_open_pressure();
+    linux_open_numa();
+    linux_open_cpu_freq();
+    return (linux_meminfo_fd < 0 || linux_stat_fd < 0) ? -1 : 0;
+}
+
+enum
+{
+    MEMINFO_TOTAL,
+    MEMINFO_FREE,
+    MEMINFO_AVAILABLE,
+    MEMINFO_BUFFERS,
+    MEMINFO_CACHED,
+    MEMINFO_INACTIVE,
+    MEMINFO_UNEVICTABLE,
+    MEMINFO_ZSWAP,
+    MEMINFO_SWAP_TOTAL,
+    MEMINFO_SWAP_FREE,
+    MEMINFO_KEYS
+};
+
+static const char *const meminfo_keys[MEMINFO_KEYS] = {
+    "MemTotal", "MemFree", "MemAvailable", "Buffers", "Cached",
+    "Inactive", "Unevictable", "Zswap", "SwapTotal", "SwapFree",
+};
+
+// Suma tamaño y uso de todos los dispositivos de /proc/swaps (valores en KB)
+static int linux_read_swaps(unsigned long long *total_kb, unsigned long long *used_kb)
+{
+    char buf[PROC_READ_BUFSIZE];
+    if (linux_swaps_fd < 0 || read_proc_fd(linux_swaps_fd, buf, sizeof(buf)) < 0)
+        return -1;
+
+    *total_kb = *used_kb = 0;
+    char *line = strchr(buf, '\n'); // Saltar la cabecera
+    while (line && *++line)
+    {
+        // Filename Type Size Used Priority
+        char *p = line;
+        for (int field = 0; field < 2 && *p; field++)
+        {
+            while (*p && *p != ' ' && *p != '\t')
+                p++;
+            while (*p == ' ' || *p == '\t')
+                p++;
+        }
+        char *end;
+        *total_kb += strtoull(p, &end, 10);
+        *used_kb += strtoull(end, NULL, 10);
+        line = strchr(line, '\n');
+    }
+    return 0;
+}
+
+static int linux_read_memory(MemoryInfo *mem_info)
+{
+    char buf[PROC_READ_BUFSIZE];
+    if (read_proc_fd(linux_meminfo_fd, buf, sizeof(buf)) < 0)
+        return -1;
+
+    unsigned long long kb[MEMINFO_KEYS] = {0};
+    kb[MEMINFO_AVAILABLE] = ~0ULL;
+    parse_key_values(buf, meminfo_keys, kb, MEMINFO_KEYS);
+
+    // Kernels antiguos no exponen MemAvailable: aproximarlo con libre + caches
+    if (kb[MEMINFO_AVAILABLE] == ~0ULL)
+        kb[MEMINFO_AVAILABLE] = kb[MEMINFO_FREE] + kb[MEMINFO_BUFFERS] + kb[MEMINFO_CACHED];
+
+    mem_info->total_ram = kb[MEMINFO_TOTAL] * 1024;
+    mem_info->free_ram = kb[MEMINFO_FREE] * 1024;
+    mem_info->inactive_ram = kb[MEMINFO_INACTIVE] * 1024;
+    mem_info->wired_ram = kb[MEMINFO_UNEVICTABLE] * 1024;
+    mem_info->compressed_ram = kb[MEMINFO_ZSWAP] * 1024;
+    mem_info->used_ram = kb[MEMINFO_TOTAL] > kb[MEMINFO_AVAILABLE] ? (kb[MEMINFO_TOTAL] - kb[MEMINFO_AVAILABLE]) * 1024 : 0;
+
+    unsigned long long swap_total_kb, swap_used_kb;
+    if (linux_read_swaps(&swap_total_kb, &swap_used_kb) != 0)
+    {
+        swap_total_kb = kb[MEMINFO_SWAP_TOTAL];
+        swap_used_kb = kb[MEMINFO_SWAP_TOTAL] - kb[MEMINFO_SWAP_FREE];
+    }
+    mem_info->swap_total = swap_total_kb * 1024;
+    mem_info->swap_used = swap_used_kb * 1024;
+
+    memory_info_finish(mem_info);
+    return 0;
+}
+
+// /proc/vmstat: una línea "nombre valor" por contador (unas 200). Varios nombres suman al
+// mismo contador: allocstall tiene una línea por zona y pgscan una por origen. Los que
+// el kernel no tiene (sin THP ni zswap, versiones viejas) quedan como VM_UNKNOWN.
+static int linux_read_vmstat(VmCounters *vm)
+{
+    static const struct
+    {
+        const char *name;
+        VmCounter counter;
+    } fields[] = {
+        {"pswpin", VM_SWAP_IN},
+        {"pswpout", VM_SWAP_OUT},
+        {"pgmajfault", VM_MAJOR_FAULTS},
+        {"pgfault", VM_MINOR_FAULTS}, // Todos los fallos; abajo se descuentan los mayores
+        {"pgscan_kswapd", VM_PAGE_SCANS},
+        {"pgscan_direct", VM_PAGE_SCANS},
+        {"pgscan_khugepaged", VM_PAGE_SCANS},
+        {"allocstall", VM_DIRECT_RECLAIM}, // Antes de Linux 4.8
+        {"allocstall_dma", VM_DIRECT_RECLAIM},
+        {"allocstall_dma32", VM_DIRECT_RECLAIM},
+        {"allocstall_normal", VM_DIRECT_RECLAIM},
+        {"allocstall_movable", VM_DIRECT_RECLAIM},
+        {"allocstall_device", VM_DIRECT_RECLAIM},
+        {"compact_stall", VM_COMPACT_STALLS},
+        {"thp_fault_alloc", VM_THP_ALLOC},
+        {"thp_collapse_alloc", VM_THP_ALLOC},
+        {"thp_split_page", VM_THP_SPLIT},
+        {"zswpout", VM_COMPRESSIONS},
+        {"zswpin", VM_DECOMPRESSIONS},
+    };
+    static char buf[16384];
+    if (linux_vmstat_fd < 0 || read_proc_fd(linux_vmstat_fd, buf, sizeof(buf)) < 0)
+        return -1;
+
+    for (int i = 0; i < VM_COUNTERS; i++)
+        vm->value[i] = VM_UNKNOWN;
+    for (const char *line = buf; *line;)
+    {
+        const char *sep = strchr(line, ' ');
+        if (!sep)
+            break;
+        size_t key_len = sep - line;
+        for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++)
+        {
+            if (strncmp(line, fields[i].name, key_len) == 0 && fields[i].name[key_len] == '\0')
+            {
+                unsigned long long *v = &vm->value[fields[i].counter];
+                *v = (*v == VM_UNKNOWN ? 0 : *v) + strtoull(sep + 1, NULL, 10);
+                break;
+            }
+        }
+        const char *next = strchr(sep, '\n');
+        if (!next)
+            break;
+        line = next + 1;
+    }
+    unsigned long long *minor = &vm->value[VM_MINOR_FAULTS], major = vm->value[VM_MAJOR_FAULTS];
+    if (*minor != VM_UNKNOWN && major != VM_UNKNOWN)
+        *minor -= MIN(*minor, major);
+    return 0;
+}
+
+static unsigned long long parse_ull(const char **p)
+{
+    const char *s = *p;
+    while (*s == ' ')
+        s++;
+    unsigned long long v = 0;
+    while (*s >= '0' && *s <= '9')
+        v = v * 10 + (unsigned long long)(*s++ - '0');
+    *p = s;
+    return v;
+}
+
+// Primera línea de /proc/stat ("cpu  user nice system idle iowait irq softirq steal ...")
+static int linux_parse_cpu_ticks(const char *buf, CpuTicks *ticks)
+{
+    if (strncmp(buf, "cpu ", 4) != 0)
+        return -1;
+    unsigned long long v[8];
+    const char *p = buf + 4;
+    for (int i = 0; i < 8; i++)
+        v[i] = parse_ull(&p);
+
+    // guest y guest_nice ya están incluidos en user y nice
+    ticks->total = v[0] + v[1] + v[2] + v[3] + v[4] + v[5] + v[6] + v[7];
+    ticks->idle = v[3] + v[4]; // idle + iowait
+    return 0;
+}
+
+static int linux_read_cpu_ticks(CpuTicks *ticks)
+{
+    char buf[512];
+    if (read_proc_fd(linux_stat_fd, buf, sizeof(buf)) < 0)
+        return -1;
+    return linux_parse_cpu_ticks(buf, ticks);
+}
+
+// Líneas "cpuN user nice system idle iowait irq softirq steal ..." de /proc/stat.
+// Los núcleos desconectados no aparecen: el índice sale del número de la línea.
+// La línea agregada sale del mismo buffer: el kernel arma /proc/stat entero (con la
+// línea intr de cada IRQ) en cada lectura, y con cientos de núcleos no conviene hacerlo dos veces.
+static int linux_read_cpu_cores(CpuCoreTicks *cores)
+{
+    static char buf[65536];
+    if (read_proc_fd(linux_stat_fd, buf, sizeof(buf)) < 0 || linux_parse_cpu_ticks(buf, &cores->all) != 0)
+        return -1;
+
+    int count = 0;
+    const char *line = strchr(buf, '\n'); // Saltar la línea agregada
+    while (line && strncmp(line + 1, "cpu", 3) == 0)
+    {
+        const char *p = line + 4;
+        int cpu = (int)parse_ull(&p);
+        if (cpu >= CPU_MAX_CORES)
+            break;
+        unsigned long long v[8];
+        for (int i = 0; i < 8; i++)
+            v[i] = parse_ull(&p);
+        for (; count < cpu; count++) // Núcleos desconectados en el medio
+            for (int st = 0; st < CORE_STATES; st++)
+                cores->ticks[st][count] = 0;
+        cores->ticks[CORE_USER][cpu] = v[0] + v[1];
+        cores->ticks[CORE_SYSTEM][cpu] = v[2];
+        cores->ticks[CORE_IDLE][cpu] = v[3];
+        cores->ticks[CORE_IOWAIT][cpu] = v[4];
+        cores->ticks[CORE_IRQ][cpu] = v[5] + v[6];
+        cores->ticks[CORE_STEAL][cpu] = v[7];
+        count = cpu + 1;
+        line = strchr(p, '\n');
+    }
+    cores->count = count;
+    return count > 0 ? 0 : -1;
+}
+
+// Copia los contadores de 64 bits de un mensaje RTM_NEWLINK
+static void netlink_parse_link(struct nlmsghdr *nh, NetStats *stats)
+{
+    struct ifinfomsg *ifi = NLMSG_DATA(nh);
+    int attr_len = IFLA_PAYLOAD(nh);
+    const char *name = NULL;
+    struct rtnl_link_stats64 st64;
+    int have_stats = 0;
+
+    for (struct rtattr *rta = IFLA_RTA(ifi); RTA_OK(rta, attr_len); rta = RTA_NEXT(rta, attr_len))
+    {
+        if (rta->rta_type == IFLA_IFNAME)
+        {
+            name = RTA_DATA(rta);
+        }
+        else if (rta->rta_type == IFLA_STATS64 && RTA_PAYLOAD(rta) >= sizeof(st64))
+        {
+            memcpy(&st64, RTA_DATA(rta), sizeof(st64)); // El atributo puede no estar alineado a 8
+            have_stats = 1;
+        }
+    }
+    if (!name || !have_stats)
+        return;
+
+    NetIfCounters c;
+    snprintf(c.name, sizeof(c.name), "%s", name);
+    c.flags = ifi->ifi_flags;
+    c.rx_bytes = st64.rx_bytes;
+    c.tx_bytes = st64.tx_bytes;
+    c.rx_packets = st64.rx_packets;
+    c.tx_packets = st64.tx_packets;
+    c.rx_errors = st64.rx_errors;
+    c.tx_errors = st64.tx_errors;
+    c.rx_dropped = st64.rx_dropped;
+    c.tx_dropped = st64.tx_dropped;
+    net_stats_add(stats, &c);
+}
+
+// Un único volcado RTM_GETLINK con IFLA_STATS64 para todas las interfaces
+static int linux_read_net_netlink(NetStats *stats)
+{
+    struct
+    {
+        struct nlmsghdr nh;
+        struct ifinfomsg ifi;
+    } req;
+    memset(&req, 0, sizeof(req));
+    req.nh.nlmsg_len = NLMSG_LENGTH(sizeof(struct ifinfomsg));
+    req.nh.nlmsg_type = RTM_GETLINK;
+    req.nh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    req.nh.nlmsg_seq = ++linux_netlink_seq;
+    req.ifi.ifi_family = AF_UNSPEC;
+
+    if (COUNT_SYSCALL(send(linux_netlink_fd, &req, req.nh.nlmsg_len, 0)) < 0)
+        return -1;
+
+    stats->count = stats->overflow = 0;
+    stats->counter_bits = 64;
+    static char buf[32768] __attribute__((aligned(NLMSG_ALIGNTO)));
+    for (;;)
+    {
+        ssize_t len = COUNT_SYSCALL(recv(linux_netlink_fd, buf, sizeof(buf), 0));
+        if (len <= 0)
+            return -1;
+        for (struct nlmsghdr *nh = (struct nlmsghdr *)buf; NLMSG_OK(nh, (size_t)len); nh = NLMSG_NEXT(nh, len))
+        {
+            if (nh->nlmsg_seq != linux_netlink_seq)
+                continue; // Respuesta de una petición anterior
+            if (nh->nlmsg_type == NLMSG_DONE)
+                return 0;
+            if (nh->nlmsg_type == NLMSG_ERROR)
+                return -1;
+            if (nh->nlmsg_type == RTM_NEWLINK)
+                netlink_parse_link(nh, stats);
+        }
+    }
+}
+
+// Alternativa cuando rtnetlink no está disponible: /proc/net/dev con pread
+static int linux_read_net_procfs(NetStats *stats)
+{
+    char buf[PROC_READ_BUFSIZE];
+    if (linux_netdev_fd < 0 || read_proc_fd(linux_netdev_fd, buf, sizeof(buf)) < 0)
+        return -1;
+
+    stats->count = stats->overflow = 0;
+    stats->counter_bits = 64;
+    char *line = buf;
+    while ((line = strchr(line, '\n')) && *++line)
+    {
+        char *colon = strchr(line, ':');
+        char *eol = strchr(line, '\n');
+        if (!colon || (eol && colon > eol))
+            continue; // Cabeceras
+
+        while (*line == ' ')
+            line++;
+        NetIfCounters slot, *c = &slot;
+        snprintf(c->name, sizeof(c->name), "%.*s", (int)(colon - line), line);
+        c->flags = IFF_UP | (strcmp(c->name, "lo") == 0 ? IFF_LOOPBACK : 0);
+
+        // rx: bytes packets errs drop fifo frame compressed multicast | tx: bytes packets errs drop ...
+        unsigned long long v[12];
+        char *p = colon + 1;
+        for (int i = 0; i < 12; i++)
+            v[i] = strtoull(p, &p, 10);
+        c->rx_bytes = v[0];
+        c->rx_packets = v[1];
+        c->rx_errors = v[2];
+        c->rx_dropped = v[3];
+        c->tx_bytes = v[8];
+        c->tx_packets = v[9];
+        c->tx_errors = v[10];
+        c->tx_dropped = v[11];
+        net_stats_add(stats, c);
+    }
+    return 0;
+}
+
+static int linux_read_net(NetStats *stats)
+{
+    if (linux_netlink_fd >= 0 && linux_read_net_netlink(stats) == 0)
+        return 0;
+    return linux_read_net_procfs(stats);
+}
+
+// Lee un archivo relativo a /proc (p. ej. "1234/stat") con openat + read, sin stdio
+static ssize_t read_proc_at(const char *path, char *buf, size_t buflen)
+{
+    int fd = COUNT_SYSCALL(openat(linux_proc_dir_fd, path, O_RDONLY | O_CLOEXEC));
+    if (fd < 0)
+        return -1;
+    ssize_t n = COUNT_SYSCALL(read(fd, buf, buflen - 1));
+    COUNT_SYSCALL(close(fd));
+    if (n < 0)
+        return -1;
+    buf[n] = '\0';
+    return n;
+}
+
+// Parsea /proc/PID/stat. El nombre va entre paréntesis y puede contener espacios,
+// por eso los campos se cuentan a partir del último ')'.
+static int linux_parse_pid_stat(const char *buf, ProcEntry *e, int is_new, unsigned long long *start_ticks)
+{
+    const char *open_paren = strchr(buf, '(');
+    const char *close_paren = strrchr(buf, ')');
+    if (!open_paren || !close_paren || close_paren[1] != ' ')
+        return -1;
+    if (is_new)
+    {
+        int len = MIN((int)(close_paren - open_paren - 1), PROC_NAME_LEN - 1);
+        memcpy(e->name, open_paren + 1, len);
+        e->name[len] = '\0';
+    }
+
+    // Campo 3 = estado; 4 = ppid; 14/15 = utime/stime; 22 = starttime; 24 = rss (páginas)
+    const char *p = close_paren + 2;
+    e->state = *p;
+    p += 1;
+    unsigned long long utime = 0, stime = 0, rss_pages = 0;
+    char *end;
+    for (int field = 4; field <= 24 && *p; field++)
+    {
+        unsigned long long v = strtoull(p, &end, 10);
+        if (end == p)
+            break;
+        p = end;
+        if (field == 4)
+            e->ppid = (int)v;
+        else if (field == 14)
+            utime = v;
+        else if (field == 15)
+            stime = v;
+        else if (field == 22)
+            *start_ticks = v;
+        else if (field == 24)
+            rss_pages = v;
+    }
+    e->cpu_time_ns = (utime + stime) * (1000000000ULL / linux_clk_tck);
+    e->rss_bytes = rss_pages * linux_page_size;
+    return 0;
+}
+
+struct linux_dirent64
+{
+    unsigned long long d_ino;
+    long long d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+// Recorre /proc con getdents64 sobre un descriptor abierto una sola vez.
+// /proc/PID/stat se lee en cada pasada (contadores); /proc/PID/status solo para PIDs nuevos.
+static int linux_scan_processes(ProcTable *table)
+{
+    if (linux_proc_dir_fd < 0 || COUNT_SYSCALL(lseek(linux_proc_dir_fd, 0, SEEK_SET)) < 0)
+        return -1;
+
+    table->generation++;
+    static char dents[65536];
+    char path[32], buf[1024];
+    for (;;)
+    {
+        long nread = COUNT_SYSCALL(syscall(SYS_getdents64, linux_proc_dir_fd, dents, sizeof(dents)));
+        if (nread < 0)
+            return -1;
+        if (nread == 0)
+            break;
+        for (long off = 0; off < nread;)
+        {
+            struct linux_dirent64 *d = (struct linux_dirent64 *)(dents + off);
+            off += d->d_reclen;
+            if (d->d_name[0] < '1' || d->d_name[0] > '9')
+                continue; // Solo directorios numéricos
+
+            int pid = atoi(d->d_name);
+            snprintf(path, sizeof(path), "%d/stat", pid);
+            if (read_proc_at(path, buf, sizeof(buf)) < 0)
+                continue; // El proceso terminó entre getdents y openat
+
+            int is_new;
+            ProcEntry *e = proc_table_upsert(table, pid, &is_new);
+            if (!e)
+                return -1;
+            unsigned long long start_ticks = 0;
+            if (linux_parse_pid_stat(buf, e, is_new, &start_ticks) != 0)
+                continue;
+            unsigned long long start_ms = linux_boot_time_ms + start_ticks * 1000 / linux_clk_tck;
+            if (!is_new && start_ms != e->start_ms)
+            {
+                // PID reutilizado por otro proceso: releer los datos fijos
+                is_new = 1;
+                e->has_prev = 0;
+                e->mem_ns = 0;
+                linux_parse_pid_stat(buf, e, 1, &start_ticks);
+            }
+            e->start_ms = start_ms;
+
+            if (is_new)
+            {
+                snprintf(path, sizeof(path), "%d/status", pid);
+                if (read_proc_at(path, buf, sizeof(buf)) > 0)
+                {
+                    char *uid = strstr(buf, "\nUid:");
+                    if (uid)
+                        e->uid = (unsigned int)strtoul(uid + 5, NULL, 10);
+                }
+            }
+            if (table->want_io)
+            {
+                // /proc/PID/io solo es legible para procesos propios (o con privilegios)
+                snprintf(path, sizeof(path), "%d/io", pid);
+                if (read_proc_at(path, buf, sizeof(buf)) > 0)
+                {
+                    char *rd = strstr(buf, "read_bytes:");
+                    char *wr = strstr(buf, "\nwrite_bytes:");
+                    e->io_bytes = (rd ? strtoull(rd + 11, NULL, 10) : 0) + (wr ? strtoull(wr + 13, NULL, 10) : 0);
+                }
+            }
+            e->generation = table->generation;
+        }
+    }
+    proc_table_sweep(table);
+    return 0;
+}
+
+// /proc/PID/smaps_rollup (Linux 4.14+) suma todas las regiones del proceso en una sola
+// lectura, pero el kernel recorre sus tablas de páginas para armarla: en procesos grandes
+// cuesta milisegundos. Solo se puede leer con los mismos permisos que ptrace.
+static int linux_read_proc_memory(int pid, ProcMemory *mem)
+{
+    static const char *const keys[] = {"Rss", "Pss", "Private_Clean", "Private_Dirty", "Swap"};
+    unsigned long long kb[5] = {0};
+    char path[32], buf[2048];
+    snprintf(path, sizeof(path), "%d/smaps_rollup", pid);
+    if (read_proc_at(path, buf, sizeof(buf)) <= 0)
+        return -1;
+    parse_key_values(buf, keys, kb, 5);
+    mem->rss = kb[0] * 1024;
+    mem->pss = kb[1] * 1024;
+    mem->uss = (kb[2] + kb[3]) * 1024;
+    mem->swap = kb[4] * 1024;
+    return 0;
+}
+
+static MountList linux_mounts; // Última tabla leída de mountinfo, sin el espacio
+
+// Un loop o ram que no respalda un montaje listado es ruido (snaps, imágenes): con
+// decenas de ellos el disco real quedaba fuera de los DISK_MAX_DEVICES
+static int linux_disk_is_noise(const char *name, int name_len, unsigned int major, unsigned int minor)
+{
+    if (!(name_len > 4 && strncmp(name, "loop", 4) == 0) && !(name_len > 3 && strncmp(name, "ram", 3) == 0))
+        return 0;
+    for (int i = 0; i < linux_mounts.count; i++)
+        if (linux_mounts.mounts[i].major == major && linux_mounts.mounts[i].minor == minor)
+            return 0;
+    return 1;
+}
+
+// /proc/diskstats: "major minor nombre lecturas fusionadas sectores ms escrituras fusionadas
+// sectores ms en_curso ms_activo ms_ponderado ...". Los dispositivos sin actividad y los
+// loop o ram que no respaldan un montaje se omiten.
+static int linux_read_disk_io(DiskIoStats *stats)
+{
+    static char buf[65536];
+    if (read_proc_fd(linux_diskstats_fd, buf, sizeof(buf)) < 0)
+        return -1;
+
+    stats->count = 0;
+    for (const char *line = buf; *line && stats->count < DISK_MAX_DEVICES;)
+    {
+        const char *p = line;
+        unsigned int major = (unsigned int)parse_ull(&p);
+        unsigned int minor = (unsigned int)parse_ull(&p);
+        while (*p == ' ')
+            p++;
+        const char *name = p;
+        while (*p && *p != ' ' && *p != '\n')
+            p++;
+        int name_len = (int)(p - name);
+        unsigned long long v[11];
+        for (int i = 0; i < 11; i++)
+            v[i] = parse_ull(&p);
+        const char *next = strchr(p, '\n');
+        line = next ? next + 1 : p + strlen(p);
+
+        if (v[0] + v[4] == 0 || linux_disk_is_noise(name, name_len, major, minor))
+            continue;
+        DiskIoCounters *d = &stats->devices[stats->count++];
+        snprintf(d->name, sizeof(d->name), "%.*s", name_len, name);
+        d->major = major;
+        d->minor = minor;
+        d->reads = v[0];
+        d->read_bytes = v[2] * 512; // Sectores de 512 bytes sin importar el dispositivo
+        d->read_ms = v[3];
+        d->writes = v[4];
+        d->write_bytes = v[6] * 512;
+        d->write_ms = v[7];
+        d->busy_ms = v[9];
+        d->queue_ms = v[10];
+    }
+    return 0;
+}
+
+// Los campos de mountinfo escapan espacio, tab, \n y \ como \ooo
+static void mountinfo_unescape(const char *in, size_t len, char *out, size_t out_len)
+{
+    size_t o = 0;
+    for (size_t i = 0; i < len && o + 1 < out_len; i++)
+    {
+        if (in[i] == '\\' && i + 3 < len && isdigit((unsigned char)in[i + 1]))
+        {
+            out[o++] = (char)((in[i + 1] - '0') * 64 + (in[i + 2] - '0') * 8 + (in[i + 3] - '0'));
+            i += 3;
+        }
+        else
+            out[o++] = in[i];
+    }
+    out[o] = '\0';
+}
+
+// Sistemas de archivos locales con datos propios: los montados desde /dev (salvo imágenes
+// squashfs) y zfs. Quedan afuera proc, sysfs, tmpfs, cgroup, overlay y también los de red
+// y FUSE remotos (nfs, cifs, sshfs...): con el servidor caído statfs bloquearía al
+// muestreador en cada muestra.
+static int linux_is_real_fs(const char *fstype, const char *source)
+{
+    if (strncmp(source, "/dev/", 5) == 0)
+        return strcmp(fstype, "squashfs") != 0; // fuseblk (ntfs-3g) es local y se queda
+    return strcmp(fstype, "zfs") == 0;
+}
+
+// "id padre major:minor raíz punto_de_montaje opciones [opcionales...] - tipo origen ..."
+static void linux_parse_mountinfo(const char *buf, MountList *mounts)
+{
+    mounts->count = 0;
+    for (const char *line = buf; *line && mounts->count < DISK_MAX_MOUNTS;)
+    {
+        const char *end = strchr(line, '\n');
+        if (!end)
+            end = line + strlen(line);
+        const char *field[5];
+        int len[5], n = 0;
+        const char *p = line;
+        while (n < 5 && p < end)
+        {
+            while (*p == ' ')
+                p++;
+            field[n] = p;
+            while (p < end && *p != ' ')
+                p++;
+            len[n] = (int)(p - field[n]);
+            n++;
+        }
+        const char *sep = strstr(p, " - ");
+        if (n == 5 && sep && sep < end)
+        {
+            char fstype[16], source[64];
+            const char *q = sep + 3;
+            const char *type_end = strchr(q, ' ');
+            if (type_end && type_end < end)
+            {
+                snprintf(fstype, sizeof(fstype), "%.*s", (int)(type_end - q), q);
+                const char *src_end = strchr(type_end + 1, ' ');
+                if (!src_end || src_end > end)
+                    src_end = end;
+                mountinfo_unescape(type_end + 1, src_end - type_end - 1, source, sizeof(source));
+
+                unsigned int major = 0, minor = 0;
+                sscanf(field[2], "%u:%u", &major, &minor);
+                int duplicate = 0; // Montajes bind del mismo dispositivo: alcanza con el primero
+                for (int i = 0; i < mounts->count; i++)
+                    duplicate |= mounts->mounts[i].major == major && mounts->mounts[i].minor == minor;
+                if (!duplicate && linux_is_real_fs(fstype, source))
+                {
+                    MountEntry *m = &mounts->mounts[mounts->count++];
+                    memset(m, 0, sizeof(*m));
+                    mountinfo_unescape(field[4], len[4], m->mount_point, sizeof(m->mount_point));
+                    const char *dev = strncmp(source, "/dev/", 5) == 0 ? source + 5 : source;
+                    snprintf(m->device, sizeof(m->device), "%.31s", dev);
+                    snprintf(m->fstype, sizeof(m->fstype), "%s", fstype);
+                    m->major = major;
+                    m->minor = minor;
+                }
+            }
+        }
+        line = *end ? end + 1 : end;
+    }
+}
+
+// mountinfo avisa con POLLPRI cuando cambió la tabla de montajes: solo entonces se relee.
+// El espacio de cada sistema de archivos sí se consulta en cada muestra.
+static int linux_read_mounts(MountList *mounts)
+{
+    struct pollfd pfd = {linux_mountinfo_fd, POLLPRI, 0};
+    if (linux_mountinfo_fd < 0)
+        return -1;
+    if (!linux_mounts_parsed || (COUNT_SYSCALL(poll(&pfd, 1, 0)) > 0 && (pfd.revents & (POLLPRI | POLLERR))))
+    {
+        static char buf[262144];
+        if (read_proc_fd(linux_mountinfo_fd, buf, sizeof(buf)) < 0)
+            return -1;
+        linux_parse_mountinfo(buf, &linux_mounts);
+        linux_mounts_parsed = 1;
+    }
+    mounts->count = linux_mounts.count;
+    for (int i = 0; i < linux_mounts.count; i++)
+    {
+        MountEntry *m = &mounts->mounts[i];
+        *m = linux_mounts.mounts[i];
+        struct statfs sfs;
+        if (COUNT_SYSCALL(statfs(m->mount_point, &sfs)) == 0)
+            mount_entry_fill(m, sfs.f_blocks, sfs.f_bfree, sfs.f_bavail, sfs.f_bsize);
+    }
+    return 0;
+}
+
+static void linux_collector_close(void)
+{
+    if (linux_meminfo_fd >= 0)
+        close(linux_meminfo_fd);
+    if (linux_stat_fd >= 0)
+        close(linux_stat_fd);
+    if (linux_swaps_fd >= 0)
+        close(linux_swaps_fd);
+    if (linux_vmstat_fd >= 0)
+        close(linux_vmstat_fd);
+    if (linux_netdev_fd >= 0)
+        close(linux_netdev_fd);
+    if (linux_diskstats_fd >= 0)
+        close(linux_diskstats_fd);
+    if (linux_mountinfo_fd >= 0)
+        close(linux_mountinfo_fd);
+    if (linux_netlink_fd >= 0)
+        close(linux_netlink_fd);
+    if (linux_proc_dir_fd >= 0)
+        close(linux_proc_dir_fd);
+    linux_meminfo_fd = linux_stat_fd = linux_swaps_fd = linux_netdev_fd = linux_netlink_fd = linux_proc_dir_fd = -1;
+    linux_diskstats_fd = linux_mountinfo_fd = linux_vmstat_fd = -1;
+    linux_close_pressure();
+    linux_close_cgroup();
+    linux_close_numa();
+    linux_close_cpu_freq();
+    for (int i = 0; i < sensor_set.count; i++)
+        close(sensor_set.sensors[i].fd);
+    sensor_set_reset(&sensor_set);
+}
+
+static const Collector linux_collector = {
+    "Linux",
+    linux_collector_open,
+    linux_read_memory,
+    linux_read_vmstat,
+    linux_read_cpu_ticks,
+    linux_read_cpu_cores,
+    linux_read_cpu_freq,
+    linux_read_net,
+    linux_scan_processes,
+    linux_read_proc_memory,
+    linux_read_sensors,
+    linux_read_disk_io,
+    linux_read_mounts,
+    linux_read_pressure,
+    linux_watch_pressure,
+    linux_read_cgroup,
+    linux_read_numa,
+    linux_collector_close,
+};
+
+static const Collector *collector = &linux_collector;
+
+#endif
+
+// Función para obtener información de memoria con el backend de la plataforma
+int get_memory_info(MemoryInfo *mem_info)
+{
+    return collector->read_memory(mem_info);
+}
+
+// Función para convertir bytes a formato legible
+void format_bytes(unsigned long long bytes, char *buffer)
+{
+    const char *units[] = {"B", "KB", "MB", "GB", "TB"};
+    int unit = 0;
+    double size = bytes;
+
+    while (size >= 1024 && unit < 4)
+    {
+        size /= 1024;
+        unit++;
+    }
+
+    sprintf(buffer, "%.2f %s", size, units[unit]);
+}
+
+// Color según el nivel de uso: verde, amarillo (>60) o rojo (>80)
+static int level_color(double value)
+{
+    if (value > 80)
+        return 3;
+    if (value > 60)
+        return 2;
+    return 1;
+}
+
+// Función para dibujar una barra de progreso
+void draw_progress_bar(WINDOW *win, int y, int x, int width, double percentage, const char *label)
+{
+    int filled = (int)(percentage * width / 100);
+
+    mvwprintw(win, y, x, "%s: [", label);
+
+    // Determinar color basado en el porcentaje
+    int active_color_pair = 1; // Verde por defecto
+    if (has_colors())
+    {
+        if (percentage > 80)
+        {
+            active_color_pair = 3; // Rojo para uso alto
+        }
+        else if (percentage > 60)
+        {
+            active_color_pair = 2; // Amarillo para uso medio
+        }
+        wattron(win, COLOR_PAIR(active_color_pair));
+    }
+
+    // Dibujar la parte llena de la barra
+    for (int i = 0; i < filled; i++)
+    {
+        mvwaddch(win, y, x + strlen(label) + 3 + i, ACS_BLOCK); // Usar ACS_BLOCK para un relleno más sólido
+    }
+
+    if (has_colors())
+    {
+        wattroff(win, COLOR_PAIR(active_color_pair));
+    }
+
+    for (int i = filled; i < width; i++)
+    {
+        mvwaddch(win, y, x + strlen(label) + 3 + i, '-');
+    }
+
+    wprintw(win, "] %.1f%%", percentage); // printw continúa desde la posición actual del cursor
+}
+
+// Función para dibujar un gráfico de uso de memoria tipo Ecualizador
+void draw_memory_graph(WINDOW *win, int start_y, int start_x, MemoryInfo *history_data, int capacity, int oldest_buffer_idx, int current_data_count)
+{
+    int graph_height = 10;
+    int graph_on_screen_width = getmaxx(win) - start_x - 2; // Ancho disponible, -1 para eje Y, -1 para margen derecho
+    if (graph_on_screen_width < 1)
+        graph_on_screen_width = 1;
+
+    int effective_num_points_to_draw = MIN(current_data_count, graph_on_screen_width);
+    if (effective_num_points_to_draw <= 0)
+        return;
+
+    mvwprintw(win, start_y - 1, start_x, "Historial RAM (Ecualizador - %d segs):", effective_num_points_to_draw);
+
+    // Dibujar Eje Y
+    for (int y_offset = 0; y_offset < graph_height; ++y_offset)
+    {
+        mvwaddch(win, start_y + y_offset, start_x - 1, ACS_VLINE);
+    }
+    // Dibujar Eje X
+    for (int x_offset = 0; x_offset < effective_num_points_to_draw; ++x_offset)
+    {
+        mvwaddch(win, start_y + graph_height, start_x + x_offset, ACS_HLINE);
+    }
+    mvwaddch(win, start_y + graph_height, start_x - 1, ACS_LLCORNER); // Esquina
+
+    double max_ram_percentage = 100.0;
+
+    // Determinar el índice del primer dato a leer del buffer para el gráfico
+    int first_buffer_idx_for_render = (oldest_buffer_idx + (current_data_count - effective_num_points_to_draw) + capacity) % capacity;
+
+    for (int screen_col_idx = 0; screen_col_idx < effective_num_points_to_draw; ++screen_col_idx)
+    {
+        int actual_history_buffer_idx = (first_buffer_idx_for_render + screen_col_idx) % capacity;
+        double current_percentage = history_data[actual_history_buffer_idx].ram_percentage;
+
+        if (history_data[actual_history_buffer_idx].total_ram == 0 && current_percentage == 0.0)
+        {
+            current_percentage = 0.0; // Dato no inicializado, tratar como 0%
+        }
+
+        int plot_x = start_x + screen_col_idx;
+        int bar_pixel_height = (int)(current_percentage / max_ram_percentage * graph_height);
+        bar_pixel_height = MAX(0, MIN(graph_height, bar_pixel_height)); // Asegurar que esté dentro de los límites 0..graph_height
+
+        // Dibujar la barra vertical para la columna actual
+        for (int h_row_in_graph = 0; h_row_in_graph < graph_height; ++h_row_in_graph)
+        {
+            // h_row_in_graph = 0 es la fila superior del área del gráfico
+            // h_row_in_graph = graph_height - 1 es la fila inferior del área del gráfico
+            int current_screen_y = start_y + h_row_in_graph;
+
+            // La barra se llena desde abajo hacia arriba.
+            // Si h_row_in_graph es mayor o igual a (graph_height - bar_pixel_height), está dentro de la barra.
+            if (h_row_in_graph >= (graph_height - bar_pixel_height))
+            {
+                mvwaddch(win, current_screen_y, plot_x, ACS_BLOCK); // Carácter para la barra
+            }
+            else
+            {
+                mvwaddch(win, current_screen_y, plot_x, ' '); // Espacio vacío encima de la barra
+            }
+        }
+    }
+}
+
+// --- HISTORIAL POR NIVELES ---
+
+// Cada métrica se acumula en tres niveles de resolución: 1 s durante 10 minutos, 10 s
+// durante 6 horas y 1 min durante 7 días. Cada nivel recibe las muestras crudas
+// directamente (no se recalcula desde el nivel anterior), así que agregar una muestra
+// es O(1) y cambiar de nivel en los gráficos no recorre datos. La estructura no tiene
+// punteros ni memoria dinámica: se puede copiar o mapear tal cual.
+
+#define CPU_HEATMAP_WIDTH 12
+#define HIST_TIERS 3
+#define HIST_TIER0_BUCKETS 600   // 10 min de 1 s
+#define HIST_TIER1_BUCKETS 2160  // 6 h de 10 s
+#define HIST_TIER2_BUCKETS 10080 // 7 días de 1 min
+#define HIST_BUCKETS (HIST_TIER0_BUCKETS + HIST_TIER1_BUCKETS + HIST_TIER2_BUCKETS)
+#define NUMA_HIST_NODES 4 // Nodos con historial propio; el resto solo se ve en el panel
+
+typedef enum
+{
+    HIST_RAM,          // % de RAM usada
+    HIST_CPU,          // % de CPU
+    HIST_SWAP_IO,      // Páginas/s leídas y escritas en la swap
+    HIST_MAJOR_FAULTS, // Fallos mayores/s
+    HIST_CPU_FREQ,     // MHz medios de los núcleos
+    HIST_CPU_THROTTLE, // Límites térmicos/s
+    HIST_NUMA_RAM,     // % de RAM usada de cada nodo NUMA, uno por nodo
+    HIST_METRICS = HIST_NUMA_RAM + NUMA_HIST_NODES
+} HistMetric;
+
+typedef struct
+{
+    unsigned long long period_ns;
+    int capacity;
+    int base; // Primer bucket del nivel dentro de HistoryStore.buckets
+    const char *label;
+} HistTierDef;
+
+static const HistTierDef hist_tiers[HIST_TIERS] = {
+    {1000000000ULL, HIST_TIER0_BUCKETS, 0, "1 s"},
+    {10000000000ULL, HIST_TIER1_BUCKETS, HIST_TIER0_BUCKETS, "10 s"},
+    {60000000000ULL, HIST_TIER2_BUCKETS, HIST_TIER0_BUCKETS + HIST_TIER1_BUCKETS, "1 min"},
+};
+
+typedef struct
+{
+    float min;
+    float max;
+    double sum;
+    unsigned int count; // 0 = sin datos en ese período
+} HistBucket;
+
+typedef struct
+{
+    unsigned long long newest[HIST_TIERS]; // Período (tiempo / period_ns) del bucket más nuevo
+    int filled[HIST_TIERS];                // Buckets en uso, hasta capacity
+    int numa_nodes; // Series HIST_NUMA_RAM en uso: 0 con menos de dos nodos
+    HistBucket buckets[HIST_METRICS][HIST_BUCKETS];
+} HistoryStore;
+
+void hist_reset(HistoryStore *hs)
+{
+    memset(hs, 0, sizeof(*hs));
+}
+
+// Métricas con historial; las series NUMA de más quedan sin tocar
+static int hist_metric_count(const HistoryStore *hs)
+{
+    return HIST_NUMA_RAM + MIN(MAX(hs->numa_nodes, 0), NUMA_HIST_NODES);
+}
+
+// Copia solo las series en uso: el segmento compartido se copia en cada muestra y en un
+// equipo sin NUMA las de los nodos serían casi la mitad
+void hist_copy(HistoryStore *dst, const HistoryStore *src)
+{
+    int metrics = hist_metric_count(src);
+    memcpy(dst, src, offsetof(HistoryStore, buckets));
+    memcpy(dst->buckets, src->buckets, (size_t)metrics * sizeof(src->buckets[0]));
+}
+
+// Agrega una muestra (un valor por métrica) tomada en ts_ns
+void hist_add(HistoryStore *hs, unsigned long long ts_ns, const double values[HIST_METRICS])
+{
+    int metrics = hist_metric_count(hs);
+    for (int t = 0; t < HIST_TIERS; t++)
+    {
+        const HistTierDef *def = &hist_tiers[t];
+        unsigned long long slot = ts_ns / def->period_ns;
+        unsigned long long advance = 0;
+        if (hs->filled[t] == 0)
+        {
+            hs->newest[t] = slot;
+            hs->filled[t] = 1;
+            advance = 1; // Limpiar el primer bucket
+        }
+        else if (slot > hs->newest[t])
+        {
+            advance = slot - hs->newest[t];
+            hs->newest[t] = slot;
+            hs->filled[t] = (int)MIN((unsigned long long)def->capacity, hs->filled[t] + advance);
+        }
+        // Una muestra con tiempo anterior al bucket más nuevo (reloj ajustado) cae en este
+
+        // Los períodos sin muestras quedan vacíos; un hueco largo limpia a lo sumo un nivel entero
+        int to_clear = (int)MIN(advance, (unsigned long long)def->capacity);
+        for (int i = 0; i < to_clear; i++)
+        {
+            int idx = def->base + (int)((hs->newest[t] - i) % def->capacity);
+            for (int m = 0; m < metrics; m++)
+                memset(&hs->buckets[m][idx], 0, sizeof(HistBucket));
+        }
+
+        int idx = def->base + (int)(hs->newest[t] % def->capacity);
+        for (int m = 0; m < metrics; m++)
+        {
+            HistBucket *b = &hs->buckets[m][idx];
+            float v = (float)values[m];
+            if (b->count == 0 || v < b->min)
+                b->min = v;
+            if (b->count == 0 || v > b->max)
+                b->max = v;
+            b->sum += values[m];
+            b->count++;
+        }
+    }
+}
+
+// Bucket del nivel tier, contando hacia atrás desde el más nuevo (age 0). NULL si no existe.
+const HistBucket *hist_bucket(const HistoryStore *hs, int tier, HistMetric metric, int age)
+{
+    const HistTierDef *def = &hist_tiers[tier];
+    if (age < 0 || age >= hs->filled[tier])
+        return NULL;
+    int idx = def->base + (int)((hs->newest[tier] - age) % def->capacity);
+    return &hs->buckets[metric][idx];
+}
+
+// Copia los últimos count buckets en orden cronológico (promedio y máximo; -1 si el
+// período no tiene datos). Devuelve cuántos puntos hay.
+int hist_read(const HistoryStore *hs, int tier, HistMetric metric, int count, double *avg, double *max)
+{
+    int points = MIN(count, hs->filled[tier]);
+    for (int i = 0; i < points; i++)
+    {
+        const HistBucket *b = hist_bucket(hs, tier, metric, points - 1 - i);
+        avg[i] = b->count ? b->sum / b->count : -1;
+        if (max)
+            max[i] = b->count ? b->max : -1;
+    }
+    return points;
+}
+
+// Tiempo que cubre un nivel completo
+unsigned long long hist_span_ns(int tier)
+{
+    return hist_tiers[tier].period_ns * hist_tiers[tier].capacity;
+}
+
+// Uso de CPU entre dos lecturas; 0 si no hay lectura anterior
+static double cpu_ticks_usage(const CpuTicks *last, const CpuTicks *now)
+{
+    double usage = 0.0;
+    if (last->total != 0)
+    {
+        uint64_t diff_total = now->total - last->total;
+        uint64_t diff_idle = now->idle - last->idle;
+        if (diff_total > 0)
+        {
+            usage = 100.0 * (diff_total - diff_idle) / diff_total;
+        }
+    }
+    return usage;
+}
+
+// Función para obtener el uso de CPU (promedio de todos los núcleos)
+double get_cpu_usage()
+{
+    static CpuTicks last = {0, 0};
+    CpuTicks now;
+    if (collector->read_cpu_ticks(&now) != 0)
+    {
+        return 0.0;
+    }
+
+    double usage = cpu_ticks_usage(&last, &now);
+    last = now;
+    return usage;
+}
+
+// Dibuja histograma de memoria con barras ▓ rojas y coordenadas verdes
+// avg y max traen un punto por columna en orden cronológico (-1 = sin datos); el máximo
+// del período se marca sobre la barra del promedio. Ocupa hasta width columnas desde start_x.
+void draw_memory_histogram(WINDOW *win, int start_y, int start_x, int width, const double *avg, const double *max, int count, const char *title)
+{
+    int graph_height = 10;
+    int graph_width = MIN(count, width);
+    if (graph_width <= 0)
+        return;
+
+    mvwprintw(win, start_y - 1, start_x, "%.*s", width, title);
+
+    // Eje Y y coordenadas verdes
+    for (int y = 0; y < graph_height; ++y)
+    {
+        if (has_colors())
+            wattron(win, COLOR_PAIR(5));
+        mvwprintw(win, start_y + y, start_x - 5, "%3d%%", (graph_height - y) * 10);
+        if (has_colors())
+            wattroff(win, COLOR_PAIR(5));
+    }
+
+    // Barras ▓ rojas
+    for (int i = 0; i < graph_width; ++i)
+    {
+        int idx = count - graph_width + i;
+        if (avg[idx] < 0)
+            continue;
+        int bar_height = (int)(avg[idx] / 100.0 * graph_height);
+        int max_height = MAX(bar_height, (int)(max[idx] / 100.0 * graph_height));
+        for (int y = 0; y < graph_height; ++y)
+        {
+            if (y == graph_height - max_height && max_height > bar_height)
+            {
+                if (has_colors())
+                    wattron(win, COLOR_PAIR(2));
+                mvwaddch(win, start_y + y, start_x + i, '-');
+                if (has_colors())
+                    wattroff(win, COLOR_PAIR(2));
+            }
+            else if (y >= graph_height - bar_height)
+            {
+                if (has_colors())
+                    wattron(win, COLOR_PAIR(3));
+                mvwaddch(win, start_y + y, start_x + i, 'X');
+                if (has_colors())
+                    wattroff(win, COLOR_PAIR(3));
+            }
+            else
+            {
+                mvwaddch(win, start_y + y, start_x + i, ' ');
+            }
+        }
+    }
+}
+
+// Dibuja mapa de calor de CPU
+void draw_cpu_heatmap(WINDOW *win, int y, int x, const double *cpu_history, int count, const char *period_label)
+{
+    mvwprintw(win, y - 1, x, "CPU Heatmap (últimos %d x %s):", count, period_label);
+    for (int i = 0; i < count; ++i)
+    {
+        double usage = cpu_history[i];
+        char symbol = ' ';
+        int color = 1;
+        if (usage < 0)
+        {
+            symbol = '.';
+            color = 6; // Sin datos
+        }
+        else if (usage < 40)
+        {
+            symbol = ' ';
+            color = 1; // Verde
+        }
+        else if (usage < 75)
+        {
+            symbol = '#';
+            color = 2; // Amarillo
+        }
+        else
+        {
+            symbol = '@';
+            color = 3; // Rojo
+        }
+        if (has_colors())
+            wattron(win, COLOR_PAIR(color));
+        wprintw(win, "[%c]", symbol);
+        if (has_colors())
+            wattroff(win, COLOR_PAIR(color));
+    }
+}
+
+#define CORE_HISTORY_CAPACITY 120
+
+// Una fila por núcleo a lo largo del tiempo (la más reciente a la derecha), seguida del
+// desglose de la última muestra y, si se conoce (core_temp puede ser NULL), su
+// temperatura. Si no entran todas las filas, cada una agrupa varios núcleos y muestra el
+// más ocupado del grupo para que no se pierdan los picos. Con core_node (NULL fuera de
+// NUMA) los núcleos se ordenan por nodo y ningún grupo mezcla nodos; core_node es un
+// índice y node_id da el número de nodo del sistema para la etiqueta. Con freq (NULL si
+// no se conoce) el desglose suma la frecuencia efectiva, en rojo si el núcleo se limitó.
+void draw_core_heatmap(WINDOW *win, int y, int x, int width, int max_rows, const unsigned char history[][CPU_MAX_CORES],
+                       int newest_idx, int count, int cores, const CpuCoreUsage *latest, const float *core_temp, const signed char *core_node,
+                       const int *node_id, const CpuFreqUsage *freq)
+{
+    if (cores <= 0 || max_rows <= 0 || width < 20)
+        return;
+
+    // Orden de los núcleos: por nodo (los de nodo desconocido al final) conservando el número
+    int order[CPU_MAX_CORES];
+    int node_first[NUMA_MAX_NODES + 2] = {0};
+    int nodes = 1;
+    if (core_node)
+    {
+        nodes = NUMA_MAX_NODES + 1;
+        for (int c = 0; c < cores; c++)
+            node_first[(core_node[c] >= 0 ? core_node[c] : NUMA_MAX_NODES) + 1]++;
+        for (int n = 0; n < nodes; n++)
+            node_first[n + 1] += node_first[n];
+        int next[NUMA_MAX_NODES + 1];
+        memcpy(next, node_first, sizeof(next));
+        for (int c = 0; c < cores; c++)
+            order[next[core_node[c] >= 0 ? core_node[c] : NUMA_MAX_NODES]++] = c;
+    }
+    else
+    {
+        node_first[1] = cores;
+        for (int c = 0; c < cores; c++)
+            order[c] = c;
+    }
+
+    // El grupo más chico con el que entran todas las filas, sin cruzar de un nodo a otro
+    int group = 1, rows;
+    for (;; group++)
+    {
+        rows = 0;
+        for (int n = 0; n < nodes; n++)
+            rows += (node_first[n + 1] - node_first[n] + group - 1) / group;
+        if (rows <= max_rows || group >= cores)
+            break;
+    }
+    rows = MIN(rows, max_rows);
+    int detail_width = group == 1 ? 36 + (core_temp ? 7 : 0) + (freq ? 6 : 0) : 0;
+    int label_width = 8;
+    int cells = MIN(count, width - label_width - detail_width);
+    if (cells <= 0)
+    {
+        detail_width = 0;
+        cells = MIN(count, width - label_width);
+    }
+
+    if (group == 1)
+        mvwprintw(win, y - 1, x, "Por núcleo (%% ocupado, últimas %d muestras):", cells);
+    else
+        mvwprintw(win, y - 1, x, "Por núcleo (máximo de cada %d, últimas %d muestras):", group, cells);
+
+    int node = 0, next_in_node = 0;
+    for (int r = 0; r < rows; r++)
+    {
+        while (next_in_node >= node_first[node + 1])
+            next_in_node = node_first[++node];
+        int begin = next_in_node;
+        int end = MIN(node_first[node + 1], begin + group);
+        next_in_node = end;
+        int first = order[begin];
+        char label[16];
+        if (!core_node)
+            snprintf(label, sizeof(label), group == 1 ? "cpu%d" : "%3d-%d", first, order[end - 1]);
+        else if (node < NUMA_MAX_NODES)
+            snprintf(label, sizeof(label), group == 1 ? "n%d c%d" : "n%d c%d+", node_id[node], first);
+        else
+            snprintf(label, sizeof(label), group == 1 ? "? c%d" : "? c%d+", first);
+        mvwprintw(win, y + r, x, "%-7.7s ", label);
+
+        for (int i = 0; i < cells; i++)
+        {
+            const unsigned char *row = history[(newest_idx - cells + i + CORE_HISTORY_CAPACITY) % CORE_HISTORY_CAPACITY];
+            int busy = 0;
+            for (int k = begin; k < end; k++)
+                busy = MAX(busy, row[order[k]]);
+            char symbol = busy < 40 ? '.' : busy < 75 ? '#' : '@';
+            int color = level_color(busy);
+            if (has_colors())
+                wattron(win, COLOR_PAIR(color));
+            waddch(win, symbol);
+            if (has_colors())
+                wattroff(win, COLOR_PAIR(color));
+        }
+        if (detail_width > 0)
+        {
+            wprintw(win, " us%3.0f sy%3.0f io%3.0f irq%3.0f st%3.0f", latest->pct[CORE_USER][first], latest->pct[CORE_SYSTEM][first],
+                    latest->pct[CORE_IOWAIT][first], latest->pct[CORE_IRQ][first], latest->pct[CORE_STEAL][first]);
+            if (freq && first < freq->count && !isnan(freq->mhz[first]))
+            {
+                int throttled = freq->throttle[first] > 0;
+                if (throttled && has_colors())
+                    wattron(win, COLOR_PAIR(3));
+                wprintw(win, " %4.1fG", freq->mhz[first] / 1000);
+                if (throttled && has_colors())
+                    wattroff(win, COLOR_PAIR(3));
+            }
+            else if (freq)
+                wprintw(win, "     -");
+            if (core_temp && !isnan(core_temp[first]))
+                wprintw(win, " %3.0f°C", core_temp[first]);
+        }
+    }
+}
+
+// --- AGREGADOS PARA RED ---
+
+#define NET_HISTORY_CAPACITY 60
+
+// Tasas de una interfaz calculadas entre dos muestras, con su propio historial
+typedef struct
+{
+    NetIfCounters prev;
+    int has_prev;
+    double rx_rate; // bytes/s
+    double tx_rate;
+    double rx_pps;
+    double tx_pps;
+    unsigned long long rx_errors; // Errores y descartes del último intervalo
+    unsigned long long tx_errors;
+    unsigned long long rx_dropped;
+    unsigned long long tx_dropped;
+    float rx_history[NET_HISTORY_CAPACITY];
+    float tx_history[NET_HISTORY_CAPACITY];
+    int history_idx;
+    int history_count;
+} NetIfRate;
+
+typedef struct
+{
+    int count;
+    NetIfRate ifaces[NET_MAX_INTERFACES];
+    double rx_rate; // Suma de interfaces no loopback, bytes/s
+    double tx_rate;
+    unsigned int overflow_hash; // El de la lectura anterior, para no restar grupos distintos
+} NetRates;
+
+// Obtener contadores de red por interfaz con el backend nativo (sin fork)
+void get_net_stats(NetStats *stats)
+{
+    if (collector->read_net(stats) != 0)
+    {
+        stats->count = 0;
+    }
+    stats->rx_bytes = 0;
+    stats->tx_bytes = 0;
+    for (int i = 0; i < stats->count; i++)
+    {
+        if (stats->ifaces[i].flags & IFF_LOOPBACK)
+            continue;
+        stats->rx_bytes += stats->ifaces[i].rx_bytes;
+        stats->tx_bytes += stats->ifaces[i].tx_bytes;
+    }
+}
+
+// Diferencia entre dos lecturas de un contador. Si el valor bajó, o dio la vuelta
+// (contadores de 32 bits) o se reinició (interfaz recreada, driver recargado):
+// en el segundo caso se cuenta solo lo acumulado desde el reinicio.
+static unsigned long long counter_delta(unsigned long long curr, unsigned long long prev, int bits)
+{
+    if (curr >= prev)
+        return curr - prev;
+    if (bits < 64 && prev - curr > (1ULL << (bits - 1)))
+        return curr + ((1ULL << bits) - prev);
+    return curr;
+}
+
+// Actualiza las tasas por interfaz; las interfaces se emparejan por nombre
+void net_rates_update(NetRates *rates, const NetStats *stats, double elapsed)
+{
+    NetIfRate updated[NET_MAX_INTERFACES];
+    rates->rx_rate = rates->tx_rate = 0;
+
+    for (int i = 0; i < stats->count; i++)
+    {
+        const NetIfCounters *curr = &stats->ifaces[i];
+        NetIfRate *r = &updated[i];
+        memset(r, 0, sizeof(*r));
+        for (int j = 0; j < rates->count; j++)
+        {
+            if (strcmp(rates->ifaces[j].prev.name, curr->name) == 0)
+            {
+                *r = rates->ifaces[j];
+                break;
+            }
+        }
+
+        // Si cambiaron las interfaces agrupadas, la suma no es comparable con la anterior
+        if (stats->overflow && i == stats->count - 1 && stats->overflow_hash != rates->overflow_hash)
+            r->has_prev = 0;
+        if (r->has_prev && elapsed > 0)
+        {
+            int bits = stats->counter_bits;
+            r->rx_rate = counter_delta(curr->rx_bytes, r->prev.rx_bytes, bits) / elapsed;
+            r->tx_rate = counter_delta(curr->tx_bytes, r->prev.tx_bytes, bits) / elapsed;
+            r->rx_pps = counter_delta(curr->rx_packets, r->prev.rx_packets, bits) / elapsed;
+            r->tx_pps = counter_delta(curr->tx_packets, r->prev.tx_packets, bits) / elapsed;
+            r->rx_errors = counter_delta(curr->rx_errors, r->prev.rx_errors, bits);
+            r->tx_errors = counter_delta(curr->tx_errors, r->prev.tx_errors, bits);
+            r->rx_dropped = counter_delta(curr->rx_dropped, r->prev.rx_dropped, bits);
+            r->tx_dropped = counter_delta(curr->tx_dropped, r->prev.tx_dropped, bits);
+
+            r->rx_history[r->history_idx] = (float)r->rx_rate;
+            r->tx_history[r->history_idx] = (float)r->tx_rate;
+            r->history_idx = (r->history_idx + 1) % NET_HISTORY_CAPACITY;
+            if (r->history_count < NET_HISTORY_CAPACITY)
+                r->history_count++;
+
+            if (!(curr->flags & IFF_LOOPBACK))
+            {
+                rates->rx_rate += r->rx_rate;
+                rates->tx_rate += r->tx_rate;
+            }
+        }
+        r->prev = *curr;
+        r->has_prev = 1;
+    }
+
+    // Las interfaces que desaparecieron se descartan junto con su historial
+    memcpy(rates->ifaces, updated, sizeof(NetIfRate) * stats->count);
+    rates->count = stats->count;
+    rates->overflow_hash = stats->overflow ? stats->overflow_hash : 0;
+}
+
+// Dibuja una línea de tendencia con los últimos valores de un historial circular
+void draw_sparkline(WINDOW *win, int y, int x, int width, const float *history, int capacity, int write_idx, int count)
+{
+    static const char levels[] = " .:-=+*#";
+    int points = MIN(count, width);
+    float max_value = 0;
+    for (int i = 0; i < points; ++i)
+    {
+        float v = history[(write_idx - points + i + capacity) % capacity];
+        if (v > max_value)
+            max_value = v;
+    }
+    wmove(win, y, x);
+    for (int i = 0; i < points; ++i)
+    {
+        float v = history[(write_idx - points + i + capacity) % capacity];
+        int level = max_value > 0 ? (int)(v / max_value * (sizeof(levels) - 2)) : 0;
+        waddch(win, levels[level]);
+    }
+}
+
+// Dibuja una fila por interfaz: tasas, errores, descartes y tendencia de bajada
+void draw_net_interfaces(WINDOW *win, int y, int x, int width, int max_rows, const NetRates *rates)
+{
+    char line[160];
+    int row = 0;
+    for (int i = 0; i < rates->count && row < max_rows; i++)
+    {
+        const NetIfRate *r = &rates->ifaces[i];
+        if ((r->prev.flags & IFF_LOOPBACK) || !(r->prev.flags & IFF_UP))
+            continue;
+        if (row == max_rows - 1 && rates->count - i > 1)
+        {
+            mvwprintw(win, y + row, x, "(+%d interfaces)", rates->count - i);
+            break;
+        }
+        int len = snprintf(line, sizeof(line), "%-10.10s v %8.2f ^ %8.2f Mb/s  err %llu/%llu  drop %llu/%llu ",
+                           r->prev.name, r->rx_rate * 8.0 / (1024 * 1024), r->tx_rate * 8.0 / (1024 * 1024),
+                           r->rx_errors, r->tx_errors, r->rx_dropped, r->tx_dropped);
+        mvwaddnstr(win, y + row, x, line, width);
+        if (len < width - 1)
+            draw_sparkline(win, y + row, x + len, MIN(20, width - len), r->rx_history, NET_HISTORY_CAPACITY, r->history_idx, r->history_count);
+        row++;
+    }
+}
+
+// Dibuja barra de red
+void draw_network_bar(WINDOW *win, int y, int x, double value, double max_value, const char *label, int color_pair)
+{
+    int width = 30;
     int filled = (int)((value / max_value) * width);
     if (filled > width)
         filled = width;
-    mvprintw(y, x, "%s: ", label);
+    mvwprintw(win, y, x, "%s: ", label);
+    if (has_colors())
+        wattron(win, COLOR_PAIR(color_pair));
+    for (int i = 0; i < filled; ++i)
+        waddch(win, '#');
+    if (has_colors())
+        wattroff(win, COLOR_PAIR(color_pair));
+    for (int i = filled; i < width; ++i)
+        waddch(win, ' ');
+}
+
+// --- PROCESOS ACTIVOS ---
+
+// Tabla de procesos compartida entre pasadas
+ProcTable proc_table = {0};
+
+// Obtiene el número de procesos activos y los clasifica:
+// durmiendo = fondo; del resto, los de root son de sistema y los demás de usuario
+void get_process_stats(ProcessStats *stats)
+{
+    stats->system = stats->user = stats->background = stats->total = 0;
+    if (!proc_table.slots && proc_table_init(&proc_table, PROC_TABLE_INITIAL_CAPACITY) != 0)
+        return;
+    if (collector->scan_processes(&proc_table) != 0)
+        return;
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    unsigned long long now_ns = (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    double elapsed_ns = proc_table.last_scan_ns ? (double)(now_ns - proc_table.last_scan_ns) : 0;
+    proc_table.last_scan_ns = now_ns;
+
+    for (unsigned int i = 0; i < proc_table.capacity; i++)
+    {
+        ProcEntry *e = &proc_table.slots[i];
+        if (e->pid == 0)
+            continue;
+
+        // %CPU e E/S por diferencia de contadores con la pasada anterior
+        if (e->has_prev && elapsed_ns > 0)
+        {
+            e->cpu_pct = e->cpu_time_ns >= e->prev_cpu_time_ns ? (float)((e->cpu_time_ns - e->prev_cpu_time_ns) / elapsed_ns * 100.0) : 0;
+            e->io_rate = e->io_bytes >= e->prev_io_bytes ? (float)((e->io_bytes - e->prev_io_bytes) / (elapsed_ns / 1e9)) : 0;
+        }
+        else
+        {
+            e->cpu_pct = 0;
+            e->io_rate = 0;
+        }
+        e->prev_cpu_time_ns = e->cpu_time_ns;
+        e->prev_io_bytes = e->io_bytes;
+        e->has_prev = 1;
+
+        if (e->state == 'S')
+            stats->background++;
+        else if (e->uid == 0)
+            stats->system++;
+        else
+            stats->user++;
+    }
+    stats->total = stats->system + stats->user + stats->background;
+}
+
+// Dibuja barras para procesos
+void draw_process_bars(WINDOW *win, int y, int x, ProcessStats *stats)
+{
+    int maxval = stats->system;
+    if (stats->user > maxval)
+        maxval = stats->user;
+    if (stats->background > maxval)
+        maxval = stats->background;
+    int width = 20;
+#define PROC_BAR(val) (maxval > 0 ? (val) * width / maxval : 0)
+    mvwprintw(win, y, x, "Procesos:");
+    mvwprintw(win, y + 1, x, "Sistema: ");
+    for (int i = 0; i < PROC_BAR(stats->system); ++i)
+        waddch(win, ACS_CKBOARD);
+    wprintw(win, "  %d", stats->system);
+    mvwprintw(win, y + 2, x, "Usuario: ");
+    for (int i = 0; i < PROC_BAR(stats->user); ++i)
+        waddch(win, ACS_CKBOARD);
+    wprintw(win, "  %d", stats->user);
+    mvwprintw(win, y + 3, x, "Fondo:   ");
+    for (int i = 0; i < PROC_BAR(stats->background); ++i)
+        waddch(win, ACS_CKBOARD);
+    wprintw(win, "  %d", stats->background);
+    mvwprintw(win, y + 4, x, "Total:   %d", stats->total);
+}
+
+// --- ESPACIO DE DISCO ---
+
+typedef struct
+{
+    unsigned long long total;
+    unsigned long long used;
+    unsigned long long free;
+    double percent_used;
+} DiskStats;
+
+// Obtiene espacio de disco para "/"
+void get_disk_stats(DiskStats *stats)
+{
+    struct statfs sfs;
+    if (COUNT_SYSCALL(statfs("/", &sfs)) == 0)
+    {
+        stats->total = (unsigned long long)sfs.f_blocks * sfs.f_bsize;
+        stats->free = (unsigned long long)sfs.f_bfree * sfs.f_bsize;
+        stats->used = stats->total - stats->free;
+        stats->percent_used = stats->total > 0 ? (double)stats->used / stats->total * 100.0 : 0.0;
+    }
+    else
+    {
+        stats->total = stats->used = stats->free = stats->percent_used = 0;
+    }
+}
+
+// Barra horizontal de disco
+void draw_disk_bar(WINDOW *win, int y, int x, const DiskStats *stats)
+{
+    char used_str[32], total_str[32];
+    format_bytes(stats->used, used_str);
+    format_bytes(stats->total, total_str);
+    int width = 32;
+    int filled = (int)(stats->percent_used * width / 100.0);
+    mvwprintw(win, y, x, "Disco /: [");
+    if (has_colors())
+        wattron(win, COLOR_PAIR(3));
+    for (int i = 0; i < filled; ++i)
+        waddch(win, ACS_CKBOARD);
+    if (has_colors())
+        wattroff(win, COLOR_PAIR(3));
+    for (int i = filled; i < width; ++i)
+        waddch(win, ' ');
+    wprintw(win, "] %.0f%% usado (%s de %s)", stats->percent_used, used_str, total_str);
+}
+
+// Tasas de un dispositivo de bloques entre dos lecturas
+typedef struct
+{
+    DiskIoCounters prev;
+    int has_prev;
+    double read_bps; // bytes/s
+    double write_bps;
+    double read_iops;
+    double write_iops;
+    double await_ms;    // Latencia media por operación del intervalo
+    double queue_depth; // Operaciones en curso en promedio, -1 si no se sabe
+    double util_pct;    // Tiempo ocupado, -1 si no se sabe
+} DiskIoRate;
+
+typedef struct
+{
+    int count;
+    DiskIoRate devices[DISK_MAX_DEVICES];
+} DiskIoRates;
+
+// Actualiza las tasas por dispositivo; los dispositivos se emparejan por nombre
+void disk_io_update(DiskIoRates *rates, const DiskIoStats *stats, double elapsed)
+{
+    DiskIoRate updated[DISK_MAX_DEVICES];
+    for (int i = 0; i < stats->count; i++)
+    {
+        const DiskIoCounters *curr = &stats->devices[i];
+        DiskIoRate *r = &updated[i];
+        memset(r, 0, sizeof(*r));
+        for (int j = 0; j < rates->count; j++)
+        {
+            if (strcmp(rates->devices[j].prev.name, curr->name) == 0)
+            {
+                *r = rates->devices[j];
+                break;
+            }
+        }
+
+        r->queue_depth = r->util_pct = -1;
+        if (r->has_prev && elapsed > 0)
+        {
+            unsigned long long reads = counter_delta(curr->reads, r->prev.reads, 64);
+            unsigned long long writes = counter_delta(curr->writes, r->prev.writes, 64);
+            unsigned long long io_ms = counter_delta(curr->read_ms, r->prev.read_ms, 64) + counter_delta(curr->write_ms, r->prev.write_ms, 64);
+            r->read_bps = counter_delta(curr->read_bytes, r->prev.read_bytes, 64) / elapsed;
+            r->write_bps = counter_delta(curr->write_bytes, r->prev.write_bytes, 64) / elapsed;
+            r->read_iops = reads / elapsed;
+            r->write_iops = writes / elapsed;
+            r->await_ms = reads + writes > 0 ? (double)io_ms / (reads + writes) : 0;
+            if (curr->queue_ms != DISK_UNKNOWN)
+                r->queue_depth = counter_delta(curr->queue_ms, r->prev.queue_ms, 64) / (elapsed * 1000.0);
+            if (curr->busy_ms != DISK_UNKNOWN)
+                r->util_pct = MIN(100.0, counter_delta(curr->busy_ms, r->prev.busy_ms, 64) / (elapsed * 10.0));
+        }
+        r->prev = *curr;
+        r->has_prev = 1;
+    }
+    memcpy(rates->devices, updated, sizeof(DiskIoRate) * stats->count);
+    rates->count = stats->count;
+}
+
+// Dispositivo que respalda un montaje: por major:minor en Linux; en macOS por nombre,
+// donde disk3 cubre también a disk3s1 y disk3s1s1
+const DiskIoRate *disk_io_for_mount(const DiskIoRates *rates, const MountEntry *m)
+{
+    for (int i = 0; i < rates->count; i++)
+    {
+        const DiskIoRate *r = &rates->devices[i];
+        if (m->major || m->minor)
+        {
+            if (r->prev.major == m->major && r->prev.minor == m->minor)
+                return r;
+            continue;
+        }
+        size_t len = strlen(r->prev.name);
+        if (strncmp(m->device, r->prev.name, len) == 0 && (m->device[len] == '\0' || m->device[len] == 's'))
+            return r;
+    }
+    return NULL;
+}
+
+// Barra de ocupación de un sistema de archivos montado
+void draw_mount_bar(WINDOW *win, int y, int x, int width, const MountEntry *m)
+{
+    char used_str[32], total_str[32];
+    format_bytes(m->used, used_str);
+    format_bytes(m->total, total_str);
+    int filled = (int)(m->percent_used * width / 100.0);
+    int color = m->percent_used > 90 ? 3 : m->percent_used > 75 ? 2 : 1;
+    mvwprintw(win, y, x, "%-14.14s [", m->mount_point);
+    if (has_colors())
+        wattron(win, COLOR_PAIR(color));
+    for (int i = 0; i < filled; ++i)
+        waddch(win, ACS_CKBOARD);
+    if (has_colors())
+        wattroff(win, COLOR_PAIR(color));
+    for (int i = filled; i < width; ++i)
+        waddch(win, ' ');
+    wprintw(win, "] %3.0f%% %s/%s", m->percent_used, used_str, total_str);
+}
+
+#define DISK_IO_FORMAT "%-14.14s %10s %5s %10s %5s %7s %5s %4s"
+
+// Una línea de E/S con las columnas de DISK_IO_FORMAT: lectura y escritura por segundo,
+// latencia media, cola y uso
+void draw_disk_io_line(WINDOW *win, int y, int x, const char *device, const DiskIoRate *r)
+{
+    char rd[32], wr[32], rd_ops[16], wr_ops[16], await[16], queue[16], util[16];
+    if (!r)
+    {
+        mvwprintw(win, y, x, "%-14.14s sin estadísticas de E/S", device);
+        return;
+    }
+    format_bytes((unsigned long long)r->read_bps, rd);
+    format_bytes((unsigned long long)r->write_bps, wr);
+    if (r->queue_depth >= 0)
+        snprintf(queue, sizeof(queue), "%.2f", r->queue_depth);
+    else
+        snprintf(queue, sizeof(queue), "-");
+    if (r->util_pct >= 0)
+        snprintf(util, sizeof(util), "%.0f%%", r->util_pct);
+    else
+        snprintf(util, sizeof(util), "-");
+    snprintf(rd_ops, sizeof(rd_ops), "%.0f", r->read_iops);
+    snprintf(wr_ops, sizeof(wr_ops), "%.0f", r->write_iops);
+    snprintf(await, sizeof(await), "%.1fms", r->await_ms);
+    mvwprintw(win, y, x, DISK_IO_FORMAT, device, rd, rd_ops, wr, wr_ops, await, queue, util);
+}
+
+// --- USO DEL CGROUP ---
+
+// Consumo de un cgroup entre dos lecturas
+typedef struct
+{
+    CgroupCounters prev;
+    int has_prev;
+    double cpu_pct;       // Del límite de CPU del cgroup observado
+    double throttled_pct; // Períodos de cpu.max en los que se agotó la cuota
+    double throttled_ms;  // ms por segundo frenado por la cuota
+    double read_bps, write_bps, read_iops, write_iops;
+} CgroupRate;
+
+typedef struct
+{
+    CgroupInfo info;
+    CgroupRate self;
+    int child_count;
+    int child_total; // Hijos directos, aunque solo se sigan los child_count con más memoria
+    CgroupRate children[CGROUP_CHILD_MAX]; // De mayor a menor memoria
+} CgroupUsage;
+
+static void cgroup_rate_update(CgroupRate *r, const CgroupCounters *curr, double elapsed, double cpu_limit)
+{
+    if (r->has_prev && elapsed > 0)
+    {
+        const CgroupCounters *prev = &r->prev;
+        unsigned long long periods = counter_delta(curr->nr_periods, prev->nr_periods, 64);
+        r->cpu_pct = cpu_limit > 0 ? MIN(100.0, counter_delta(curr->cpu_usage_us, prev->cpu_usage_us, 64) / (elapsed * 1e4 * cpu_limit)) : 0;
+        r->throttled_pct = periods > 0 ? 100.0 * counter_delta(curr->nr_throttled, prev->nr_throttled, 64) / periods : 0;
+        r->throttled_ms = counter_delta(curr->throttled_us, prev->throttled_us, 64) / (elapsed * 1000.0);
+        r->read_bps = counter_delta(curr->io_rbytes, prev->io_rbytes, 64) / elapsed;
+        r->write_bps = counter_delta(curr->io_wbytes, prev->io_wbytes, 64) / elapsed;
+        r->read_iops = counter_delta(curr->io_rios, prev->io_rios, 64) / elapsed;
+        r->write_iops = counter_delta(curr->io_wios, prev->io_wios, 64) / elapsed;
+    }
+    r->prev = *curr;
+    r->has_prev = 1;
+}
+
+static int compare_cgroup_memory(const void *a, const void *b)
+{
+    unsigned long long x = ((const CgroupRate *)a)->prev.memory_current, y = ((const CgroupRate *)b)->prev.memory_current;
+    return x > y ? -1 : x < y;
+}
+
+// Actualiza las tasas del cgroup y de sus hijos, que se emparejan por nombre
+void cgroup_usage_update(CgroupUsage *usage, const CgroupStats *stats, double elapsed)
+{
+    usage->info = stats->info;
+    cgroup_rate_update(&usage->self, &stats->self, elapsed, stats->info.cpu_limit);
+
+    CgroupRate updated[CGROUP_CHILD_MAX];
+    for (int i = 0; i < stats->child_count; i++)
+    {
+        const CgroupCounters *curr = &stats->children[i];
+        CgroupRate *r = &updated[i];
+        memset(r, 0, sizeof(*r));
+        for (int j = 0; j < usage->child_count; j++)
+        {
+            if (strcmp(usage->children[j].prev.name, curr->name) == 0)
+            {
+                *r = usage->children[j];
+                break;
+            }
+        }
+        cgroup_rate_update(r, curr, elapsed, stats->info.cpu_limit);
+    }
+    qsort(updated, stats->child_count, sizeof(CgroupRate), compare_cgroup_memory);
+    memcpy(usage->children, updated, sizeof(CgroupRate) * stats->child_count);
+    usage->child_count = stats->child_count;
+    usage->child_total = stats->child_total;
+}
+
+// --- PAGINACIÓN ---
+
+// Nombres de los eventos en el exportador
+static const char *const vm_counter_names[VM_COUNTERS] = {
+    "swap_in", "swap_out", "major_fault", "minor_fault", "page_out", "page_scan",
+    "direct_reclaim", "compact_stall", "thp_alloc", "thp_split", "compression", "decompression",
+};
+
+// Tasas por segundo entre dos lecturas de los contadores de paginación
+typedef struct
+{
+    int valid;                // Hubo una lectura anterior con la que comparar
+    double rate[VM_COUNTERS]; // NAN si el sistema no informa el contador
+} VmRates;
+
+void vm_rates_update(VmRates *rates, const VmCounters *prev, const VmCounters *curr, double elapsed)
+{
+    rates->valid = elapsed > 0;
+    for (int i = 0; i < VM_COUNTERS; i++)
+    {
+        if (!rates->valid || curr->value[i] == VM_UNKNOWN || prev->value[i] == VM_UNKNOWN)
+            rates->rate[i] = NAN;
+        else
+            rates->rate[i] = counter_delta(curr->value[i], prev->value[i], 64) / elapsed;
+    }
+}
+
+// Tasa para los historiales, que no admiten huecos por métrica: 0 si no se conoce
+static double vm_rate_or_zero(const VmRates *rates, VmCounter c)
+{
+    return rates->valid && !isnan(rates->rate[c]) ? rates->rate[c] : 0;
+}
+
+// --- USO POR NODO NUMA ---
+
+typedef struct
+{
+    int id;
+    int cpu_count;
+    unsigned long long total;
+    unsigned long long used; // total - libre: un nodo sin libre asigna en otro aunque tenga caché
+    unsigned long long file;
+    unsigned long long anon;
+    double ram_pct;
+    double cpu_pct;      // Ocupación media de sus núcleos, NAN si no se sabe
+    double miss_rate;    // Páginas/s, NAN sin lectura anterior
+    double foreign_rate;
+    unsigned long long numa_miss; // Acumulados de la lectura anterior
+    unsigned long long numa_foreign;
+} NumaNodeUsage;
+
+typedef struct
+{
+    int count;
+    signed char cpu_node[CPU_MAX_CORES];
+    NumaNodeUsage nodes[NUMA_MAX_NODES];
+} NumaUsage;
+
+void numa_usage_update(NumaUsage *usage, const NumaStats *stats, const CpuCoreUsage *cores, double elapsed)
+{
+    double busy[NUMA_MAX_NODES] = {0};
+    int busy_cores[NUMA_MAX_NODES] = {0};
+    for (int c = 0; c < cores->count; c++)
+    {
+        int node = stats->cpu_node[c];
+        if (node >= 0 && node < stats->count)
+            busy[node] += cores->busy[c], busy_cores[node]++;
+    }
+
+    int same_nodes = usage->count == stats->count && elapsed > 0;
+    for (int i = 0; i < stats->count; i++)
+    {
+        const NumaNodeCounters *n = &stats->nodes[i];
+        NumaNodeUsage *u = &usage->nodes[i];
+        int have_prev = same_nodes && u->id == n->id;
+        u->miss_rate = have_prev ? counter_delta(n->numa_miss, u->numa_miss, 64) / elapsed : NAN;
+        u->foreign_rate = have_prev ? counter_delta(n->numa_foreign, u->numa_foreign, 64) / elapsed : NAN;
+        u->numa_miss = n->numa_miss;
+        u->numa_foreign = n->numa_foreign;
+        u->id = n->id;
+        u->cpu_count = n->cpu_count;
+        u->total = n->total;
+        u->used = n->total - MIN(n->free, n->total);
+        u->file = n->file;
+        u->anon = n->anon;
+        u->ram_pct = n->total ? 100.0 * u->used / n->total : 0;
+        u->cpu_pct = busy_cores[i] ? busy[i] / busy_cores[i] : NAN;
+    }
+    memcpy(usage->cpu_node, stats->cpu_node, sizeof(usage->cpu_node));
+    usage->count = stats->count;
+}
+
+// --- FRECUENCIA POR NÚCLEO ---
+
+// La frecuencia de cada núcleo es la que informó cpufreq; los límites térmicos salen de
+// la diferencia entre lecturas. prev->count es 0 en la primera lectura.
+void cpu_freq_usage(const CpuFreqStats *prev, const CpuFreqStats *cur, double elapsed, CpuFreqUsage *out)
+{
+    int have_prev = prev->count > 0 && elapsed > 0;
+    double package_rate[CPU_FREQ_PACKAGES];
+    out->package_throttle_total = CPU_FREQ_UNKNOWN;
+    for (int p = 0; p < cur->package_count; p++)
+    {
+        int known = cur->package_throttle[p] != CPU_FREQ_UNKNOWN;
+        package_rate[p] = known && have_prev && p < prev->package_count && prev->package_throttle[p] != CPU_FREQ_UNKNOWN
+                              ? counter_delta(cur->package_throttle[p], prev->package_throttle[p], 64) / elapsed
+                              : NAN;
+        if (known)
+            out->package_throttle_total = (out->package_throttle_total == CPU_FREQ_UNKNOWN ? 0 : out->package_throttle_total) + cur->package_throttle[p];
+    }
+
+    double sum = 0, throttle_sum = 0;
+    int known = 0, throttle_known = 0;
+    out->min_mhz = out->max_mhz = 0;
+    out->core_throttle_total = CPU_FREQ_UNKNOWN;
+    for (int c = 0; c < cur->count; c++)
+    {
+        int prev_core = have_prev && c < prev->count;
+        double mhz = cur->cur_khz[c] ? cur->cur_khz[c] / 1000.0 : NAN;
+        out->mhz[c] = (float)mhz;
+        if (!isnan(mhz))
+        {
+            sum += mhz;
+            out->min_mhz = known ? MIN(out->min_mhz, mhz) : mhz;
+            out->max_mhz = known ? MAX(out->max_mhz, mhz) : mhz;
+            known++;
+        }
+
+        // Límites del núcleo más los de su paquete, que lo frenan igual
+        double rate = NAN;
+        if (cur->core_throttle[c] != CPU_FREQ_UNKNOWN)
+        {
+            out->core_throttle_total = (out->core_throttle_total == CPU_FREQ_UNKNOWN ? 0 : out->core_throttle_total) + cur->core_throttle[c];
+            if (prev_core && prev->core_throttle[c] != CPU_FREQ_UNKNOWN)
+                rate = counter_delta(cur->core_throttle[c], prev->core_throttle[c], 64) / elapsed;
+        }
+        int p = cur->package[c];
+        if (p >= 0 && p < cur->package_count && !isnan(package_rate[p]))
+            rate = (isnan(rate) ? 0 : rate) + package_rate[p];
+        out->throttle[c] = (float)rate;
+        if (!isnan(rate))
+            throttle_sum += rate, throttle_known++;
+    }
+    out->avg_mhz = known ? sum / known : 0;
+    out->throttle_rate = throttle_known ? throttle_sum : NAN;
+    memcpy(out->governor, cur->governor, sizeof(out->governor));
+    out->count = cur->count;
+}
+
+// --- TOP DE PROCESOS ---
+
+#define PROC_FILTER_LEN 32
+
+typedef enum
+{
+    PROC_SORT_CPU,
+    PROC_SORT_RSS,
+    PROC_SORT_IO,
+    PROC_SORT_START,
+    PROC_SORT_PSS, // Detalle de memoria: RSS, PSS, USS y swap
+    PROC_SORT_KEYS
+} ProcSortKey;
+
+static const char *const proc_sort_names[PROC_SORT_KEYS] = {"CPU", "MEM", "E/S", "INICIO", "PSS"};
+
+typedef struct
+{
+    double value;
+    const ProcEntry *entry;
+} ProcRank;
+
+static double proc_sort_value(const ProcEntry *e, ProcSortKey key)
+{
+    switch (key)
+    {
+    case PROC_SORT_RSS:
+        return (double)e->rss_bytes;
+    case PROC_SORT_IO:
+        return e->io_rate;
+    case PROC_SORT_START:
+        return (double)e->start_ms; // Más recientes primero
+    case PROC_SORT_PSS:
+        // Sin detalle todavía (o sin PSS en el backend) se ordena por lo más parecido
+        if (e->mem_ns && !e->mem_denied && e->mem.pss != PROC_MEM_UNKNOWN)
+            return (double)e->mem.pss;
+        if (e->mem_ns && !e->mem_denied && e->mem.uss != PROC_MEM_UNKNOWN)
+            return (double)e->mem.uss;
+        return (double)e->rss_bytes;
+    default:
+        return e->cpu_pct;
+    }
+}
+
+// a va "antes" que b en el ranking (mayor valor; a igualdad, menor PID)
+static int proc_rank_before(const ProcRank *a, const ProcRank *b)
+{
+    if (a->value != b->value)
+        return a->value > b->value;
+    return a->entry->pid < b->entry->pid;
+}
+
+// Hunde el elemento i del montículo mínimo (la raíz es el peor del top actual)
+static void proc_heap_sift_down(ProcRank *heap, int size, int i)
+{
+    for (;;)
+    {
+        int worst = i, l = 2 * i + 1, r = 2 * i + 2;
+        if (l < size && proc_rank_before(&heap[worst], &heap[l]))
+            worst = l;
+        if (r < size && proc_rank_before(&heap[worst], &heap[r]))
+            worst = r;
+        if (worst == i)
+            return;
+        ProcRank tmp = heap[i];
+        heap[i] = heap[worst];
+        heap[worst] = tmp;
+        i = worst;
+    }
+}
+
+static void proc_heap_sift_up(ProcRank *heap, int i)
+{
+    while (i > 0)
+    {
+        int parent = (i - 1) / 2;
+        if (!proc_rank_before(&heap[parent], &heap[i]))
+            return;
+        ProcRank tmp = heap[i];
+        heap[i] = heap[parent];
+        heap[parent] = tmp;
+        i = parent;
+    }
+}
+
+// Búsqueda de subcadena sin distinguir mayúsculas
+static int name_matches(const char *name, const char *filter)
+{
+    if (!filter[0])
+        return 1;
+    for (; *name; name++)
+    {
+        int k = 0;
+        while (filter[k] && name[k] && tolower((unsigned char)name[k]) == tolower((unsigned char)filter[k]))
+            k++;
+        if (!filter[k])
+            return 1;
+    }
+    return 0;
+}
+
+// Selecciona los n mejores procesos según key con un montículo acotado: O(P log n),
+// sin ordenar la tabla completa. Solo se ordenan los n elegidos. Devuelve cuántos hay.
+int proc_top_n(const ProcTable *table, ProcSortKey key, const char *filter, ProcRank *out, int n)
+{
+    int size = 0;
+    for (unsigned int i = 0; i < table->capacity && n > 0; i++)
+    {
+        const ProcEntry *e = &table->slots[i];
+        if (e->pid == 0 || !name_matches(e->name, filter))
+            continue;
+        ProcRank candidate = {proc_sort_value(e, key), e};
+        if (size < n)
+        {
+            out[size] = candidate;
+            proc_heap_sift_up(out, size++);
+        }
+        else if (proc_rank_before(&candidate, &out[0]))
+        {
+            out[0] = candidate;
+            proc_heap_sift_down(out, size, 0);
+        }
+    }
+
+    // Extraer del montículo: cada vez sale el peor, que va al final
+    for (int end = size - 1; end > 0; end--)
+    {
+        ProcRank tmp = out[0];
+        out[0] = out[end];
+        out[end] = tmp;
+        proc_heap_sift_down(out, end, 0);
+    }
+    return size;
+}
+
+// --- EVENTOS: TEMPORIZADORES Y SEÑALES COMO DESCRIPTORES ---
+
+// Temporizador periódico que se puede esperar con poll(). Los vencimientos son absolutos
+// (timerfd con TFD_TIMER_ABSTIME en Linux, EVFILT_TIMER en macOS): el período no se
+// corre aunque una iteración tarde más de lo previsto.
+int timer_open(void)
+{
+#if defined(__linux__)
+    return timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+#else
+    return kqueue();
+#endif
+}
+
+// Programa vencimientos cada period_ns, el primero a un período de ahora
+int timer_arm(int fd, unsigned long long period_ns)
+{
+#if defined(__linux__)
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    unsigned long long first_ns = (unsigned long long)now.tv_sec * 1000000000ULL + now.tv_nsec + period_ns;
+    struct itimerspec spec;
+    spec.it_value.tv_sec = first_ns / 1000000000ULL;
+    spec.it_value.tv_nsec = first_ns % 1000000000ULL;
+    spec.it_interval.tv_sec = period_ns / 1000000000ULL;
+    spec.it_interval.tv_nsec = period_ns % 1000000000ULL;
+    return timerfd_settime(fd, TFD_TIMER_ABSTIME, &spec, NULL);
+#else
+    struct kevent ev;
+    EV_SET(&ev, 1, EVFILT_TIMER, EV_ADD | EV_ENABLE, NOTE_NSECONDS, (intptr_t)period_ns, NULL);
+    return kevent(fd, &ev, 1, NULL, 0, NULL);
+#endif
+}
+
+// Consume los vencimientos pendientes y devuelve cuántos hubo (más de 1 = plazos perdidos)
+unsigned long long timer_ack(int fd)
+{
+#if defined(__linux__)
+    unsigned long long expirations = 0;
+    if (read(fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+        return 0;
+    return expirations;
+#else
+    struct kevent ev;
+    struct timespec zero = {0, 0};
+    if (kevent(fd, NULL, 0, &ev, 1, &zero) != 1)
+        return 0;
+    return (unsigned long long)ev.data;
+#endif
+}
+
+// SIGWINCH como descriptor. En Linux la señal debe estar bloqueada en todos los hilos
+// (block_winch antes de crearlos) y se lee con signalfd; en macOS kqueue registra la
+// señal aunque esté ignorada.
+void block_winch(void)
+{
+#if defined(__linux__)
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGWINCH);
+    pthread_sigmask(SIG_BLOCK, &mask, NULL);
+#endif
+}
+
+int winch_open(void)
+{
+#if defined(__linux__)
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGWINCH);
+    return signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+#else
+    int kq = kqueue();
+    if (kq < 0)
+        return -1;
+    signal(SIGWINCH, SIG_IGN); // Que no lo atienda el manejador de ncurses
+    struct kevent ev;
+    EV_SET(&ev, SIGWINCH, EVFILT_SIGNAL, EV_ADD | EV_ENABLE, 0, 0, NULL);
+    if (kevent(kq, &ev, 1, NULL, 0, NULL) != 0)
+    {
+        close(kq);
+        return -1;
+    }
+    return kq;
+#endif
+}
+
+void winch_ack(int fd)
+{
+#if defined(__linux__)
+    struct signalfd_siginfo info;
+    while (read(fd, &info, sizeof(info)) == sizeof(info))
+        ;
+#else
+    struct kevent ev;
+    struct timespec zero = {0, 0};
+    while (kevent(fd, NULL, 0, &ev, 1, &zero) == 1)
+        ;
+#endif
+}
+
+// Vacía un pipe de aviso no bloqueante
+void drain_fd(int fd)
+{
+    char buf[64];
+    while (read(fd, buf, sizeof(buf)) > 0)
+        ;
+}
+
+// --- MUESTREO EN SEGUNDO PLANO ---
+
+#define SAMPLE_RING_CAPACITY 16
+#define QUERY_RING_CAPACITY 8
+#define PROC_TOP_MAX 64
+#define MIN_INTERVAL_MS 100
+#define MAX_INTERVAL_MS 10000
+#define PSI_BURST_INTERVAL_MS 100 // Intervalo mientras un disparador PSI informa presión
+#define PSI_BURST_HOLD_MS 3000    // Sin avisos durante este lapso se vuelve al intervalo normal
+
+// Cola circular sin bloqueo de un productor y un consumidor. head solo lo escribe el
+// productor y tail solo el consumidor; el par release/acquire garantiza que el
+// consumidor vea la ranura completa antes que el nuevo head. Cada índice va en su
+// propia línea de caché para que los dos hilos no se la disputen.
+typedef struct
+{
+    _Alignas(64) _Atomic size_t head;
+    _Alignas(64) _Atomic size_t tail;
+    _Alignas(64) size_t capacity; // Potencia de 2
+    size_t elem_size;
+    unsigned char *slots;
+    _Atomic unsigned long long dropped; // Elementos descartados por cola llena
+} SpscRing;
+
+static int spsc_init(SpscRing *ring, size_t capacity, size_t elem_size)
+{
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->dropped, 0);
+    ring->capacity = capacity;
+    ring->elem_size = elem_size;
+    ring->slots = calloc(capacity, elem_size);
+    return ring->slots ? 0 : -1;
+}
+
+static void spsc_free(SpscRing *ring)
+{
+    free(ring->slots);
+    ring->slots = NULL;
+}
+
+// Productor: ranura donde escribir en el lugar, o NULL si la cola está llena
+static void *spsc_reserve(SpscRing *ring)
+{
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if (head - tail == ring->capacity)
+        return NULL;
+    return ring->slots + (head & (ring->capacity - 1)) * ring->elem_size;
+}
+
+// Productor: hace visible la ranura reservada
+static void spsc_publish(SpscRing *ring)
+{
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+// Productor: copia y publica; con la cola llena descarta el elemento (nunca bloquea)
+static int spsc_push(SpscRing *ring, const void *elem)
+{
+    void *slot = spsc_reserve(ring);
+    if (!slot)
+    {
+        atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+        return -1;
+    }
+    memcpy(slot, elem, ring->elem_size);
+    spsc_publish(ring);
+    return 0;
+}
+
+// Consumidor: elemento más antiguo sin leer, o NULL si no hay
+static const void *spsc_peek(SpscRing *ring)
+{
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    if (tail == head)
+        return NULL;
+    return ring->slots + (tail & (ring->capacity - 1)) * ring->elem_size;
+}
+
+// Consumidor: libera la ranura leída con spsc_peek
+static void spsc_consume(SpscRing *ring)
+{
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+}
+
+// Fila del top de procesos ya resuelta por el muestreador
+typedef struct
+{
+    int pid;
+    char name[PROC_NAME_LEN];
+    float cpu_pct;
+    float io_rate;
+    unsigned long long rss_bytes;
+    unsigned long long start_ms;
+    ProcMemory mem;  // Solo con el orden PSS
+    int mem_known;   // mem viene de una lectura exitosa
+} ProcRow;
+
+// Orden y filtro del top que pide la UI
+typedef struct
+{
+    ProcSortKey sort;
+    char filter[PROC_FILTER_LEN];
+} ProcQuery;
+
+// --- CONSUMO PROPIO DEL MONITOR ---
+
+static unsigned long long clock_ns(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Contador de ciclos para cronometrar las fases del bucle sin llamar al sistema:
+// TSC en x86, contador virtual en ARM. Se convierte a tiempo recién al mostrar.
+static inline unsigned long long cycles_now(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    unsigned long long v;
+    __asm__ volatile("mrs %0, cntvct_el0" : "=r"(v));
+    return v;
+#else
+    return clock_ns(CLOCK_MONOTONIC);
+#endif
+}
+
+typedef enum
+{
+    PHASE_COLLECT, // sampler_collect, en el hilo muestreador
+    PHASE_LAYOUT,  // screen_layout
+    PHASE_DRAW,    // Contenido de los paneles hasta wnoutrefresh
+    PHASE_UPDATE,  // doupdate
+    PHASES
+} Phase;
+
+static const char *const phase_names[PHASES] = {"recolección", "disposición", "dibujo", "doupdate"};
+
+// Histograma logarítmico: el casillero b cuenta duraciones de [2^b, 2^(b+1)) ciclos.
+// Cada fase la escribe un solo hilo; la UI solo lee, por eso alcanza con atómicos relajados.
+#define PHASE_BUCKETS 40
+
+typedef struct
+{
+    _Atomic unsigned long long buckets[PHASE_BUCKETS];
+    _Atomic unsigned long long count;
+    _Atomic unsigned long long cycles;
+} PhaseHist;
+
+static struct
+{
+    unsigned long long base_cycles; // Referencia para convertir ciclos a nanosegundos
+    unsigned long long base_ns;
+    PhaseHist phases[PHASES];
+} prof;
+
+void prof_init(void)
+{
+    prof.base_cycles = cycles_now();
+    prof.base_ns = clock_ns(CLOCK_MONOTONIC);
+}
+
+static inline void prof_bump(_Atomic unsigned long long *counter, unsigned long long value)
+{
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + value, memory_order_relaxed);
+}
+
+// Cierra una fase empezada en start = cycles_now()
+static inline void prof_end(Phase phase, unsigned long long start)
+{
+    unsigned long long elapsed = cycles_now() - start;
+    int bucket = elapsed ? 63 - __builtin_clzll(elapsed) : 0;
+    PhaseHist *h = &prof.phases[phase];
+    prof_bump(&h->buckets[MIN(bucket, PHASE_BUCKETS - 1)], 1);
+    prof_bump(&h->count, 1);
+    prof_bump(&h->cycles, elapsed);
+}
+
+// Nanosegundos por ciclo, medidos contra el reloj monotónico desde prof_init
+static double prof_ns_per_cycle(void)
+{
+    unsigned long long cycles = cycles_now() - prof.base_cycles;
+    unsigned long long ns = clock_ns(CLOCK_MONOTONIC) - prof.base_ns;
+    return cycles > 0 && ns > 0 ? (double)ns / cycles : 1.0;
+}
+
+typedef struct
+{
+    unsigned long long count;
+    double mean_ns;
+    double p50_ns; // Centro del casillero: precisión de un factor 2
+    double p99_ns;
+    unsigned long long buckets[PHASE_BUCKETS];
+} PhaseStats;
+
+void prof_read(Phase phase, PhaseStats *out)
+{
+    const PhaseHist *h = &prof.phases[phase];
+    double ns_per_cycle = prof_ns_per_cycle();
+    unsigned long long total = 0;
+    for (int b = 0; b < PHASE_BUCKETS; b++)
+        total += out->buckets[b] = atomic_load_explicit(&h->buckets[b], memory_order_relaxed);
+    out->count = total;
+    out->mean_ns = total ? atomic_load_explicit(&h->cycles, memory_order_relaxed) * ns_per_cycle / total : 0;
+    out->p50_ns = out->p99_ns = 0;
+
+    unsigned long long seen = 0;
+    for (int b = 0; b < PHASE_BUCKETS && total > 0; b++)
+    {
+        unsigned long long before = seen;
+        seen += out->buckets[b];
+        double mid_ns = 1.5 * (double)(1ULL << b) * ns_per_cycle;
+        if (before < (total + 1) / 2 && seen >= (total + 1) / 2)
+            out->p50_ns = mid_ns;
+        if (before < total - total / 100 && seen >= total - total / 100)
+            out->p99_ns = mid_ns;
+    }
+}
+
+// Contadores acumulados del proceso; las tasas salen de dos lecturas
+typedef struct
+{
+    unsigned long long cpu_ns;       // Usuario + sistema, todos los hilos
+    unsigned long long ctx_switches; // Voluntarios + involuntarios
+    unsigned long long forks;
+    unsigned long long syscalls; // Solo las envueltas en COUNT_SYSCALL por el hilo que lee
+    unsigned long long rss_bytes;
+} SelfCounters;
+
+typedef struct
+{
+    int valid;
+    double cpu_pct;
+    unsigned long long rss_bytes;
+    double forks_rate;
+    double ctx_rate;
+    double syscall_rate; // Del hilo muestreador y solo las instrumentadas, no las de curses
+} SelfStats;
+
+void get_self_counters(SelfCounters *c)
+{
+    struct rusage ru;
+    memset(c, 0, sizeof(*c));
+    if (COUNT_SYSCALL(getrusage(RUSAGE_SELF, &ru)) == 0)
+    {
+        c->cpu_ns = ((unsigned long long)ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000000ULL +
+                    ((unsigned long long)ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1000ULL;
+        c->ctx_switches = ru.ru_nvcsw + ru.ru_nivcsw;
+    }
+    c->forks = fork_count;
+    c->syscalls = syscall_count;
+
+    // RSS actual; ru_maxrss es solo el pico
+#if defined(__APPLE__)
+    mach_task_basic_info_data_t info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (COUNT_SYSCALL(task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count)) == KERN_SUCCESS)
+        c->rss_bytes = info.resident_size;
+#else
+    static int statm_fd = -1;
+    if (statm_fd < 0)
+        statm_fd = open("/proc/self/statm", O_RDONLY | O_CLOEXEC);
+    char buf[128];
+    ssize_t n = statm_fd >= 0 ? COUNT_SYSCALL(pread(statm_fd, buf, sizeof(buf) - 1, 0)) : -1;
+    if (n > 0)
+    {
+        buf[n] = '\0';
+        char *p = strchr(buf, ' ');
+        if (p)
+            c->rss_bytes = strtoull(p + 1, NULL, 10) * (unsigned long long)sysconf(_SC_PAGESIZE);
+    }
+#endif
+}
+
+void self_stats_update(SelfStats *out, const SelfCounters *prev, const SelfCounters *cur, double elapsed)
+{
+    out->rss_bytes = cur->rss_bytes;
+    out->valid = elapsed > 0;
+    if (!out->valid)
+        return;
+    out->cpu_pct = (cur->cpu_ns - prev->cpu_ns) / (elapsed * 1e9) * 100.0;
+    out->forks_rate = (cur->forks - prev->forks) / elapsed;
+    out->ctx_rate = (cur->ctx_switches - prev->ctx_switches) / elapsed;
+    out->syscall_rate = (cur->syscalls - prev->syscalls) / elapsed;
+}
+
+// --- DETALLE DE MEMORIA POR PROCESO ---
+
+// Leer smaps_rollup de cada proceso en cada muestra costaría más que todo el resto del
+// muestreo, así que el detalle se refresca con un presupuesto de tiempo fijo: primero los
+// que más RSS tienen (son los que el top va a mostrar) y después, por turno, los que
+// tengan el dato más viejo que PROC_MEM_STALE_NS. El cursor persiste entre muestras y el
+// turno avanza al menos un proceso por muestra aunque los mayores agoten el presupuesto,
+// de modo que con el tiempo todos pasan por la lectura.
+#define PROC_MEM_BUDGET_NS 5000000ULL       // 5 ms por muestra
+#define PROC_MEM_PRIORITY 32                // Mayores consumidores, releídos cada segundo
+#define PROC_MEM_PRIORITY_NS 1000000000ULL
+#define PROC_MEM_STALE_NS 10000000000ULL    // Resto: se relee cada 10 s como mucho
+#define PROC_MEM_DENIED_NS 60000000000ULL   // Lecturas denegadas: se reintenta al minuto
+
+typedef struct
+{
+    int refreshed;    // Procesos leídos en la última muestra
+    int pending;      // Procesos sin detalle o con detalle viejo
+    double spent_ms;  // Tiempo que llevó la última muestra
+} ProcMemScan;
+
+static int proc_mem_older(const ProcEntry *e, unsigned long long now, unsigned long long age_ns)
+{
+    if (!e->mem_ns)
+        return 1;
+    return now - e->mem_ns >= (e->mem_denied ? PROC_MEM_DENIED_NS : age_ns);
+}
+
+static void proc_mem_read(ProcEntry *e, unsigned long long now)
+{
+    e->mem_denied = collector->read_proc_memory(e->pid, &e->mem) != 0;
+    e->mem_ns = now;
+}
+
+void proc_mem_refresh(ProcTable *table, ProcMemScan *scan)
+{
+    unsigned long long start = clock_ns(CLOCK_MONOTONIC);
+    unsigned long long deadline = start + PROC_MEM_BUDGET_NS, now = start;
+    scan->refreshed = 0;
+
+    ProcRank top[PROC_MEM_PRIORITY];
+    int n = proc_top_n(table, PROC_SORT_RSS, "", top, PROC_MEM_PRIORITY);
+    for (int i = 0; i < n && now < deadline; i++)
+    {
+        ProcEntry *e = (ProcEntry *)top[i].entry;
+        if (!proc_mem_older(e, now, PROC_MEM_PRIORITY_NS))
+            continue;
+        proc_mem_read(e, now);
+        scan->refreshed++;
+        now = clock_ns(CLOCK_MONOTONIC);
+    }
+
+    unsigned int mask = table->capacity - 1;
+    int turns = 0;
+    for (unsigned int visited = 0; visited < table->capacity && (now < deadline || turns == 0); visited++)
+    {
+        ProcEntry *e = &table->slots[table->mem_cursor];
+        table->mem_cursor = (table->mem_cursor + 1) & mask;
+        if (e->pid == 0 || !proc_mem_older(e, now, PROC_MEM_STALE_NS))
+            continue;
+        proc_mem_read(e, now);
+        scan->refreshed++;
+        turns++;
+        now = clock_ns(CLOCK_MONOTONIC);
+    }
+
+    scan->pending = 0;
+    for (unsigned int i = 0; i < table->capacity; i++)
+        scan->pending += table->slots[i].pid != 0 && proc_mem_older(&table->slots[i], now, PROC_MEM_STALE_NS);
+    scan->spent_ms = (now - start) / 1e6;
+}
+
+// --- ALERTAS ---
+
+#define ALERT_MAX_RULES 16
+#define ALERT_RATE_SLOTS 1024 // Muestras que caben en la ventana de una regla de tasa
+#define ALERT_MAX_CHILDREN 8  // Comandos de --alert-exec corriendo a la vez
+#define ALERT_HYSTERESIS 0.05 // Sin clear=, la alerta se apaga un 5% del umbral más allá
+
+typedef enum
+{
+    ALERT_OK,
+    ALERT_PENDING, // Se cumple la condición pero todavía no durante for=
+    ALERT_FIRING,
+} AlertState;
+
+// Estado de cada regla tal como viaja en la muestra (la ven la UI, los visores y el exportador)
+typedef struct
+{
+    char name[32];
+    float value; // Último valor evaluado: la métrica o su tasa por segundo
+    unsigned char state;
+    unsigned char bytes; // El valor son bytes por segundo
+} AlertItem;
+
+typedef struct
+{
+    int count;
+    int firing;
+    AlertItem items[ALERT_MAX_RULES];
+} AlertStatus;
+
+// Una muestra completa: lo que la UI necesita para dibujar un cuadro
+typedef struct
+{
+    unsigned long long timestamp_ns; // CLOCK_REALTIME
+    unsigned long long seq;          // Número de recolección; se repite al reordenar el top
+    int memory_ok;
+    MemoryInfo memory;
+    double cpu_usage;
+    CpuCoreUsage cores;
+    double cpu_temp; // °C del sensor principal del CPU, -1 si no hay
+    SensorReadings sensors;
+    NetStats net_counters; // Contadores acumulados por interfaz, tal como los da el backend
+    NetRates net;
+    ProcessStats procs;
+    DiskStats disk;
+    MountList mounts;     // Sistemas de archivos sobre dispositivos reales
+    DiskIoRates disk_io;  // Tasas por dispositivo de bloques
+    VmCounters vm_counters; // Contadores de paginación acumulados, tal como los da el backend
+    VmRates vm;             // Paginación por segundo
+    NumaUsage numa;         // Por nodo; count < 2 en equipos sin NUMA
+    CpuFreqUsage freq;      // Frecuencia efectiva y límites térmicos por núcleo
+    ProcQuery proc_query; // Orden y filtro con que se armó el top
+    int proc_rows;
+    ProcRow top[PROC_TOP_MAX];
+    ProcMemScan proc_mem; // Refresco del detalle de memoria (orden PSS)
+    SelfStats self;     // Consumo del propio monitor
+    AlertStatus alerts; // Reglas de --alert
+    CgroupUsage cgroup; // --cgroup
+    PressureStats pressure;
+    int pressure_triggers;                 // Disparadores PSI registrados
+    int pressure_burst;                    // Muestreo rápido por presión en curso
+    unsigned long long pressure_events;    // Avisos de los disparadores desde el inicio
+} Sample;
+
+// Reglas de --alert. Se evalúan en el hilo muestreador al terminar cada muestra, así
+// que también funcionan sin interfaz. Cada evaluación es O(1): los umbrales comparan el
+// valor nuevo y las reglas de tasa mantienen su propia ventana, de la que solo se
+// descartan por delante las muestras que quedaron viejas.
+typedef struct
+{
+    const char *name;
+    int bytes;
+    double (*get)(const Sample *s); // NAN si la muestra no trae el dato
+} AlertMetric;
+
+static double alert_metric_ram(const Sample *s) { return s->memory_ok ? s->memory.ram_percentage : NAN; }
+static double alert_metric_swap(const Sample *s) { return s->memory_ok ? s->memory.swap_percentage : NAN; }
+static double alert_metric_cpu(const Sample *s) { return s->cpu_usage; }
+static double alert_metric_temp(const Sample *s) { return s->cpu_temp >= 0 ? s->cpu_temp : NAN; }
+static double alert_metric_disk(const Sample *s) { return s->disk.total > 0 ? s->disk.percent_used : NAN; }
+static double alert_metric_rx(const Sample *s) { return s->net.rx_rate; }
+static double alert_metric_tx(const Sample *s) { return s->net.tx_rate; }
+static double alert_metric_procs(const Sample *s) { return s->procs.total; }
+static double alert_metric_psi_cpu(const Sample *s) { return s->pressure.valid ? s->pressure.sys[PSI_CPU].some.avg10 : NAN; }
+static double alert_metric_psi_mem(const Sample *s) { return s->pressure.valid ? s->pressure.sys[PSI_MEMORY].some.avg10 : NAN; }
+static double alert_metric_psi_io(const Sample *s) { return s->pressure.valid ? s->pressure.sys[PSI_IO].some.avg10 : NAN; }
+static double alert_metric_swapio(const Sample *s) { return s->vm.valid && !isnan(s->vm.rate[VM_SWAP_IN]) ? s->vm.rate[VM_SWAP_IN] + s->vm.rate[VM_SWAP_OUT] : NAN; }
+static double alert_metric_majflt(const Sample *s) { return s->vm.valid ? s->vm.rate[VM_MAJOR_FAULTS] : NAN; }
+static double alert_metric_throttle(const Sample *s) { return s->cgroup.info.valid && s->cgroup.info.cpu_quota ? s->cgroup.self.throttled_pct : NAN; }
+
+static const AlertMetric alert_metrics[] = {
+    {"ram", 0, alert_metric_ram},
+    {"swap", 0, alert_metric_swap},
+    {"cpu", 0, alert_metric_cpu},
+    {"temp", 0, alert_metric_temp},
+    {"disk", 0, alert_metric_disk},
+    {"rx", 1, alert_metric_rx},
+    {"tx", 1, alert_metric_tx},
+    {"procs", 0, alert_metric_procs},
+    {"psi_cpu", 0, alert_metric_psi_cpu},
+    {"psi_mem", 0, alert_metric_psi_mem},
+    {"psi_io", 0, alert_metric_psi_io},
+    {"throttle", 0, alert_metric_throttle},
+    {"swapio", 0, alert_metric_swapio},
+    {"majflt", 0, alert_metric_majflt},
+};
+
+typedef struct
+{
+    char name[32]; // La regla tal como se escribió, sin las opciones
+    const AlertMetric *metric;
+    int below; // '<' en lugar de '>'
+    int rate;  // rate(métrica): cambio por segundo a lo largo de window=
+    double threshold;
+    double clear; // Valor que apaga la alerta (histéresis)
+    unsigned long long for_ns;
+    unsigned long long window_ns;
+    AlertState state;
+    unsigned long long since_ns; // Desde cuándo se cumple la condición
+    // Ventana de las reglas de tasa: (tiempo, valor) en orden, la más vieja en tail
+    unsigned long long win_t[ALERT_RATE_SLOTS];
+    double win_v[ALERT_RATE_SLOTS];
+    int win_tail, win_count;
+} AlertRule;
+
+typedef struct
+{
+    AlertRule rules[ALERT_MAX_RULES];
+    int count;
+    const char *exec_cmd; // --alert-exec
+    FILE *log;            // --alert-log
+    pid_t children[ALERT_MAX_CHILDREN];
+} AlertEngine;
+
+static AlertEngine alert_engine;
+
+// Número con sufijo opcional K, M o G (potencias de 1024, para bytes por segundo)
+static int alert_parse_value(const char *str, double *out)
+{
+    char *end;
+    *out = strtod(str, &end);
+    if (end == str)
+        return -1;
+    static const char suffixes[] = "KMG";
+    const char *suffix = *end ? strchr(suffixes, toupper((unsigned char)*end)) : NULL;
+    if (suffix)
+    {
+        for (const char *p = suffixes; p <= suffix; p++)
+            *out *= 1024;
+        end++;
+    }
+    return *end ? -1 : 0;
+}
+
+// METRICA>VALOR o rate(METRICA)>VALOR, con '<' para el sentido contrario, seguido de
+// opciones separadas por comas: for=SEG, clear=VALOR, window=SEG (solo tasas)
+int alert_add(AlertEngine *eng, const char *spec, char *err, size_t err_len)
+{
+    if (eng->count >= ALERT_MAX_RULES)
+    {
+        snprintf(err, err_len, "Demasiadas reglas de alerta (máximo %d)", ALERT_MAX_RULES);
+        return -1;
+    }
+    AlertRule *r = &eng->rules[eng->count];
+    memset(r, 0, sizeof(*r));
+    char buf[128];
+    snprintf(buf, sizeof(buf), "%s", spec);
+    char *opts = strchr(buf, ',');
+    if (opts)
+        *opts++ = '\0';
+    snprintf(r->name, sizeof(r->name), "%.31s", buf);
+
+    char *op = strpbrk(buf, "<>");
+    if (!op)
+    {
+        snprintf(err, err_len, "Regla sin '<' ni '>': %s", spec);
+        return -1;
+    }
+    r->below = *op == '<';
+    *op = '\0';
+    char *metric = buf;
+    size_t len = strlen(metric);
+    if (strncmp(metric, "rate(", 5) == 0 && len > 6 && metric[len - 1] == ')')
+    {
+        r->rate = 1;
+        metric[len - 1] = '\0';
+        metric += 5;
+        r->window_ns = 5000000000ULL;
+    }
+    for (size_t i = 0; i < sizeof(alert_metrics) / sizeof(alert_metrics[0]); i++)
+        if (strcmp(metric, alert_metrics[i].name) == 0)
+            r->metric = &alert_metrics[i];
+    if (!r->metric)
+    {
+        char names[160];
+        size_t used = 0;
+        names[0] = '\0';
+        for (size_t i = 0; i < sizeof(alert_metrics) / sizeof(alert_metrics[0]) && used < sizeof(names); i++)
+            used += snprintf(names + used, sizeof(names) - used, "%s%s", i ? ", " : "", alert_metrics[i].name);
+        snprintf(err, err_len, "Métrica desconocida en %s (%s)", spec, names);
+        return -1;
+    }
+    if (alert_parse_value(op + 1, &r->threshold) != 0)
+    {
+        snprintf(err, err_len, "Umbral inválido en %s", spec);
+        return -1;
+    }
+    double band = fabs(r->threshold) * ALERT_HYSTERESIS;
+    r->clear = r->below ? r->threshold + band : r->threshold - band;
+
+    for (char *opt = opts ? strtok(opts, ",") : NULL; opt; opt = strtok(NULL, ","))
+    {
+        double value;
+        char *eq = strchr(opt, '=');
+        if (!eq || alert_parse_value(eq + 1, &value) != 0)
+        {
+            snprintf(err, err_len, "Opción inválida en %s: %s", spec, opt);
+            return -1;
+        }
+        *eq = '\0';
+        if (strcmp(opt, "for") == 0 && value >= 0)
+            r->for_ns = (unsigned long long)(value * 1e9);
+        else if (strcmp(opt, "clear") == 0)
+            r->clear = value;
+        else if (strcmp(opt, "window") == 0 && r->rate && value > 0)
+            r->window_ns = (unsigned long long)(value * 1e9);
+        else
+        {
+            snprintf(err, err_len, "Opción inválida en %s: %s", spec, opt);
+            return -1;
+        }
+    }
+    if (r->below ? r->clear < r->threshold : r->clear > r->threshold)
+    {
+        snprintf(err, err_len, "clear= queda del lado que dispara la alerta en %s", spec);
+        return -1;
+    }
+    eng->count++;
+    return 0;
+}
+
+// Tasa por segundo entre la muestra más vieja de la ventana y la actual; NAN mientras
+// la ventana no se llenó. Si window/intervalo supera ALERT_RATE_SLOTS el anillo se llena
+// antes de cubrir la ventana: la tasa sale entonces del tramo más largo que se conserva.
+static double alert_rate(AlertRule *r, unsigned long long now_ns, double value)
+{
+    if (r->win_count == ALERT_RATE_SLOTS)
+    {
+        r->win_tail = (r->win_tail + 1) % ALERT_RATE_SLOTS;
+        r->win_count--;
+    }
+    int head = (r->win_tail + r->win_count) % ALERT_RATE_SLOTS;
+    r->win_t[head] = now_ns;
+    r->win_v[head] = value;
+    r->win_count++;
+    // Conservar como referencia la última muestra que tenga al menos window de antigüedad
+    while (r->win_count > 2 && now_ns - r->win_t[(r->win_tail + 1) % ALERT_RATE_SLOTS] >= r->window_ns)
+    {
+        r->win_tail = (r->win_tail + 1) % ALERT_RATE_SLOTS;
+        r->win_count--;
+    }
+    unsigned long long span = now_ns - r->win_t[r->win_tail];
+    if ((span < r->window_ns && r->win_count < ALERT_RATE_SLOTS) || span == 0)
+        return NAN;
+    return (value - r->win_v[r->win_tail]) / (span / 1e9);
+}
+
+// Comandos de --alert-exec que ya terminaron
+static void alert_reap(AlertEngine *eng)
+{
+    for (int i = 0; i < ALERT_MAX_CHILDREN; i++)
+        if (eng->children[i] > 0 && waitpid(eng->children[i], NULL, WNOHANG) != 0)
+            eng->children[i] = 0;
+}
+
+// Registra el cambio de estado y lanza el comando sin esperarlo. El comando recibe la
+// regla, el estado y el valor en ALERT_RULE, ALERT_STATE y ALERT_VALUE.
+static void alert_notify(AlertEngine *eng, const AlertRule *r, double value, unsigned long long timestamp_ns)
+{
+    const char *state = r->state == ALERT_FIRING ? "activa" : "resuelta";
+    char value_str[32];
+    snprintf(value_str, sizeof(value_str), "%.2f", value);
+    if (eng->log)
+    {
+        fprintf(eng->log, "%llu.%03llu\t%s\t%s\t%s\n", timestamp_ns / 1000000000ULL, timestamp_ns / 1000000ULL % 1000,
+                state, r->name, value_str);
+        fflush(eng->log);
+    }
+    if (!eng->exec_cmd)
+        return;
+    int slot = -1;
+    for (int i = 0; i < ALERT_MAX_CHILDREN && slot < 0; i++)
+        if (eng->children[i] == 0)
+            slot = i;
+    if (slot < 0)
+    {
+        if (eng->log)
+            fprintf(eng->log, "# comando omitido: ya hay %d en curso\n", ALERT_MAX_CHILDREN);
+        return;
+    }
+
+    char env_rule[64], env_state[32], env_value[48];
+    snprintf(env_rule, sizeof(env_rule), "ALERT_RULE=%s", r->name);
+    snprintf(env_state, sizeof(env_state), "ALERT_STATE=%s", state);
+    snprintf(env_value, sizeof(env_value), "ALERT_VALUE=%s", value_str);
+    extern char **environ;
+    int env_count = 0;
+    while (environ[env_count])
+        env_count++;
+    char **envp = malloc((env_count + 4) * sizeof(*envp));
+    if (!envp)
+        return;
+    memcpy(envp, environ, env_count * sizeof(*envp));
+    envp[env_count] = env_rule;
+    envp[env_count + 1] = env_state;
+    envp[env_count + 2] = env_value;
+    envp[env_count + 3] = NULL;
+    char *argv[] = {"/bin/sh", "-c", (char *)eng->exec_cmd, NULL};
+    pid_t pid;
+    if (COUNT_FORK(posix_spawn(&pid, "/bin/sh", NULL, NULL, argv, envp)) == 0)
+        eng->children[slot] = pid;
+    free(envp);
+}
+
+// Evalúa todas las reglas sobre la muestra recién tomada y deja el resultado en s->alerts
+void alert_evaluate(AlertEngine *eng, Sample *s)
+{
+    AlertStatus *out = &s->alerts;
+    unsigned long long now_ns = clock_ns(CLOCK_MONOTONIC);
+    out->count = eng->count;
+    out->firing = 0;
+    if (eng->exec_cmd)
+        alert_reap(eng);
+    for (int i = 0; i < eng->count; i++)
+    {
+        AlertRule *r = &eng->rules[i];
+        double value = r->metric->get(s);
+        if (r->rate && !isnan(value))
+            value = alert_rate(r, now_ns, value);
+
+        AlertState prev = r->state;
+        if (!isnan(value))
+        {
+            int trips = r->below ? value < r->threshold : value > r->threshold;
+            int clears = r->below ? value >= r->clear : value <= r->clear;
+            if (r->state == ALERT_FIRING)
+            {
+                if (clears)
+                    r->state = ALERT_OK;
+            }
+            else if (!trips)
+                r->state = ALERT_OK;
+            else
+            {
+                if (r->state == ALERT_OK)
+                    r->since_ns = now_ns;
+                r->state = now_ns - r->since_ns >= r->for_ns ? ALERT_FIRING : ALERT_PENDING;
+            }
+        }
+        if ((prev == ALERT_FIRING) != (r->state == ALERT_FIRING))
+            alert_notify(eng, r, value, s->timestamp_ns);
+
+        AlertItem *item = &out->items[i];
+        memcpy(item->name, r->name, sizeof(item->name));
+        item->value = (float)value;
+        item->state = (unsigned char)r->state;
+        item->bytes = (unsigned char)r->metric->bytes;
+        if (r->state == ALERT_FIRING)
+            out->firing++;
+    }
+}
+
+void alert_engine_close(AlertEngine *eng)
+{
+    if (eng->log)
+        fclose(eng->log);
+    eng->log = NULL;
+}
+
+// Hilo recolector: toma todas las métricas a intervalo fijo y las publica para la UI
+typedef struct
+{
+    pthread_t thread;
+    _Atomic int interval_ms; // Lo cambia la UI; el muestreador reprograma su temporizador
+    _Atomic unsigned long long overruns; // Plazos de muestreo perdidos
+    SpscRing samples;   // muestreador -> UI
+    SpscRing queries;   // UI -> muestreador
+    int wake_pipe[2];   // Despierta al muestreador (consulta nueva, cambio de intervalo)
+    int stop_pipe[2];   // Se escribe una vez al terminar
+    int notify_pipe[2]; // Avisa a la UI que hay datos nuevos en las colas
+    _Atomic int pipe_errno; // Último aviso entre hilos que falló; lo informa el hilo principal
+    // Estado privado del hilo muestreador
+    Sample current;
+    unsigned long long last_net_ns;
+    DiskIoStats disk_stats;
+    unsigned long long last_disk_ns;
+    CgroupStats cgroup_stats;
+    unsigned long long last_cgroup_ns;
+    unsigned long long last_vm_ns;
+    NumaStats numa_stats;
+    unsigned long long last_numa_ns;
+    CpuCoreTicks core_ticks[2]; // Lectura anterior y actual, se alternan
+    int core_cur;
+    CpuFreqStats freq_stats[2]; // Igual que core_ticks
+    int freq_cur;
+    unsigned long long last_freq_ns;
+    SelfCounters self_prev;
+    unsigned long long self_prev_ns;
+} Sampler;
+
+// Arma el top de procesos sobre la tabla ya escaneada (no vuelve a recorrer /proc)
+static void sampler_rank_processes(Sample *s)
+{
+    ProcRank ranked[PROC_TOP_MAX];
+    s->proc_rows = proc_top_n(&proc_table, s->proc_query.sort, s->proc_query.filter, ranked, PROC_TOP_MAX);
+    for (int i = 0; i < s->proc_rows; i++)
+    {
+        const ProcEntry *e = ranked[i].entry;
+        ProcRow *row = &s->top[i];
+        row->pid = e->pid;
+        memcpy(row->name, e->name, sizeof(row->name));
+        row->cpu_pct = e->cpu_pct;
+        row->io_rate = e->io_rate;
+        row->rss_bytes = e->rss_bytes;
+        row->start_ms = e->start_ms;
+        row->mem = e->mem;
+        row->mem_known = e->mem_ns && !e->mem_denied;
+    }
+}
+
+// Modo contenedor: la RAM, la swap y el CPU de los paneles pasan a ser los del cgroup.
+// Como en docker stats, el caché inactivo no cuenta como usado: se reclama sin presión.
+static void cgroup_apply(Sample *s)
+{
+    const CgroupInfo *cg = &s->cgroup.info;
+    MemoryInfo *m = &s->memory;
+    if (cg->has_memory && s->memory_ok)
+    {
+        unsigned long long current = s->cgroup.self.prev.memory_current;
+        if (cg->memory_max != CGROUP_UNLIMITED)
+            m->total_ram = MIN(m->total_ram, cg->memory_max);
+        m->used_ram = MIN(current > cg->inactive_file ? current - cg->inactive_file : 0, m->total_ram);
+        m->free_ram = m->total_ram - m->used_ram;
+        m->inactive_ram = cg->inactive_file;
+        m->wired_ram = cg->kernel;
+        m->compressed_ram = 0;
+        if (cg->has_swap)
+        {
+            m->swap_used = cg->swap_current;
+            if (cg->swap_max != CGROUP_UNLIMITED)
+                m->swap_total = MIN(m->swap_total, cg->swap_max);
+        }
+        memory_info_finish(m);
+    }
+    if (cg->has_cpu)
+        s->cpu_usage = s->cgroup.self.cpu_pct;
+}
+
+static void sampler_collect(Sampler *sp)
+{
+    unsigned long long start = cycles_now();
+    Sample *s = &sp->current;
+    s->timestamp_ns = clock_ns(CLOCK_REALTIME);
+    s->seq++;
+    s->memory_ok = get_memory_info(&s->memory) == 0;
+    // Una lectura da el uso total y el de cada núcleo (antes del cgroup, que puede reemplazarlo)
+    CpuCoreTicks *cores = &sp->core_ticks[sp->core_cur];
+    if (collector->read_cpu_cores(cores) == 0)
+    {
+        const CpuCoreTicks *prev = &sp->core_ticks[!sp->core_cur];
+        s->cpu_usage = cpu_ticks_usage(&prev->all, &cores->all);
+        cpu_core_usage(prev, cores, &s->cores);
+        sp->core_cur = !sp->core_cur;
+    }
+    else
+    {
+        s->cores.count = 0;
+        s->cpu_usage = get_cpu_usage();
+    }
+    VmCounters vm;
+    if (collector->read_vmstat(&vm) == 0)
+    {
+        unsigned long long vm_ns = clock_ns(CLOCK_MONOTONIC);
+        vm_rates_update(&s->vm, &s->vm_counters, &vm, sp->last_vm_ns ? (vm_ns - sp->last_vm_ns) / 1e9 : 0);
+        s->vm_counters = vm;
+        sp->last_vm_ns = vm_ns;
+    }
+    else
+        s->vm.valid = 0;
+    if (collector->read_cgroup(&sp->cgroup_stats) == 0)
+    {
+        unsigned long long cgroup_ns = clock_ns(CLOCK_MONOTONIC);
+        cgroup_usage_update(&s->cgroup, &sp->cgroup_stats, sp->last_cgroup_ns ? (cgroup_ns - sp->last_cgroup_ns) / 1e9 : 0);
+        sp->last_cgroup_ns = cgroup_ns;
+        cgroup_apply(s);
+    }
+    else
+        s->cgroup.info.valid = 0;
+
+    if (collector->read_numa(&sp->numa_stats) == 0)
+    {
+        unsigned long long numa_ns = clock_ns(CLOCK_MONOTONIC);
+        numa_usage_update(&s->numa, &sp->numa_stats, &s->cores, sp->last_numa_ns ? (numa_ns - sp->last_numa_ns) / 1e9 : 0);
+        sp->last_numa_ns = numa_ns;
+    }
+    else
+        s->numa.count = 0;
+    CpuFreqStats *freq = &sp->freq_stats[sp->freq_cur];
+    if (collector->read_cpu_freq(freq) == 0)
+    {
+        unsigned long long freq_ns = clock_ns(CLOCK_MONOTONIC);
+        cpu_freq_usage(&sp->freq_stats[!sp->freq_cur], freq, sp->last_freq_ns ? (freq_ns - sp->last_freq_ns) / 1e9 : 0, &s->freq);
+        sp->freq_cur = !sp->freq_cur;
+        sp->last_freq_ns = freq_ns;
+    }
+    else
+        s->freq.count = 0;
+
+    if (collector->read_sensors(&s->sensors) != 0)
+        s->sensors.count = 0;
+    int cpu_main = sensor_set.cpu_main;
+    s->cpu_temp = cpu_main >= 0 && cpu_main < s->sensors.count && !isnan(s->sensors.value[cpu_main]) ? s->sensors.value[cpu_main] : -1;
+
+    get_net_stats(&s->net_counters);
+    unsigned long long now_ns = clock_ns(CLOCK_MONOTONIC);
+    net_rates_update(&s->net, &s->net_counters, (now_ns - sp->last_net_ns) / 1e9);
+    sp->last_net_ns = now_ns;
+
+    proc_table_set_want_io(&proc_table, s->proc_query.sort == PROC_SORT_IO);
+    get_process_stats(&s->procs);
+    if (s->proc_query.sort == PROC_SORT_PSS)
+        proc_mem_refresh(&proc_table, &s->proc_mem);
+    sampler_rank_processes(s);
+    get_disk_stats(&s->disk);
+    collector->read_pressure(&s->pressure);
+    if (collector->read_mounts(&s->mounts) != 0)
+        s->mounts.count = 0;
+    if (collector->read_disk_io(&sp->disk_stats) == 0)
+    {
+        unsigned long long disk_ns = clock_ns(CLOCK_MONOTONIC);
+        disk_io_update(&s->disk_io, &sp->disk_stats, (disk_ns - sp->last_disk_ns) / 1e9);
+        sp->last_disk_ns = disk_ns;
+    }
+    else
+        s->disk_io.count = 0;
+
+    SelfCounters self;
+    get_self_counters(&self);
+    self_stats_update(&s->self, &sp->self_prev, &self, sp->self_prev_ns ? (now_ns - sp->self_prev_ns) / 1e9 : 0);
+    sp->self_prev = self;
+    sp->self_prev_ns = now_ns;
+    alert_evaluate(&alert_engine, s);
+    prof_end(PHASE_COLLECT, start);
+}
+
+// Avisa a la UI; si el pipe está lleno ya hay un aviso pendiente. Con curses en pantalla
+// no se puede escribir en stderr: el error queda para sampler_take_error.
+static void sampler_notify(Sampler *sp)
+{
+    if (write(sp->notify_pipe[1], "s", 1) < 0 && errno != EAGAIN)
+        atomic_store(&sp->pipe_errno, errno);
+}
+
+// Devuelve y olvida el último error de aviso entre hilos, 0 si no hubo
+static int sampler_take_error(Sampler *sp)
+{
+    return atomic_exchange(&sp->pipe_errno, 0);
+}
+
+// Para los modos sin interfaz, donde stderr está libre
+static void sampler_log_error(Sampler *sp)
+{
+    int err = sampler_take_error(sp);
+    if (err)
+        fprintf(stderr, "Aviso entre hilos: %s\n", strerror(err));
+}
+
+// Bucle del muestreador: espera con poll() al temporizador de plazos absolutos,
+// a las consultas de la UI, a los disparadores de presión y al aviso de fin.
+// Mientras el kernel informa presión se muestrea cada PSI_BURST_INTERVAL_MS; pasados
+// PSI_BURST_HOLD_MS sin avisos se vuelve al intervalo elegido.
+static void *sampler_main(void *arg)
+{
+    Sampler *sp = arg;
+    int timer_fd = timer_open();
+    int armed_ms = atomic_load(&sp->interval_ms);
+    if (timer_fd < 0 || timer_arm(timer_fd, (unsigned long long)armed_ms * 1000000ULL) != 0)
+        return NULL;
+    int psi_fds[PSI_RESOURCES];
+    int psi_count = collector->watch_pressure(psi_fds, PSI_RESOURCES);
+    unsigned long long burst_until_ns = 0;
+    sp->current.pressure_triggers = psi_count;
+
+    sampler_collect(sp);
+    spsc_push(&sp->samples, &sp->current);
+    sampler_notify(sp);
+
+    for (;;)
+    {
+        struct pollfd fds[3 + PSI_RESOURCES] = {{sp->stop_pipe[0], POLLIN, 0}, {sp->wake_pipe[0], POLLIN, 0}, {timer_fd, POLLIN, 0}};
+        for (int i = 0; i < psi_count; i++)
+            fds[3 + i] = (struct pollfd){psi_fds[i], POLLPRI, 0};
+        if (poll(fds, 3 + psi_count, -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        if (fds[0].revents)
+            break;
+
+        int publish = 0;
+        int pressured = 0;
+        for (int i = 0; i < psi_count; i++)
+        {
+            if (fds[3 + i].revents & POLLERR)
+                psi_fds[i] = -1; // Disparador inválido: poll lo ignora de acá en más
+            else if (fds[3 + i].revents & POLLPRI)
+                pressured = 1;
+        }
+        if (pressured)
+        {
+            // Muestra inmediata: no esperar al próximo tic del intervalo normal
+            burst_until_ns = clock_ns(CLOCK_MONOTONIC) + PSI_BURST_HOLD_MS * 1000000ULL;
+            sp->current.pressure_events++;
+            sp->current.pressure_burst = 1;
+            sampler_collect(sp);
+            publish = 1;
+        }
+        else if (fds[2].revents)
+        {
+            unsigned long long expirations = timer_ack(timer_fd);
+            if (expirations > 1)
+                atomic_fetch_add(&sp->overruns, expirations - 1);
+            if (expirations > 0)
+            {
+                sp->current.pressure_burst = burst_until_ns > clock_ns(CLOCK_MONOTONIC);
+                sampler_collect(sp);
+                publish = 1;
+            }
+        }
+        if (fds[1].revents)
+        {
+            drain_fd(sp->wake_pipe[0]);
+
+            // Consultas de la UI: solo se reordena el top sobre la tabla existente
+            int reranked = 0;
+            const ProcQuery *q;
+            while ((q = spsc_peek(&sp->queries)) != NULL)
+            {
+                sp->current.proc_query = *q;
+                spsc_consume(&sp->queries);
+                reranked = 1;
+            }
+            if (reranked && !publish)
+                sampler_rank_processes(&sp->current);
+            publish |= reranked;
+        }
+        if (publish)
+        {
+            spsc_push(&sp->samples, &sp->current);
+            sampler_notify(sp);
+        }
+
+        int interval_ms = atomic_load(&sp->interval_ms);
+        if (sp->current.pressure_burst)
+            interval_ms = MIN(interval_ms, PSI_BURST_INTERVAL_MS);
+        if (interval_ms != armed_ms && timer_arm(timer_fd, (unsigned long long)interval_ms * 1000000ULL) == 0)
+            armed_ms = interval_ms;
+    }
+    close(timer_fd);
+    return NULL;
+}
+
+int sampler_start(Sampler *sp, int interval_ms)
+{
+    memset(sp, 0, sizeof(*sp));
+    atomic_init(&sp->interval_ms, interval_ms);
+    atomic_init(&sp->overruns, 0);
+    sp->current.proc_query.sort = PROC_SORT_CPU;
+    if (spsc_init(&sp->samples, SAMPLE_RING_CAPACITY, sizeof(Sample)) != 0 ||
+        spsc_init(&sp->queries, QUERY_RING_CAPACITY, sizeof(ProcQuery)) != 0 ||
+        pipe(sp->wake_pipe) != 0 || pipe(sp->stop_pipe) != 0 || pipe(sp->notify_pipe) != 0)
+        return -1;
+    fcntl(sp->wake_pipe[0], F_SETFL, O_NONBLOCK);
+    fcntl(sp->wake_pipe[1], F_SETFL, O_NONBLOCK);
+    fcntl(sp->notify_pipe[0], F_SETFL, O_NONBLOCK);
+    fcntl(sp->notify_pipe[1], F_SETFL, O_NONBLOCK);
+
+    // Primera lectura de red como referencia para las tasas
+    get_net_stats(&sp->current.net_counters);
+    sp->last_net_ns = clock_ns(CLOCK_MONOTONIC);
+    net_rates_update(&sp->current.net, &sp->current.net_counters, 0);
+    if (collector->read_disk_io(&sp->disk_stats) == 0)
+    {
+        sp->last_disk_ns = clock_ns(CLOCK_MONOTONIC);
+        disk_io_update(&sp->current.disk_io, &sp->disk_stats, 0);
+    }
+    if (collector->read_vmstat(&sp->current.vm_counters) == 0)
+        sp->last_vm_ns = clock_ns(CLOCK_MONOTONIC);
+    // Los núcleos y la frecuencia comparan contra la lectura anterior del par: sin esta
+    // primera lectura la muestra inicial mostraría el promedio desde el arranque del equipo
+    if (collector->read_cpu_cores(&sp->core_ticks[sp->core_cur]) == 0)
+        sp->core_cur = !sp->core_cur;
+    if (collector->read_cpu_freq(&sp->freq_stats[sp->freq_cur]) == 0)
+    {
+        sp->last_freq_ns = clock_ns(CLOCK_MONOTONIC);
+        sp->freq_cur = !sp->freq_cur;
+    }
+
+    if (pthread_create(&sp->thread, NULL, sampler_main, sp) != 0)
+        return -1;
+    return 0;
+}
+
+void sampler_stop(Sampler *sp)
+{
+    if (write(sp->stop_pipe[1], "x", 1) < 0)
+        return;
+    pthread_join(sp->thread, NULL);
+    int *pipes[] = {sp->wake_pipe, sp->stop_pipe, sp->notify_pipe};
+    for (int i = 0; i < 3; i++)
+    {
+        close(pipes[i][0]);
+        close(pipes[i][1]);
+    }
+    spsc_free(&sp->samples);
+    spsc_free(&sp->queries);
+}
+
+// Cambia el intervalo de muestreo; el muestreador reprograma su temporizador al despertar.
+// Se llama con curses activo: un fallo al despertar queda para sampler_take_error.
+void sampler_set_interval(Sampler *sp, int interval_ms)
+{
+    atomic_store(&sp->interval_ms, interval_ms);
+    if (write(sp->wake_pipe[1], "i", 1) < 0 && errno != EAGAIN)
+        atomic_store(&sp->pipe_errno, errno);
+}
+
+// Envía una nueva consulta del top y despierta al muestreador
+void sampler_send_query(Sampler *sp, const ProcQuery *query)
+{
+    if (spsc_push(&sp->queries, query) == 0 && write(sp->wake_pipe[1], "q", 1) < 0 && errno != EAGAIN)
+        atomic_store(&sp->pipe_errno, errno);
+}
+
+// Tabla de procesos ordenada por la clave elegida, con filtro por nombre
+// Con el orden PSS las columnas pasan a ser el desglose de memoria ("-" si no se leyó)
+void draw_process_list(WINDOW *win, int y, int x, int max_rows, unsigned long long total_ram, const ProcRow *rows, int n, const ProcQuery *query, int editing_filter, const ProcMemScan *mem_scan)
+{
+    int width = getmaxx(win) - x;
+    if (max_rows <= 0 || width < 40)
+        return;
+
+    if (has_colors())
+        wattron(win, COLOR_PAIR(4));
+    wattron(win, A_BOLD);
+    mvwprintw(win, y, x, "%-*.*s", width, width, "");
+    mvwprintw(win, y, x, "TOP PROCESOS (orden: %s)", proc_sort_names[query->sort]);
+    wattroff(win, A_BOLD);
+    if (has_colors())
+        wattroff(win, COLOR_PAIR(4));
+    if (editing_filter || query->filter[0])
+        wprintw(win, "  filtro: %s%s", query->filter, editing_filter ? "_" : "");
+    int detail = query->sort == PROC_SORT_PSS;
+    if (detail)
+        wprintw(win, "  leídos: %d en %.1f ms, pendientes: %d", mem_scan->refreshed, mem_scan->spent_ms, mem_scan->pending);
+
+    mvwprintw(win, y + 1, x, "%-*.*s", width, width,
+              detail ? "PID     Nombre                      RSS        PSS        USS       Swap"
+                     : "PID     Nombre               CPU%   MEM%        RSS       E/S/s  Inicio");
+    for (int row = 0; row < max_rows; row++)
+    {
+        mvwprintw(win, y + 2 + row, x, "%-*s", width, "");
+        if (row >= n)
+            continue;
+        const ProcRow *e = &rows[row];
+        if (detail)
+        {
+            const unsigned long long values[4] = {e->rss_bytes, e->mem.pss, e->mem.uss, e->mem.swap};
+            char cols[4][32];
+            for (int k = 0; k < 4; k++)
+            {
+                if (k > 0 && (!e->mem_known || values[k] == PROC_MEM_UNKNOWN))
+                    snprintf(cols[k], sizeof(cols[k]), "-");
+                else
+                    format_bytes(values[k], cols[k]);
+            }
+            mvwprintw(win, y + 2 + row, x, "%-7d %-20.20s %10s %10s %10s %10s",
+                      e->pid, e->name, cols[0], cols[1], cols[2], cols[3]);
+            continue;
+        }
+        char rss_str[32], io_str[32], start_str[16] = "--:--";
+        format_bytes(e->rss_bytes, rss_str);
+        format_bytes((unsigned long long)e->io_rate, io_str);
+        time_t start = (time_t)(e->start_ms / 1000);
+        struct tm tm_start;
+        if (e->start_ms && localtime_r(&start, &tm_start))
+            strftime(start_str, sizeof(start_str), "%H:%M", &tm_start);
+        double mem = total_ram > 0 ? (double)e->rss_bytes / total_ram * 100.0 : 0.0;
+        mvwprintw(win, y + 2 + row, x, "%-7d %-20.20s %5.1f  %5.1f %10s %11s  %s",
+                 e->pid, e->name, e->cpu_pct, mem, rss_str, io_str, start_str);
+    }
+}
+
+// --- GRABACIÓN Y REPRODUCCIÓN ---
+
+// Formato de grabación (--record / --replay). Columnar y de tamaño fijo:
+//
+//   RecHeader | RecColumn[column_count] | SourceHost | bloques...
+//
+// Cada bloque de datos guarda REC_BLOCK_SAMPLES muestras columna por columna (todas las
+// celdas ocupan 8 bytes), así que el archivo se escribe con un write() cada 64 muestras
+// y un bloque parcial solo aparece al final. Cada REC_INDEX_EVERY bloques de datos va un
+// bloque índice con el rango de tiempo y el desplazamiento de cada uno: la reproducción
+// salta de índice en índice sin tocar las páginas de datos. Al cerrar se agrega un índice
+// corto con los bloques del último grupo. Los enteros se escriben en el orden de bytes del
+// equipo que graba; byte_order permite detectar una grabación ajena.
+//
+// El bloque en construcción se reescribe en su lugar cada REC_CHECKPOINT_NS, así que una
+// grabación cortada sin cierre ordenado (SIGKILL, corte de luz) pierde como mucho eso.
+// La versión 1 no tenía SourceHost y la 2 lo tenía sin el procesador; se siguen leyendo,
+// con lo que falte como N/D.
+
+#define REC_MAGIC "MEMREC\0\1"
+#define REC_VERSION 3
+#define REC_BYTE_ORDER 0x01020304u
+#define REC_BLOCK_SAMPLES 64
+#define REC_INDEX_EVERY 64
+#define REC_BLOCK_DATA 0x41544144u  // "DATA"
+#define REC_BLOCK_INDEX 0x58444e49u // "INDX"
+#define REC_CHECKPOINT_NS (10ULL * 1000000000ULL)
+
+typedef struct
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t column_count;
+    uint32_t block_samples;
+    uint32_t index_every;
+    uint32_t interval_ms;
+    uint64_t created_ns;
+    char backend[16];
+    char reserved[8];
+} RecHeader;
+
+// Datos del equipo que grabó o que publica, para que el panel de información no muestre
+// el equipo local al reproducir o al mirar otro proceso
+typedef struct
+{
+    char hostname[64];
+    char os_version[64];
+    char kernel[64];
+    char ip_addr[64];
+    char interfaces[256];
+    int32_t cpu_count;
+    uint32_t reserved;
+    uint64_t boot_ns; // Arranque en reloj de pared: el uptime sale del tiempo de cada muestra
+    char cpu_name[128]; // Vacío en grabaciones de la versión 2
+    double cpu_speed_ghz;
+} SourceHost;
+
+#define SOURCE_HOST_V2_SIZE offsetof(SourceHost, cpu_name)
+
+typedef enum
+{
+    REC_ULL,    // unsigned long long
+    REC_INT,    // int, guardado como int64
+    REC_DOUBLE, // double
+} RecType;
+
+typedef struct
+{
+    char name[24];
+    uint32_t type;
+    uint32_t reserved;
+} RecColumn;
+
+typedef struct
+{
+    uint32_t kind;  // REC_BLOCK_DATA o REC_BLOCK_INDEX
+    uint32_t count; // Muestras (datos) o entradas (índice)
+    uint64_t first_ns;
+    uint64_t last_ns;
+    uint64_t reserved;
+} RecBlockHeader;
+
+typedef struct
+{
+    uint64_t first_ns;
+    uint64_t last_ns;
+    uint64_t offset; // Desde el inicio del archivo
+    uint64_t count;
+} RecIndexEntry;
+
+// Columnas grabadas: campos escalares de Sample. El top de procesos y las interfaces de
+// red no se graban (son de tamaño variable). La primera columna debe ser el tiempo.
+typedef struct
+{
+    const char *name;
+    RecType type;
+    size_t offset;
+} RecColumnDef;
+
+#define REC_COL(name, type, field) {name, type, offsetof(Sample, field)}
+
+static const RecColumnDef rec_columns[] = {
+    REC_COL("timestamp_ns", REC_ULL, timestamp_ns),
+    REC_COL("cpu_usage", REC_DOUBLE, cpu_usage),
+    REC_COL("cpu_temp", REC_DOUBLE, cpu_temp),
+    REC_COL("mem_total", REC_ULL, memory.total_ram),
+    REC_COL("mem_free", REC_ULL, memory.free_ram),
+    REC_COL("mem_used", REC_ULL, memory.used_ram),
+    REC_COL("mem_inactive", REC_ULL, memory.inactive_ram),
+    REC_COL("mem_wired", REC_ULL, memory.wired_ram),
+    REC_COL("mem_compressed", REC_ULL, memory.compressed_ram),
+    REC_COL("mem_pct", REC_DOUBLE, memory.ram_percentage),
+    REC_COL("swap_used", REC_ULL, memory.swap_used),
+    REC_COL("swap_total", REC_ULL, memory.swap_total),
+    REC_COL("swap_pct", REC_DOUBLE, memory.swap_percentage),
+    REC_COL("net_rx_rate", REC_DOUBLE, net.rx_rate),
+    REC_COL("net_tx_rate", REC_DOUBLE, net.tx_rate),
+    REC_COL("procs_total", REC_INT, procs.total),
+    REC_COL("procs_system", REC_INT, procs.system),
+    REC_COL("procs_user", REC_INT, procs.user),
+    REC_COL("procs_background", REC_INT, procs.background),
+    REC_COL("disk_total", REC_ULL, disk.total),
+    REC_COL("disk_used", REC_ULL, disk.used),
+    REC_COL("disk_free", REC_ULL, disk.free),
+    REC_COL("disk_pct", REC_DOUBLE, disk.percent_used),
+    REC_COL("cpu_freq_mhz", REC_DOUBLE, freq.avg_mhz),
+    REC_COL("cpu_throttle_rate", REC_DOUBLE, freq.throttle_rate),
+    REC_COL("vm_valid", REC_INT, vm.valid),
+    REC_COL("vm_swap_in", REC_DOUBLE, vm.rate[VM_SWAP_IN]),
+    REC_COL("vm_swap_out", REC_DOUBLE, vm.rate[VM_SWAP_OUT]),
+    REC_COL("vm_major_faults", REC_DOUBLE, vm.rate[VM_MAJOR_FAULTS]),
+    REC_COL("vm_minor_faults", REC_DOUBLE, vm.rate[VM_MINOR_FAULTS]),
+    REC_COL("vm_page_outs", REC_DOUBLE, vm.rate[VM_PAGE_OUTS]),
+    REC_COL("vm_page_scans", REC_DOUBLE, vm.rate[VM_PAGE_SCANS]),
+    REC_COL("vm_direct_reclaim", REC_DOUBLE, vm.rate[VM_DIRECT_RECLAIM]),
+    REC_COL("vm_compact_stalls", REC_DOUBLE, vm.rate[VM_COMPACT_STALLS]),
+    REC_COL("vm_thp_alloc", REC_DOUBLE, vm.rate[VM_THP_ALLOC]),
+    REC_COL("vm_thp_split", REC_DOUBLE, vm.rate[VM_THP_SPLIT]),
+    REC_COL("vm_compressions", REC_DOUBLE, vm.rate[VM_COMPRESSIONS]),
+    REC_COL("vm_decompressions", REC_DOUBLE, vm.rate[VM_DECOMPRESSIONS]),
+};
+
+#define REC_COLUMNS ((int)(sizeof(rec_columns) / sizeof(rec_columns[0])))
+#define REC_DATA_BLOCK_SIZE(columns) (sizeof(RecBlockHeader) + (size_t)(columns) * REC_BLOCK_SAMPLES * 8)
+#define REC_INDEX_BLOCK_SIZE (sizeof(RecBlockHeader) + REC_INDEX_EVERY * sizeof(RecIndexEntry))
+
+// Copia un campo de Sample a una celda de 8 bytes y viceversa
+static void rec_store_cell(unsigned char *cell, const Sample *s, const RecColumnDef *def)
+{
+    const unsigned char *field = (const unsigned char *)s + def->offset;
+    if (def->type == REC_INT)
+    {
+        int value;
+        memcpy(&value, field, sizeof(value));
+        int64_t wide = value;
+        memcpy(cell, &wide, 8);
+    }
+    else
+        memcpy(cell, field, 8);
+}
+
+static void rec_load_cell(Sample *s, const RecColumnDef *def, const unsigned char *cell)
+{
+    unsigned char *field = (unsigned char *)s + def->offset;
+    if (def->type == REC_INT)
+    {
+        int64_t wide;
+        memcpy(&wide, cell, 8);
+        int value = (int)wide;
+        memcpy(field, &value, sizeof(value));
+    }
+    else
+        memcpy(field, cell, 8);
+}
+
+typedef struct
+{
+    int fd;
+    unsigned char *block; // Bloque de datos en construcción
+    int block_count;
+    uint64_t block_first_ns;
+    uint64_t checkpoint_ns; // Última vez que el bloque parcial llegó al disco
+    uint64_t offset;        // Donde empieza el próximo bloque
+    RecIndexEntry index[REC_INDEX_EVERY];
+    int index_count;
+    unsigned long long samples;
+    int failed; // Un error de escritura detiene la grabación, no el monitor
+} Recorder;
+
+static int write_full(int fd, const void *buf, size_t len)
+{
+    const unsigned char *p = buf;
+    while (len > 0)
+    {
+        ssize_t n = write(fd, p, len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+int recorder_open(Recorder *rec, const char *path, int interval_ms, const SourceHost *source)
+{
+    memset(rec, 0, sizeof(*rec));
+    rec->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (rec->fd < 0)
+        return -1;
+    rec->block = calloc(1, REC_DATA_BLOCK_SIZE(REC_COLUMNS));
+    if (!rec->block)
+    {
+        close(rec->fd);
+        return -1;
+    }
+
+    RecHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, REC_MAGIC, sizeof(header.magic));
+    header.version = REC_VERSION;
+    header.byte_order = REC_BYTE_ORDER;
+    header.column_count = REC_COLUMNS;
+    header.block_samples = REC_BLOCK_SAMPLES;
+    header.index_every = REC_INDEX_EVERY;
+    header.interval_ms = (uint32_t)interval_ms;
+    header.created_ns = clock_ns(CLOCK_REALTIME);
+    snprintf(header.backend, sizeof(header.backend), "%s", collector->name);
+
+    RecColumn columns[REC_COLUMNS];
+    memset(columns, 0, sizeof(columns));
+    for (int i = 0; i < REC_COLUMNS; i++)
+    {
+        snprintf(columns[i].name, sizeof(columns[i].name), "%s", rec_columns[i].name);
+        columns[i].type = rec_columns[i].type;
+    }
+    if (write_full(rec->fd, &header, sizeof(header)) != 0 || write_full(rec->fd, columns, sizeof(columns)) != 0 ||
+        write_full(rec->fd, source, sizeof(*source)) != 0)
+    {
+        close(rec->fd);
+        free(rec->block);
+        return -1;
+    }
+    rec->offset = sizeof(header) + sizeof(columns) + sizeof(*source);
+    return 0;
+}
+
+static RecBlockHeader *recorder_seal_block(Recorder *rec)
+{
+    RecBlockHeader *bh = (RecBlockHeader *)rec->block;
+    bh->kind = REC_BLOCK_DATA;
+    bh->count = (uint32_t)rec->block_count;
+    bh->first_ns = rec->block_first_ns;
+    uint64_t last_ns;
+    memcpy(&last_ns, rec->block + sizeof(RecBlockHeader) + (size_t)(rec->block_count - 1) * 8, 8);
+    bh->last_ns = last_ns;
+    return bh;
+}
+
+// Escribe el bloque parcial en su lugar sin avanzar: el siguiente write() lo pisa
+static void recorder_checkpoint(Recorder *rec, uint64_t now_ns)
+{
+    rec->checkpoint_ns = now_ns;
+    if (rec->block_count == 0 || rec->failed)
+        return;
+    recorder_seal_block(rec);
+    size_t size = REC_DATA_BLOCK_SIZE(REC_COLUMNS);
+    ssize_t n;
+    do
+        n = pwrite(rec->fd, rec->block, size, (off_t)rec->offset);
+    while (n < 0 && errno == EINTR);
+    if (n != (ssize_t)size)
+        rec->failed = 1;
+}
+
+static void recorder_flush_block(Recorder *rec)
+{
+    if (rec->block_count == 0 || rec->failed)
+        return;
+
+    RecBlockHeader *bh = recorder_seal_block(rec);
+    size_t size = REC_DATA_BLOCK_SIZE(REC_COLUMNS);
+    if (write_full(rec->fd, rec->block, size) != 0)
+    {
+        rec->failed = 1;
+        return;
+    }
+    RecIndexEntry *ie = &rec->index[rec->index_count++];
+    ie->first_ns = bh->first_ns;
+    ie->last_ns = bh->last_ns;
+    ie->offset = rec->offset;
+    ie->count = bh->count;
+    rec->offset += size;
+    memset(rec->block, 0, size);
+    rec->block_count = 0;
+
+    if (rec->index_count == REC_INDEX_EVERY)
+    {
+        unsigned char index_block[REC_INDEX_BLOCK_SIZE];
+        RecBlockHeader ih = {REC_BLOCK_INDEX, REC_INDEX_EVERY, rec->index[0].first_ns, rec->index[REC_INDEX_EVERY - 1].last_ns, 0};
+        memcpy(index_block, &ih, sizeof(ih));
+        memcpy(index_block + sizeof(ih), rec->index, sizeof(rec->index));
+        if (write_full(rec->fd, index_block, sizeof(index_block)) != 0)
+            rec->failed = 1;
+        rec->offset += sizeof(index_block);
+        rec->index_count = 0;
+    }
+}
+
+// Agrega una muestra; solo escribe al archivo cuando se completa un bloque
+void recorder_append(Recorder *rec, const Sample *s)
+{
+    if (rec->failed || !s->memory_ok)
+        return;
+    if (rec->block_count == 0)
+        rec->block_first_ns = s->timestamp_ns;
+    unsigned char *columns = rec->block + sizeof(RecBlockHeader);
+    for (int c = 0; c < REC_COLUMNS; c++)
+        rec_store_cell(columns + ((size_t)c * REC_BLOCK_SAMPLES + rec->block_count) * 8, s, &rec_columns[c]);
+    rec->samples++;
+    if (++rec->block_count == REC_BLOCK_SAMPLES)
+    {
+        recorder_flush_block(rec);
+        rec->checkpoint_ns = s->timestamp_ns;
+    }
+    else if (s->timestamp_ns < rec->checkpoint_ns || s->timestamp_ns - rec->checkpoint_ns >= REC_CHECKPOINT_NS)
+        recorder_checkpoint(rec, s->timestamp_ns); // El reloj de pared puede retroceder
+}
+
+// Escribe el bloque parcial y un índice corto con los bloques del último grupo. La
+// reproducción no lo necesita (recorre esa cola bloque por bloque) pero deja el archivo
+// completo para otras herramientas.
+void recorder_close(Recorder *rec)
+{
+    recorder_flush_block(rec);
+    if (!rec->failed && rec->index_count > 0)
+    {
+        unsigned char index_block[REC_INDEX_BLOCK_SIZE];
+        memset(index_block, 0, sizeof(index_block));
+        RecBlockHeader ih = {REC_BLOCK_INDEX, (uint32_t)rec->index_count, rec->index[0].first_ns, rec->index[rec->index_count - 1].last_ns, 0};
+        memcpy(index_block, &ih, sizeof(ih));
+        memcpy(index_block + sizeof(ih), rec->index, (size_t)rec->index_count * sizeof(RecIndexEntry));
+        if (write_full(rec->fd, index_block, sizeof(index_block)) != 0)
+            rec->failed = 1;
+    }
+    if (rec->fd >= 0)
+        close(rec->fd);
+    free(rec->block);
+    rec->block = NULL;
+    rec->fd = -1;
+}
+
+typedef struct
+{
+    uint64_t first_ns;
+    unsigned long long first_sample; // Índice global de la primera muestra del bloque
+    int count;
+    const unsigned char *columns;
+} RecBlockRef;
+
+typedef struct
+{
+    unsigned char *map;
+    size_t size;
+    RecHeader header;
+    int col_map[REC_COLUMNS]; // Columna del archivo para cada columna conocida, -1 si falta
+    RecBlockRef *blocks;
+    int block_count;
+    unsigned long long sample_count;
+    SourceHost source;
+    int has_source; // 0 en grabaciones de la versión 1
+} Recording;
+
+static int recording_add_block(Recording *r, const RecBlockHeader *bh, uint64_t offset, int *capacity)
+{
+    if (bh->kind != REC_BLOCK_DATA || bh->count == 0 || bh->count > REC_BLOCK_SAMPLES)
+        return -1;
+    if (r->block_count == *capacity)
+    {
+        int new_capacity = *capacity ? *capacity * 2 : 64;
+        RecBlockRef *blocks = realloc(r->blocks, (size_t)new_capacity * sizeof(*blocks));
+        if (!blocks)
+            return -1;
+        r->blocks = blocks;
+        *capacity = new_capacity;
+    }
+    RecBlockRef *ref = &r->blocks[r->block_count++];
+    ref->first_ns = bh->first_ns;
+    ref->first_sample = r->sample_count;
+    ref->count = (int)bh->count;
+    ref->columns = r->map + offset + sizeof(RecBlockHeader);
+    r->sample_count += bh->count;
+    return 0;
+}
+
+void recording_close(Recording *r)
+{
+    if (r->map)
+        munmap(r->map, r->size);
+    free(r->blocks);
+    memset(r, 0, sizeof(*r));
+}
+
+// Mapea una grabación y arma la tabla de bloques. Devuelve 0 o -1 (con un mensaje en err).
+int recording_open(Recording *r, const char *path, char *err, size_t err_len)
+{
+    memset(r, 0, sizeof(*r));
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        snprintf(err, err_len, "%s: %s", path, strerror(errno));
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(RecHeader))
+    {
+        snprintf(err, err_len, "%s: archivo vacío o ilegible", path);
+        close(fd);
+        return -1;
+    }
+    r->size = (size_t)st.st_size;
+    void *map = mmap(NULL, r->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        snprintf(err, err_len, "%s: %s", path, strerror(errno));
+        return -1;
+    }
+    r->map = map;
+
+    memcpy(&r->header, r->map, sizeof(r->header));
+    const RecHeader *h = &r->header;
+    if (memcmp(h->magic, REC_MAGIC, sizeof(h->magic)) != 0 || h->version < 1 || h->version > REC_VERSION)
+    {
+        snprintf(err, err_len, "%s: no es una grabación de memoriuses", path);
+        recording_close(r);
+        return -1;
+    }
+    if (h->byte_order != REC_BYTE_ORDER || h->block_samples != REC_BLOCK_SAMPLES || h->index_every != REC_INDEX_EVERY)
+    {
+        snprintf(err, err_len, "%s: grabación de otra arquitectura o versión", path);
+        recording_close(r);
+        return -1;
+    }
+    size_t data_start = sizeof(RecHeader) + (size_t)h->column_count * sizeof(RecColumn);
+    r->has_source = h->version >= 2;
+    size_t source_size = h->version >= 3 ? sizeof(SourceHost) : SOURCE_HOST_V2_SIZE;
+    if (r->has_source)
+        data_start += source_size;
+    if (data_start > r->size)
+    {
+        snprintf(err, err_len, "%s: encabezado truncado", path);
+        recording_close(r);
+        return -1;
+    }
+    if (r->has_source)
+    {
+        memset(&r->source, 0, sizeof(r->source));
+        memcpy(&r->source, r->map + data_start - source_size, source_size);
+        char *fields[] = {r->source.hostname, r->source.os_version, r->source.kernel, r->source.ip_addr, r->source.interfaces};
+        for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++)
+            fields[i][63] = '\0'; // El archivo puede venir de cualquier lado
+        r->source.interfaces[sizeof(r->source.interfaces) - 1] = '\0';
+        r->source.cpu_name[sizeof(r->source.cpu_name) - 1] = '\0';
+    }
+
+    // Las columnas se buscan por nombre: las desconocidas se ignoran y las que faltan quedan en cero
+    for (int i = 0; i < REC_COLUMNS; i++)
+    {
+        r->col_map[i] = -1;
+        for (uint32_t c = 0; c < h->column_count; c++)
+        {
+            RecColumn col;
+            memcpy(&col, r->map + sizeof(RecHeader) + c * sizeof(RecColumn), sizeof(col));
+            col.name[sizeof(col.name) - 1] = '\0';
+            if (strcmp(col.name, rec_columns[i].name) == 0 && col.type == (uint32_t)rec_columns[i].type)
+            {
+                r->col_map[i] = (int)c;
+                break;
+            }
+        }
+    }
+    if (r->col_map[0] < 0)
+    {
+        snprintf(err, err_len, "%s: falta la columna de tiempo", path);
+        recording_close(r);
+        return -1;
+    }
+
+    // Los grupos completos se leen desde su bloque índice, sin tocar los datos
+    size_t data_size = REC_DATA_BLOCK_SIZE(h->column_count);
+    size_t group_size = REC_INDEX_EVERY * data_size + REC_INDEX_BLOCK_SIZE;
+    int capacity = 0;
+    uint64_t offset = data_start;
+    while (offset + group_size <= r->size)
+    {
+        RecBlockHeader ih;
+        memcpy(&ih, r->map + offset + REC_INDEX_EVERY * data_size, sizeof(ih));
+        if (ih.kind != REC_BLOCK_INDEX || ih.count != REC_INDEX_EVERY)
+            break;
+        for (int i = 0; i < REC_INDEX_EVERY; i++)
+        {
+            RecIndexEntry ie;
+            memcpy(&ie, r->map + offset + REC_INDEX_EVERY * data_size + sizeof(ih) + i * sizeof(ie), sizeof(ie));
+            RecBlockHeader bh = {REC_BLOCK_DATA, (uint32_t)ie.count, ie.first_ns, ie.last_ns, 0};
+            if (ie.offset + data_size > r->size || recording_add_block(r, &bh, ie.offset, &capacity) != 0)
+                break;
+        }
+        offset += group_size;
+    }
+    // Cola sin índice completo (grupo incompleto o grabación interrumpida); el índice corto
+    // del cierre no es un bloque de datos y corta el recorrido
+    while (offset + data_size <= r->size)
+    {
+        RecBlockHeader bh;
+        memcpy(&bh, r->map + offset, sizeof(bh));
+        if (recording_add_block(r, &bh, offset, &capacity) != 0)
+            break;
+        offset += data_size;
+    }
+    if (r->sample_count == 0)
+    {
+        snprintf(err, err_len, "%s: la grabación no tiene muestras", path);
+        recording_close(r);
+        return -1;
+    }
+    return 0;
+}
+
+static const RecBlockRef *recording_block_of(const Recording *r, unsigned long long idx)
+{
+    int lo = 0, hi = r->block_count - 1;
+    while (lo < hi)
+    {
+        int mid = (lo + hi + 1) / 2;
+        if (r->blocks[mid].first_sample <= idx)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    return &r->blocks[lo];
+}
+
+// Reconstruye la muestra idx (0 .. sample_count-1)
+void recording_read(const Recording *r, unsigned long long idx, Sample *s)
+{
+    const RecBlockRef *b = recording_block_of(r, idx);
+    int row = (int)(idx - b->first_sample);
+    memset(s, 0, offsetof(Sample, top));
+    for (int i = 0; i < REC_COLUMNS; i++)
+    {
+        if (r->col_map[i] < 0)
+            continue;
+        const unsigned char *cell = b->columns + ((size_t)r->col_map[i] * REC_BLOCK_SAMPLES + row) * 8;
+        rec_load_cell(s, &rec_columns[i], cell);
+    }
+    s->seq = idx + 1;
+    s->memory_ok = 1;
+}
+
+unsigned long long recording_time(const Recording *r, unsigned long long idx)
+{
+    const RecBlockRef *b = recording_block_of(r, idx);
+    uint64_t ts;
+    memcpy(&ts, b->columns + ((size_t)r->col_map[0] * REC_BLOCK_SAMPLES + (idx - b->first_sample)) * 8, 8);
+    return ts;
+}
+
+// Primera muestra con tiempo >= ts_ns (sample_count si no hay ninguna)
+unsigned long long recording_seek(const Recording *r, unsigned long long ts_ns)
+{
+    unsigned long long lo = 0, hi = r->sample_count;
+    while (lo < hi)
+    {
+        unsigned long long mid = lo + (hi - lo) / 2;
+        if (recording_time(r, mid) < ts_ns)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+// --- DATOS DEL EQUIPO ---
+
+// Lo que no cambia mientras corre el monitor se lee una vez al inicio. Direcciones e
+// interfaces se releen solo cuando el kernel avisa (rtnetlink en Linux, socket de rutas
+// en macOS), así que dibujar el panel no cuesta ninguna llamada al sistema.
+typedef struct
+{
+    char cpu_name[128];
+    int cpu_count;
+    double cpu_speed_ghz; // Frecuencia nominal, 0 si no se conoce
+    char hostname[64];
+    char os_version[64];
+    char kernel[64];
+    char ip_addr[64];     // Primera IPv4 que no es loopback, con su interfaz
+    char interfaces[256]; // Interfaces activas con dirección, sin loopback
+    unsigned long long generation; // Sube con cada relectura de direcciones
+    int event_fd;                  // -1 si no hay avisos del kernel
+} HostFacts;
+
+static HostFacts host = {.event_fd = -1};
+
+static void host_read_cpu(HostFacts *h)
+{
+#if defined(__APPLE__)
+    size_t len = sizeof(h->cpu_name);
+    COUNT_SYSCALL(sysctlbyname("machdep.cpu.brand_string", h->cpu_name, &len, NULL, 0));
+    int cpu_count;
+    len = sizeof(cpu_count);
+    if (COUNT_SYSCALL(sysctlbyname("hw.ncpu", &cpu_count, &len, NULL, 0)) == 0)
+        h->cpu_count = cpu_count;
+    uint64_t hz = 0;
+    len = sizeof(hz);
+    if (COUNT_SYSCALL(sysctlbyname("hw.cpufrequency", &hz, &len, NULL, 0)) == 0 && hz > 0)
+        h->cpu_speed_ghz = hz / 1e9;
+#else
+    long cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpu_count > 0)
+        h->cpu_count = (int)cpu_count;
+
+    char path[PATH_MAX], line[256];
+    snprintf(path, sizeof(path), "%s/cpuinfo", linux_proc_root);
+    FILE *fp = fopen(path, "r");
+    if (fp)
+    {
+        while (fgets(line, sizeof(line), fp))
+        {
+            char *value = strchr(line, ':');
+            if (!value)
+                continue;
+            value += (value[1] == ' ') ? 2 : 1;
+            value[strcspn(value, "\n")] = 0;
+            if (strncmp(line, "model name", 10) == 0 && !h->cpu_name[0])
+                snprintf(h->cpu_name, sizeof(h->cpu_name), "%s", value);
+            else if (strncmp(line, "cpu MHz", 7) == 0 && h->cpu_speed_ghz == 0)
+                h->cpu_speed_ghz = atof(value) / 1000.0;
+            if (h->cpu_name[0] && h->cpu_speed_ghz > 0)
+                break;
+        }
+        fclose(fp);
+    }
+    // "cpu MHz" es la de ese instante; la nominal es base_frequency (intel_pstate) o
+    // cpuinfo_base_freq (amd-pstate). cpuinfo_max_freq incluye el turbo
+    static const char *const base_files[] = {"base_frequency", "cpuinfo_base_freq"};
+    for (size_t f = 0; f < sizeof(base_files) / sizeof(base_files[0]); f++)
+    {
+        snprintf(path, sizeof(path), "%s/devices/system/cpu/cpu0/cpufreq/%s", linux_sysfs_root, base_files[f]);
+        unsigned int khz = linux_read_khz(path);
+        if (khz > 0)
+        {
+            h->cpu_speed_ghz = khz / 1e6;
+            break;
+        }
+    }
+#endif
+}
+
+static void host_read_os(HostFacts *h)
+{
+    struct utsname uts;
+    if (COUNT_SYSCALL(uname(&uts)) == 0)
+        snprintf(h->kernel, sizeof(h->kernel), "%.12s %.50s", uts.sysname, uts.release);
+#if defined(__APPLE__)
+    char version[32];
+    size_t len = sizeof(version);
+    if (COUNT_SYSCALL(sysctlbyname("kern.osproductversion", version, &len, NULL, 0)) == 0)
+        snprintf(h->os_version, sizeof(h->os_version), "macOS %s", version);
+#else
+    FILE *fp = fopen("/etc/os-release", "r");
+    if (!fp)
+        return;
+    char line[256];
+    while (fgets(line, sizeof(line), fp))
+    {
+        if (strncmp(line, "PRETTY_NAME=", 12) != 0)
+            continue;
+        char *value = line + 12;
+        value[strcspn(value, "\n")] = 0;
+        size_t len = strlen(value);
+        if (len >= 2 && value[0] == '"' && value[len - 1] == '"')
+        {
+            value[len - 1] = 0;
+            value++;
+        }
+        snprintf(h->os_version, sizeof(h->os_version), "%.63s", value);
+        break;
+    }
+    fclose(fp);
+#endif
+}
+
+// Direcciones e interfaces activas con getifaddrs
+static void host_read_addresses(HostFacts *h)
+{
+    struct ifaddrs *ifap;
+    snprintf(h->ip_addr, sizeof(h->ip_addr), "N/D");
+    h->interfaces[0] = 0;
+    h->generation++;
+    if (COUNT_SYSCALL(getifaddrs(&ifap)) != 0)
+        return;
+    int have_ip = 0;
+    for (struct ifaddrs *ifa = ifap; ifa; ifa = ifa->ifa_next)
+    {
+        if (!ifa->ifa_addr || (ifa->ifa_flags & IFF_LOOPBACK) || !(ifa->ifa_flags & IFF_UP))
+            continue;
+        int family = ifa->ifa_addr->sa_family;
+        if (family != AF_INET && family != AF_INET6)
+            continue;
+        if (family == AF_INET && !have_ip)
+        {
+            char addr[INET_ADDRSTRLEN];
+            inet_ntop(AF_INET, &((struct sockaddr_in *)ifa->ifa_addr)->sin_addr, addr, sizeof(addr));
+            snprintf(h->ip_addr, sizeof(h->ip_addr), "%s (%.*s)", addr, IFNAMSIZ, ifa->ifa_name);
+            have_ip = 1;
+        }
+        // Una interfaz aparece una vez por dirección: listarla solo la primera
+        size_t name_len = strlen(ifa->ifa_name), len = strlen(h->interfaces);
+        int listed = 0;
+        for (const char *p = h->interfaces; (p = strstr(p, ifa->ifa_name)) != NULL; p += name_len)
+            listed |= (p == h->interfaces || p[-1] == ' ') && (p[name_len] == ' ' || p[name_len] == 0);
+        if (!listed)
+            snprintf(h->interfaces + len, sizeof(h->interfaces) - len, "%s%s", len > 0 ? " " : "", ifa->ifa_name);
+    }
+    freeifaddrs(ifap);
+    if (!h->interfaces[0])
+        snprintf(h->interfaces, sizeof(h->interfaces), "N/D");
+}
+
+// Lee todos los datos del equipo; se llama una vez al iniciar
+void host_facts_load(HostFacts *h)
+{
+    int event_fd = h->event_fd;
+    memset(h, 0, sizeof(*h));
+    h->event_fd = event_fd;
+    h->cpu_count = 1;
+    host_read_cpu(h);
+    host_read_os(h);
+    if (gethostname(h->hostname, sizeof(h->hostname)) != 0)
+        h->hostname[0] = 0;
+    host_read_addresses(h);
+    char *fields[] = {h->cpu_name, h->hostname, h->os_version, h->kernel};
+    for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++)
+        if (!fields[i][0])
+            strcpy(fields[i], "N/D");
+}
+
+// Se suscribe a los cambios de direcciones y de estado de las interfaces
+int host_events_open(HostFacts *h)
+{
+#if defined(__APPLE__)
+    h->event_fd = socket(PF_ROUTE, SOCK_RAW, AF_UNSPEC);
+    if (h->event_fd >= 0)
+    {
+        fcntl(h->event_fd, F_SETFL, O_NONBLOCK);
+        fcntl(h->event_fd, F_SETFD, FD_CLOEXEC);
+    }
+#else
+    h->event_fd = socket(AF_NETLINK, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (h->event_fd >= 0)
+    {
+        struct sockaddr_nl local;
+        memset(&local, 0, sizeof(local));
+        local.nl_family = AF_NETLINK;
+        local.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR;
+        if (bind(h->event_fd, (struct sockaddr *)&local, sizeof(local)) != 0)
+        {
+            close(h->event_fd);
+            h->event_fd = -1;
+        }
+    }
+#endif
+    return h->event_fd;
+}
+
+// Vacía los avisos pendientes y relee las direcciones si alguno las afecta.
+// Devuelve 1 si cambiaron los datos.
+int host_events_handle(HostFacts *h)
+{
+    char buf[8192];
+    int relevant = 0;
+    ssize_t len;
+    while ((len = COUNT_SYSCALL(recv(h->event_fd, buf, sizeof(buf), 0))) > 0)
+    {
+#if defined(__APPLE__)
+        // El socket de rutas también informa rutas y ARP: interesan solo direcciones e interfaces
+        for (ssize_t off = 0; off + (ssize_t)sizeof(struct rt_msghdr) <= len;)
+        {
+            const struct rt_msghdr *rtm = (const struct rt_msghdr *)(buf + off);
+            if (rtm->rtm_msglen == 0)
+                break;
+            relevant |= rtm->rtm_type == RTM_NEWADDR || rtm->rtm_type == RTM_DELADDR || rtm->rtm_type == RTM_IFINFO;
+            off += rtm->rtm_msglen;
+        }
+#else
+        for (struct nlmsghdr *nh = (struct nlmsghdr *)buf; NLMSG_OK(nh, len); nh = NLMSG_NEXT(nh, len))
+            relevant |= nh->nlmsg_type == RTM_NEWADDR || nh->nlmsg_type == RTM_DELADDR ||
+                        nh->nlmsg_type == RTM_NEWLINK || nh->nlmsg_type == RTM_DELLINK;
+#endif
+    }
+    // ENOBUFS: se perdieron avisos, releer por las dudas
+    if (len < 0 && errno == ENOBUFS)
+        relevant = 1;
+    if (relevant)
+        host_read_addresses(h);
+    return relevant;
+}
+
+void host_events_close(HostFacts *h)
+{
+    if (h->event_fd >= 0)
+        close(h->event_fd);
+    h->event_fd = -1;
+}
+
+// Horas desde el arranque, contando suspensiones: el reloj se lee sin llamar al sistema
+double host_uptime_hours(void)
+{
+#if defined(__APPLE__)
+    return clock_ns(CLOCK_MONOTONIC) / 3.6e12;
+#else
+    return clock_ns(CLOCK_BOOTTIME) / 3.6e12;
+#endif
+}
+
+// Lo que se guarda en la grabación o en el segmento compartido
+void host_source_fill(const HostFacts *h, SourceHost *out)
+{
+    memset(out, 0, sizeof(*out));
+    snprintf(out->hostname, sizeof(out->hostname), "%s", h->hostname);
+    snprintf(out->os_version, sizeof(out->os_version), "%s", h->os_version);
+    snprintf(out->kernel, sizeof(out->kernel), "%s", h->kernel);
+    snprintf(out->ip_addr, sizeof(out->ip_addr), "%s", h->ip_addr);
+    snprintf(out->interfaces, sizeof(out->interfaces), "%s", h->interfaces);
+    out->cpu_count = h->cpu_count;
+    snprintf(out->cpu_name, sizeof(out->cpu_name), "%s", h->cpu_name);
+    out->cpu_speed_ghz = h->cpu_speed_ghz;
+    out->boot_ns = clock_ns(CLOCK_REALTIME) - (uint64_t)(host_uptime_hours() * 3.6e12);
+}
+
+// --- ESTADÍSTICAS POR VENTANA ---
+
+// Mínimo, máximo, media y percentiles de cada métrica sobre el último minuto, los
+// últimos 5 minutos y la última hora. Cada ventana se divide en WSTAT_BUCKETS tramos
+// de tiempo (1 s, 5 s y 1 min): la ventana avanza de a un tramo y lo que vence se
+// descuenta de los totales, así que cada muestra cuesta O(1) amortizado.
+//  - min/max: colas monótonas sobre los tramos cerrados, más el tramo abierto
+//  - media: suma y cantidad corridas
+//  - percentiles: histograma con WSTAT_BINS cubetas (lineal para %, logarítmico para
+//    tasas), que a diferencia de un t-digest admite restar el tramo que vence
+
+#define WSTAT_BUCKETS 60
+#define WSTAT_BINS 256
+#define WSTAT_RATE_STEPS 6 // Cubetas por octava de las tasas: de 1 B/s a 4 TB/s en 252 cubetas
+
+typedef enum
+{
+    WSTAT_RAM,
+    WSTAT_SWAP,
+    WSTAT_CPU,
+    WSTAT_NET_RX,
+    WSTAT_NET_TX,
+    WSTAT_DISK_READ,
+    WSTAT_DISK_WRITE,
+    WSTAT_METRICS
+} WindowMetric;
+
+typedef enum
+{
+    WSTAT_1M,
+    WSTAT_5M,
+    WSTAT_1H,
+    WSTAT_WINDOWS
+} WindowSpan;
+
+static const struct
+{
+    const char *name;
+    int rate; // Bytes por segundo: cubetas logarítmicas
+} wstat_metrics[WSTAT_METRICS] = {
+    [WSTAT_RAM] = {"RAM %", 0},
+    [WSTAT_SWAP] = {"Swap %", 0},
+    [WSTAT_CPU] = {"CPU %", 0},
+    [WSTAT_NET_RX] = {"Red baja/s", 1},
+    [WSTAT_NET_TX] = {"Red sube/s", 1},
+    [WSTAT_DISK_READ] = {"Lectura/s", 1},
+    [WSTAT_DISK_WRITE] = {"Escritura/s", 1},
+};
+
+static const struct
+{
+    const char *name;
+    unsigned int bucket_s; // Duración de cada tramo
+} wstat_windows[WSTAT_WINDOWS] = {
+    [WSTAT_1M] = {"último minuto", 1},
+    [WSTAT_5M] = {"últimos 5 minutos", 5},
+    [WSTAT_1H] = {"última hora", 60},
+};
+
+typedef struct
+{
+    unsigned long long open; // Número absoluto del tramo abierto, 0 si la ventana está vacía
+    // Tramos en un anillo indexado por número % WSTAT_BUCKETS
+    double sum[WSTAT_BUCKETS];
+    unsigned int count[WSTAT_BUCKETS];
+    float min[WSTAT_BUCKETS], max[WSTAT_BUCKETS];
+    unsigned short hist[WSTAT_BUCKETS][WSTAT_BINS];
+    // Totales de los tramos vigentes
+    double total_sum;
+    unsigned int total_count;
+    unsigned int total_hist[WSTAT_BINS];
+    // Colas monótonas de números de tramo cerrados: valores crecientes en min_q, decrecientes en max_q
+    unsigned long long min_q[WSTAT_BUCKETS], max_q[WSTAT_BUCKETS];
+    int min_head, min_len, max_head, max_len;
+} WindowAgg;
+
+typedef struct
+{
+    WindowAgg agg[WSTAT_METRICS][WSTAT_WINDOWS];
+} WindowStats;
+
+typedef struct
+{
+    unsigned int count;
+    double min, max, mean, p95, p99;
+} WindowSummary;
+
+// Las tasas usan cubetas lineales dentro de cada potencia de dos (como HdrHistogram),
+// sin recurrir a libm
+static int wstat_bin(int rate, double v)
+{
+    double pos = v * WSTAT_BINS / 100.0;
+    if (rate)
+    {
+        double x = v < 0 ? 1 : v + 1;
+        int octave = x >= 0x1p62 ? 62 : 63 - __builtin_clzll((unsigned long long)x);
+        pos = octave * WSTAT_RATE_STEPS + (x / (double)(1ULL << octave) - 1) * WSTAT_RATE_STEPS;
+    }
+    return pos < 0 ? 0 : pos >= WSTAT_BINS ? WSTAT_BINS - 1 : (int)pos;
+}
+
+// Valor en una posición fraccionaria de las cubetas; la parte entera es la cubeta
+static double wstat_bin_edge(int rate, double pos)
+{
+    if (!rate)
+        return pos * 100.0 / WSTAT_BINS;
+    int octave = (int)(pos / WSTAT_RATE_STEPS);
+    return (double)(1ULL << octave) * (1 + (pos - octave * WSTAT_RATE_STEPS) / WSTAT_RATE_STEPS) - 1;
+}
+
+// Agrega un tramo cerrado a las colas monótonas
+static void wstat_close_bucket(WindowAgg *a, unsigned long long b)
+{
+    int slot = b % WSTAT_BUCKETS;
+    if (a->count[slot] == 0)
+        return;
+    while (a->min_len > 0 && a->min[a->min_q[(a->min_head + a->min_len - 1) % WSTAT_BUCKETS] % WSTAT_BUCKETS] >= a->min[slot])
+        a->min_len--;
+    a->min_q[(a->min_head + a->min_len++) % WSTAT_BUCKETS] = b;
+    while (a->max_len > 0 && a->max[a->max_q[(a->max_head + a->max_len - 1) % WSTAT_BUCKETS] % WSTAT_BUCKETS] <= a->max[slot])
+        a->max_len--;
+    a->max_q[(a->max_head + a->max_len++) % WSTAT_BUCKETS] = b;
+}
+
+// Descuenta de los totales el tramo que ocupa el lugar y lo deja vacío
+static void wstat_expire_slot(WindowAgg *a, int slot)
+{
+    if (a->count[slot] == 0)
+        return;
+    a->total_sum -= a->sum[slot];
+    a->total_count -= a->count[slot];
+    for (int i = 0; i < WSTAT_BINS; i++)
+        a->total_hist[i] -= a->hist[slot][i];
+    memset(a->hist[slot], 0, sizeof(a->hist[slot]));
+    a->sum[slot] = 0;
+    a->count[slot] = 0;
+}
+
+static void wstat_add(WindowAgg *a, int rate, unsigned long long b, double v)
+{
+    if (a->open == 0 || b < a->open)
+    {
+        // Primera muestra, o el tiempo retrocedió (salto en una grabación): empezar de nuevo
+        memset(a, 0, sizeof(*a));
+        a->open = b;
+    }
+    else if (b > a->open)
+    {
+        wstat_close_bucket(a, a->open);
+        // Vencen los tramos que quedan fuera de la ventana; tras un hueco largo, todos
+        unsigned long long steps = MIN(b - a->open, (unsigned long long)WSTAT_BUCKETS);
+        for (unsigned long long i = 1; i <= steps; i++)
+            wstat_expire_slot(a, (a->open + i) % WSTAT_BUCKETS);
+        a->open = b;
+        unsigned long long oldest = b >= WSTAT_BUCKETS - 1 ? b - (WSTAT_BUCKETS - 1) : 0;
+        while (a->min_len > 0 && a->min_q[a->min_head] < oldest)
+        {
+            a->min_head = (a->min_head + 1) % WSTAT_BUCKETS;
+            a->min_len--;
+        }
+        while (a->max_len > 0 && a->max_q[a->max_head] < oldest)
+        {
+            a->max_head = (a->max_head + 1) % WSTAT_BUCKETS;
+            a->max_len--;
+        }
+    }
+
+    int slot = b % WSTAT_BUCKETS;
+    int bin = wstat_bin(rate, v);
+    if (a->count[slot] == 0 || v < a->min[slot])
+        a->min[slot] = (float)v;
+    if (a->count[slot] == 0 || v > a->max[slot])
+        a->max[slot] = (float)v;
+    a->sum[slot] += v;
+    a->count[slot]++;
+    if (a->hist[slot][bin] < USHRT_MAX)
+    {
+        a->hist[slot][bin]++;
+        a->total_hist[bin]++;
+    }
+    a->total_sum += v;
+    a->total_count++;
+}
+
+// Percentil q (0-1) con interpolación dentro de la cubeta, acotado al mínimo y máximo reales
+static double wstat_quantile(const WindowAgg *a, int rate, double q, double lo, double hi)
+{
+    unsigned int hist_total = 0;
+    for (int i = 0; i < WSTAT_BINS; i++)
+        hist_total += a->total_hist[i];
+    double rank = q * hist_total;
+    unsigned int seen = 0;
+    for (int i = 0; i < WSTAT_BINS; i++)
+    {
+        if (a->total_hist[i] == 0 || seen + a->total_hist[i] < rank)
+        {
+            seen += a->total_hist[i];
+            continue;
+        }
+        double v = wstat_bin_edge(rate, i + (rank - seen) / a->total_hist[i]);
+        return v < lo ? lo : v > hi ? hi : v;
+    }
+    return hi;
+}
+
+void wstat_summary(const WindowAgg *a, int rate, WindowSummary *out)
+{
+    memset(out, 0, sizeof(*out));
+    out->count = a->total_count;
+    if (a->total_count == 0)
+        return;
+    int open = a->open % WSTAT_BUCKETS;
+    out->min = a->count[open] ? a->min[open] : INFINITY;
+    out->max = a->count[open] ? a->max[open] : -INFINITY;
+    if (a->min_len > 0)
+        out->min = MIN(out->min, a->min[a->min_q[a->min_head] % WSTAT_BUCKETS]);
+    if (a->max_len > 0)
+        out->max = MAX(out->max, a->max[a->max_q[a->max_head] % WSTAT_BUCKETS]);
+    out->mean = a->total_sum / a->total_count;
+    out->p95 = wstat_quantile(a, rate, 0.95, out->min, out->max);
+    out->p99 = wstat_quantile(a, rate, 0.99, out->min, out->max);
+}
+
+// Suma de E/S de los dispositivos que respaldan algún montaje (sin contar dos veces
+// un disco y sus particiones)
+static void wstat_disk_rates(const Sample *s, double *read_bps, double *write_bps)
+{
+    *read_bps = *write_bps = 0;
+    for (int i = 0; i < s->mounts.count; i++)
+    {
+        const DiskIoRate *r = disk_io_for_mount(&s->disk_io, &s->mounts.mounts[i]);
+        int repeated = 0;
+        for (int j = 0; j < i && r; j++)
+            repeated |= disk_io_for_mount(&s->disk_io, &s->mounts.mounts[j]) == r;
+        if (r && !repeated)
+        {
+            *read_bps += r->read_bps;
+            *write_bps += r->write_bps;
+        }
+    }
+}
+
+void wstat_record(WindowStats *ws, const Sample *s)
+{
+    double values[WSTAT_METRICS];
+    values[WSTAT_RAM] = s->memory.ram_percentage;
+    values[WSTAT_SWAP] = s->memory.swap_percentage;
+    values[WSTAT_CPU] = s->cpu_usage;
+    values[WSTAT_NET_RX] = s->net.rx_rate;
+    values[WSTAT_NET_TX] = s->net.tx_rate;
+    wstat_disk_rates(s, &values[WSTAT_DISK_READ], &values[WSTAT_DISK_WRITE]);
+    unsigned long long sec = s->timestamp_ns / 1000000000ULL;
+    for (int m = 0; m < WSTAT_METRICS; m++)
+        for (int w = 0; w < WSTAT_WINDOWS; w++)
+            wstat_add(&ws->agg[m][w], wstat_metrics[m].rate, sec / wstat_windows[w].bucket_s + 1, values[m]);
+}
+
+void wstat_reset(WindowStats *ws)
+{
+    memset(ws, 0, sizeof(*ws));
+}
+
+// --- INTERFAZ ---
+
+// Estado propio de la UI: historiales y preferencias del usuario
+typedef struct
+{
+    HistoryStore history;
+    int zoom; // Nivel del historial que muestran los gráficos
+
+    // Últimas muestras de ocupación por núcleo, [tiempo][núcleo] en % (0-100)
+    unsigned char core_history[CORE_HISTORY_CAPACITY][CPU_MAX_CORES];
+    int core_history_idx; // Próxima fila a escribir
+    int core_history_count;
+    int core_count;
+    CpuCoreUsage cores; // Desglose de la última muestra
+
+    double net_down_max;
+    double net_up_max;
+
+    ProcQuery proc_query;
+    int editing_filter;
+    int interval_ms;
+    int replaying;   // Se muestra una grabación en lugar del equipo local
+    const SourceHost *source; // Equipo de la grabación o del publicador, NULL si es este o no se sabe
+    int show_self;   // Panel con el consumo del propio monitor
+    int stats_window; // Ventana del panel de estadísticas, -1 si está oculto
+    char status[96]; // Estado de la grabación o reproducción, vacío si no hay
+
+    WindowStats stats;
+} UiState;
+
+// Incorpora una muestra nueva a los historiales de la UI
+void ui_record_sample(UiState *ui, const Sample *s)
+{
+    if (!s->memory_ok)
+        return;
+
+    // Actualizar historiales de memoria y CPU
+    double values[HIST_METRICS];
+    values[HIST_RAM] = s->memory.ram_percentage;
+    values[HIST_CPU] = s->cpu_usage;
+    values[HIST_SWAP_IO] = vm_rate_or_zero(&s->vm, VM_SWAP_IN) + vm_rate_or_zero(&s->vm, VM_SWAP_OUT);
+    values[HIST_MAJOR_FAULTS] = vm_rate_or_zero(&s->vm, VM_MAJOR_FAULTS);
+    values[HIST_CPU_FREQ] = s->freq.avg_mhz;
+    values[HIST_CPU_THROTTLE] = isnan(s->freq.throttle_rate) ? 0 : s->freq.throttle_rate;
+    // Las series por nodo se suman recién cuando aparecen dos nodos; solo crecen
+    if (s->numa.count >= 2)
+        ui->history.numa_nodes = MAX(ui->history.numa_nodes, MIN(s->numa.count, NUMA_HIST_NODES));
+    for (int i = 0; i < NUMA_HIST_NODES; i++)
+        values[HIST_NUMA_RAM + i] = i < s->numa.count ? s->numa.nodes[i].ram_pct : 0;
+    hist_add(&ui->history, s->timestamp_ns, values);
+    wstat_record(&ui->stats, s);
+
+    if (s->cores.count > 0)
+    {
+        if (s->cores.count != ui->core_count)
+        {
+            ui->core_history_idx = ui->core_history_count = 0;
+            ui->core_count = s->cores.count;
+        }
+        unsigned char *row = ui->core_history[ui->core_history_idx];
+        for (int c = 0; c < s->cores.count; c++)
+            row[c] = (unsigned char)(s->cores.busy[c] + 0.5f);
+        ui->core_history_idx = (ui->core_history_idx + 1) % CORE_HISTORY_CAPACITY;
+        if (ui->core_history_count < CORE_HISTORY_CAPACITY)
+            ui->core_history_count++;
+        ui->cores = s->cores;
+    }
+
+    double net_down = s->net.rx_rate * 8.0 / (1024 * 1024); // Mb/s
+    double net_up = s->net.tx_rate * 8.0 / (1024 * 1024);   // Mb/s
+    if (net_down > ui->net_down_max)
+        ui->net_down_max = net_down;
+    if (net_up > ui->net_up_max)
+        ui->net_up_max = net_up;
+}
+
+void ui_reset_history(UiState *ui)
+{
+    hist_reset(&ui->history);
+    wstat_reset(&ui->stats);
+    ui->core_history_idx = ui->core_history_count = 0;
+}
+
+void ui_init(UiState *ui, int interval_ms)
+{
+    memset(ui, 0, sizeof(*ui));
+    ui->net_down_max = ui->net_up_max = 1;
+    ui->proc_query.sort = PROC_SORT_CPU;
+    ui->interval_ms = interval_ms;
+    ui->stats_window = -1;
+}
+
+// Reproducción de una grabación: reemplaza al muestreador como fuente de muestras
+#define PLAYER_MIN_TICK_MS 20
+#define PLAYER_MAX_SPEED 256.0
+#define PLAYER_MIN_SPEED (1.0 / 16)
+
+typedef struct
+{
+    Recording rec;
+    unsigned long long pos;          // Próxima muestra a mostrar
+    unsigned long long play_ns;      // Tiempo de la grabación ya reproducido
+    unsigned long long last_tick_ns; // CLOCK_MONOTONIC del último avance
+    double speed;
+    int paused;
+    int timer_fd;
+} Player;
+
+void player_rearm(Player *pl)
+{
+    unsigned long long interval_ns = (pl->rec.header.interval_ms ? pl->rec.header.interval_ms : 1000) * 1000000ULL;
+    unsigned long long tick_ns = (unsigned long long)(interval_ns / pl->speed);
+    if (tick_ns < PLAYER_MIN_TICK_MS * 1000000ULL)
+        tick_ns = PLAYER_MIN_TICK_MS * 1000000ULL;
+    if (tick_ns > interval_ns)
+        tick_ns = interval_ns;
+    timer_arm(pl->timer_fd, tick_ns);
+}
+
+void ui_player_status(UiState *ui, const Player *pl)
+{
+    snprintf(ui->status, sizeof(ui->status), "reproduciendo x%g%s  muestra %llu/%llu", pl->speed,
+             pl->paused ? " (pausa)" : "", pl->pos, pl->rec.sample_count);
+}
+
+// Avanza el reloj de reproducción y pasa a la UI las muestras que ya corresponden.
+// Devuelve distinto de cero si hay algo nuevo que dibujar.
+int ui_player_advance(UiState *ui, Player *pl, Sample *latest)
+{
+    unsigned long long now = clock_ns(CLOCK_MONOTONIC);
+    if (!pl->paused)
+        pl->play_ns += (unsigned long long)((now - pl->last_tick_ns) * pl->speed);
+    pl->last_tick_ns = now;
+
+    int shown = 0;
+    while (pl->pos < pl->rec.sample_count && recording_time(&pl->rec, pl->pos) <= pl->play_ns)
+    {
+        recording_read(&pl->rec, pl->pos++, latest);
+        ui_record_sample(ui, latest);
+        shown++;
+    }
+    if (pl->pos == pl->rec.sample_count && !pl->paused)
+    {
+        pl->paused = 1; // Fin de la grabación
+        shown++;
+    }
+    if (shown)
+        ui_player_status(ui, pl);
+    return shown;
+}
+
+// Salta a la muestra idx reconstruyendo los historiales con las muestras que caben en
+// el nivel más largo
+void ui_player_seek(UiState *ui, Player *pl, unsigned long long idx, Sample *latest)
+{
+    if (idx >= pl->rec.sample_count)
+        idx = pl->rec.sample_count - 1;
+    ui_reset_history(ui);
+    unsigned long long target_ns = recording_time(&pl->rec, idx);
+    unsigned long long span_ns = hist_span_ns(HIST_TIERS - 1);
+    unsigned long long from = target_ns > span_ns ? recording_seek(&pl->rec, target_ns - span_ns) : 0;
+    for (unsigned long long i = from; i <= idx; i++)
+    {
+        recording_read(&pl->rec, i, latest);
+        ui_record_sample(ui, latest);
+    }
+    pl->pos = idx + 1;
+    pl->play_ns = latest->timestamp_ns;
+    pl->last_tick_ns = clock_ns(CLOCK_MONOTONIC);
+    ui_player_status(ui, pl);
+}
+
+// Teclas propias de la reproducción. Devuelve 1 si la tecla se usó.
+int handle_player_key(UiState *ui, Player *pl, int ch, Sample *latest)
+{
+    long long step_ns = 0;
+    if (ch == ' ')
+    {
+        pl->paused = !pl->paused;
+        pl->last_tick_ns = clock_ns(CLOCK_MONOTONIC);
+        if (!pl->paused && pl->pos == pl->rec.sample_count)
+            ui_player_seek(ui, pl, 0, latest); // Al final, volver a empezar
+    }
+    else if (ch == '>' && pl->speed < PLAYER_MAX_SPEED)
+        pl->speed *= 2, player_rearm(pl);
+    else if (ch == '<' && pl->speed > PLAYER_MIN_SPEED)
+        pl->speed /= 2, player_rearm(pl);
+    else if (ch == KEY_RIGHT)
+        step_ns = 60LL * 1000000000LL;
+    else if (ch == KEY_LEFT)
+        step_ns = -60LL * 1000000000LL;
+    else if (ch == KEY_NPAGE)
+        step_ns = 600LL * 1000000000LL;
+    else if (ch == KEY_PPAGE)
+        step_ns = -600LL * 1000000000LL;
+    else if (ch == KEY_HOME)
+        ui_player_seek(ui, pl, 0, latest);
+    else if (ch == KEY_END)
+        ui_player_seek(ui, pl, pl->rec.sample_count - 1, latest);
+    else
+        return 0;
+
+    if (step_ns != 0)
+    {
+        long long target = (long long)pl->play_ns + step_ns;
+        unsigned long long idx = recording_seek(&pl->rec, target > 0 ? (unsigned long long)target : 0);
+        ui_player_seek(ui, pl, idx, latest);
+    }
+    ui_player_status(ui, pl);
+    return 1;
+}
+
+// --- PANTALLA: PANELES CON REDIBUJADO INCREMENTAL ---
+
+// Cada panel vive en su propia ventana. El título y el separador (cromo) se dibujan una
+// vez por disposición; el contenido solo se redibuja cuando cambia el hash de los datos
+// que muestra, y todo se vuelca junto con wnoutrefresh + doupdate. Así la terminal
+// recibe únicamente las celdas que cambiaron.
+
+#define LEFT_COLUMN_WIDTH 70
+#define TOP_MIN_COLS 110
+#define SYSINFO_HEIGHT 4
+#define SELF_HEIGHT 11
+
+typedef unsigned long long Hash;
+#define HASH_INIT 1469598103934665603ULL
+
+// FNV-1a
+static Hash hash_bytes(Hash h, const void *data, size_t len)
+{
+    const unsigned char *p = data;
+    for (size_t i = 0; i < len; i++)
+        h = (h ^ p[i]) * 1099511628211ULL;
+    return h;
+}
+
+static Hash hash_int(Hash h, long long value)
+{
+    return hash_bytes(h, &value, sizeof(value));
+}
+
+static Hash hash_str(Hash h, const char *str)
+{
+    return hash_bytes(h, str, strlen(str) + 1);
+}
+
+// Valor cuantizado a la precisión con que se muestra (p. ej. scale 10 = un decimal)
+static Hash hash_scaled(Hash h, double value, double scale)
+{
+    return hash_int(h, (long long)(value * scale + (value >= 0 ? 0.5 : -0.5)));
+}
+
+static Hash hash_bytes_fmt(Hash h, unsigned long long bytes)
+{
+    char buf[32];
+    format_bytes(bytes, buf);
+    return hash_str(h, buf);
+}
+
+typedef enum
+{
+    PANEL_HEADER,
+    PANEL_ALERTS,
+    PANEL_CPU,
+    PANEL_TEMP,
+    PANEL_PROCS,
+    PANEL_RAM,
+    PANEL_NUMA,
+    PANEL_NET,
+    PANEL_DISK,
+    PANEL_SWAP,
+    PANEL_CGROUP,
+    PANEL_PRESSURE,
+    PANEL_VMSTAT,
+    PANEL_HISTOGRAM,
+    PANEL_STATS,
+    PANEL_HEATMAP,
+    PANEL_TOP,
+    PANEL_SELF,
+    PANEL_SYSINFO,
+    PANEL_FOOTER,
+    PANEL_COUNT
+} PanelId;
+
+typedef enum
+{
+    CHROME_NONE,  // Sin título
+    CHROME_TITLE, // Título en la primera fila
+    CHROME_RULED, // Título y separador horizontal
+} ChromeKind;
+
+typedef struct
+{
+    const char *title; // Puede llevar un %s, que recibe el nombre del backend
+    ChromeKind chrome;
+    attr_t title_attrs;
+    Hash (*hash)(const Sample *s, const UiState *ui);
+    void (*draw)(WINDOW *win, const Sample *s, const UiState *ui);
+} PanelDef;
+
+typedef struct
+{
+    int visible;
+    int y, x, h, w;
+    WINDOW *frame; // Cromo
+    WINDOW *body;  // Contenido
+    int chrome_drawn;
+    Hash drawn_hash;
+} Panel;
+
+typedef struct
+{
+    Panel panels[PANEL_COUNT];
+    int lines;
+    int cols;
+    int show_self; // Con qué valor de ui->show_self se hizo la disposición
+    int show_stats;
+    int disk_rows;     // Montajes a los que se les hizo lugar en el panel de discos
+    int pressure_rows; // Filas de recursos del panel de presión; 0 lo oculta
+    int vm_rows;       // Filas del panel de paginación; 0 si el sistema no la informa
+    int numa_rows;     // Filas del panel NUMA; 0 con un solo nodo
+    int cgroup_rows;   // Filas del panel del cgroup; 0 fuera del modo contenedor
+    unsigned long long frames;
+    unsigned long long panel_redraws; // Paneles redibujados desde el inicio
+} Screen;
+
+static Hash hash_header(const Sample *s, const UiState *ui)
+{
+    Hash h = hash_int(hash_int(HASH_INIT, (long long)(s->timestamp_ns / 1000000000ULL)), ui->interval_ms);
+    return hash_str(h, ui->status);
+}
+
+static void draw_header(WINDOW *win, const Sample *s, const UiState *ui)
+{
+    time_t now = (time_t)(s->timestamp_ns / 1000000000ULL);
+    char time_str[32];
+    ctime_r(&now, time_str);
+    time_str[strcspn(time_str, "\n")] = '\0';
+    if (ui->replaying)
+        mvwprintw(win, 0, 0, "Grabado: %s  [%s]", time_str, ui->status);
+    else if (ui->status[0])
+        mvwprintw(win, 0, 0, "Actualizado: %s (cada %d ms)  [%s]", time_str, ui->interval_ms, ui->status);
+    else
+        mvwprintw(win, 0, 0, "Actualizado: %s (cada %d ms)", time_str, ui->interval_ms);
+}
+
+static Hash hash_alerts(const Sample *s, const UiState *ui)
+{
+    (void)ui;
+    Hash h = hash_int(HASH_INIT, s->alerts.count);
+    for (int i = 0; i < s->alerts.count; i++)
+    {
+        const AlertItem *a = &s->alerts.items[i];
+        h = hash_int(h, a->state);
+        if (a->state != ALERT_OK)
+            h = a->bytes ? hash_bytes_fmt(h, (unsigned long long)fabsf(a->value)) : hash_scaled(h, a->value, 10);
+    }
+    return h;
+}
+
+// Barra de alertas: las activas en rojo, las que esperan cumplir for= en amarillo
+static void draw_alerts(WINDOW *win, const Sample *s, const UiState *ui)
+{
+    (void)ui;
+    const AlertStatus *st = &s->alerts;
+    if (st->count == 0)
+        return;
+    int pending = 0;
+    for (int i = 0; i < st->count; i++)
+        pending += st->items[i].state == ALERT_PENDING;
+    if (st->firing == 0 && pending == 0)
+    {
+        if (has_colors())
+            wattron(win, COLOR_PAIR(1));
+        mvwprintw(win, 0, 0, "Alertas: sin novedades (%d %s)", st->count, st->count == 1 ? "regla" : "reglas");
+        if (has_colors())
+            wattroff(win, COLOR_PAIR(1));
+        return;
+    }
+    wattron(win, A_BOLD);
+    mvwprintw(win, 0, 0, "ALERTAS:");
+    wattroff(win, A_BOLD);
+    for (int pass = ALERT_FIRING; pass >= ALERT_PENDING; pass--)
+    {
+        for (int i = 0; i < st->count; i++)
+        {
+            const AlertItem *a = &st->items[i];
+            if (a->state != pass)
+                continue;
+            char value[32];
+            if (a->bytes)
+            {
+                format_bytes((unsigned long long)fabsf(a->value), value);
+                strcat(value, "/s");
+            }
+            else
+                snprintf(value, sizeof(value), "%.1f", a->value);
+            int color = pass == ALERT_FIRING ? 3 : 2;
+            if (has_colors())
+                wattron(win, COLOR_PAIR(color));
+            wprintw(win, "  %s (%s%s)", a->name, value, pass == ALERT_PENDING ? ", pendiente" : "");
+            if (has_colors())
+                wattroff(win, COLOR_PAIR(color));
+        }
+    }
+}
+
+// Los límites térmicos se muestran si el sistema los cuenta; en una grabación vieja no hay
+static int cpu_throttle_known(const CpuFreqUsage *f)
+{
+    return !isnan(f->throttle_rate) && (f->count > 0 || f->avg_mhz > 0);
+}
+
+static Hash hash_cpu(const Sample *s, const UiState *ui)
+{
+    (void)ui;
+    Hash h = hash_scaled(HASH_INIT, s->cpu_usage, 10); // Nombre y núcleos son fijos
+    h = hash_scaled(h, s->freq.avg_mhz, 0.1);
+    h = hash_scaled(hash_scaled(h, s->freq.min_mhz, 0.1), s->freq.max_mhz, 0.1);
+    h = hash_str(h, s->freq.governor);
+    return cpu_throttle_known(&s->freq) ? hash_scaled(h, s->freq.throttle_rate, 10) : hash_int(h, -1);
+}
+
+static void draw_cpu(WINDOW *win, const Sample *s, const UiState *ui)
+{
+    // Como en el panel de información: el procesador del equipo de origen, nunca el local
+    const char *cpu_name = host.cpu_name;
+    int cpu_count = host.cpu_count;
+    double cpu_speed_ghz = host.cpu_speed_ghz;
+    if (ui->source || ui->replaying)
+    {
+        cpu_name = ui->source && ui->source->cpu_name[0] ? ui->source->cpu_name : "N/D";
+        cpu_count = ui->source ? ui->source->cpu_count : 0;
+        cpu_speed_ghz = ui->source ? ui->source->cpu_speed_ghz : 0;
+    }
+    mvwprintw(win, 0, 2, "Nombre: %.*s", getmaxx(win) - 10, cpu_name);
+    if (cpu_count > 0)
+        mvwprintw(win, 1, 2, "Núcleos: %d", cpu_count);
+    else
+        mvwprintw(win, 1, 2, "Núcleos: N/D");
+    // La frecuencia efectiva media y su rango entre núcleos; sin ella, la nominal
+    if (s->freq.avg_mhz > 0)
+    {
+        char line[96];
+        int n = snprintf(line, sizeof(line), "Frec.: %.2f GHz", s->freq.avg_mhz / 1000);
+        if (s->freq.max_mhz > 0)
+            n += snprintf(line + n, sizeof(line) - n, " (%.1f-%.1f)", s->freq.min_mhz / 1000, s->freq.max_mhz / 1000);
+        if (s->freq.governor[0])
+            snprintf(line + n, sizeof(line) - n, " %s", s->freq.governor);
+        mvwprintw(win, 2, 2, "%.*s", MAX(0, getmaxx(win) - 3), line);
+    }
+    else if (cpu_speed_ghz > 0)
+        mvwprintw(win, 2, 2, "Velocidad: %.2f GHz", cpu_speed_ghz);
+    else
+        mvwprintw(win, 2, 2, "Velocidad: N/D");
+    int color = level_color(s->cpu_usage);
+    if (has_colors())
+        wattron(win, COLOR_PAIR(color));
+    mvwprintw(win, 3, 2, "Uso: %.1f%%", s->cpu_usage);
+    if (has_colors())
+        wattroff(win, COLOR_PAIR(color));
+    if (cpu_throttle_known(&s->freq))
+    {
+        color = s->freq.throttle_rate > 0 ? 3 : 0;
+        if (color && has_colors())
+            wattron(win, COLOR_PAIR(color));
+        mvwprintw(win, 3, 16, "lím. térmico: %.1f/s", s->freq.throttle_rate);
+        if (color && has_colors())
+            wattroff(win, COLOR_PAIR(color));
+    }
+}
+
+static Hash hash_temp(const Sample *s, const UiState *ui)
+{
+    (void)ui;
+    Hash h = hash_scaled(HASH_INIT, s->cpu_temp, 10);
+    for (int i = 0; i < s->sensors.count; i++)
+        h = isnan(s->sensors.value[i]) ? hash_int(h, -1) : hash_scaled(h, s->sensors.value[i], 10);
+    return h;
+}
+
+static void draw_sensor_line(WINDOW *win, int row, const Sensor *sn, float value)
+{
+    int label_width = MAX(1, getmaxx(win) - 11);
+    mvwprintw(win, row, 0, "%-*.*s ", label_width, label_width, sn->label);
+    if (isnan(value))
+    {
+        wprintw(win, "     N/D");
+        return;
+    }
+    if (sn->kind == SENSOR_FAN)
+        wprintw(win, "%5.0f RPM", value);
+    else if (sn->kind == SENSOR_POWER)
+        wprintw(win, "%6.1f W", value);
+    else
+    {
+        int color = level_color(value);
+        if (has_colors())
+            wattron(win, COLOR_PAIR(color));
+        wprintw(win, "%6.1f°C", value);
+        if (has_colors())
+            wattroff(win, COLOR_PAIR(color));
+    }
+}
+
+// Primero la temperatura principal y la de cada paquete, después los núcleos en una sola
+// línea y, mientras haya filas, ventiladores, potencia y las demás temperaturas
+static void draw_temp(WINDOW *win, const Sample *s, const UiState *ui)
+{
+    (void)ui;
+    const SensorReadings *rd = &s->sensors;
+    int n = MIN(rd->count, sensor_set.count);
+    int rows = getmaxy(win);
+    int width = getmaxx(win);
+    if (n == 0)
+    {
+        // Sin sensores (o reproduciendo una grabación): solo la temperatura principal
+        if (s->cpu_temp > 0)
+        {
+            int color = level_color(s->cpu_temp);
+            if (has_colors())
+                wattron(win, COLOR_PAIR(color));
+            mvwprintw(win, 0, 0, "CPU: %.1f°C", s->cpu_temp);
+            if (has_colors())
+                wattroff(win, COLOR_PAIR(color));
+        }
+        else
+        {
+            if (has_colors())
+                wattron(win, COLOR_PAIR(7));
+            mvwprintw(win, 0, 0, "N/D");
+            if (has_colors())
+                wattroff(win, COLOR_PAIR(7));
+        }
+        return;
+    }
+
+    int row = 0;
+    int shown[SENSOR_MAX] = {0};
+    for (int i = 0; i < n && row < rows; i++)
+    {
+        const Sensor *sn = &sensor_set.sensors[i];
+        if (sn->kind == SENSOR_TEMP && sn->core < 0 && (i == sensor_set.cpu_main || sn->package >= 0))
+        {
+            draw_sensor_line(win, row++, sn, rd->value[i]);
+            shown[i] = 1;
+        }
+    }
+
+    int cores = 0;
+    float hottest = -INFINITY;
+    for (int i = 0; i < n; i++)
+        if (sensor_set.sensors[i].core >= 0 && !isnan(rd->value[i]))
+        {
+            cores++;
+            hottest = MAX(hottest, rd->value[i]);
+        }
+    if (cores > 0 && row < rows)
+    {
+        int color = level_color(hottest);
+        if (has_colors())
+            wattron(win, COLOR_PAIR(color));
+        mvwprintw(win, row, 0, "Núcleos máx %.0f:", hottest);
+        if (has_colors())
+            wattroff(win, COLOR_PAIR(color));
+        for (int i = 0; i < n; i++)
+        {
+            if (sensor_set.sensors[i].core < 0)
+                continue;
+            shown[i] = 1;
+            if (getcurx(win) + 3 > width)
+                continue;
+            if (isnan(rd->value[i]))
+                wprintw(win, " --");
+            else
+                wprintw(win, " %2.0f", rd->value[i]);
+        }
+        row++;
+    }
+
+    static const SensorKind order[] = {SENSOR_FAN, SENSOR_POWER, SENSOR_TEMP};
+    for (size_t k = 0; k < sizeof(order) / sizeof(order[0]); k++)
+        for (int i = 0; i < n && row < rows; i++)
+            if (!shown[i] && sensor_set.sensors[i].kind == order[k])
+                draw_sensor_line(win, row++, &sensor_set.sensors[i], rd->value[i]);
+}
+
+static Hash hash_procs(const Sample *s, const UiState *ui)
+{
+    (void)ui;
+    return hash_bytes(HASH_INIT, &s->procs, sizeof(s->procs));
+}
+
+static void draw_procs(WINDOW *win, const Sample *s, const UiState *ui)
+{
+    (void)ui;
+    mvwprintw(win, 0, 0, "  Sistema:   %d", s->procs.system);
+    mvwprintw(win, 1, 0, "  Usuario:   %d", s->procs.user);
+    mvwprintw(win, 2, 0, "  Fondo:     %d", s->procs.background);
+    mvwprintw(win, 3, 0, "  Total:     %d", s->procs.total);
+}
+
+static Hash hash_ram(const Sample *s, const UiState *ui)
+{
+    (void)ui;
+    Hash h = hash_bytes_fmt(HASH_INIT, s->memory.total_ram);
+    h = hash_bytes_fmt(h, s->memory.used_ram);
+    h = hash_bytes_fmt(h, s->memory.free_ram);
+    return hash_int(h, level_color(s->memory.ram_percentage));
+}
+
+static void draw_ram(WINDOW *win, const Sample *s, const UiState *ui)
+{
+    (void)ui;
+    char total_ram_str[32], used_ram_str[32], free_ram_str[32];
+    format_bytes(s->memory.total_ram, total_ram_str);
+    format_bytes(s->memory.used_ram, used_ram_str);
+    format_bytes(s->memory.free_ram, free_ram_str);
+
+    mvwprintw(win, 0, 2, "Total: %s", total_ram_str);
+    int color = level_color(s->memory.ram_percentage);
+    if (has_colors())
+        wattron(win, COLOR_PAIR(color));
+    mvwprintw(win, 1, 2, "Usada: %s", used_ram_str);
+    if (has_colors())
+        wattroff(win, COLOR_PAIR(color));
+    mvwprintw(win, 2, 2, "Libre: %s", free_ram_str);
+}
+
+static Hash hash_net(const Sample *s, const UiState *ui)
+{
+    (void)ui;
+    Hash h = hash_scaled(HASH_INIT, s->net.rx_rate * 8.0 / (1024 * 1024), 100);
+    h = hash_scaled(h, s->net.tx_rate * 8.0 / (1024 * 1024), 100);
+    for (int i = 0; i < s->net.count; i++)
+    {
+        const NetIfRate *r = &s->net.ifaces[i];
+        h = hash_str(h, r->prev.name);
+        h = hash_int(h, r->prev.flags);
+        h = hash_scaled(h, r->rx_rate * 8.0 / (1024 * 1024), 100);
+        h = hash_scaled(h, r->tx_rate * 8.0 / (1024 * 1024), 100);
+        h = hash_int(h, (long long)(r->rx_errors + r->tx_errors + r->rx_dropped + r->tx_dropped));
+        h = hash_int(h, r->history_idx);
+    }
+    return h;
+}
+
+static void draw_net(WINDOW *win, const Sample *s, const UiState *ui)
+{
+    (void)ui;
+    mvwprintw(win, 0, 2, "+ Download: %.2f Mb/s", s->net.rx_rate * 8.0 / (1024 * 1024));
+    mvwprintw(win, 1, 2, "- Upload  : %.2f Mb/s", s->net.tx_rate * 8.0 / (1024 * 1024));
+    draw_net_interfaces(win, 0, 30, getmaxx(win) - 31, getmaxy(win), &s->net);
+}
+
+static Hash hash_disk(const Sample *s, const UiState *ui)
+{
+    (void)ui;
+    if (s->mounts.count == 0)
+    {
+        Hash h = hash_bytes_fmt(HASH_INIT, s->disk.used);
+        h = hash_bytes_fmt(h, s->disk.total);
+        return hash_scaled(h, s->disk.percent_used, 1);
+    }
+    Hash h = HASH_INIT;
+    for (int i = 0; i < s->mounts.count && i < DISK_PANEL_MOUNTS; i++)
+    {
+        const MountEntry *m = &s->mounts.mounts[i];
+        h = hash_str(h, m->mount_point);
+        h = hash_bytes_fmt(hash_bytes_fmt(h, m->used), m->total);
+        h = hash_scaled(h, m->percent_used, 1);
+        const DiskIoRate *r = disk_io_for_mount(&s->disk_io, m);
+        if (!r)
+            continue;
+        h = hash_bytes_fmt(hash_bytes_fmt(h, (unsigned long long)r->read_bps), (unsigned long long)r->write_bps);
+        h = hash_scaled(hash_scaled(h, r->read_iops, 1), r->write_iops, 1);
+        h = hash_scaled(hash_scaled(h, r->await_ms, 100), r->queue_depth, 100);
+        h = hash_scaled(h, r->util_pct, 1);
+    }
+    return h;
+}
+
+// Encabezado de columnas y dos filas por montaje: ocupación y E/S del dispositivo que
+// lo respalda. Sin tabla de montajes (grabaciones) queda la barra de "/".
+static void draw_disk(WINDOW *win, const Sample *s, const UiState *ui)
+{
+    (void)ui;
+    if (s->mounts.count == 0)
+    {
+        draw_disk_bar(win, 0, 2, &s->disk);
+        return;
+    }
+    if (has_colors())
+        wattron(win, COLOR_PAIR(6));
+    mvwprintw(win, 0, 2, DISK_IO_FORMAT, "", "lectura/s", "op/s", "escrit./s", "op/s", "espera", "cola", "uso");
+    if (has_colors())
+        wattroff(win, COLOR_PAIR(6));
+    int rows = (getmaxy(win) - 1) / 2;
+    for (int i = 0; i < s->mounts.count && i < rows; i++)
+    {
+        const MountEntry *m = &s->mounts.mounts[i];
+        draw_mount_bar(win, 1 + 2 * i, 2, 20, m);
+        draw_disk_io_line(win, 2 + 2 * i, 2, m->device, disk_io_for_mount(&s->disk_io, m));
+    }
+}
+
+static Hash hash_swap(const Sample *s, const UiState *ui)
+{
+    (void)ui;
+    Hash h = hash_bytes_fmt(HASH_INIT, s->memory.swap_total);
+    h = hash_bytes_fmt(h, s->memory.swap_used);
+    return hash_scaled(h, s->memory.swap_percentage, 10);
+}
+
+static void draw_swap(WINDOW *win, const Sample *s, const UiState *ui)
+{
+    (void)ui;
+    char swap_total_str[32], swap_used_str[32];
+    format_bytes(s->memory.swap_total, swap_total_str);
+    format_bytes(s->memory.swap_used, swap_used_str);
+    mvwprintw(win, 0, 2, "Total: %s", swap_total_str);
+    mvwprintw(win, 1, 2, "Usada: %s", swap_used_str);
+    draw_progress_bar(win, 2, 2, 40, s->memory.swap_percentage, "SWAP");
+}
+
+#define HISTOGRAM_MAX_COLUMNS 256
+
+// Filas de recursos del panel de presión: sistema y, si lo hay, el cgroup propio
+static int pressure_rows(const PressureStats *ps)
+{
+    return ps->valid ? PSI_RESOURCES * (ps->cgroup_valid ? 2 : 1) : 0;
+}
+
+// Demora acumulada: de microsegundos a la unidad que entre en 8 columnas
+static void format_stall(unsigned long long us, char *buf, size_t len)
+{
+    if (us < 1000000ULL)
+        snprintf(buf, len, "%llums", us / 1000);
+    else if (us < 60000000ULL)
+        snprintf(buf, len, "%.1fs", us / 1e6);
+    else if (us < 3600000000ULL)
+        snprintf(buf, len, "%.1fmin", us / 6e7);
+    else
+        snprintf(buf, len, "%.1fh", us / 3.6e9);
+}
+
+static Hash hash_pressure(const Sample *s, const UiState *ui)
+{
+    (void)ui;
+    const PressureStats *ps = &s->pressure;
+    Hash h = hash_int(hash_int(HASH_INIT, ps->valid), ps->cgroup_valid);
+    h = hash_int(hash_int(h, s->pressure_triggers), s->pressure_burst);
+    h = hash_int(h, (long long)s->pressure_events);
+    for (int i = 0; i < pressure_rows(ps); i++)
+    {
+        const PressureEntry *e = i < PSI_RESOURCES ? &ps->sys[i] : &ps->cgroup[i - PSI_RESOURCES];
+        char some[16], full[16];
+        format_stall(e->some.total_us, some, sizeof(some));
+        format_stall(e->full.total_us, full, sizeof(full));
+        h = hash_str(hash_str(h, some), full);
+        h = hash_scaled(hash_scaled(h, e->some.avg10, 10), e->some.avg60, 10);
+        h = hash_scaled(h, e->full.avg10, 10);
+    }
+    return h;
+}
+
+// Porcentaje de demora: amarillo desde el 10 %, rojo desde el 40 %
+static void draw_pressure_pct(WINDOW *win, int y, int x, double pct)
+{
+    int color = pct >= 40 ? 3 : pct >= 10 ? 2 : 1;
+    if (has_colors())
+        wattron(win, COLOR_PAIR(color));
+    mvwprintw(win, y, x, "%6.1f", pct);
+    if (has_colors())
+        wattroff(win, COLOR_PAIR(color));
+}
+
+// Una fila por recurso con some (10 s, 60 s, demora total) y full (10 s, demora total),
+// en 40 columnas para que entre en la columna derecha. La última fila cuenta los
+// disparadores del kernel y si el muestreo está acelerado por presión.
+static void draw_pressure(WINDOW *win, const Sample *s, const UiState *ui)
+{
+    (void)ui;
+    static const char *const labels[PSI_RESOURCES] = {"cpu", "mem", "io"};
+    const PressureStats *ps = &s->pressure;
+    int x = getmaxx(win) >= 42 ? 2 : 0; // Sangría de la columna izquierda si entra
+    if (has_colors())
+        wattron(win, COLOR_PAIR(6));
+    mvwprintw(win, 0, x, "%-6s%6s%6s%8s%6s%8s", "", "some%", "60s", "demora", "full%", "demora");
+    if (has_colors())
+        wattroff(win, COLOR_PAIR(6));
+    int rows = MIN(pressure_rows(ps), getmaxy(win) - 2);
+    for (int i = 0; i < rows; i++)
+    {
+        const PressureEntry *e = i < PSI_RESOURCES ? &ps->sys[i] : &ps->cgroup[i - PSI_RESOURCES];
+        char label[8], some[16], full[16];
+        snprintf(label, sizeof(label), "%s%s", i < PSI_RESOURCES ? "" : "cg ", labels[i % PSI_RESOURCES]);
+        format_stall(e->some.total_us, some, sizeof(some));
+        format_stall(e->full.total_us, full, sizeof(full));
+        mvwprintw(win, 1 + i, x, "%-6s", label);
+        draw_pressure_pct(win, 1 + i, x + 6, e->some.avg10);
+        draw_pressure_pct(win, 1 + i, x + 12, e->some.avg60);
+        mvwprintw(win, 1 + i, x + 18, "%8s", some);
+        draw_pressure_pct(win, 1 + i, x + 26, e->full.avg10);
+        mvwprintw(win, 1 + i, x + 32, "%8s", full);
+    }
+    if (s->pressure_triggers == 0)
+        mvwprintw(win, 1 + rows, x, "Sin disparadores: intervalo fijo");
+    else
+    {
+        mvwprintw(win, 1 + rows, x, "Disparadores: %d  avisos: %llu", s->pressure_triggers, s->pressure_events);
+        if (s->pressure_burst)
+        {
+            if (has_colors())
+                wattron(win, COLOR_PAIR(3));
+            wprintw(win, "  RÁPIDO");
+            if (has_colors())
+                wattroff(win, COLOR_PAIR(3));
+        }
+    }
+}
+
+// Panel de paginación: dos contadores por fila. Las dos primeras filas llevan la
+// tendencia del historial (swap y fallos mayores) al nivel de zoom elegido.
+static const struct
+{
+    VmCounter left, right;
+    const char *left_label, *right_label;
+    int trend; // HistMetric, -1 sin tendencia
+} vm_panel_rows[] = {
+    {VM_SWAP_IN, VM_SWAP_OUT, "swap entr.", "sal.", HIST_SWAP_IO},
+    {VM_MAJOR_FAULTS, VM_MINOR_FAULTS, "fallos may.", "men.", HIST_MAJOR_FAULTS},
+    {VM_PAGE_SCANS, VM_DIRECT_RECLAIM, "escaneos", "recl. dir.", -1},
+    {VM_COMPACT_STALLS, VM_PAGE_OUTS, "compact.", "pageouts", -1},
+    {VM_THP_ALLOC, VM_THP_SPLIT, "THP asign.", "divid.", -1},
+    {VM_COMPRESSIONS, VM_DECOMPRESSIONS, "compresión", "descompr.", -1},
+};
+#define VM_PANEL_ROWS ((int)(sizeof(vm_panel_rows) / sizeof(vm_panel_rows[0])))
+#define VM_TREND_MAX_COLUMNS 64
+
+// Una fila se muestra si el sistema informa al menos uno de sus dos contadores
+static int vm_row_known(const VmRates *vm, int row)
+{
+    return !isnan(vm->rate[vm_panel_rows[row].left]) || !isnan(vm->rate[vm_panel_rows[row].right]);
+}
+
+static int vm_rows(const VmRates *vm)
+{
+    int rows = 0;
+    for (int i = 0; i < VM_PANEL_ROWS && vm->valid; i++)
+        rows += vm_row_known(vm, i);
+    return rows;
+}
+
+// Eventos por segundo en 7 columnas: "-" si no se conoce, k y M para los grandes
+static void format_vm_rate(double rate, char *buf, size_t len)
+{
+    if (isnan(rate))
+        snprintf(buf, len, "-");
+    else if (rate < 10)
+        snprintf(buf, len, "%.1f", rate);
+    else if (rate < 10000)
+        snprintf(buf, len, "%.0f", rate);
+    else if (rate < 10000000)
+        snprintf(buf, len, "%.1fk", rate / 1e3);
+    else
+        snprintf(buf, len, "%.1fM", rate / 1e6);
+}
+
+// Swap, fallos mayores, reclamo directo y compactación son síntomas de falta de memoria:
+// amarillos con cualquier actividad sostenida, rojos desde mil por segundo
+static void draw_vm_rate(WINDOW *win, int y, int x, VmCounter c, double rate)
+{
+    static const unsigned char alarm[VM_COUNTERS] = {
+        [VM_SWAP_IN] = 1, [VM_SWAP_OUT] = 1, [VM_MAJOR_FAULTS] = 1, [VM_DIRECT_RECLAIM] = 1, [VM_COMPACT_STALLS] = 1,
+    };
+    char buf[16];
+    format_vm_rate(rate, buf, sizeof(buf));
+    int color = !alarm[c] || isnan(rate) || rate < 1 ? 0 : rate >= 1000 ? 3 : 2;
+    if (color && has_colors())
+        wattron(win, COLOR_PAIR(color));
+    mvwprintw(win, y, x, "%7s", buf);
+    if (color && has_colors())
+        wattroff(win, COLOR_PAIR(color));
+}
+
+// Tendencia de una métrica del historial, escalada a su máximo en el tramo visible
+static void draw_vm_trend(WINDOW *win, int y, int x, int width, const UiState *ui, HistMetric metric)
+{
+    static const char levels[] = " .:-=+*#";
+    double avg[VM_TREND_MAX_COLUMNS], max_value = 0;
+    int points = hist_read(&ui->history, ui->zoom, metric, MIN(width, VM_TREND_MAX_COLUMNS), avg, NULL);
+    for (int i = 0; i < points; i++)
+        max_value = MAX(max_value, avg[i]);
+    wmove(win, y, x);
+    for (int i = 0; i < points; i++)
+    {
+        int level = avg[i] > 0 && max_value > 0 ? (int)(avg[i] / max_value * (sizeof(levels) - 2)) : 0;
+        waddch(win, avg[i] < 0 ? ' ' : levels[MAX(level, avg[i] > 0)]);
+    }
+}
+
+static Hash hash_vmstat(const Sample *s, const UiState *ui)
+{
+    Hash h = hash_int(hash_int(HASH_INIT, s->vm.valid), ui->zoom);
+    for (int i = 0; i < VM_COUNTERS; i++)
+    {
+        char buf[16];
+        format_vm_rate(s->vm.rate[i], buf, sizeof(buf));
+        h = hash_str(h, buf);
+    }
+    // La tendencia se mueve cuando avanza el nivel o cambia el bucket en curso
+    h = hash_int(h, (long long)ui->history.newest[ui->zoom]);
+    for (int m = HIST_SWAP_IO; m <= HIST_MAJOR_FAULTS; m++)
+    {
+        const HistBucket *b = hist_bucket(&ui->history, ui->zoom, m, 0);
+        h = hash_int(h, b && b->count ? (long long)(b->sum / b->count) : -1);
+    }
+    return h;
+}
+
+static void draw_vmstat(WINDOW *win, const Sample *s, const UiState *ui)
+{
+    int x = getmaxx(win) >= 42 ? 2 : 0;
+    if (has_colors())
+        wattron(win, COLOR_PAIR(6));
+    mvwprintw(win, 0, x, "eventos por segundo; tendencia de %s por columna", hist_tiers[ui->zoom].label);
+    if (has_colors())
+        wattroff(win, COLOR_PAIR(6));
+    int y = 1;
+    for (int i = 0; i < VM_PANEL_ROWS && y < getmaxy(win); i++)
+    {
+        if (!vm_row_known(&s->vm, i))
+            continue;
+        mvwprintw(win, y, x, "%-11s", vm_panel_rows[i].left_label);
+        draw_vm_rate(win, y, x + 11, vm_panel_rows[i].left, s->vm.rate[vm_panel_rows[i].left]);
+        mvwprintw(win, y, x + 20, "%-10s", vm_panel_rows[i].right_label);
+        draw_vm_rate(win, y, x + 30, vm_panel_rows[i].right, s->vm.rate[vm_panel_rows[i].right]);
+        int trend_w = getmaxx(win) - x - 39;
+        if (vm_panel_rows[i].trend >= 0 && trend_w >= 8)
+            draw_vm_trend(win, y, x + 39, trend_w, ui, vm_panel_rows[i].trend);
+        y++;
+    }
+}
+
+// Encabezado y dos filas por nodo; sin NUMA (un solo nodo) el panel no se muestra
+static int numa_rows(const NumaUsage *numa)
+{
+    return numa->count >= 2 ? 1 + 2 * numa->count : 0;
+}
+
+static Hash hash_numa(const Sample *s, const UiState *ui)
+{
+    (void)ui;
+    Hash h = hash_int(HASH_INIT, s->numa.count);
+    for (int i = 0; i < s->numa.count; i++)
+    {
+        const NumaNodeUsage *n = &s->numa.nodes[i];
+        char miss[16], foreign[16];
+        format_vm_rate(n->miss_rate, miss, sizeof(miss));
+        format_vm_rate(n->foreign_rate, foreign, sizeof(foreign));
+        h = hash_int(hash_int(h, n->id), n->cpu_count);
+        h = hash_scaled(h, n->ram_pct, 10);
+        h = hash_int(h, isnan(n->cpu_pct) ? -1 : (int)(n->cpu_pct + 0.5));
+        h = hash_str(hash_str(h, miss), foreign);
+        h = hash_bytes_fmt(hash_bytes_fmt(h, n->used), n->total);
+        h = hash_bytes_fmt(hash_bytes_fmt(h, n->file), n->anon);
+    }
+    return h;
+}
+
+// Por nodo: RAM y CPU de sus núcleos en la primera fila, con las páginas por segundo que
+// se asignaron en él queriendo otro nodo (miss) y las que otro nodo recibió en su lugar
+// (foreign); el desglose de la memoria en la segunda
+static void draw_numa(WINDOW *win, const Sample *s, const UiState *ui)
+{
+    (void)ui;
+    int x = getmaxx(win) >= 62 ? 2 : 0;
+    if (has_colors())
+        wattron(win, COLOR_PAIR(6));
+    mvwprintw(win, 0, x, "%-34s%-9s%7s %7s", "        RAM del nodo", "CPU", "miss/s", "foreign");
+    if (has_colors())
+        wattroff(win, COLOR_PAIR(6));
+    for (int i = 0; i < s->numa.count && 2 + 2 * i < getmaxy(win); i++)
+    {
+        const NumaNodeUsage *n = &s->numa.nodes[i];
+        int y = 1 + 2 * i;
+        mvwprintw(win, y, x, "nodo %d", n->id);
+        draw_progress_bar(win, y, x + 8, 10, n->ram_pct, "RAM");
+        if (isnan(n->cpu_pct))
+            mvwprintw(win, y, x + 34, "CPU   -");
+        else
+        {
+            int color = level_color(n->cpu_pct);
+            if (has_colors())
+                wattron(win, COLOR_PAIR(color));
+            mvwprintw(win, y, x + 34, "CPU %3.0f%%", n->cpu_pct);
+            if (has_colors())
+                wattroff(win, COLOR_PAIR(color));
+        }
+        char miss[16], foreign[16];
+        format_vm_rate(n->miss_rate, miss, sizeof(miss));
+        format_vm_rate(n->foreign_rate, foreign, sizeof(foreign));
+        mvwprintw(win, y, x + 43, "%7s %7s", miss, foreign);
+
+        char used[32], free_str[32], file[32], anon[32], line[160];
+        format_bytes(n->used, used);
+        format_bytes(n->total - n->used, free_str);
+        format_bytes(n->file, file);
+        format_bytes(n->anon, anon);
+        snprintf(line, sizeof(line), "%s usada, %s libre, %s arch., %s anón.", used, free_str, file, anon);
+        mvwprintw(win, y + 1, x + 8, "%.*s", MAX(0, getmaxx(win) - x - 9), line);
+    }
+}
+
+#define CGROUP_PANEL_CHILDREN 6 // Hijos que entran en el panel del cgroup
+#define CGROUP_CHILD_FORMAT "%-24.24s %10s %6s %10s %10s"
+
+// Filas del panel del cgroup: seis de resumen y, con hijos, encabezado y uno por fila
+static int cgroup_rows(const CgroupUsage *cg)
+{
+    if (!cg->info.valid)
+        return 0;
+    return 6 + (cg->child_count > 0 ? 1 + MIN(cg->child_count, CGROUP_PANEL_CHILDREN) : 0);
+}
+
+// Un tamaño o "sin límite"
+static void format_limit(unsigned long long bytes, char *buf)
+{
+    if (bytes == CGROUP_UNLIMITED)
+        strcpy(buf, "sin límite");
+    else
+        format_bytes(bytes, buf);
+}
+
+static Hash hash_cgroup(const Sample *s, const UiState *ui)
+{
+    (void)ui;
+    const CgroupUsage *cg = &s->cgroup;
+    Hash h = hash_str(HASH_INIT, cg->info.path);
+    h = hash_bytes_fmt(hash_bytes_fmt(h, cg->self.prev.memory_current), cg->info.memory_max);
+    h = hash_bytes_fmt(hash_bytes_fmt(h, cg->info.swap_current), cg->info.swap_max);
+    h = hash_bytes_fmt(hash_bytes_fmt(h, cg->info.anon), cg->info.file);
+    h = hash_bytes_fmt(h, cg->info.kernel);
+    h = hash_scaled(hash_scaled(h, cg->info.cpu_limit, 100), cg->self.cpu_pct, 10);
+    h = hash_scaled(hash_scaled(h, cg->self.throttled_pct, 1), cg->self.throttled_ms, 1);
+    h = hash_bytes_fmt(hash_bytes_fmt(h, (unsigned long long)cg->self.read_bps), (unsigned long long)cg->self.write_bps);
+    h = hash_scaled(hash_scaled(h, cg->self.read_iops, 1), cg->self.write_iops, 1);
+    for (int k = 0; k < CGROUP_IO_LIMITS; k++)
+        h = hash_int(h, (long long)cg->info.io_max[k]);
+    h = hash_int(h, cg->child_total);
+    for (int i = 0; i < cg->child_count && i < CGROUP_PANEL_CHILDREN; i++)
+    {
+        const CgroupRate *r = &cg->children[i];
+        h = hash_str(h, r->prev.name);
+        h = hash_bytes_fmt(h, r->prev.memory_current);
+        h = hash_scaled(h, r->cpu_pct, 10);
+        h = hash_bytes_fmt(hash_bytes_fmt(h, (unsigned long long)r->read_bps), (unsigned long long)r->write_bps);
+    }
+    return h;
+}
+
+// Resumen del cgroup observado contra sus límites y, con --cgroup-children, los hijos
+// que más memoria usan
+static void draw_cgroup(WINDOW *win, const Sample *s, const UiState *ui)
+{
+    (void)ui;
+    const CgroupUsage *cg = &s->cgroup;
+    const CgroupInfo *info = &cg->info;
+    char a[32], b[32], c[32], d[32];
+    mvwprintw(win, 0, 2, "Ruta: %.*s", MAX(getmaxx(win) - 9, 0), info->path);
+
+    if (info->has_memory)
+    {
+        format_bytes(cg->self.prev.memory_current, a);
+        format_limit(info->memory_max, b);
+        mvwprintw(win, 1, 2, "Mem  %s / %s", a, b);
+        if (info->memory_max != CGROUP_UNLIMITED && info->memory_max > 0)
+        {
+            double pct = 100.0 * cg->self.prev.memory_current / info->memory_max;
+            int color = level_color(pct);
+            if (has_colors())
+                wattron(win, COLOR_PAIR(color));
+            wprintw(win, "  %.0f%%", pct);
+            if (has_colors())
+                wattroff(win, COLOR_PAIR(color));
+        }
+        if (info->has_swap)
+        {
+            format_bytes(info->swap_current, c);
+            format_limit(info->swap_max, d);
+            wprintw(win, "   swap %s / %s", c, d);
+        }
+        format_bytes(info->anon, a);
+        format_bytes(info->file, b);
+        format_bytes(info->kernel, c);
+        mvwprintw(win, 2, 2, "     anon %s   file %s   kernel %s", a, b, c);
+    }
+    else
+        mvwprintw(win, 1, 2, "Mem  sin el controlador memory");
+
+    if (info->has_cpu)
+    {
+        mvwprintw(win, 3, 2, "CPU  %.1f%% de %.2f núcleos", cg->self.cpu_pct, info->cpu_limit);
+        if (info->cpu_quota)
+        {
+            int color = cg->self.throttled_pct >= 25 ? 3 : cg->self.throttled_pct > 0 ? 2 : 1;
+            if (has_colors())
+                wattron(win, COLOR_PAIR(color));
+            wprintw(win, "   frenado %.0f%% períodos, %.0f ms/s", cg->self.throttled_pct, cg->self.throttled_ms);
+            if (has_colors())
+                wattroff(win, COLOR_PAIR(color));
+        }
+        else
+            wprintw(win, " (sin cuota)");
+    }
+    else
+        mvwprintw(win, 3, 2, "CPU  sin cpu.stat");
+
+    if (info->has_io)
+    {
+        format_bytes((unsigned long long)cg->self.read_bps, a);
+        format_bytes((unsigned long long)cg->self.write_bps, b);
+        mvwprintw(win, 4, 2, "E/S  lee %s/s %.0f op/s   escribe %s/s %.0f op/s", a, cg->self.read_iops, b, cg->self.write_iops);
+        int limited = 0;
+        for (int k = 0; k < CGROUP_IO_LIMITS; k++)
+            limited |= info->io_max[k] != CGROUP_UNLIMITED;
+        if (limited)
+        {
+            mvwprintw(win, 5, 2, "     io.max:");
+            static const char *const dirs[] = {"lee", "escribe"};
+            for (int d = 0; d < 2; d++)
+            {
+                unsigned long long bps = info->io_max[d == 0 ? CGROUP_IO_RBPS : CGROUP_IO_WBPS];
+                unsigned long long iops = info->io_max[d == 0 ? CGROUP_IO_RIOPS : CGROUP_IO_WIOPS];
+                format_bytes(bps, a);
+                wprintw(win, d ? "   %s" : " %s", dirs[d]);
+                if (bps != CGROUP_UNLIMITED)
+                    wprintw(win, " %s/s", a);
+                if (iops != CGROUP_UNLIMITED)
+                    wprintw(win, " %llu op/s", iops);
+                if (bps == CGROUP_UNLIMITED && iops == CGROUP_UNLIMITED)
+                    wprintw(win, " sin límite");
+            }
+        }
+        else
+            mvwprintw(win, 5, 2, "     sin límites en io.max");
+    }
+    else
+        mvwprintw(win, 4, 2, "E/S  sin el controlador io");
+
+    if (cg->child_count == 0)
+        return;
+    if (has_colors())
+        wattron(win, COLOR_PAIR(6));
+    char title[48];
+    if (cg->child_total > cg->child_count)
+        snprintf(title, sizeof(title), "hijo (%d de %d)", cg->child_count, cg->child_total);
+    else
+        snprintf(title, sizeof(title), "hijo");
+    mvwprintw(win, 6, 2, CGROUP_CHILD_FORMAT, title, "memoria", "cpu%", "lee/s", "escribe/s");
+    if (has_colors())
+        wattroff(win, COLOR_PAIR(6));
+    int rows = MIN(cg->child_count, getmaxy(win) - 7);
+    for (int i = 0; i < rows; i++)
+    {
+        const CgroupRate *r = &cg->children[i];
+        char cpu[16];
+        format_bytes(r->prev.memory_current, a);
+        format_bytes((unsigned long long)r->read_bps, b);
+        format_bytes((unsigned long long)r->write_bps, c);
+        snprintf(cpu, sizeof(cpu), "%.1f", r->cpu_pct);
+        if (!info->has_memory)
+            strcpy(a, "-");
+        if (!info->has_io)
+        {
+            strcpy(b, "-");
+            strcpy(c, "-");
+        }
+        mvwprintw(win, 7 + i, 2, CGROUP_CHILD_FORMAT, r->prev.name, a, cpu, b, c);
+    }
+}
+
+// Con NUMA hay un histograma por nodo en lugar del de toda la RAM
+static int histogram_nodes(const Sample *s)
+{
+    return s->numa.count >= 2 ? MIN(s->numa.count, NUMA_HIST_NODES) : 0;
+}
+
+static Hash hash_histogram(const Sample *s, const UiState *ui)
+{
+    // Los buckets viejos no cambian: alcanza con el nivel, su posición y el bucket en curso
+    Hash h = hash_int(HASH_INIT, ui->zoom);
+    h = hash_int(h, (long long)ui->history.newest[ui->zoom]);
+    h = hash_int(h, ui->history.filled[ui->zoom]);
+    int nodes = histogram_nodes(s);
+    h = hash_int(h, nodes);
+    for (int m = nodes ? HIST_NUMA_RAM : HIST_RAM; m < (nodes ? HIST_NUMA_RAM + nodes : HIST_RAM + 1); m++)
+    {
+        const HistBucket *b = hist_bucket(&ui->history, ui->zoom, m, 0);
+        if (b && b->count)
+        {
+            h = hash_int(h, (int)(b->sum / b->count / 10));
+            h = hash_int(h, (int)(b->max / 10));
+        }
+    }
+    return h;
+}
+
+static void draw_histogram(WINDOW *win, const Sample *s, const UiState *ui)
+{
+    double avg[HISTOGRAM_MAX_COLUMNS], max[HISTOGRAM_MAX_COLUMNS];
+    char title[64];
+    int nodes = histogram_nodes(s);
+    if (!nodes)
+    {
+        int width = getmaxx(win) - 20;
+        int points = hist_read(&ui->history, ui->zoom, HIST_RAM, MIN(HISTOGRAM_MAX_COLUMNS, width), avg, max);
+        snprintf(title, sizeof(title), "Histograma RAM (%%, %s por columna):", hist_tiers[ui->zoom].label);
+        draw_memory_histogram(win, 1, 10, width, avg, max, points, title);
+        return;
+    }
+    // Uno al lado del otro, cada uno con su eje
+    int block_w = (getmaxx(win) - 10) / nodes;
+    for (int i = 0; i < nodes; i++)
+    {
+        int width = block_w - 8;
+        int points = hist_read(&ui->history, ui->zoom, HIST_NUMA_RAM + i, MIN(HISTOGRAM_MAX_COLUMNS, width), avg, max);
+        snprintf(title, sizeof(title), "Nodo %d (%%, %s/col):", s->numa.nodes[i].id, hist_tiers[ui->zoom].label);
+        draw_memory_histogram(win, 1, 10 + i * block_w, width, avg, max, points, title);
+    }
+}
+
+static void format_stat(char *buf, size_t len, int rate, double v)
+{
+    if (rate)
+        format_bytes((unsigned long long)v, buf);
+    else
+        snprintf(buf, len, "%.1f", v);
+}
+
+static Hash hash_stats(const Sample *s, const UiState *ui)
+{
+    (void)s;
+    Hash h = hash_int(HASH_INIT, ui->stats_window);
+    for (int m = 0; m < WSTAT_METRICS && ui->stats_window >= 0; m++)
+    {
+        WindowSummary sum;
+        wstat_summary(&ui->stats.agg[m][ui->stats_window], wstat_metrics[m].rate, &sum);
+        double values[] = {sum.min, sum.mean, sum.p95, sum.p99, sum.max};
+        h = hash_int(h, sum.count > 0);
+        for (size_t i = 0; i < sizeof(values) / sizeof(values[0]) && sum.count > 0; i++)
+            h = wstat_metrics[m].rate ? hash_bytes_fmt(h, (unsigned long long)values[i]) : hash_scaled(h, values[i], 10);
+    }
+    return h;
+}
+
+// Una fila por métrica con el resumen de la ventana elegida
+static void draw_stats(WINDOW *win, const Sample *s, const UiState *ui)
+{
+    (void)s;
+    if (ui->stats_window < 0)
+        return;
+    mvwprintw(win, 0, 2, "Ventana: %s ('e' la cambia)", wstat_windows[ui->stats_window].name);
     if (has_colors())
-        attron(COLOR_PAIR(color_pair));
-    for (int i = 0; i < filled; ++i)
-        addch('#');
+        wattron(win, COLOR_PAIR(6));
+    mvwprintw(win, 1, 2, "%-11s %10s %10s %10s %10s %10s", "", "min", "media", "p95", "p99", "max");
     if (has_colors())
-        attroff(COLOR_PAIR(color_pair));
-    for (int i = filled; i < width; ++i)
-        addch(' ');
+        wattroff(win, COLOR_PAIR(6));
+    for (int m = 0; m < WSTAT_METRICS && 2 + m < getmaxy(win); m++)
+    {
+        WindowSummary sum;
+        int rate = wstat_metrics[m].rate;
+        wstat_summary(&ui->stats.agg[m][ui->stats_window], rate, &sum);
+        mvwprintw(win, 2 + m, 2, "%-11s", wstat_metrics[m].name);
+        if (sum.count == 0)
+        {
+            wprintw(win, " %10s", "-");
+            continue;
+        }
+        double values[] = {sum.min, sum.mean, sum.p95, sum.p99, sum.max};
+        for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++)
+        {
+            char buf[32];
+            format_stat(buf, sizeof(buf), rate, values[i]);
+            wprintw(win, " %10s", buf);
+        }
+    }
+}
+
+static Hash hash_heatmap(const Sample *s, const UiState *ui)
+{
+    (void)s;
+    double cpu_heatmap[CPU_HEATMAP_WIDTH];
+    int points = hist_read(&ui->history, ui->zoom, HIST_CPU, CPU_HEATMAP_WIDTH, cpu_heatmap, NULL);
+    Hash h = hash_int(hash_int(HASH_INIT, points), ui->zoom);
+    for (int i = 0; i < points; i++)
+        h = hash_int(h, cpu_heatmap[i] < 0 ? -1 : cpu_heatmap[i] < 40 ? 0 : cpu_heatmap[i] < 75 ? 1 : 2); // Solo importa el símbolo
+    double freq[CPU_HEATMAP_WIDTH], throttle[CPU_HEATMAP_WIDTH];
+    hist_read(&ui->history, ui->zoom, HIST_CPU_FREQ, CPU_HEATMAP_WIDTH, freq, NULL);
+    hist_read(&ui->history, ui->zoom, HIST_CPU_THROTTLE, CPU_HEATMAP_WIDTH, throttle, NULL);
+    for (int i = 0; i < points; i++)
+        h = hash_int(hash_int(h, (int)(freq[i] / 10)), throttle[i] > 0);
+    for (int c = 0; c < s->freq.count; c++)
+        h = hash_int(isnan(s->freq.mhz[c]) ? hash_int(h, -1) : hash_scaled(h, s->freq.mhz[c], 0.01), s->freq.throttle[c] > 0);
+    // Las filas por núcleo se desplazan con cada muestra
+    h = hash_int(h, ui->core_history_idx);
+    return hash_int(h, ui->core_history_count);
+}
+
+// Frecuencia media debajo de cada celda del mapa de CPU, para ver si una caída coincide
+// con la carga; en rojo los períodos con límites térmicos
+static void draw_freq_trend(WINDOW *win, int y, int cells_x, int points, const UiState *ui)
+{
+    static const char levels[] = " .:-=+*#";
+    double freq[CPU_HEATMAP_WIDTH], throttle[CPU_HEATMAP_WIDTH], max_mhz = 0;
+    hist_read(&ui->history, ui->zoom, HIST_CPU_FREQ, points, freq, NULL);
+    hist_read(&ui->history, ui->zoom, HIST_CPU_THROTTLE, points, throttle, NULL);
+    for (int i = 0; i < points; i++)
+        max_mhz = MAX(max_mhz, freq[i]);
+    if (max_mhz <= 0)
+        return;
+    char label[48];
+    int len = snprintf(label, sizeof(label), "Frec. (# = %.1f GHz):", max_mhz / 1000);
+    if (cells_x - len >= 0)
+        mvwprintw(win, y, cells_x - len, "%s", label);
+    for (int i = 0; i < points; i++)
+    {
+        int level = freq[i] > 0 ? (int)(freq[i] / max_mhz * (sizeof(levels) - 2) + 0.5) : 0;
+        int color = throttle[i] > 0 ? 3 : 0;
+        if (color && has_colors())
+            wattron(win, COLOR_PAIR(color));
+        mvwprintw(win, y, cells_x + 3 * i, " %c ", freq[i] < 0 ? ' ' : levels[MAX(level, freq[i] > 0)]);
+        if (color && has_colors())
+            wattroff(win, COLOR_PAIR(color));
+    }
+}
+
+static void draw_heatmap(WINDOW *win, const Sample *s, const UiState *ui)
+{
+    double cpu_heatmap[CPU_HEATMAP_WIDTH];
+    int points = hist_read(&ui->history, ui->zoom, HIST_CPU, CPU_HEATMAP_WIDTH, cpu_heatmap, NULL);
+    draw_cpu_heatmap(win, 1, 10, cpu_heatmap, points, hist_tiers[ui->zoom].label);
+    draw_freq_trend(win, 1, getcurx(win) - 3 * points, points, ui);
+    // Temperatura de cada CPU lógica según el sensor de su núcleo físico
+    float core_temp[CPU_MAX_CORES];
+    int have_temps = 0;
+    for (int c = 0; c < ui->core_count; c++)
+    {
+        int idx = sensor_set.cpu_sensor[c];
+        core_temp[c] = idx >= 0 && idx < s->sensors.count ? s->sensors.value[idx] : NAN;
+        have_temps |= !isnan(core_temp[c]);
+    }
+    int node_id[NUMA_MAX_NODES];
+    for (int n = 0; n < s->numa.count; n++)
+        node_id[n] = s->numa.nodes[n].id;
+    draw_core_heatmap(win, 3, 2, getmaxx(win) - 3, getmaxy(win) - 3, ui->core_history, ui->core_history_idx,
+                      ui->core_history_count, ui->core_count, &ui->cores, have_temps ? core_temp : NULL,
+                      s->numa.count >= 2 ? s->numa.cpu_node : NULL, node_id, s->freq.count > 0 ? &s->freq : NULL);
+}
+
+static Hash hash_top(const Sample *s, const UiState *ui)
+{
+    Hash h = hash_bytes(HASH_INIT, &ui->proc_query, sizeof(ui->proc_query));
+    h = hash_int(h, ui->editing_filter);
+    h = hash_int(h, s->proc_rows);
+    h = hash_bytes_fmt(h, s->memory.total_ram);
+    for (int i = 0; i < s->proc_rows; i++)
+    {
+        const ProcRow *r = &s->top[i];
+        h = hash_int(h, r->pid);
+        h = hash_str(h, r->name);
+        h = hash_scaled(h, r->cpu_pct, 10);
+        h = hash_bytes_fmt(h, r->rss_bytes);
+        h = hash_bytes_fmt(h, (unsigned long long)r->io_rate);
+        if (ui->proc_query.sort == PROC_SORT_PSS)
+            h = hash_bytes(h, &r->mem, sizeof(r->mem));
+    }
+    if (ui->proc_query.sort == PROC_SORT_PSS)
+        h = hash_int(h, s->proc_mem.pending);
+    return h;
+}
+
+static void draw_top(WINDOW *win, const Sample *s, const UiState *ui)
+{
+    draw_process_list(win, 0, 0, getmaxy(win) - 2, s->memory.total_ram, s->top, s->proc_rows, &ui->proc_query, ui->editing_filter, &s->proc_mem);
+}
+
+// Duración legible: ns, µs o ms según la magnitud
+static void format_duration(double ns, char *buf, size_t len)
+{
+    if (ns < 1e3)
+        snprintf(buf, len, "%.0f ns", ns);
+    else if (ns < 1e6)
+        snprintf(buf, len, "%.1f µs", ns / 1e3);
+    else
+        snprintf(buf, len, "%.1f ms", ns / 1e6);
+}
+
+// Cambia en cada cuadro mientras está visible: el dibujo mismo suma una medición
+static Hash hash_self(const Sample *s, const UiState *ui)
+{
+    Hash h = hash_int(hash_int(HASH_INIT, s->self.valid), ui->replaying);
+    h = hash_scaled(h, s->self.cpu_pct, 10);
+    h = hash_bytes_fmt(h, s->self.rss_bytes);
+    h = hash_scaled(hash_scaled(h, s->self.forks_rate, 10), s->self.ctx_rate, 10);
+    h = hash_scaled(h, s->self.syscall_rate, 1);
+    for (int p = 0; p < PHASES; p++)
+        h = hash_int(h, atomic_load_explicit(&prof.phases[p].count, memory_order_relaxed));
+    return h;
+}
+
+static void draw_self(WINDOW *win, const Sample *s, const UiState *ui)
+{
+    if (ui->replaying)
+        mvwprintw(win, 0, 0, "Reproducción: solo se mide la interfaz");
+    else if (!s->self.valid)
+        mvwprintw(win, 0, 0, "Esperando la segunda muestra...");
+    else
+    {
+        char rss[32];
+        format_bytes(s->self.rss_bytes, rss);
+        mvwprintw(win, 0, 0, "CPU: %.1f%%  RSS: %s  Forks/s: %.1f", s->self.cpu_pct, rss, s->self.forks_rate);
+        mvwprintw(win, 1, 0, "Cambios de contexto/s: %.1f  Syscalls/s del muestreo: %.0f", s->self.ctx_rate, s->self.syscall_rate);
+    }
+
+    // Latencia por fase: p50/p99/media y el histograma log2 en un rango común
+    static const char levels[] = " .:-=+*#";
+    enum
+    {
+        COL_P50 = 13,
+        COL_P99 = 23,
+        COL_MEAN = 33,
+        COL_HIST = 43
+    };
+    PhaseStats stats[PHASES];
+    int lo = PHASE_BUCKETS, hi = -1;
+    for (int p = 0; p < PHASES; p++)
+    {
+        prof_read((Phase)p, &stats[p]);
+        for (int b = 0; b < PHASE_BUCKETS; b++)
+            if (stats[p].buckets[b])
+                lo = MIN(lo, b), hi = MAX(hi, b);
+    }
+    int hist_w = getmaxx(win) - COL_HIST;
+    if (hist_w > 0 && hi - lo + 1 > hist_w)
+        lo = hi - hist_w + 1; // Se pierden las duraciones más cortas
+
+    if (has_colors())
+        wattron(win, COLOR_PAIR(4));
+    mvwprintw(win, 3, 0, "Fase");
+    mvwprintw(win, 3, COL_P50, "p50");
+    mvwprintw(win, 3, COL_P99, "p99");
+    mvwprintw(win, 3, COL_MEAN, "media");
+    if (hist_w > 0)
+        mvwprintw(win, 3, COL_HIST, "histograma");
+    if (has_colors())
+        wattroff(win, COLOR_PAIR(4));
+
+    for (int p = 0; p < PHASES; p++)
+    {
+        const PhaseStats *st = &stats[p];
+        int row = 4 + p;
+        char buf[32];
+        mvwprintw(win, row, 0, "%s", phase_names[p]);
+        if (st->count == 0)
+        {
+            mvwprintw(win, row, COL_P50, "-");
+            continue;
+        }
+        format_duration(st->p50_ns, buf, sizeof(buf));
+        mvwprintw(win, row, COL_P50, "%s", buf);
+        format_duration(st->p99_ns, buf, sizeof(buf));
+        mvwprintw(win, row, COL_P99, "%s", buf);
+        format_duration(st->mean_ns, buf, sizeof(buf));
+        mvwprintw(win, row, COL_MEAN, "%s", buf);
+
+        unsigned long long max_count = 0;
+        for (int b = lo; b <= hi; b++)
+            max_count = MAX(max_count, st->buckets[b]);
+        wmove(win, row, COL_HIST);
+        for (int b = lo; b <= hi && b - lo < hist_w; b++)
+        {
+            int level = st->buckets[b] ? 1 + (int)(st->buckets[b] * (sizeof(levels) - 3) / max_count) : 0;
+            waddch(win, levels[level]);
+        }
+    }
+    if (hi >= lo && hist_w > 0)
+    {
+        char from[32];
+        double ns_per_cycle = prof_ns_per_cycle();
+        format_duration((double)(1ULL << lo) * ns_per_cycle, from, sizeof(from));
+        mvwprintw(win, 4 + PHASES, 0, "Histograma desde %s, cada columna duplica", from);
+    }
+}
+
+// Uptime del equipo de origen en el momento de la muestra
+static double sysinfo_source_uptime(const Sample *s, const SourceHost *src)
+{
+    return s->timestamp_ns > src->boot_ns ? (s->timestamp_ns - src->boot_ns) / 3.6e12 : 0;
+}
+
+static Hash hash_sysinfo(const Sample *s, const UiState *ui)
+{
+    if (ui->source)
+        return hash_scaled(hash_int(HASH_INIT, 1), sysinfo_source_uptime(s, ui->source), 100);
+    if (ui->replaying)
+        return hash_int(HASH_INIT, 2);
+    return hash_scaled(hash_int(HASH_INIT, (long long)host.generation), host_uptime_hours(), 100);
+}
+
+// Al reproducir o mirar otro proceso se muestra el equipo de origen, nunca el local
+static void draw_sysinfo(WINDOW *win, const Sample *s, const UiState *ui)
+{
+    const SourceHost *src = ui->source;
+    if (src)
+    {
+        mvwprintw(win, 0, 0, "Equipo: %s   Sistema: %s (%s)   CPUs: %d", src->hostname, src->os_version, src->kernel, src->cpu_count);
+        mvwprintw(win, 1, 0, "IP: %s   Interfaces: %s   Uptime: %.2f horas", src->ip_addr, src->interfaces, sysinfo_source_uptime(s, src));
+    }
+    else if (ui->replaying)
+        mvwprintw(win, 0, 0, "La grabación no guarda los datos del equipo de origen (formato anterior)");
+    else
+    {
+        mvwprintw(win, 0, 0, "Equipo: %s   Sistema: %s (%s)   CPUs: %d", host.hostname, host.os_version, host.kernel, host.cpu_count);
+        mvwprintw(win, 1, 0, "IP: %s   Interfaces: %s   Uptime: %.2f horas", host.ip_addr, host.interfaces, host_uptime_hours());
+    }
+}
+
+static Hash hash_footer(const Sample *s, const UiState *ui)
+{
+    (void)s;
+    return hash_int(HASH_INIT, ui->replaying);
+}
+
+static void draw_footer(WINDOW *win, const Sample *s, const UiState *ui)
+{
+    (void)s;
+    if (has_colors())
+        wattron(win, COLOR_PAIR(7));
+    if (ui->replaying)
+        mvwprintw(win, 0, 0, "Presiona 'q' para salir, espacio para pausar, </> para cambiar la velocidad, flechas y RePág/AvPág para moverse, Inicio/Fin, 'z' para el zoom, 'e' para estadísticas, 'o' para el consumo propio");
+    else
+        mvwprintw(win, 0, 0, "Presiona 'q' para salir, 'r' para reiniciar historial, 'z' para el zoom, c/m/i/t/p para ordenar procesos, '/' para filtrar, +/- para cambiar el intervalo, 'e' para estadísticas, 'o' para el consumo propio");
+    if (has_colors())
+        wattroff(win, COLOR_PAIR(7));
+}
+
+static const PanelDef panel_defs[PANEL_COUNT] = {
+    [PANEL_HEADER] = {"=== MONITOR DE SISTEMA %s ===", CHROME_RULED, A_BOLD | A_UNDERLINE, hash_header, draw_header},
+    [PANEL_ALERTS] = {NULL, CHROME_NONE, 0, hash_alerts, draw_alerts},
+    [PANEL_CPU] = {"CPU:", CHROME_RULED, A_BOLD, hash_cpu, draw_cpu},
+    [PANEL_TEMP] = {"Sensores:", CHROME_TITLE, A_BOLD, hash_temp, draw_temp},
+    [PANEL_PROCS] = {"Procesos:", CHROME_RULED, A_BOLD, hash_procs, draw_procs},
+    [PANEL_RAM] = {"MEMORIA RAM:", CHROME_RULED, A_BOLD, hash_ram, draw_ram},
+    [PANEL_NUMA] = {"NODOS NUMA:", CHROME_RULED, A_BOLD, hash_numa, draw_numa},
+    [PANEL_NET] = {"RED:", CHROME_RULED, A_BOLD, hash_net, draw_net},
+    [PANEL_DISK] = {"DISCOS:", CHROME_RULED, A_BOLD, hash_disk, draw_disk},
+    [PANEL_SWAP] = {"MEMORIA SWAP:", CHROME_RULED, A_BOLD, hash_swap, draw_swap},
+    [PANEL_CGROUP] = {"CGROUP:", CHROME_RULED, A_BOLD, hash_cgroup, draw_cgroup},
+    [PANEL_PRESSURE] = {"PRESIÓN (PSI):", CHROME_RULED, A_BOLD, hash_pressure, draw_pressure},
+    [PANEL_VMSTAT] = {"PAGINACIÓN:", CHROME_RULED, A_BOLD, hash_vmstat, draw_vmstat},
+    [PANEL_HISTOGRAM] = {NULL, CHROME_NONE, 0, hash_histogram, draw_histogram},
+    [PANEL_STATS] = {"ESTADÍSTICAS:", CHROME_RULED, A_BOLD, hash_stats, draw_stats},
+    [PANEL_HEATMAP] = {NULL, CHROME_NONE, 0, hash_heatmap, draw_heatmap},
+    [PANEL_TOP] = {NULL, CHROME_NONE, 0, hash_top, draw_top},
+    [PANEL_SELF] = {"CONSUMO DEL MONITOR:", CHROME_RULED, A_BOLD, hash_self, draw_self},
+    [PANEL_SYSINFO] = {"=== INFORMACION DEL SISTEMA ===", CHROME_RULED, A_BOLD, hash_sysinfo, draw_sysinfo},
+    [PANEL_FOOTER] = {NULL, CHROME_NONE, 0, hash_footer, draw_footer},
+};
+
+static void panel_place(Panel *p, int y, int x, int h, int w)
+{
+    p->visible = h > 0 && w > 0;
+    p->y = y;
+    p->x = x;
+    p->h = h;
+    p->w = w;
+}
+
+// Calcula la disposición para el tamaño actual de la terminal y recrea las ventanas
+void screen_layout(Screen *scr)
+{
+    for (int i = 0; i < PANEL_COUNT; i++)
+    {
+        Panel *p = &scr->panels[i];
+        if (p->frame)
+            delwin(p->frame);
+        if (p->body)
+            delwin(p->body);
+        memset(p, 0, sizeof(*p));
+    }
+    scr->lines = LINES;
+    scr->cols = COLS;
+
+    int wide = COLS >= TOP_MIN_COLS;
+    int left_w = wide ? LEFT_COLUMN_WIDTH : COLS;
+    int sysinfo_y = LINES - 1 - SYSINFO_HEIGHT;
+    Panel *ps = scr->panels;
+
+    panel_place(&ps[PANEL_HEADER], 0, 0, 3, COLS);
+    panel_place(&ps[PANEL_ALERTS], 3, 0, 1, COLS);
+    panel_place(&ps[PANEL_CPU], 4, 0, 6, MIN(40, COLS));
+    panel_place(&ps[PANEL_TEMP], 4, 40, 6, MIN(29, COLS - 40));
+    panel_place(&ps[PANEL_PROCS], 4, 70, 6, COLS - 70);
+
+    // Columna izquierda: los paneles se apilan mientras entren sobre la información del sistema.
+    // Sin columna derecha, el consumo del monitor reemplaza al mapa de núcleos y la
+    // presión y la paginación van debajo de la swap y los nodos NUMA debajo de la RAM; las estadísticas
+    // por ventana ocupan el lugar del gráfico de RAM. En modo contenedor el cgroup va antes que los gráficos.
+    int self_in_stack = scr->show_self && !wide;
+    int pressure_h = scr->pressure_rows ? 4 + scr->pressure_rows : 0;
+    int pressure_in_stack = pressure_h && !wide;
+    int vm_h = scr->vm_rows ? 3 + scr->vm_rows : 0;
+    int vm_in_stack = vm_h && !wide;
+    int numa_h = scr->numa_rows ? 2 + scr->numa_rows : 0;
+    int numa_in_stack = numa_h && !wide;
+    const struct
+    {
+        PanelId id;
+        int height; // Mínimo; el último panel se estira hasta la información del sistema
+        int gap;    // Filas libres antes del panel
+    } stack[] = {
+        {PANEL_RAM, 5, 1},
+        {PANEL_NUMA, numa_in_stack ? numa_h : 0, numa_in_stack},
+        {PANEL_NET, 5, 1},
+        {PANEL_DISK, scr->disk_rows ? 3 + 2 * scr->disk_rows : 3, 0},
+        {PANEL_SWAP, 5, 1},
+        {PANEL_CGROUP, scr->cgroup_rows ? 2 + scr->cgroup_rows : 0, scr->cgroup_rows > 0},
+        {PANEL_PRESSURE, pressure_in_stack ? pressure_h : 0, pressure_in_stack},
+        {PANEL_VMSTAT, vm_in_stack ? vm_h : 0, vm_in_stack},
+        {scr->show_stats ? PANEL_STATS : PANEL_HISTOGRAM, 11, 0},
+        {self_in_stack ? PANEL_SELF : PANEL_HEATMAP, self_in_stack ? SELF_HEIGHT : 2, 1},
+    };
+    int stack_count = (int)(sizeof(stack) / sizeof(stack[0]));
+    int y = 10;
+    for (int i = 0; i < stack_count; i++)
+    {
+        y += stack[i].gap;
+        int height = i == stack_count - 1 ? MAX(stack[i].height, sysinfo_y - 1 - y) : stack[i].height;
+        if (y + height <= sysinfo_y)
+            panel_place(&ps[stack[i].id], y, 0, height, left_w);
+        y += height;
+    }
+
+    // Columna derecha: los nodos NUMA, la presión y la paginación arriba si el sistema las informa
+    // y el top de procesos en todo el alto restante, menos el consumo del monitor si está a la vista
+    if (wide)
+    {
+        int self_h = scr->show_self ? SELF_HEIGHT + 1 : 0;
+        int top_y = 11;
+        if (numa_h)
+        {
+            panel_place(&ps[PANEL_NUMA], top_y, LEFT_COLUMN_WIDTH, numa_h, COLS - LEFT_COLUMN_WIDTH);
+            top_y += numa_h + 1;
+        }
+        if (pressure_h)
+        {
+            panel_place(&ps[PANEL_PRESSURE], top_y, LEFT_COLUMN_WIDTH, pressure_h, COLS - LEFT_COLUMN_WIDTH);
+            top_y += pressure_h + 1;
+        }
+        if (vm_h)
+        {
+            panel_place(&ps[PANEL_VMSTAT], top_y, LEFT_COLUMN_WIDTH, vm_h, COLS - LEFT_COLUMN_WIDTH);
+            top_y += vm_h + 1;
+        }
+        panel_place(&ps[PANEL_TOP], top_y, LEFT_COLUMN_WIDTH, sysinfo_y - 1 - top_y - self_h, COLS - LEFT_COLUMN_WIDTH);
+        if (self_h)
+            panel_place(&ps[PANEL_SELF], sysinfo_y - self_h, LEFT_COLUMN_WIDTH, SELF_HEIGHT, COLS - LEFT_COLUMN_WIDTH);
+    }
+    panel_place(&ps[PANEL_SYSINFO], sysinfo_y, 0, SYSINFO_HEIGHT, COLS);
+    panel_place(&ps[PANEL_FOOTER], LINES - 1, 0, 1, COLS);
+
+    for (int i = 0; i < PANEL_COUNT; i++)
+    {
+        Panel *p = &ps[i];
+        int chrome_rows = panel_defs[i].chrome == CHROME_RULED ? 2 : panel_defs[i].chrome == CHROME_TITLE ? 1 : 0;
+        if (!p->visible || p->h <= chrome_rows || p->y + p->h > LINES || p->x + p->w > COLS)
+        {
+            p->visible = 0;
+            continue;
+        }
+        if (chrome_rows > 0)
+        {
+            p->frame = newwin(chrome_rows, p->w, p->y, p->x);
+            wbkgd(p->frame, COLOR_PAIR(8));
+        }
+        p->body = newwin(p->h - chrome_rows, p->w, p->y + chrome_rows, p->x);
+        wbkgd(p->body, COLOR_PAIR(8));
+    }
+
+    // Limpiar lo que quede fuera de los paneles
+    werase(stdscr);
+    wnoutrefresh(stdscr);
+}
+
+static void draw_panel_chrome(Panel *p, const PanelDef *def)
+{
+    WINDOW *win = p->frame;
+    if (has_colors())
+        wattron(win, COLOR_PAIR(4));
+    wattron(win, def->title_attrs);
+    mvwprintw(win, 0, 0, def->title, collector->name);
+    wattroff(win, def->title_attrs);
+    if (has_colors())
+        wattroff(win, COLOR_PAIR(4));
+    if (def->chrome == CHROME_RULED)
+    {
+        if (has_colors())
+            wattron(win, COLOR_PAIR(6));
+        mvwhline(win, 1, 0, ACS_HLINE, p->w);
+        if (has_colors())
+            wattroff(win, COLOR_PAIR(6));
+    }
+    wnoutrefresh(win);
+}
+
+// Redibuja solo los paneles cuyos datos cambiaron y vuelca todo con un único doupdate
+void screen_draw(Screen *scr, const Sample *s, const UiState *ui)
+{
+    int disk_rows = MIN(s->mounts.count, DISK_PANEL_MOUNTS);
+    int show_stats = ui->stats_window >= 0;
+    int psi_rows = pressure_rows(&s->pressure);
+    int cg_rows = cgroup_rows(&s->cgroup);
+    int paging_rows = vm_rows(&s->vm);
+    int node_rows = numa_rows(&s->numa);
+    if (scr->lines != LINES || scr->cols != COLS || scr->show_self != ui->show_self || scr->show_stats != show_stats ||
+        scr->disk_rows != disk_rows || scr->pressure_rows != psi_rows || scr->cgroup_rows != cg_rows || scr->vm_rows != paging_rows ||
+        scr->numa_rows != node_rows)
+    {
+        unsigned long long start = cycles_now();
+        scr->show_self = ui->show_self;
+        scr->show_stats = show_stats;
+        scr->disk_rows = disk_rows;
+        scr->pressure_rows = psi_rows;
+        scr->cgroup_rows = cg_rows;
+        scr->vm_rows = paging_rows;
+        scr->numa_rows = node_rows;
+        screen_layout(scr);
+        prof_end(PHASE_LAYOUT, start);
+    }
+
+    unsigned long long start = cycles_now();
+    for (int i = 0; i < PANEL_COUNT; i++)
+    {
+        Panel *p = &scr->panels[i];
+        const PanelDef *def = &panel_defs[i];
+        if (!p->visible)
+            continue;
+        if (p->frame && !p->chrome_drawn)
+        {
+            draw_panel_chrome(p, def);
+            p->chrome_drawn = 1;
+        }
+
+        Hash h = s->memory_ok || i == PANEL_HEADER ? def->hash(s, ui) : 0;
+        if (p->drawn_hash == h && p->drawn_hash != 0)
+            continue;
+        werase(p->body);
+        if (s->memory_ok || i == PANEL_HEADER)
+            def->draw(p->body, s, ui);
+        else if (i == PANEL_CPU)
+            mvwprintw(p->body, 0, 0, "Error al obtener información de memoria");
+        wnoutrefresh(p->body);
+        p->drawn_hash = h;
+        scr->panel_redraws++;
+    }
+    prof_end(PHASE_DRAW, start);
+
+    start = cycles_now();
+    doupdate();
+    prof_end(PHASE_UPDATE, start);
+    scr->frames++;
+}
+
+void screen_free(Screen *scr)
+{
+    for (int i = 0; i < PANEL_COUNT; i++)
+    {
+        if (scr->panels[i].frame)
+            delwin(scr->panels[i].frame);
+        if (scr->panels[i].body)
+            delwin(scr->panels[i].body);
+    }
+    memset(scr, 0, sizeof(*scr));
+}
+
+// Paleta común a todos los paneles
+void ui_init_colors(void)
+{
+    if (has_colors())
+    {
+        start_color();
+        use_default_colors();
+        init_pair(1, COLOR_GREEN, COLOR_BLACK);   // Verde para uso bajo
+        init_pair(2, COLOR_YELLOW, COLOR_BLACK);  // Amarillo para uso medio
+        init_pair(3, COLOR_RED, COLOR_BLACK);     // Rojo para uso alto
+        init_pair(4, COLOR_CYAN, COLOR_BLACK);    // Cian para títulos
+        init_pair(5, COLOR_GREEN, COLOR_BLACK);   // Verde para coordenadas
+        init_pair(6, COLOR_BLUE, COLOR_BLACK);    // Azul para info
+        init_pair(7, COLOR_MAGENTA, COLOR_BLACK); // Magenta para advertencias
+        init_pair(8, COLOR_BLACK, COLOR_BLACK);   // Fondo negro
+    }
+    bkgd(COLOR_PAIR(8)); // Fondo negro para toda la pantalla
+    wbkgd(stdscr, COLOR_PAIR(8));
+}
+
+// Fuerza el redibujado completo (p. ej. tras un cambio de tamaño)
+void screen_invalidate(Screen *scr)
+{
+    scr->lines = scr->cols = 0;
+}
+
+// Procesa una tecla. Devuelve 0 para salir. *query_changed indica que hay que pedir otro top
+// e *interval_changed que cambió el intervalo de muestreo.
+int handle_key(UiState *ui, int ch, int *query_changed, int *interval_changed)
+{
+    if (ui->editing_filter)
+    {
+        char *filter = ui->proc_query.filter;
+        size_t len = strlen(filter);
+        if (ch == '\n' || ch == KEY_ENTER)
+            ui->editing_filter = 0;
+        else if (ch == 27) // Esc: descartar el filtro
+        {
+            filter[0] = '\0';
+            ui->editing_filter = 0;
+            *query_changed = 1;
+        }
+        else if ((ch == KEY_BACKSPACE || ch == 127 || ch == 8) && len > 0)
+        {
+            filter[len - 1] = '\0';
+            *query_changed = 1;
+        }
+        else if (isprint(ch) && len < PROC_FILTER_LEN - 1)
+        {
+            filter[len] = (char)ch;
+            filter[len + 1] = '\0';
+            *query_changed = 1;
+        }
+        return 1;
+    }
+    if (ch == 'q' || ch == 'Q')
+        return 0;
+    else if (ch == 'r' || ch == 'R')
+        ui_reset_history(ui);
+    else if (ch == 'z' || ch == 'Z')
+        ui->zoom = (ui->zoom + 1) % HIST_TIERS;
+    else if (ch == 'o' || ch == 'O')
+        ui->show_self = !ui->show_self;
+    else if (ch == 'e' || ch == 'E')
+        ui->stats_window = ui->stats_window + 1 < WSTAT_WINDOWS ? ui->stats_window + 1 : -1; // 1 min, 5 min, 1 h, oculto
+    else if (ch == 'c' || ch == 'C')
+        ui->proc_query.sort = PROC_SORT_CPU, *query_changed = 1;
+    else if (ch == 'm' || ch == 'M')
+        ui->proc_query.sort = PROC_SORT_RSS, *query_changed = 1;
+    else if (ch == 'i' || ch == 'I')
+        ui->proc_query.sort = PROC_SORT_IO, *query_changed = 1;
+    else if (ch == 't' || ch == 'T')
+        ui->proc_query.sort = PROC_SORT_START, *query_changed = 1;
+    else if (ch == 'p' || ch == 'P')
+        ui->proc_query.sort = PROC_SORT_PSS, *query_changed = 1;
+    else if (ch == '/')
+        ui->editing_filter = 1;
+    else if (ch == '+' && ui->interval_ms > MIN_INTERVAL_MS)
+        ui->interval_ms = MAX(MIN_INTERVAL_MS, ui->interval_ms / 2), *interval_changed = 1;
+    else if (ch == '-' && ui->interval_ms < MAX_INTERVAL_MS)
+        ui->interval_ms = MIN(MAX_INTERVAL_MS, ui->interval_ms * 2), *interval_changed = 1;
+    return 1;
+}
+
+// Ajusta ncurses al nuevo tamaño de la terminal; la disposición se recalcula al dibujar
+void ui_handle_resize(Screen *scr)
+{
+    struct winsize ws;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_row > 0 && ws.ws_col > 0)
+        resizeterm(ws.ws_row, ws.ws_col);
+    screen_invalidate(scr);
+}
+
+// --- BANCO DE PRUEBAS ---
+
+// --bench mide cuánto cuesta el monitor: cada recolector por separado, la muestra
+// completa del muestreador y el dibujo de un cuadro sobre una terminal sin pantalla
+#define BENCH_DEFAULT_ITERATIONS 200
+#define BENCH_LINES 50
+#define BENCH_COLS 160
+
+// Estado compartido por los casos; todo corre en el hilo principal
+static struct
+{
+    Sampler sampler;
+    Screen screen;
+    UiState ui;
+    Sample frames[2]; // Muestras que se alternan en el dibujo incremental
+    unsigned frame;
+} bench;
+
+static void bench_memory(void)
+{
+    MemoryInfo mem;
+    get_memory_info(&mem);
+}
+
+static void bench_vmstat(void)
+{
+    VmCounters vm;
+    collector->read_vmstat(&vm);
+}
+
+static void bench_cpu(void)
+{
+    get_cpu_usage();
+}
+
+static void bench_cpu_freq(void)
+{
+    Sampler *sp = &bench.sampler;
+    if (collector->read_cpu_freq(&sp->freq_stats[sp->freq_cur]) == 0)
+    {
+        cpu_freq_usage(&sp->freq_stats[!sp->freq_cur], &sp->freq_stats[sp->freq_cur], 1.0, &sp->current.freq);
+        sp->freq_cur = !sp->freq_cur;
+    }
+}
+
+static void bench_cores(void)
+{
+    Sampler *sp = &bench.sampler;
+    if (collector->read_cpu_cores(&sp->core_ticks[sp->core_cur]) == 0)
+    {
+        cpu_core_usage(&sp->core_ticks[!sp->core_cur], &sp->core_ticks[sp->core_cur], &sp->current.cores);
+        sp->core_cur = !sp->core_cur;
+    }
+}
+
+static void bench_net(void)
+{
+    get_net_stats(&bench.sampler.current.net_counters);
+}
+
+static void bench_procs(void)
+{
+    get_process_stats(&bench.sampler.current.procs);
+}
+
+// Régimen estable del orden PSS: tras la primera pasada solo se releen los mayores
+static void bench_proc_memory(void)
+{
+    proc_mem_refresh(&proc_table, &bench.sampler.current.proc_mem);
+}
+
+static void bench_disk(void)
+{
+    DiskStats disk;
+    get_disk_stats(&disk);
+}
+
+static void bench_disk_io(void)
+{
+    collector->read_disk_io(&bench.sampler.disk_stats);
+}
+
+static void bench_mounts(void)
+{
+    collector->read_mounts(&bench.sampler.current.mounts);
+}
+
+static void bench_pressure(void)
+{
+    collector->read_pressure(&bench.sampler.current.pressure);
+}
+
+static void bench_cgroup(void)
+{
+    collector->read_cgroup(&bench.sampler.cgroup_stats);
+}
+
+static void bench_numa(void)
+{
+    collector->read_numa(&bench.sampler.numa_stats);
+}
+
+static void bench_sensors(void)
+{
+    collector->read_sensors(&bench.sampler.current.sensors);
+}
+
+static void bench_sample(void)
+{
+    sampler_collect(&bench.sampler);
+}
+
+// Cuadro completo: disposición, marcos y todos los paneles, como tras un cambio de tamaño
+static void bench_frame_full(void)
+{
+    screen_invalidate(&bench.screen);
+    clearok(curscr, TRUE); // Repintar la terminal entera, no solo la diferencia
+    screen_draw(&bench.screen, &bench.frames[0], &bench.ui);
+}
+
+// Cuadro del bucle principal: una muestra nueva y solo los paneles que cambiaron
+static void bench_frame_incremental(void)
+{
+    // Las dos muestras se alternan, pero el reloj avanza un segundo por cuadro como en vivo
+    static Sample s;
+    s = bench.frames[bench.frame & 1];
+    s.timestamp_ns = bench.frames[1].timestamp_ns + ++bench.frame * 1000000000ULL;
+    ui_record_sample(&bench.ui, &s);
+    screen_draw(&bench.screen, &s, &bench.ui);
+}
+
+typedef struct
+{
+    const char *name;
+    void (*run)(void);
+    int frame; // Necesita la terminal sin pantalla
+} BenchCase;
+
+static const BenchCase bench_cases[] = {
+    {"get_memory_info", bench_memory, 0},
+    {"read_vmstat", bench_vmstat, 0},
+    {"get_cpu_usage", bench_cpu, 0},
+    {"read_cpu_cores + cpu_core_usage", bench_cores, 0},
+    {"read_cpu_freq + cpu_freq_usage", bench_cpu_freq, 0},
+    {"get_net_stats", bench_net, 0},
+    {"get_process_stats", bench_procs, 0},
+    {"proc_mem_refresh", bench_proc_memory, 0},
+    {"get_disk_stats", bench_disk, 0},
+    {"read_disk_io", bench_disk_io, 0},
+    {"read_mounts", bench_mounts, 0},
+    {"read_pressure", bench_pressure, 0},
+    {"read_cgroup", bench_cgroup, 0},
+    {"read_numa", bench_numa, 0},
+    {"read_sensors", bench_sensors, 0},
+    {"sampler_collect (muestra completa)", bench_sample, 0},
+    {"cuadro completo", bench_frame_full, 1},
+    {"cuadro incremental", bench_frame_incremental, 1},
+};
+
+static int compare_ull(const void *a, const void *b)
+{
+    unsigned long long x = *(const unsigned long long *)a, y = *(const unsigned long long *)b;
+    return x < y ? -1 : x > y;
+}
+
+static unsigned long long file_size(FILE *fp)
+{
+    struct stat st;
+    fflush(fp);
+    return fstat(fileno(fp), &st) == 0 ? (unsigned long long)st.st_size : 0;
+}
+
+static void bench_case(const BenchCase *bc, int iterations, unsigned long long *lat, FILE *term_out)
+{
+    unsigned long long syscalls = syscall_count, forks = fork_count;
+    unsigned long long bytes = term_out ? file_size(term_out) : 0;
+    for (int i = 0; i < iterations; i++)
+    {
+        unsigned long long start = clock_ns(CLOCK_MONOTONIC);
+        bc->run();
+        lat[i] = clock_ns(CLOCK_MONOTONIC) - start;
+    }
+    syscalls = syscall_count - syscalls;
+    forks = fork_count - forks;
+    qsort(lat, iterations, sizeof(*lat), compare_ull);
+    int p99 = MIN(iterations - 1, iterations * 99 / 100);
+
+    char bytes_str[24] = "-";
+    if (term_out)
+        snprintf(bytes_str, sizeof(bytes_str), "%.0f", (double)(file_size(term_out) - bytes) / iterations);
+    printf("%10.1f %10.1f %9.1f %6.2f %8s  %s\n", lat[iterations / 2] / 1e3, lat[p99] / 1e3,
+           (double)syscalls / iterations, (double)forks / iterations, bytes_str, bc->name);
+}
+
+// Corre todos los casos y escribe la tabla en stdout. Los cuadros se dibujan con newterm
+// sobre un archivo temporal: se mide también cuántos bytes recibiría la terminal.
+int bench_run(int iterations)
+{
+    if (collector->open() != 0)
+    {
+        fprintf(stderr, "No se pudo inicializar el recolector %s\n", collector->name);
+        return 1;
+    }
+    unsigned long long *lat = malloc(iterations * sizeof(*lat));
+    if (!lat)
+        return 1;
+
+    Sampler *sp = &bench.sampler;
+    sp->current.proc_query.sort = PROC_SORT_CPU;
+    get_net_stats(&sp->current.net_counters);
+    sp->last_net_ns = sp->last_disk_ns = clock_ns(CLOCK_MONOTONIC);
+    ui_init(&bench.ui, 1000);
+    host_facts_load(&host);
+
+    printf("Banco de pruebas: recolector %s, %d iteraciones por caso\n", collector->name, iterations);
+    printf("%11s %11s %9s %6s %8s  %s\n", "p50 µs", "p99 µs", "syscalls", "forks", "bytes", "caso");
+
+    const char *term = getenv("TERM");
+    if (!term || !*term || strcmp(term, "dumb") == 0)
+        term = "xterm";
+    FILE *term_out = tmpfile();
+    FILE *term_in = fopen("/dev/null", "r");
+    SCREEN *headless = NULL;
+    for (size_t c = 0; c < sizeof(bench_cases) / sizeof(bench_cases[0]); c++)
+    {
+        const BenchCase *bc = &bench_cases[c];
+        if (bc->frame && !headless)
+        {
+            if (!term_out || !term_in || !(headless = newterm(term, term_out, term_in)))
+            {
+                printf("No se pudo abrir una terminal %s sin pantalla: se omiten los cuadros\n", term);
+                break;
+            }
+            set_term(headless);
+            resize_term(BENCH_LINES, BENCH_COLS);
+            ui_init_colors();
+            // Dos muestras consecutivas, como las que entrega el muestreador
+            for (int i = 0; i < 2; i++)
+            {
+                sampler_collect(sp);
+                bench.frames[i] = sp->current;
+                ui_record_sample(&bench.ui, &bench.frames[i]);
+            }
+        }
+        bench_case(bc, iterations, lat, bc->frame ? term_out : NULL);
+    }
+
+    if (headless)
+    {
+        screen_free(&bench.screen);
+        endwin();
+        delscreen(headless);
+    }
+    if (term_out)
+        fclose(term_out);
+    if (term_in)
+        fclose(term_in);
+    free(lat);
+    proc_table_free(&proc_table);
+    collector->close();
+    return 0;
+}
+
+// --- MODOS SIN INTERFAZ ---
+
+// Los modos sin interfaz terminan con SIGINT o SIGTERM y cierran todo en orden
+static volatile sig_atomic_t stop_requested = 0;
+
+static void on_stop_signal(int sig)
+{
+    (void)sig;
+    stop_requested = 1;
+}
+
+void install_stop_handlers(void)
+{
+    struct sigaction sa, old;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_stop_signal; // Sin SA_RESTART: poll vuelve con EINTR
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    // Cerrar la terminal también cierra la grabación, salvo bajo nohup
+    if (sigaction(SIGHUP, NULL, &old) == 0 && old.sa_handler != SIG_IGN)
+        sigaction(SIGHUP, &sa, NULL);
 }
 
-double cached_cpu_temp = -1;
-time_t last_temp_check = 0;
+// --batch: sin interfaz, una línea por muestra en stdout con las métricas principales
+// y el consumo del propio monitor, para verificar presupuestos en producción
+
+static void batch_print(const Sample *s)
+{
+    PhaseStats collect;
+    prof_read(PHASE_COLLECT, &collect);
+    printf("%llu.%03llu\t%.1f\t%.1f\t%.2f\t%llu\t%.1f\t%.1f\t%.0f\t%.1f\t%.1f\t%d\n",
+           s->timestamp_ns / 1000000000ULL, s->timestamp_ns / 1000000ULL % 1000, s->cpu_usage,
+           s->memory_ok ? s->memory.ram_percentage : 0.0, s->self.cpu_pct, s->self.rss_bytes / 1024,
+           s->self.forks_rate, s->self.ctx_rate, s->self.syscall_rate, collect.p50_ns / 1e3, collect.p99_ns / 1e3,
+           s->alerts.firing);
+    fflush(stdout);
+}
 
-double get_cpu_temperature_cached()
+// count = 0: hasta SIGINT o SIGTERM
+int batch_run(Sampler *sp, int count, Recorder *rec)
 {
-    time_t now = time(NULL);
-    if (now - last_temp_check > 30 || cached_cpu_temp < 0)
-    { // Actualiza cada 30 segundos
-        FILE *fp = popen("sudo powermetrics --samplers smc -n1 2>/dev/null | grep -m1 'CPU die temperature' | awk '{print $4}'", "r");
-        if (fp)
+    install_stop_handlers();
+    printf("# tiempo\tcpu%%\tram%%\tpropio_cpu%%\tpropio_rss_kb\tforks/s\tctx/s\tsyscalls_muestreo/s\trecoleccion_p50_us\trecoleccion_p99_us\talertas\n");
+    int printed = 0;
+    unsigned long long last_seq = 0;
+    struct pollfd pfd = {sp->notify_pipe[0], POLLIN, 0};
+    while (!stop_requested && (count == 0 || printed < count))
+    {
+        if (poll(&pfd, 1, -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        drain_fd(sp->notify_pipe[0]);
+        sampler_log_error(sp);
+        const Sample *s;
+        while ((s = spsc_peek(&sp->samples)) != NULL)
         {
-            double temp = -1;
-            fscanf(fp, "%lf", &temp);
-            pclose(fp);
-            if (temp > 0)
-                cached_cpu_temp = temp;
+            // Las muestras sin datos del proceso (la primera) no entran en la salida
+            if (s->seq != last_seq && s->self.valid && (count == 0 || printed < count))
+            {
+                batch_print(s);
+                if (rec)
+                    recorder_append(rec, s);
+                printed++;
+            }
+            last_seq = s->seq;
+            spsc_consume(&sp->samples);
         }
-        last_temp_check = now;
     }
-    return cached_cpu_temp;
+    return 0;
 }
 
-// --- PROCESOS ACTIVOS ---
+// --- EXPORTADOR OPENMETRICS ---
+
+// --serve: cada muestra se serializa una sola vez en una página; todos los scrapers
+// reciben esa misma memoria con writev. Las consultas nunca disparan una recolección.
+#define SERVE_MAX_CLIENTS 64
+#define SERVE_PAGES 4 // Una en uso por clientes lentos no bloquea la siguiente muestra
+#define SERVE_REQUEST_MAX 2048
+#define SERVE_IDLE_TIMEOUT_NS 10000000000ULL
 
 typedef struct
 {
-    int total;
-    int system;
-    int user;
-    int background;
-} ProcessStats;
+    char header[192]; // Respuesta HTTP con el Content-Length de esta página
+    size_t header_len;
+    char *body;
+    size_t body_len;
+    size_t body_cap;
+    int refs; // Clientes que todavía la están enviando
+} MetricsPage;
 
-// Obtiene el número de procesos activos y los clasifica
-void get_process_stats(ProcessStats *stats)
+typedef struct
 {
-    FILE *fp = popen("ps -axo user,stat | awk 'NR>1 {if($2 ~ /S/) bg++; else if($1==\"root\") sys++; else usr++;} END {print sys,usr,bg,sys+usr+bg}'", "r");
-    if (!fp)
+    int fd; // -1 = libre
+    int writing;
+    char request[SERVE_REQUEST_MAX];
+    size_t request_len;
+    MetricsPage *page;    // Respuesta compartida, o NULL si es una fija (404, 503)
+    const char *fixed;
+    size_t sent;
+    unsigned long long last_ns; // Última actividad, para cortar conexiones colgadas
+} ServeClient;
+
+typedef struct
+{
+    int listen_fd;
+    const char *unix_path; // Se borra al terminar
+    MetricsPage pages[SERVE_PAGES];
+    MetricsPage *current; // Última muestra serializada
+    ServeClient clients[SERVE_MAX_CLIENTS];
+} Server;
+
+static const char serve_not_found[] =
+    "HTTP/1.1 404 Not Found\r\nContent-Type: text/plain\r\nContent-Length: 22\r\nConnection: close\r\n\r\n"
+    "Solo existe /metrics\r\n";
+static const char serve_unavailable[] =
+    "HTTP/1.1 503 Service Unavailable\r\nContent-Type: text/plain\r\nContent-Length: 21\r\nConnection: close\r\n\r\n"
+    "Sin muestras todavía";
+
+static void page_printf(MetricsPage *pg, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+static void page_printf(MetricsPage *pg, const char *fmt, ...)
+{
+    for (;;)
     {
-        stats->system = stats->user = stats->background = stats->total = 0;
-        return;
+        va_list ap;
+        va_start(ap, fmt);
+        size_t room = pg->body_cap - pg->body_len;
+        int n = vsnprintf(pg->body ? pg->body + pg->body_len : NULL, room, fmt, ap);
+        va_end(ap);
+        if (n < 0)
+            return;
+        if ((size_t)n < room)
+        {
+            pg->body_len += n;
+            return;
+        }
+        // La página crece una vez y se reutiliza en las muestras siguientes
+        size_t cap = MAX(pg->body_cap * 2, pg->body_len + n + 4096);
+        char *body = realloc(pg->body, cap);
+        if (!body)
+            return;
+        pg->body = body;
+        pg->body_cap = cap;
     }
-    fscanf(fp, "%d %d %d %d", &stats->system, &stats->user, &stats->background, &stats->total);
-    pclose(fp);
 }
 
-// Dibuja barras para procesos
-void draw_process_bars(int y, int x, ProcessStats *stats)
+// Valor de etiqueta OpenMetrics: se escapan \, " y saltos de línea
+static const char *label_escape(const char *in, char *out, size_t len)
 {
-    int maxval = stats->system;
-    if (stats->user > maxval)
-        maxval = stats->user;
-    if (stats->background > maxval)
-        maxval = stats->background;
-    int width = 20;
-#define PROC_BAR(val) (maxval > 0 ? (val) * width / maxval : 0)
-    mvprintw(y, x, "Procesos:");
-    mvprintw(y + 1, x, "Sistema: ");
-    for (int i = 0; i < PROC_BAR(stats->system); ++i)
-        addch(ACS_CKBOARD);
-    printw("  %d", stats->system);
-    mvprintw(y + 2, x, "Usuario: ");
-    for (int i = 0; i < PROC_BAR(stats->user); ++i)
-        addch(ACS_CKBOARD);
-    printw("  %d", stats->user);
-    mvprintw(y + 3, x, "Fondo:   ");
-    for (int i = 0; i < PROC_BAR(stats->background); ++i)
-        addch(ACS_CKBOARD);
-    printw("  %d", stats->background);
-    mvprintw(y + 4, x, "Total:   %d", stats->total);
+    size_t o = 0;
+    for (; *in && o + 2 < len; in++)
+    {
+        if (*in == '\\' || *in == '"' || *in == '\n')
+            out[o++] = '\\';
+        out[o++] = *in == '\n' ? 'n' : *in;
+    }
+    out[o] = '\0';
+    return out;
 }
 
-// --- ESPACIO DE DISCO ---
+static void page_family(MetricsPage *pg, const char *name, const char *type, const char *unit, const char *help)
+{
+    page_printf(pg, "# TYPE %s %s\n", name, type);
+    if (unit)
+        page_printf(pg, "# UNIT %s %s\n", name, unit);
+    page_printf(pg, "# HELP %s %s\n", name, help);
+}
 
-typedef struct
+void metrics_render(MetricsPage *pg, const Sample *s)
 {
-    unsigned long long total;
-    unsigned long long used;
-    unsigned long long free;
-    double percent_used;
-} DiskStats;
+    pg->body_len = 0;
+    page_family(pg, "memoriuses_sample_timestamp_seconds", "gauge", "seconds", "Momento de la muestra.");
+    page_printf(pg, "memoriuses_sample_timestamp_seconds %llu.%03llu\n", s->timestamp_ns / 1000000000ULL, s->timestamp_ns / 1000000ULL % 1000);
 
-// Obtiene espacio de disco para "/"
-void get_disk_stats(DiskStats *stats)
+    if (s->memory_ok)
+    {
+        const MemoryInfo *m = &s->memory;
+        page_family(pg, "memoriuses_memory_bytes", "gauge", "bytes", "Memoria RAM por estado.");
+        page_printf(pg, "memoriuses_memory_bytes{state=\"total\"} %llu\n", m->total_ram);
+        page_printf(pg, "memoriuses_memory_bytes{state=\"used\"} %llu\n", m->used_ram);
+        page_printf(pg, "memoriuses_memory_bytes{state=\"free\"} %llu\n", m->free_ram);
+        page_printf(pg, "memoriuses_memory_bytes{state=\"inactive\"} %llu\n", m->inactive_ram);
+        page_printf(pg, "memoriuses_memory_bytes{state=\"wired\"} %llu\n", m->wired_ram);
+        page_printf(pg, "memoriuses_memory_bytes{state=\"compressed\"} %llu\n", m->compressed_ram);
+        page_family(pg, "memoriuses_swap_bytes", "gauge", "bytes", "Memoria de intercambio.");
+        page_printf(pg, "memoriuses_swap_bytes{state=\"total\"} %llu\n", m->swap_total);
+        page_printf(pg, "memoriuses_swap_bytes{state=\"used\"} %llu\n", m->swap_used);
+    }
+    if (s->vm.valid)
+    {
+        page_family(pg, "memoriuses_vm_events", "counter", NULL, "Eventos de paginación acumulados; los que el sistema no informa no aparecen.");
+        for (int i = 0; i < VM_COUNTERS; i++)
+            if (s->vm_counters.value[i] != VM_UNKNOWN)
+                page_printf(pg, "memoriuses_vm_events_total{event=\"%s\"} %llu\n", vm_counter_names[i], s->vm_counters.value[i]);
+    }
+    if (s->numa.count >= 2)
+    {
+        page_family(pg, "memoriuses_numa_memory_bytes", "gauge", "bytes", "Memoria de cada nodo NUMA por estado.");
+        for (int i = 0; i < s->numa.count; i++)
+        {
+            const NumaNodeUsage *n = &s->numa.nodes[i];
+            page_printf(pg, "memoriuses_numa_memory_bytes{node=\"%d\",state=\"total\"} %llu\n", n->id, n->total);
+            page_printf(pg, "memoriuses_numa_memory_bytes{node=\"%d\",state=\"used\"} %llu\n", n->id, n->used);
+            page_printf(pg, "memoriuses_numa_memory_bytes{node=\"%d\",state=\"file\"} %llu\n", n->id, n->file);
+            page_printf(pg, "memoriuses_numa_memory_bytes{node=\"%d\",state=\"anon\"} %llu\n", n->id, n->anon);
+        }
+        page_family(pg, "memoriuses_numa_events", "counter", NULL, "Páginas asignadas fuera del nodo preferido, acumuladas.");
+        for (int i = 0; i < s->numa.count; i++)
+        {
+            const NumaNodeUsage *n = &s->numa.nodes[i];
+            page_printf(pg, "memoriuses_numa_events_total{node=\"%d\",event=\"miss\"} %llu\n", n->id, n->numa_miss);
+            page_printf(pg, "memoriuses_numa_events_total{node=\"%d\",event=\"foreign\"} %llu\n", n->id, n->numa_foreign);
+        }
+    }
+
+    page_family(pg, "memoriuses_cpu_usage_ratio", "gauge", "ratio", "Uso de CPU del último intervalo, todos los núcleos.");
+    page_printf(pg, "memoriuses_cpu_usage_ratio %.4f\n", s->cpu_usage / 100.0);
+    if (s->cores.count > 0)
+    {
+        page_family(pg, "memoriuses_cpu_core_busy_ratio", "gauge", "ratio", "Ocupación de cada núcleo en el último intervalo.");
+        for (int c = 0; c < s->cores.count; c++)
+            page_printf(pg, "memoriuses_cpu_core_busy_ratio{core=\"%d\"} %.4f\n", c, s->cores.busy[c] / 100.0);
+    }
+    if (s->freq.count > 0)
+    {
+        page_family(pg, "memoriuses_cpu_core_frequency_hertz", "gauge", "hertz", "Frecuencia efectiva de cada núcleo en el último intervalo.");
+        for (int c = 0; c < s->freq.count; c++)
+            if (!isnan(s->freq.mhz[c]))
+                page_printf(pg, "memoriuses_cpu_core_frequency_hertz{core=\"%d\"} %.0f\n", c, s->freq.mhz[c] * 1e6);
+        if (s->freq.governor[0])
+        {
+            page_family(pg, "memoriuses_cpu_governor", "info", NULL, "Gobernador de frecuencia del núcleo 0.");
+            page_printf(pg, "memoriuses_cpu_governor_info{governor=\"%s\"} 1\n", s->freq.governor);
+        }
+        if (s->freq.core_throttle_total != CPU_FREQ_UNKNOWN || s->freq.package_throttle_total != CPU_FREQ_UNKNOWN)
+        {
+            page_family(pg, "memoriuses_cpu_throttle_events", "counter", NULL, "Límites térmicos acumulados, sumados sobre núcleos o paquetes.");
+            if (s->freq.core_throttle_total != CPU_FREQ_UNKNOWN)
+                page_printf(pg, "memoriuses_cpu_throttle_events_total{scope=\"core\"} %llu\n", s->freq.core_throttle_total);
+            if (s->freq.package_throttle_total != CPU_FREQ_UNKNOWN)
+                page_printf(pg, "memoriuses_cpu_throttle_events_total{scope=\"package\"} %llu\n", s->freq.package_throttle_total);
+        }
+    }
+    if (s->cpu_temp >= 0)
+    {
+        page_family(pg, "memoriuses_cpu_temperature_celsius", "gauge", "celsius", "Sensor principal del CPU.");
+        page_printf(pg, "memoriuses_cpu_temperature_celsius %.1f\n", s->cpu_temp);
+    }
+
+    // Contadores crudos por interfaz: el scraper calcula las tasas
+    static const struct
+    {
+        const char *name;
+        const char *unit;
+        const char *help;
+        size_t rx, tx;
+    } net_families[] = {
+        {"memoriuses_network_bytes", "bytes", "Bytes por interfaz y dirección.", offsetof(NetIfCounters, rx_bytes), offsetof(NetIfCounters, tx_bytes)},
+        {"memoriuses_network_packets", NULL, "Paquetes por interfaz y dirección.", offsetof(NetIfCounters, rx_packets), offsetof(NetIfCounters, tx_packets)},
+        {"memoriuses_network_errors", NULL, "Errores por interfaz y dirección.", offsetof(NetIfCounters, rx_errors), offsetof(NetIfCounters, tx_errors)},
+        {"memoriuses_network_dropped", NULL, "Descartes por interfaz y dirección.", offsetof(NetIfCounters, rx_dropped), offsetof(NetIfCounters, tx_dropped)},
+    };
+    const NetStats *net = &s->net_counters;
+    for (size_t f = 0; f < sizeof(net_families) / sizeof(net_families[0]) && net->count > 0; f++)
+    {
+        page_family(pg, net_families[f].name, "counter", net_families[f].unit, net_families[f].help);
+        for (int i = 0; i < net->count; i++)
+        {
+            const unsigned char *c = (const unsigned char *)&net->ifaces[i];
+            char iface[2 * IFNAMSIZ];
+            label_escape(net->ifaces[i].name, iface, sizeof(iface));
+            page_printf(pg, "%s_total{interface=\"%s\",direction=\"rx\"} %llu\n", net_families[f].name, iface,
+                        *(const unsigned long long *)(c + net_families[f].rx));
+            page_printf(pg, "%s_total{interface=\"%s\",direction=\"tx\"} %llu\n", net_families[f].name, iface,
+                        *(const unsigned long long *)(c + net_families[f].tx));
+        }
+    }
+
+    if (s->disk.total > 0)
+    {
+        page_family(pg, "memoriuses_disk_bytes", "gauge", "bytes", "Espacio del sistema de archivos raíz.");
+        page_printf(pg, "memoriuses_disk_bytes{state=\"total\"} %llu\n", s->disk.total);
+        page_printf(pg, "memoriuses_disk_bytes{state=\"used\"} %llu\n", s->disk.used);
+        page_printf(pg, "memoriuses_disk_bytes{state=\"free\"} %llu\n", s->disk.free);
+    }
+    if (s->mounts.count > 0)
+    {
+        page_family(pg, "memoriuses_filesystem_bytes", "gauge", "bytes", "Espacio por sistema de archivos montado.");
+        for (int i = 0; i < s->mounts.count; i++)
+        {
+            const MountEntry *m = &s->mounts.mounts[i];
+            char mount[2 * sizeof(m->mount_point)], device[2 * sizeof(m->device)];
+            label_escape(m->mount_point, mount, sizeof(mount));
+            label_escape(m->device, device, sizeof(device));
+            page_printf(pg, "memoriuses_filesystem_bytes{mountpoint=\"%s\",device=\"%s\",fstype=\"%s\",state=\"total\"} %llu\n", mount, device, m->fstype, m->total);
+            page_printf(pg, "memoriuses_filesystem_bytes{mountpoint=\"%s\",device=\"%s\",fstype=\"%s\",state=\"used\"} %llu\n", mount, device, m->fstype, m->used);
+            page_printf(pg, "memoriuses_filesystem_bytes{mountpoint=\"%s\",device=\"%s\",fstype=\"%s\",state=\"free\"} %llu\n", mount, device, m->fstype, m->free);
+        }
+    }
+
+    // Contadores crudos por dispositivo de bloques; los que el backend no ofrece se omiten
+    static const struct
+    {
+        const char *name;
+        const char *unit;
+        const char *help;
+        size_t read, write; // write == read: contador sin dirección
+    } disk_families[] = {
+        {"memoriuses_disk_io_bytes", "bytes", "Bytes transferidos por dispositivo y dirección.", offsetof(DiskIoCounters, read_bytes), offsetof(DiskIoCounters, write_bytes)},
+        {"memoriuses_disk_io_operations", NULL, "Operaciones completadas por dispositivo y dirección.", offsetof(DiskIoCounters, reads), offsetof(DiskIoCounters, writes)},
+        {"memoriuses_disk_io_time_milliseconds", "milliseconds", "Tiempo acumulado de las operaciones.", offsetof(DiskIoCounters, read_ms), offsetof(DiskIoCounters, write_ms)},
+        {"memoriuses_disk_busy_milliseconds", "milliseconds", "Tiempo con alguna operación en curso.", offsetof(DiskIoCounters, busy_ms), offsetof(DiskIoCounters, busy_ms)},
+        {"memoriuses_disk_queue_milliseconds", "milliseconds", "Tiempo ponderado por la cola de operaciones.", offsetof(DiskIoCounters, queue_ms), offsetof(DiskIoCounters, queue_ms)},
+    };
+    const DiskIoRates *io = &s->disk_io;
+    for (size_t f = 0; f < sizeof(disk_families) / sizeof(disk_families[0]) && io->count > 0; f++)
+    {
+        const unsigned char *first = (const unsigned char *)&io->devices[0].prev;
+        if (*(const unsigned long long *)(first + disk_families[f].read) == DISK_UNKNOWN)
+            continue;
+        page_family(pg, disk_families[f].name, "counter", disk_families[f].unit, disk_families[f].help);
+        for (int i = 0; i < io->count; i++)
+        {
+            const unsigned char *c = (const unsigned char *)&io->devices[i].prev;
+            char device[2 * sizeof(io->devices[i].prev.name)];
+            label_escape(io->devices[i].prev.name, device, sizeof(device));
+            if (disk_families[f].read == disk_families[f].write)
+            {
+                page_printf(pg, "%s_total{device=\"%s\"} %llu\n", disk_families[f].name, device,
+                            *(const unsigned long long *)(c + disk_families[f].read));
+                continue;
+            }
+            page_printf(pg, "%s_total{device=\"%s\",direction=\"read\"} %llu\n", disk_families[f].name, device,
+                        *(const unsigned long long *)(c + disk_families[f].read));
+            page_printf(pg, "%s_total{device=\"%s\",direction=\"write\"} %llu\n", disk_families[f].name, device,
+                        *(const unsigned long long *)(c + disk_families[f].write));
+        }
+    }
+
+    // Presión del sistema y, si el monitor corre en un cgroup v2 propio, la de ese cgroup
+    if (s->pressure.valid)
+    {
+        static const char *const scopes[] = {"system", "cgroup"};
+        const PressureEntry *entries[] = {s->pressure.sys, s->pressure.cgroup};
+        int scope_count = s->pressure.cgroup_valid ? 2 : 1;
+        page_family(pg, "memoriuses_pressure_stall_seconds", "counter", "seconds", "Tiempo acumulado con tareas demoradas por falta del recurso.");
+        for (int sc = 0; sc < scope_count; sc++)
+            for (int r = 0; r < PSI_RESOURCES; r++)
+            {
+                page_printf(pg, "memoriuses_pressure_stall_seconds_total{resource=\"%s\",kind=\"some\",scope=\"%s\"} %.6f\n", psi_names[r], scopes[sc],
+                            entries[sc][r].some.total_us / 1e6);
+                page_printf(pg, "memoriuses_pressure_stall_seconds_total{resource=\"%s\",kind=\"full\",scope=\"%s\"} %.6f\n", psi_names[r], scopes[sc],
+                            entries[sc][r].full.total_us / 1e6);
+            }
+        page_family(pg, "memoriuses_pressure_avg10_ratio", "gauge", "ratio", "Fracción del tiempo con demora en los últimos 10 s.");
+        for (int sc = 0; sc < scope_count; sc++)
+            for (int r = 0; r < PSI_RESOURCES; r++)
+            {
+                page_printf(pg, "memoriuses_pressure_avg10_ratio{resource=\"%s\",kind=\"some\",scope=\"%s\"} %.4f\n", psi_names[r], scopes[sc],
+                            entries[sc][r].some.avg10 / 100);
+                page_printf(pg, "memoriuses_pressure_avg10_ratio{resource=\"%s\",kind=\"full\",scope=\"%s\"} %.4f\n", psi_names[r], scopes[sc],
+                            entries[sc][r].full.avg10 / 100);
+            }
+    }
+
+    // Modo contenedor: el cgroup observado y sus hijos, cada uno con su ruta completa
+    const CgroupUsage *cg = &s->cgroup;
+    if (cg->info.valid)
+    {
+        char self[2 * CGROUP_PATH_LEN], child[2 * CGROUP_PATH_LEN + CGROUP_NAME_LEN];
+        label_escape(cg->info.path, self, sizeof(self));
+        const char *sep = strcmp(cg->info.path, "/") == 0 ? "" : "/";
+        if (cg->info.has_memory)
+        {
+            const struct
+            {
+                const char *state;
+                unsigned long long value;
+            } memory[] = {
+                {"current", cg->self.prev.memory_current},
+                {"max", cg->info.memory_max},
+                {"high", cg->info.memory_high},
+                {"anon", cg->info.anon},
+                {"file", cg->info.file},
+                {"kernel", cg->info.kernel},
+                {"swap", cg->info.has_swap ? cg->info.swap_current : CGROUP_UNLIMITED},
+                {"swap_max", cg->info.has_swap ? cg->info.swap_max : CGROUP_UNLIMITED},
+            };
+            page_family(pg, "memoriuses_cgroup_memory_bytes", "gauge", "bytes", "Memoria del cgroup y sus límites; un límite sin valor no aparece.");
+            for (size_t i = 0; i < sizeof(memory) / sizeof(memory[0]); i++)
+                if (memory[i].value != CGROUP_UNLIMITED)
+                    page_printf(pg, "memoriuses_cgroup_memory_bytes{cgroup=\"%s\",state=\"%s\"} %llu\n", self, memory[i].state, memory[i].value);
+            for (int i = 0; i < cg->child_count; i++)
+            {
+                label_escape(cg->children[i].prev.name, child, sizeof(child));
+                page_printf(pg, "memoriuses_cgroup_memory_bytes{cgroup=\"%s%s%s\",state=\"current\"} %llu\n", self, sep, child,
+                            cg->children[i].prev.memory_current);
+            }
+        }
+        if (cg->info.has_cpu)
+        {
+            page_family(pg, "memoriuses_cgroup_cpu_limit_cores", "gauge", NULL, "Núcleos disponibles: cuota de cpu.max o CPUs del cpuset.");
+            page_printf(pg, "memoriuses_cgroup_cpu_limit_cores{cgroup=\"%s\"} %.2f\n", self, cg->info.cpu_limit);
+            page_family(pg, "memoriuses_cgroup_cpu_seconds", "counter", "seconds", "Tiempo de CPU consumido por el cgroup.");
+            page_printf(pg, "memoriuses_cgroup_cpu_seconds_total{cgroup=\"%s\",mode=\"user\"} %.6f\n", self, cg->self.prev.cpu_user_us / 1e6);
+            page_printf(pg, "memoriuses_cgroup_cpu_seconds_total{cgroup=\"%s\",mode=\"system\"} %.6f\n", self, cg->self.prev.cpu_system_us / 1e6);
+            for (int i = 0; i < cg->child_count; i++)
+            {
+                const CgroupCounters *c = &cg->children[i].prev;
+                label_escape(c->name, child, sizeof(child));
+                page_printf(pg, "memoriuses_cgroup_cpu_seconds_total{cgroup=\"%s%s%s\",mode=\"user\"} %.6f\n", self, sep, child, c->cpu_user_us / 1e6);
+                page_printf(pg, "memoriuses_cgroup_cpu_seconds_total{cgroup=\"%s%s%s\",mode=\"system\"} %.6f\n", self, sep, child, c->cpu_system_us / 1e6);
+            }
+            if (cg->info.cpu_quota)
+            {
+                page_family(pg, "memoriuses_cgroup_cpu_periods", "counter", NULL, "Períodos de cpu.max transcurridos y con la cuota agotada.");
+                page_printf(pg, "memoriuses_cgroup_cpu_periods_total{cgroup=\"%s\",state=\"elapsed\"} %llu\n", self, cg->self.prev.nr_periods);
+                page_printf(pg, "memoriuses_cgroup_cpu_periods_total{cgroup=\"%s\",state=\"throttled\"} %llu\n", self, cg->self.prev.nr_throttled);
+                page_family(pg, "memoriuses_cgroup_cpu_throttled_seconds", "counter", "seconds", "Tiempo frenado por la cuota de cpu.max.");
+                page_printf(pg, "memoriuses_cgroup_cpu_throttled_seconds_total{cgroup=\"%s\"} %.6f\n", self, cg->self.prev.throttled_us / 1e6);
+            }
+        }
+        if (cg->info.has_io)
+        {
+            page_family(pg, "memoriuses_cgroup_io_bytes", "counter", "bytes", "Bytes de E/S del cgroup, sumando todos los dispositivos.");
+            page_printf(pg, "memoriuses_cgroup_io_bytes_total{cgroup=\"%s\",direction=\"read\"} %llu\n", self, cg->self.prev.io_rbytes);
+            page_printf(pg, "memoriuses_cgroup_io_bytes_total{cgroup=\"%s\",direction=\"write\"} %llu\n", self, cg->self.prev.io_wbytes);
+            for (int i = 0; i < cg->child_count; i++)
+            {
+                const CgroupCounters *c = &cg->children[i].prev;
+                label_escape(c->name, child, sizeof(child));
+                page_printf(pg, "memoriuses_cgroup_io_bytes_total{cgroup=\"%s%s%s\",direction=\"read\"} %llu\n", self, sep, child, c->io_rbytes);
+                page_printf(pg, "memoriuses_cgroup_io_bytes_total{cgroup=\"%s%s%s\",direction=\"write\"} %llu\n", self, sep, child, c->io_wbytes);
+            }
+            page_family(pg, "memoriuses_cgroup_io_operations", "counter", NULL, "Operaciones de E/S del cgroup.");
+            page_printf(pg, "memoriuses_cgroup_io_operations_total{cgroup=\"%s\",direction=\"read\"} %llu\n", self, cg->self.prev.io_rios);
+            page_printf(pg, "memoriuses_cgroup_io_operations_total{cgroup=\"%s\",direction=\"write\"} %llu\n", self, cg->self.prev.io_wios);
+        }
+    }
+
+    if (s->alerts.count > 0)
+    {
+        page_family(pg, "memoriuses_alert_state", "stateset", NULL, "Estado de cada regla de --alert.");
+        static const char *const states[] = {"ok", "pending", "firing"};
+        for (int i = 0; i < s->alerts.count; i++)
+        {
+            char rule[2 * sizeof(s->alerts.items[i].name)];
+            label_escape(s->alerts.items[i].name, rule, sizeof(rule));
+            for (int st = ALERT_OK; st <= ALERT_FIRING; st++)
+                page_printf(pg, "memoriuses_alert_state{rule=\"%s\",memoriuses_alert_state=\"%s\"} %d\n", rule, states[st],
+                            s->alerts.items[i].state == st);
+        }
+    }
+
+    page_family(pg, "memoriuses_processes", "gauge", NULL, "Procesos por clase.");
+    page_printf(pg, "memoriuses_processes{class=\"system\"} %d\n", s->procs.system);
+    page_printf(pg, "memoriuses_processes{class=\"user\"} %d\n", s->procs.user);
+    page_printf(pg, "memoriuses_processes{class=\"background\"} %d\n", s->procs.background);
+    page_printf(pg, "# EOF\n");
+
+    pg->header_len = (size_t)snprintf(pg->header, sizeof(pg->header),
+                                      "HTTP/1.1 200 OK\r\n"
+                                      "Content-Type: application/openmetrics-text; version=1.0.0; charset=utf-8\r\n"
+                                      "Content-Length: %zu\r\nConnection: close\r\n\r\n",
+                                      pg->body_len);
+}
+
+// ADDR es "unix:/ruta", "host:puerto" o ":puerto" (127.0.0.1)
+int serve_open(Server *srv, const char *addr, char *err, size_t err_len)
 {
-    struct statfs sfs;
-    if (statfs("/", &sfs) == 0)
+    memset(srv, 0, sizeof(*srv));
+    for (int i = 0; i < SERVE_MAX_CLIENTS; i++)
+        srv->clients[i].fd = -1;
+    srv->listen_fd = -1;
+
+    if (strncmp(addr, "unix:", 5) == 0)
     {
-        stats->total = (unsigned long long)sfs.f_blocks * sfs.f_bsize;
-        stats->free = (unsigned long long)sfs.f_bfree * sfs.f_bsize;
-        stats->used = stats->total - stats->free;
-        stats->percent_used = stats->total > 0 ? (double)stats->used / stats->total * 100.0 : 0.0;
+        struct sockaddr_un sun;
+        memset(&sun, 0, sizeof(sun));
+        sun.sun_family = AF_UNIX;
+        if (strlen(addr + 5) >= sizeof(sun.sun_path))
+        {
+            snprintf(err, err_len, "Ruta de socket demasiado larga: %s", addr + 5);
+            return -1;
+        }
+        strcpy(sun.sun_path, addr + 5);
+        struct stat st;
+        if (stat(sun.sun_path, &st) == 0 && S_ISSOCK(st.st_mode))
+            unlink(sun.sun_path); // Socket de una ejecución anterior
+        srv->listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (srv->listen_fd < 0 || bind(srv->listen_fd, (struct sockaddr *)&sun, sizeof(sun)) != 0)
+        {
+            snprintf(err, err_len, "No se pudo abrir %s: %s", addr, strerror(errno));
+            return -1;
+        }
+        srv->unix_path = addr + 5;
     }
     else
     {
-        stats->total = stats->used = stats->free = stats->percent_used = 0;
+        char host[256];
+        const char *colon = strrchr(addr, ':');
+        const char *port = colon ? colon + 1 : addr;
+        size_t host_len = colon ? (size_t)(colon - addr) : 0;
+        if (host_len >= sizeof(host) || !*port)
+        {
+            snprintf(err, err_len, "Dirección inválida: %s", addr);
+            return -1;
+        }
+        memcpy(host, addr, host_len);
+        host[host_len] = '\0';
+        if (host_len >= 2 && host[0] == '[' && host[host_len - 1] == ']') // [::1]:9100
+        {
+            memmove(host, host + 1, host_len - 2);
+            host[host_len - 2] = '\0';
+        }
+
+        struct addrinfo hints, *res;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = AI_PASSIVE;
+        int rc = getaddrinfo(host[0] ? host : "127.0.0.1", port, &hints, &res);
+        if (rc != 0)
+        {
+            snprintf(err, err_len, "Dirección inválida %s: %s", addr, gai_strerror(rc));
+            return -1;
+        }
+        srv->listen_fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+        int one = 1;
+        if (srv->listen_fd >= 0)
+            setsockopt(srv->listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        rc = srv->listen_fd >= 0 ? bind(srv->listen_fd, res->ai_addr, res->ai_addrlen) : -1;
+        freeaddrinfo(res);
+        if (rc != 0)
+        {
+            snprintf(err, err_len, "No se pudo abrir %s: %s", addr, strerror(errno));
+            return -1;
+        }
     }
+    if (listen(srv->listen_fd, 64) != 0)
+    {
+        snprintf(err, err_len, "No se pudo escuchar en %s: %s", addr, strerror(errno));
+        return -1;
+    }
+    fcntl(srv->listen_fd, F_SETFL, O_NONBLOCK);
+    fcntl(srv->listen_fd, F_SETFD, FD_CLOEXEC);
+    return 0;
 }
 
-// Barra horizontal de disco
-void draw_disk_bar(int y, int x, DiskStats *stats)
+static void serve_drop(ServeClient *c)
 {
-    char used_str[32], total_str[32];
-    format_bytes(stats->used, used_str);
-    format_bytes(stats->total, total_str);
-    int width = 32;
-    int filled = (int)(stats->percent_used * width / 100.0);
-    mvprintw(y, x, "Disco /: [");
-    if (has_colors())
-        attron(COLOR_PAIR(3));
-    for (int i = 0; i < filled; ++i)
-        addch(ACS_CKBOARD);
-    if (has_colors())
-        attroff(COLOR_PAIR(3));
-    for (int i = filled; i < width; ++i)
-        addch(' ');
-    printw("] %.0f%% usado (%s de %s)", stats->percent_used, used_str, total_str);
+    if (c->page)
+        c->page->refs--;
+    close(c->fd);
+    c->fd = -1;
+    c->page = NULL;
+}
+
+// Serializa la muestra en una página que ningún cliente esté enviando
+static void serve_publish(Server *srv, const Sample *s)
+{
+    MetricsPage *pg = srv->current && srv->current->refs == 0 ? srv->current : NULL;
+    for (int i = 0; i < SERVE_PAGES && !pg; i++)
+        if (srv->pages[i].refs == 0)
+            pg = &srv->pages[i];
+    if (!pg)
+        return; // Todas ocupadas por clientes lentos: siguen con la muestra anterior
+    metrics_render(pg, s);
+    srv->current = pg;
+}
+
+// Envía lo que falte de la respuesta; devuelve 0 cuando terminó o la conexión se cerró
+static int serve_flush(ServeClient *c)
+{
+    for (;;)
+    {
+        struct iovec iov[2];
+        int n = 0;
+        if (c->page)
+        {
+            size_t total = c->page->header_len + c->page->body_len;
+            if (c->sent >= total)
+                return 0;
+            if (c->sent < c->page->header_len)
+            {
+                iov[n].iov_base = c->page->header + c->sent;
+                iov[n++].iov_len = c->page->header_len - c->sent;
+                iov[n].iov_base = c->page->body;
+                iov[n++].iov_len = c->page->body_len;
+            }
+            else
+            {
+                iov[n].iov_base = c->page->body + (c->sent - c->page->header_len);
+                iov[n++].iov_len = total - c->sent;
+            }
+        }
+        else
+        {
+            size_t total = strlen(c->fixed);
+            if (c->sent >= total)
+                return 0;
+            iov[n].iov_base = (void *)(c->fixed + c->sent);
+            iov[n++].iov_len = total - c->sent;
+        }
+        ssize_t w = writev(c->fd, iov, n);
+        if (w < 0)
+            return errno == EAGAIN || errno == EINTR ? 1 : 0;
+        c->sent += w;
+    }
+}
+
+static void serve_read(Server *srv, ServeClient *c)
+{
+    ssize_t n = read(c->fd, c->request + c->request_len, sizeof(c->request) - 1 - c->request_len);
+    if (n <= 0)
+    {
+        if (n == 0 || (errno != EAGAIN && errno != EINTR))
+            serve_drop(c);
+        return;
+    }
+    c->request_len += n;
+    c->request[c->request_len] = '\0';
+    if (!strstr(c->request, "\r\n\r\n") && !strstr(c->request, "\n\n"))
+    {
+        if (c->request_len == sizeof(c->request) - 1)
+            serve_drop(c); // Encabezados demasiado largos
+        return;
+    }
+
+    int metrics = strncmp(c->request, "GET /metrics ", 13) == 0 || strncmp(c->request, "GET / ", 6) == 0;
+    c->writing = 1;
+    if (metrics && srv->current)
+    {
+        c->page = srv->current;
+        c->page->refs++;
+    }
+    else
+        c->fixed = metrics ? serve_unavailable : serve_not_found;
+    if (!serve_flush(c))
+        serve_drop(c);
+}
+
+static void serve_accept(Server *srv, unsigned long long now_ns)
+{
+    for (;;)
+    {
+        int fd = accept(srv->listen_fd, NULL, NULL);
+        if (fd < 0)
+            return;
+        ServeClient *c = NULL;
+        for (int i = 0; i < SERVE_MAX_CLIENTS && !c; i++)
+            if (srv->clients[i].fd < 0)
+                c = &srv->clients[i];
+        if (!c)
+        {
+            close(fd); // Sin lugar: el scraper reintentará
+            continue;
+        }
+        fcntl(fd, F_SETFL, O_NONBLOCK);
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+        memset(c, 0, sizeof(*c));
+        c->fd = fd;
+        c->last_ns = now_ns;
+    }
+}
+
+// Bucle del exportador: muestras nuevas, conexiones y clientes en un solo poll()
+int serve_run(Server *srv, Sampler *sp, Recorder *rec)
+{
+    install_stop_handlers();
+    signal(SIGPIPE, SIG_IGN); // Un scraper que corta no debe terminar el proceso
+
+    static Sample latest;
+    unsigned long long last_seq = 0;
+    int have_sample = 0;
+    while (!stop_requested)
+    {
+        struct pollfd fds[2 + SERVE_MAX_CLIENTS];
+        ServeClient *owners[2 + SERVE_MAX_CLIENTS];
+        int nfds = 0;
+        fds[nfds++] = (struct pollfd){sp->notify_pipe[0], POLLIN, 0};
+        fds[nfds++] = (struct pollfd){srv->listen_fd, POLLIN, 0};
+        for (int i = 0; i < SERVE_MAX_CLIENTS; i++)
+        {
+            ServeClient *c = &srv->clients[i];
+            if (c->fd < 0)
+                continue;
+            owners[nfds] = c;
+            fds[nfds++] = (struct pollfd){c->fd, c->writing ? POLLOUT : POLLIN, 0};
+        }
+        if (poll(fds, nfds, 1000) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        unsigned long long now_ns = clock_ns(CLOCK_MONOTONIC);
+
+        if (fds[0].revents)
+        {
+            drain_fd(sp->notify_pipe[0]);
+            sampler_log_error(sp);
+            const Sample *s;
+            int fresh = 0;
+            while ((s = spsc_peek(&sp->samples)) != NULL)
+            {
+                if (rec && (!have_sample || s->seq != last_seq))
+                    recorder_append(rec, s);
+                last_seq = s->seq;
+                have_sample = fresh = 1;
+                latest = *s; // La ranura se libera al consumir
+                spsc_consume(&sp->samples);
+            }
+            if (fresh)
+                serve_publish(srv, &latest);
+        }
+        if (fds[1].revents)
+            serve_accept(srv, now_ns);
+
+        for (int i = 2; i < nfds; i++)
+        {
+            ServeClient *c = owners[i];
+            if (c->fd < 0)
+                continue;
+            if (fds[i].revents)
+            {
+                c->last_ns = now_ns;
+                if (!c->writing)
+                    serve_read(srv, c);
+                else if (!serve_flush(c))
+                    serve_drop(c);
+            }
+            else if (now_ns - c->last_ns > SERVE_IDLE_TIMEOUT_NS)
+                serve_drop(c);
+        }
+    }
+    return 0;
 }
 
-// Obtener nombre del procesador
-void get_cpu_name(char *buf, size_t buflen)
+void serve_close(Server *srv)
 {
-    size_t len = buflen;
-    sysctlbyname("machdep.cpu.brand_string", buf, &len, NULL, 0);
+    for (int i = 0; i < SERVE_MAX_CLIENTS; i++)
+        if (srv->clients[i].fd >= 0)
+            serve_drop(&srv->clients[i]);
+    if (srv->listen_fd >= 0)
+        close(srv->listen_fd);
+    if (srv->unix_path)
+        unlink(srv->unix_path);
+    for (int i = 0; i < SERVE_PAGES; i++)
+        free(srv->pages[i].body);
 }
 
-// Obtener velocidad del procesador en GHz
-double get_cpu_speed_ghz()
+// --- MEMORIA COMPARTIDA: UN RECOLECTOR, MUCHOS VISORES ---
+
+// --publish NOMBRE recolecta sin interfaz y deja la última muestra y los historiales en
+// un segmento POSIX; --attach NOMBRE lo mapea solo lectura y dibuja desde ahí. Cada
+// visor cuesta un memcpy por muestra en lugar de otra pasada por /proc.
+//
+// El segmento se protege con un seqlock: el publicador deja seq impar mientras escribe
+// y los visores reintentan la copia si seq cambió o era impar. Nadie se bloquea.
+#define SHM_MAGIC "MEMSHM\0\1"
+#define SHM_VERSION 4
+#define SHM_POLL_MS 100 // Cada cuánto mira el visor si hay una muestra nueva
+#define SHM_READ_ATTEMPTS 8
+#define SHM_RETRY_NS 250000 // Pausa entre intentos: una escritura del publicador es un memcpy
+
+typedef struct
 {
-    uint64_t hz = 0;
-    size_t len = sizeof(hz);
-    if (sysctlbyname("hw.cpufrequency", &hz, &len, NULL, 0) == 0 && hz > 0)
-        return hz / 1e9;
-    return 0.0;
+    char magic[8];
+    uint32_t version;
+    uint32_t segment_size; // Publicador y visor deben ser el mismo binario
+    int32_t interval_ms;
+    int32_t publisher_pid;
+    char backend[16];
+    SourceHost host; // Escrito una vez, antes que magic
+    SensorSet sensors; // Igual: el visor no abre el recolector y dibuja con esta descripción
+    _Atomic uint32_t seq;
+
+    // Lo que la UI necesita para dibujar un cuadro, igual que en UiState
+    Sample latest;
+    HistoryStore history;
+    unsigned char core_history[CORE_HISTORY_CAPACITY][CPU_MAX_CORES];
+    int core_history_idx;
+    int core_history_count;
+    int core_count;
+    CpuCoreUsage cores;
+    double net_down_max;
+    double net_up_max;
+    WindowStats stats;
+} ShmSegment;
+
+typedef struct
+{
+    char name[256];
+    ShmSegment *seg;
+    int owner; // El publicador borra el segmento al terminar
+    int timer_fd;
+    ShmSegment *scratch; // Copia del visor: solo pasa a la UI si seq no cambió durante ella
+    uint32_t last_seq;
+    int have_sample;
+    int publisher_gone;
+} SharedView;
+
+static void shm_normalize_name(const char *name, char *out, size_t len)
+{
+    snprintf(out, len, "%s%s", name[0] == '/' ? "" : "/", name);
 }
 
-// Obtener nombre del host
-void get_hostname(char *buf, size_t buflen)
+static int shm_publisher_alive(const ShmSegment *seg)
 {
-    gethostname(buf, buflen);
+    return seg->publisher_pid > 0 && (kill(seg->publisher_pid, 0) == 0 || errno == EPERM);
 }
 
-// Obtener versión de macOS
-void get_macos_version(char *buf, size_t buflen)
+// Mapea un segmento existente en modo lectura y valida el formato
+static ShmSegment *shm_map_readonly(const char *name, char *err, size_t err_len)
 {
-    FILE *fp = popen("sw_vers -productVersion", "r");
-    if (fp)
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0)
     {
-        fgets(buf, buflen, fp);
-        buf[strcspn(buf, "\n")] = 0;
-        pclose(fp);
+        snprintf(err, err_len, "No hay un publicador en %s: %s", name, strerror(errno));
+        return NULL;
     }
-    else
+    struct stat st;
+    ShmSegment *seg = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size == (off_t)sizeof(ShmSegment))
+        seg = mmap(NULL, sizeof(ShmSegment), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (seg == MAP_FAILED)
+    {
+        snprintf(err, err_len, "%s no es un segmento de esta versión de memoriuses", name);
+        return NULL;
+    }
+    if (memcmp(seg->magic, SHM_MAGIC, 8) != 0 || seg->version != SHM_VERSION || seg->segment_size != sizeof(ShmSegment))
     {
-        strncpy(buf, "N/D", buflen);
+        munmap(seg, sizeof(ShmSegment));
+        snprintf(err, err_len, "%s no es un segmento de esta versión de memoriuses", name);
+        return NULL;
     }
+    return seg;
 }
 
-// Obtener dirección IP de la interfaz principal
-void get_ip_address(char *buf, size_t buflen)
+int shm_publish_open(SharedView *v, const char *name, int interval_ms, const SourceHost *source, char *err, size_t err_len)
 {
-    FILE *fp = popen("ipconfig getifaddr en0", "r");
-    if (fp)
+    memset(v, 0, sizeof(*v));
+    v->timer_fd = -1;
+    shm_normalize_name(name, v->name, sizeof(v->name));
+
+    int fd = shm_open(v->name, O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0 && errno == EEXIST)
     {
-        fgets(buf, buflen, fp);
-        buf[strcspn(buf, "\n")] = 0;
-        pclose(fp);
+        // Solo se reemplaza el segmento de un publicador que ya no existe
+        ShmSegment *old = shm_map_readonly(v->name, err, err_len);
+        int alive = old && shm_publisher_alive(old);
+        if (old)
+        {
+            if (alive)
+                snprintf(err, err_len, "El proceso %d ya publica en %s", old->publisher_pid, v->name);
+            munmap(old, sizeof(ShmSegment));
+        }
+        if (alive)
+            return -1;
+        shm_unlink(v->name);
+        fd = shm_open(v->name, O_RDWR | O_CREAT | O_EXCL, 0644);
     }
-    else
+    if (fd < 0 || ftruncate(fd, sizeof(ShmSegment)) != 0)
+    {
+        snprintf(err, err_len, "No se pudo crear %s: %s", v->name, strerror(errno));
+        if (fd >= 0)
+        {
+            close(fd);
+            shm_unlink(v->name);
+        }
+        return -1;
+    }
+    v->seg = mmap(NULL, sizeof(ShmSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (v->seg == MAP_FAILED)
     {
-        strncpy(buf, "N/D", buflen);
+        snprintf(err, err_len, "No se pudo mapear %s: %s", v->name, strerror(errno));
+        v->seg = NULL;
+        shm_unlink(v->name);
+        return -1;
     }
+    v->owner = 1;
+
+    // El encabezado se escribe una vez; magic va al final para que un visor no lo acepte a medias
+    ShmSegment *seg = v->seg;
+    seg->version = SHM_VERSION;
+    seg->segment_size = sizeof(ShmSegment);
+    seg->interval_ms = interval_ms;
+    seg->publisher_pid = getpid();
+    snprintf(seg->backend, sizeof(seg->backend), "%s", collector->name);
+    seg->host = *source;
+    seg->sensors = sensor_set;
+    for (int i = 0; i < seg->sensors.count; i++)
+        seg->sensors.sensors[i].fd = -1; // Los descriptores son del publicador
+    atomic_store_explicit(&seg->seq, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    memcpy(seg->magic, SHM_MAGIC, 8);
+    return 0;
 }
 
-// Listar interfaces de red activas
-void list_active_interfaces(char *buf, size_t buflen)
+static void shm_publish(SharedView *v, const Sample *s, const UiState *ui)
 {
-    FILE *fp = popen("ifconfig | grep 'flags=' | awk -F: '{print $1}'", "r");
-    if (!fp)
-    {
-        strncpy(buf, "N/D", buflen);
-        return;
-    }
-    buf[0] = 0;
-    char line[64];
-    while (fgets(line, sizeof(line), fp))
+    ShmSegment *seg = v->seg;
+    uint32_t seq = atomic_load_explicit(&seg->seq, memory_order_relaxed);
+    atomic_store_explicit(&seg->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    seg->latest = *s;
+    hist_copy(&seg->history, &ui->history);
+    memcpy(seg->core_history, ui->core_history, sizeof(seg->core_history));
+    seg->core_history_idx = ui->core_history_idx;
+    seg->core_history_count = ui->core_history_count;
+    seg->core_count = ui->core_count;
+    seg->cores = ui->cores;
+    seg->net_down_max = ui->net_down_max;
+    seg->net_up_max = ui->net_up_max;
+    seg->stats = ui->stats;
+
+    atomic_store_explicit(&seg->seq, seq + 2, memory_order_release);
+}
+
+// Bucle del publicador: los historiales se arman igual que en la UI y se publican enteros
+int shm_publish_run(SharedView *v, Sampler *sp, Recorder *rec)
+{
+    install_stop_handlers();
+    static UiState history;
+    ui_init(&history, v->seg->interval_ms);
+
+    unsigned long long last_seq = 0;
+    int have_sample = 0;
+    struct pollfd pfd = {sp->notify_pipe[0], POLLIN, 0};
+    while (!stop_requested)
     {
-        strncat(buf, line, buflen - strlen(buf) - 1);
-        if (strlen(buf) > buflen - 16)
+        if (poll(&pfd, 1, -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
             break;
+        }
+        drain_fd(sp->notify_pipe[0]);
+        sampler_log_error(sp);
+        const Sample *s;
+        while ((s = spsc_peek(&sp->samples)) != NULL)
+        {
+            if (!have_sample || s->seq != last_seq)
+            {
+                ui_record_sample(&history, s);
+                if (rec)
+                    recorder_append(rec, s);
+            }
+            last_seq = s->seq;
+            have_sample = 1;
+            shm_publish(v, s, &history);
+            spsc_consume(&sp->samples);
+        }
     }
-    pclose(fp);
+    return 0;
 }
 
-// Listado de procesos: PID, nombre, %CPU, %MEM
-void draw_process_list(int y, int x, int max_rows)
+int shm_attach_open(SharedView *v, const char *name, char *err, size_t err_len)
 {
-    FILE *fp = popen("ps -axo pid,comm,%cpu,%mem | head -n 16", "r");
-    if (!fp)
-        return;
-    char line[128];
-    int row = 0;
-    mvprintw(y, x, "PID     Nombre                CPU%%   MEM%%");
-    while (fgets(line, sizeof(line), fp) && row < max_rows)
+    memset(v, 0, sizeof(*v));
+    v->timer_fd = -1;
+    shm_normalize_name(name, v->name, sizeof(v->name));
+    v->seg = shm_map_readonly(v->name, err, err_len);
+    if (!v->seg)
+        return -1;
+    // Los paneles de sensores y el mapa de núcleos leen sensor_set, como en modo local
+    sensor_set = v->seg->sensors;
+    sensor_set.count = MAX(0, MIN(sensor_set.count, SENSOR_MAX));
+    v->scratch = malloc(sizeof(ShmSegment));
+    if (!v->scratch)
     {
-        mvprintw(y + row + 1, x, "%.*s", (int)sizeof(line) - 1, line);
-        row++;
+        snprintf(err, err_len, "Sin memoria para el visor");
+        return -1;
+    }
+    v->timer_fd = timer_open();
+    if (v->timer_fd < 0 || timer_arm(v->timer_fd, SHM_POLL_MS * 1000000ULL) != 0)
+    {
+        snprintf(err, err_len, "No se pudo crear el temporizador del visor");
+        return -1;
     }
-    pclose(fp);
+    return 0;
 }
 
-int main()
+// Copia la publicación si cambió. Devuelve 1 si hay datos nuevos en ui y latest.
+// La copia va primero a v->scratch: una lectura a medio escribir nunca llega a la UI.
+// Si el publicador sigue escribiendo tras unos intentos, queda para el próximo tick.
+int shm_attach_poll(SharedView *v, UiState *ui, Sample *latest)
 {
-    // Inicializar ncurses
-    initscr();
-    cbreak();
-    noecho();
-    nodelay(stdscr, TRUE);
-    curs_set(0);
+    const ShmSegment *seg = v->seg;
+    ShmSegment *copy = v->scratch;
+    int gone = !shm_publisher_alive(seg);
+    int changed = gone != v->publisher_gone;
+    v->publisher_gone = gone;
 
-    if (has_colors())
+    const size_t tail = offsetof(ShmSegment, core_history);
+    for (int attempt = 0; attempt < SHM_READ_ATTEMPTS; attempt++)
     {
-        start_color();
-        use_default_colors();
-        init_pair(1, COLOR_GREEN, COLOR_BLACK);   // Verde para uso bajo
-        init_pair(2, COLOR_YELLOW, COLOR_BLACK);  // Amarillo para uso medio
-        init_pair(3, COLOR_RED, COLOR_BLACK);     // Rojo para uso alto
-        init_pair(4, COLOR_CYAN, COLOR_BLACK);    // Cian para títulos
-        init_pair(5, COLOR_GREEN, COLOR_BLACK);   // Verde para coordenadas
-        init_pair(6, COLOR_BLUE, COLOR_BLACK);    // Azul para info
-        init_pair(7, COLOR_MAGENTA, COLOR_BLACK); // Magenta para advertencias
-        init_pair(8, COLOR_BLACK, COLOR_BLACK);   // Fondo negro
-    }
-    bkgd(COLOR_PAIR(8)); // Fondo negro para toda la pantalla
-    wbkgd(stdscr, COLOR_PAIR(8));
+        if (attempt > 0)
+            nanosleep(&(struct timespec){0, SHM_RETRY_NS}, NULL);
+        uint32_t seq = atomic_load_explicit(&seg->seq, memory_order_acquire);
+        if (seq == 0 || (v->have_sample && seq == v->last_seq))
+            break; // Sin muestras todavía, o nada nuevo
+        if (seq & 1)
+            continue; // El publicador está escribiendo
+
+        copy->latest = seg->latest;
+        hist_copy(&copy->history, &seg->history);
+        memcpy((unsigned char *)copy + tail, (const unsigned char *)seg + tail, sizeof(ShmSegment) - tail);
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&seg->seq, memory_order_relaxed) != seq)
+            continue;
 
-    MemoryInfo current_info;
-    MemoryInfo history[HISTORY_CAPACITY] = {0};
-    int history_write_idx = 0;
-    int history_data_count = 0;
+        *latest = copy->latest;
+        hist_copy(&ui->history, &copy->history);
+        memcpy(ui->core_history, copy->core_history, sizeof(ui->core_history));
+        ui->core_history_idx = copy->core_history_idx;
+        ui->core_history_count = copy->core_history_count;
+        ui->core_count = copy->core_count;
+        ui->cores = copy->cores;
+        ui->net_down_max = copy->net_down_max;
+        ui->net_up_max = copy->net_up_max;
+        ui->stats = copy->stats;
+        v->last_seq = seq;
+        v->have_sample = changed = 1;
+        break;
+    }
+    if (changed)
+        snprintf(ui->status, sizeof(ui->status), "%s %.40s (pid %d, %.15s)", gone ? "publicador detenido:" : "visor de",
+                 v->name, seg->publisher_pid, seg->backend);
+    return changed;
+}
 
-    double cpu_history[CPU_HISTORY_CAPACITY] = {0};
-    int cpu_history_idx = 0;
-    int cpu_history_count = 0;
+void shm_close(SharedView *v)
+{
+    if (v->timer_fd >= 0)
+        close(v->timer_fd);
+    if (v->seg)
+        munmap(v->seg, sizeof(ShmSegment));
+    free(v->scratch);
+    if (v->owner)
+        shm_unlink(v->name);
+}
 
-    char total_ram_str[32], used_ram_str[32], free_ram_str[32];
-    char inactive_ram_str[32], wired_ram_str[32], compressed_ram_str[32];
-    char swap_total_str[32], swap_used_str[32];
+// --- OPCIONES DE LÍNEA DE COMANDOS ---
 
-    NetStats prev_stats = {0, 0}, curr_stats = {0, 0};
-    struct timeval prev_time, curr_time;
-    get_net_stats(&prev_stats);
-    gettimeofday(&prev_time, NULL);
+typedef struct
+{
+    int interval_ms;
+    const char *record_path; // --record: grabar las muestras en este archivo
+    const char *replay_path; // --replay: mostrar una grabación en lugar del equipo
+    double speed;            // Velocidad inicial de la reproducción
+    int bench;               // --bench: iteraciones por caso, 0 = monitor normal
+    int batch;               // --batch: salida por líneas sin interfaz
+    int batch_count;         // Muestras a imprimir en --batch, 0 = sin límite
+    const char *serve_addr;  // --serve: exportador OpenMetrics sin interfaz
+    const char *publish_name; // --publish: recolector para varios visores
+    const char *attach_name;  // --attach: visor de un publicador
+    const char *alert_log;    // --alert-log: cambios de estado de las alertas
+    int cgroup;               // --cgroup: modo contenedor
+    int cgroup_children;      // --cgroup-children
+} Options;
 
-    double net_down = 0, net_up = 0, net_down_max = 1, net_up_max = 1;
+enum
+{
+    OPT_PROC_ROOT = 256,
+    OPT_SYS_ROOT,
+    OPT_ALERT_EXEC,
+    OPT_ALERT_LOG,
+    OPT_CGROUP_CHILDREN,
+};
 
-    ProcessStats proc_stats;
-    DiskStats disk_stats;
+void print_usage(const char *prog)
+{
+    printf("Uso: %s [opciones]\n", prog);
+    printf("  -i, --interval MS   intervalo de muestreo en milisegundos (%d-%d, por defecto 1000)\n", MIN_INTERVAL_MS, MAX_INTERVAL_MS);
+    printf("  -w, --record ARCHIVO  graba todas las muestras en ARCHIVO\n");
+    printf("  -p, --replay ARCHIVO  reproduce una grabación en lugar del equipo local\n");
+    printf("  -s, --speed X       velocidad inicial de la reproducción (por defecto 1)\n");
+    printf("  -B, --batch[=N]     sin interfaz: una línea por muestra con el consumo propio (N muestras)\n");
+    printf("  -e, --serve ADDR    sin interfaz: exporta las métricas en OpenMetrics por HTTP\n");
+    printf("                      (ADDR = host:puerto, :puerto o unix:/ruta)\n");
+    printf("  -P, --publish NOMBRE sin interfaz: publica muestras e historiales en memoria compartida\n");
+    printf("  -a, --attach NOMBRE muestra lo que publica otro proceso, sin recolectar\n");
+    printf("  -A, --alert REGLA   alerta con histéresis, se puede repetir. REGLA: METRICA>VALOR o\n");
+    printf("                      rate(METRICA)>VALOR (también '<'), con opciones for=SEG, clear=VALOR\n");
+    printf("                      y window=SEG. Métricas: ram swap cpu temp disk rx tx procs\n");
+    printf("                      psi_cpu psi_mem psi_io throttle swapio majflt\n");
+    printf("      --alert-exec CMD ejecuta CMD con sh al activarse o resolverse una alerta\n");
+    printf("                      (recibe ALERT_RULE, ALERT_STATE y ALERT_VALUE)\n");
+    printf("      --alert-log ARCHIVO agrega cada cambio de estado a ARCHIVO\n");
+    printf("  -g, --cgroup[=RUTA] modo contenedor: memoria, CPU y E/S del cgroup v2 RUTA (por defecto\n");
+    printf("                      el propio) contra sus límites, solo Linux\n");
+    printf("      --cgroup-children suma al panel del cgroup el consumo de cada hijo directo\n");
+    printf("  -b, --bench[=N]     mide cada recolector y el dibujo de un cuadro (N iteraciones, por defecto %d)\n", BENCH_DEFAULT_ITERATIONS);
+    printf("      --proc-root DIR lee /proc desde DIR (árbol de prueba, solo Linux)\n");
+    printf("      --sys-root DIR  lee /sys desde DIR (árbol de prueba, solo Linux)\n");
+    printf("  -h, --help          muestra esta ayuda\n");
+}
 
-    char cpu_name[128] = "N/D";
-    char hostname[64] = "N/D";
-    char macos_version[32] = "N/D";
-    char ip_addr[32] = "N/D";
-    char interfaces[256] = "N/D";
+// Devuelve 0 si hay que continuar, 1 si se mostró la ayuda y -1 ante un error
+int parse_options(int argc, char **argv, Options *opts)
+{
+    static const struct option long_options[] = {
+        {"interval", required_argument, NULL, 'i'},
+        {"record", required_argument, NULL, 'w'},
+        {"replay", required_argument, NULL, 'p'},
+        {"speed", required_argument, NULL, 's'},
+        {"bench", optional_argument, NULL, 'b'},
+        {"batch", optional_argument, NULL, 'B'},
+        {"serve", required_argument, NULL, 'e'},
+        {"publish", required_argument, NULL, 'P'},
+        {"attach", required_argument, NULL, 'a'},
+        {"alert", required_argument, NULL, 'A'},
+        {"alert-exec", required_argument, NULL, OPT_ALERT_EXEC},
+        {"alert-log", required_argument, NULL, OPT_ALERT_LOG},
+        {"cgroup", optional_argument, NULL, 'g'},
+        {"cgroup-children", no_argument, NULL, OPT_CGROUP_CHILDREN},
+        {"proc-root", required_argument, NULL, OPT_PROC_ROOT},
+        {"sys-root", required_argument, NULL, OPT_SYS_ROOT},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0},
+    };
+    memset(opts, 0, sizeof(*opts));
+    opts->interval_ms = 1000;
+    opts->speed = 1;
 
-    while (1)
+    int opt;
+    while ((opt = getopt_long(argc, argv, "i:w:p:s:b::B::e:P:a:A:g::h", long_options, NULL)) != -1)
     {
-        clear();
-        bkgd(COLOR_PAIR(8)); // Fondo negro para toda la pantalla
-        wbkgd(stdscr, COLOR_PAIR(8));
-
-        if (get_memory_info(&current_info) != 0)
+        switch (opt)
         {
-            mvprintw(0, 0, "Error al obtener información de memoria");
-            refresh();
-            sleep(1);
-            continue;
+        case 'i':
+            opts->interval_ms = atoi(optarg);
+            if (opts->interval_ms < MIN_INTERVAL_MS || opts->interval_ms > MAX_INTERVAL_MS)
+            {
+                fprintf(stderr, "Intervalo fuera de rango: %s\n", optarg);
+                return -1;
+            }
+            break;
+        case 'w':
+            opts->record_path = optarg;
+            break;
+        case 'p':
+            opts->replay_path = optarg;
+            break;
+        case 's':
+            opts->speed = atof(optarg);
+            if (opts->speed < PLAYER_MIN_SPEED || opts->speed > PLAYER_MAX_SPEED)
+            {
+                fprintf(stderr, "Velocidad fuera de rango: %s\n", optarg);
+                return -1;
+            }
+            break;
+        case 'b':
+            opts->bench = optarg ? atoi(optarg) : BENCH_DEFAULT_ITERATIONS;
+            if (opts->bench <= 0)
+            {
+                fprintf(stderr, "Cantidad de iteraciones inválida: %s\n", optarg);
+                return -1;
+            }
+            break;
+        case 'B':
+            opts->batch = 1;
+            opts->batch_count = optarg ? atoi(optarg) : 0;
+            if (opts->batch_count < 0)
+            {
+                fprintf(stderr, "Cantidad de muestras inválida: %s\n", optarg);
+                return -1;
+            }
+            break;
+        case 'e':
+            opts->serve_addr = optarg;
+            break;
+        case 'P':
+            opts->publish_name = optarg;
+            break;
+        case 'a':
+            opts->attach_name = optarg;
+            break;
+        case 'A':
+        {
+            char err[320];
+            if (alert_add(&alert_engine, optarg, err, sizeof(err)) != 0)
+            {
+                fprintf(stderr, "%s\n", err);
+                return -1;
+            }
+            break;
         }
+        case OPT_ALERT_EXEC:
+            alert_engine.exec_cmd = optarg;
+            break;
+        case OPT_ALERT_LOG:
+            opts->alert_log = optarg;
+            break;
+        case 'g':
+            opts->cgroup = 1;
+#if defined(__linux__)
+            linux_cgroup_arg = optarg ? optarg : "";
+            if (*linux_cgroup_arg && *linux_cgroup_arg != '/')
+            {
+                fprintf(stderr, "La ruta de --cgroup va dentro de la jerarquía, como en /proc/PID/cgroup: %s\n", optarg);
+                return -1;
+            }
+            break;
+#else
+            fprintf(stderr, "--cgroup solo existe en Linux\n");
+            return -1;
+#endif
+        case OPT_CGROUP_CHILDREN:
+            opts->cgroup_children = 1;
+#if defined(__linux__)
+            linux_cgroup_children = 1;
+#endif
+            break;
+        case OPT_PROC_ROOT:
+        case OPT_SYS_ROOT:
+#if defined(__linux__)
+            if (opt == OPT_PROC_ROOT)
+                linux_proc_root = optarg;
+            else
+                linux_sysfs_root = optarg;
+            break;
+#else
+            fprintf(stderr, "--proc-root y --sys-root solo existen en Linux\n");
+            return -1;
+#endif
+        case 'h':
+            print_usage(argv[0]);
+            return 1;
+        default:
+            print_usage(argv[0]);
+            return -1;
+        }
+    }
+    if (opts->record_path && opts->replay_path)
+    {
+        fprintf(stderr, "--record y --replay no se pueden combinar\n");
+        return -1;
+    }
+    // Como mucho una fuente de muestras distinta del equipo local o un modo sin interfaz
+    int sources = (opts->replay_path != NULL) + (opts->attach_name != NULL);
+    int headless = opts->batch + (opts->serve_addr != NULL) + (opts->publish_name != NULL);
+    if (sources + headless > 1)
+    {
+        fprintf(stderr, "--replay, --attach, --batch, --serve y --publish no se pueden combinar entre sí\n");
+        return -1;
+    }
+    if (opts->attach_name && opts->record_path)
+    {
+        fprintf(stderr, "Un visor no graba: usar --record junto con --publish\n");
+        return -1;
+    }
+    if ((opts->attach_name || opts->replay_path) && (alert_engine.count || alert_engine.exec_cmd || opts->alert_log))
+    {
+        fprintf(stderr, "Las alertas se evalúan donde se recolecta: usar --alert sin --attach ni --replay\n");
+        return -1;
+    }
+    if ((alert_engine.exec_cmd || opts->alert_log) && !alert_engine.count)
+    {
+        fprintf(stderr, "--alert-exec y --alert-log necesitan al menos una regla --alert\n");
+        return -1;
+    }
+    if (opts->cgroup_children && !opts->cgroup)
+    {
+        fprintf(stderr, "--cgroup-children necesita --cgroup\n");
+        return -1;
+    }
+    if (opts->cgroup && (opts->attach_name || opts->replay_path))
+    {
+        fprintf(stderr, "El cgroup se mide donde se recolecta: usar --cgroup sin --attach ni --replay\n");
+        return -1;
+    }
+    return 0;
+}
 
-        // Actualizar historial de memoria
-        history[history_write_idx] = current_info;
-        history_write_idx = (history_write_idx + 1) % HISTORY_CAPACITY;
-        if (history_data_count < HISTORY_CAPACITY)
-            history_data_count++;
-
-        // Actualizar historial de CPU
-        double cpu_usage = get_cpu_usage();
-        cpu_history[cpu_history_idx] = cpu_usage;
-        cpu_history_idx = (cpu_history_idx + 1) % CPU_HISTORY_CAPACITY;
-        if (cpu_history_count < CPU_HISTORY_CAPACITY)
-            cpu_history_count++;
+int main(int argc, char **argv)
+{
+    Options opts;
+    int parsed = parse_options(argc, argv, &opts);
+    if (parsed != 0)
+        return parsed < 0 ? 1 : 0;
+    prof_init();
+    if (opts.bench)
+        return bench_run(opts.bench);
 
-        format_bytes(current_info.total_ram, total_ram_str);
-        format_bytes(current_info.used_ram, used_ram_str);
-        format_bytes(current_info.free_ram, free_ram_str);
-        format_bytes(current_info.inactive_ram, inactive_ram_str);
-        format_bytes(current_info.wired_ram, wired_ram_str);
-        format_bytes(current_info.compressed_ram, compressed_ram_str);
-        format_bytes(current_info.swap_total, swap_total_str);
-        format_bytes(current_info.swap_used, swap_used_str);
+    // En reproducción y como visor las muestras vienen de afuera: no se abre el recolector
+    static Player player;
+    static SharedView shared;
+    int replaying = opts.replay_path != NULL;
+    int viewing = opts.attach_name != NULL;
+    char err[256];
+    if (viewing)
+    {
+        if (shm_attach_open(&shared, opts.attach_name, err, sizeof(err)) != 0)
+        {
+            fprintf(stderr, "%s\n", err);
+            return 1;
+        }
+    }
+    else if (replaying)
+    {
+        if (recording_open(&player.rec, opts.replay_path, err, sizeof(err)) != 0)
+        {
+            fprintf(stderr, "%s\n", err);
+            return 1;
+        }
+        player.speed = opts.speed;
+        player.timer_fd = timer_open();
+        if (player.timer_fd < 0)
+        {
+            fprintf(stderr, "No se pudo crear el temporizador de reproducción\n");
+            return 1;
+        }
+        player_rearm(&player);
+    }
+    else if (collector->open() != 0)
+    {
+        fprintf(stderr, "No se pudo inicializar el recolector %s\n", collector->name);
+        return 1;
+    }
 
-        time_t now = time(NULL);
-        char *time_str = ctime(&now);
-        time_str[strlen(time_str) - 1] = '\0';
+    // La grabación y el segmento compartido llevan los datos de este equipo
+    static SourceHost source;
+    host_facts_load(&host);
+    host_source_fill(&host, &source);
 
-        // --- CABECERA ---
-        if (has_colors())
-            attron(COLOR_PAIR(4));
-        attron(A_BOLD | A_UNDERLINE);
-        mvprintw(0, 0, "=== MONITOR DE SISTEMA macOS ===");
-        attroff(A_BOLD | A_UNDERLINE);
-        if (has_colors())
-            attroff(COLOR_PAIR(4));
-        if (has_colors())
-            attron(COLOR_PAIR(6));
-        mvhline(1, 0, ACS_HLINE, COLS);
-        if (has_colors())
-            attroff(COLOR_PAIR(6));
-        mvprintw(2, 0, "Actualizado: %s", ctime(&now));
+    // El exportador y el segmento compartido se abren antes del muestreo para fallar rápido
+    static Server server;
+    if ((opts.serve_addr && serve_open(&server, opts.serve_addr, err, sizeof(err)) != 0) ||
+        (opts.publish_name && shm_publish_open(&shared, opts.publish_name, opts.interval_ms, &source, err, sizeof(err)) != 0))
+    {
+        fprintf(stderr, "%s\n", err);
+        return 1;
+    }
 
-        // --- CPU ---
-        if (has_colors())
-            attron(COLOR_PAIR(4));
-        attron(A_BOLD);
-        mvprintw(4, 0, "CPU:");
-        attroff(A_BOLD);
-        if (has_colors())
-            attroff(COLOR_PAIR(4));
-        if (has_colors())
-            attron(COLOR_PAIR(6));
-        mvhline(5, 0, ACS_HLINE, COLS);
-        if (has_colors())
-            attroff(COLOR_PAIR(6));
-        mvprintw(6, 2, "Nombre: %s", cpu_name);
-        mvprintw(7, 2, "Núcleos: %d", get_cpu_count());
-        mvprintw(8, 2, "Velocidad: %.2f GHz", get_cpu_speed_ghz());
-        if (cpu_usage > 80 && has_colors())
-            attron(COLOR_PAIR(3));
-        else if (cpu_usage > 60 && has_colors())
-            attron(COLOR_PAIR(2));
-        else if (has_colors())
-            attron(COLOR_PAIR(1));
-        mvprintw(9, 2, "Uso: %.1f%%", cpu_usage);
-        if (has_colors())
-            attroff(COLOR_PAIR(1) | COLOR_PAIR(2) | COLOR_PAIR(3));
+    static Recorder recorder;
+    if (opts.record_path && recorder_open(&recorder, opts.record_path, opts.interval_ms, &source) != 0)
+    {
+        fprintf(stderr, "No se pudo crear la grabación %s: %s\n", opts.record_path, strerror(errno));
+        return 1;
+    }
+    if (opts.alert_log && !(alert_engine.log = fopen(opts.alert_log, "a")))
+    {
+        fprintf(stderr, "No se pudo abrir el registro de alertas %s: %s\n", opts.alert_log, strerror(errno));
+        return 1;
+    }
 
-        // --- RAM ---
-        if (has_colors())
-            attron(COLOR_PAIR(4));
-        attron(A_BOLD);
-        mvprintw(11, 0, "MEMORIA RAM:");
-        attroff(A_BOLD);
-        if (has_colors())
-            attroff(COLOR_PAIR(4));
-        if (has_colors())
-            attron(COLOR_PAIR(6));
-        mvhline(12, 0, ACS_HLINE, COLS);
-        if (has_colors())
-            attroff(COLOR_PAIR(6));
-        mvprintw(13, 2, "Total: %s", total_ram_str);
-        if (current_info.ram_percentage > 80 && has_colors())
-            attron(COLOR_PAIR(3));
-        else if (current_info.ram_percentage > 60 && has_colors())
-            attron(COLOR_PAIR(2));
-        else if (has_colors())
-            attron(COLOR_PAIR(1));
-        mvprintw(14, 2, "Usada: %s", used_ram_str);
-        if (has_colors())
-            attroff(COLOR_PAIR(1) | COLOR_PAIR(2) | COLOR_PAIR(3));
-        mvprintw(15, 2, "Libre: %s", free_ram_str);
+    // SIGWINCH se atiende con un descriptor: bloquearla antes de crear los hilos
+    block_winch();
 
-        // --- TEMPERATURA CPU ---
-        double cpu_temp = get_cpu_temperature_cached();
-        if (has_colors())
-            attron(COLOR_PAIR(4));
-        attron(A_BOLD);
-        mvprintw(4, 40, "Temperatura CPU:");
-        attroff(A_BOLD);
-        if (has_colors())
-            attroff(COLOR_PAIR(4));
-        if (cpu_temp > 0)
-        {
-            if (cpu_temp > 80 && has_colors())
-                attron(COLOR_PAIR(3));
-            else if (cpu_temp > 60 && has_colors())
-                attron(COLOR_PAIR(2));
-            else if (has_colors())
-                attron(COLOR_PAIR(1));
-            mvprintw(5, 40, "%.1f°C", cpu_temp);
-            if (has_colors())
-                attroff(COLOR_PAIR(1) | COLOR_PAIR(2) | COLOR_PAIR(3));
+    // La recolección corre en su propio hilo; la UI solo dibuja la última muestra
+    Sampler sampler;
+    if (!replaying && !viewing && sampler_start(&sampler, opts.interval_ms) != 0)
+    {
+        fprintf(stderr, "No se pudo iniciar el hilo de muestreo\n");
+        return 1;
+    }
+    if (opts.batch || opts.serve_addr || opts.publish_name)
+    {
+        Recorder *rec = opts.record_path ? &recorder : NULL;
+        if (opts.batch)
+            batch_run(&sampler, opts.batch_count, rec);
+        else if (opts.serve_addr)
+        {
+            serve_run(&server, &sampler, rec);
+            serve_close(&server);
         }
         else
         {
-            if (has_colors())
-                attron(COLOR_PAIR(7));
-            mvprintw(5, 40, "N/D");
-            if (has_colors())
-                attroff(COLOR_PAIR(7));
+            shm_publish_run(&shared, &sampler, rec);
+            shm_close(&shared);
         }
+        sampler_stop(&sampler);
+        proc_table_free(&proc_table);
+        collector->close();
+        alert_engine_close(&alert_engine);
+        if (opts.record_path)
+            recorder_close(&recorder);
+        return recorder.failed ? 1 : 0;
+    }
 
-        // --- PROCESOS ---
-        get_process_stats(&proc_stats);
-        if (has_colors())
-            attron(COLOR_PAIR(4));
-        attron(A_BOLD);
-        mvprintw(4, 70, "Procesos:");
-        attroff(A_BOLD);
-        if (has_colors())
-            attroff(COLOR_PAIR(4));
-        if (has_colors())
-            attron(COLOR_PAIR(6));
-        mvhline(5, 70, ACS_HLINE, COLS - 70);
-        if (has_colors())
-            attroff(COLOR_PAIR(6));
-        mvprintw(6, 70, "  Sistema:   %d", proc_stats.system);
-        mvprintw(7, 70, "  Usuario:   %d", proc_stats.user);
-        mvprintw(8, 70, "  Fondo:     %d", proc_stats.background);
-        mvprintw(9, 70, "  Total:     %d", proc_stats.total);
-
-        // --- RED ---
-        get_net_stats(&curr_stats);
-        gettimeofday(&curr_time, NULL);
-        double elapsed = (curr_time.tv_sec - prev_time.tv_sec) + (curr_time.tv_usec - prev_time.tv_usec) / 1e6;
-        if (elapsed > 0)
-        {
-            net_down = (curr_stats.rx_bytes - prev_stats.rx_bytes) * 8.0 / (elapsed * 1024 * 1024); // Mb/s
-            net_up = (curr_stats.tx_bytes - prev_stats.tx_bytes) * 8.0 / (elapsed * 1024 * 1024);   // Mb/s
-            if (net_down > net_down_max)
-                net_down_max = net_down;
-            if (net_up > net_up_max)
-                net_up_max = net_up;
-        }
-        prev_stats = curr_stats;
-        prev_time = curr_time;
+    // Grabando, SIGINT/SIGTERM/SIGHUP salen del bucle y cierran la grabación con su índice.
+    // Se instalan antes de initscr para que ncurses no ponga los suyos.
+    if (opts.record_path)
+        install_stop_handlers();
 
-        if (has_colors())
-            attron(COLOR_PAIR(4));
-        attron(A_BOLD);
-        mvprintw(17, 0, "RED:");
-        attroff(A_BOLD);
-        if (has_colors())
-            attroff(COLOR_PAIR(4));
-        if (has_colors())
-            attron(COLOR_PAIR(6));
-        mvhline(18, 0, ACS_HLINE, COLS);
-        if (has_colors())
-            attroff(COLOR_PAIR(6));
-        mvprintw(19, 2, "+ Download: %.2f Mb/s", net_down);
-        mvprintw(20, 2, "- Upload  : %.2f Mb/s", net_up);
+    // Inicializar ncurses (con el locale del usuario para que °, ú, ñ ocupen una columna)
+    setlocale(LC_ALL, "");
+    initscr();
+    cbreak();
+    noecho();
+    nodelay(stdscr, TRUE);
+    keypad(stdscr, TRUE);
+    curs_set(0);
+    int winch_fd = winch_open();
 
-        // --- DISCO ---
-        get_disk_stats(&disk_stats);
-        if (has_colors())
-            attron(COLOR_PAIR(4));
-        attron(A_BOLD);
-        mvprintw(22, 0, "DISCO:");
-        attroff(A_BOLD);
-        if (has_colors())
-            attroff(COLOR_PAIR(4));
-        if (has_colors())
-            attron(COLOR_PAIR(6));
-        mvhline(23, 0, ACS_HLINE, COLS);
-        if (has_colors())
-            attroff(COLOR_PAIR(6));
-        draw_disk_bar(24, 2, &disk_stats);
+    ui_init_colors();
+    refresh();
 
-        // --- SWAP ---
-        if (has_colors())
-            attron(COLOR_PAIR(4));
-        attron(A_BOLD);
-        mvprintw(26, 0, "MEMORIA SWAP:");
-        attroff(A_BOLD);
-        if (has_colors())
-            attroff(COLOR_PAIR(4));
-        if (has_colors())
-            attron(COLOR_PAIR(6));
-        mvhline(27, 0, ACS_HLINE, COLS);
-        if (has_colors())
-            attroff(COLOR_PAIR(6));
-        mvprintw(28, 2, "Total: %s", swap_total_str);
-        mvprintw(29, 2, "Usada: %s", swap_used_str);
-        draw_progress_bar(30, 2, 40, current_info.swap_percentage, "SWAP");
+    static Screen screen;
+    static UiState ui;
+    ui_init(&ui, opts.interval_ms);
+    host_events_open(&host);
+
+    static Sample latest;
+    int have_sample = 0;
+    int running = 1;
+
+    ui.replaying = replaying;
+    if (replaying && player.rec.has_source)
+        ui.source = &player.rec.source;
+    else if (viewing)
+        ui.source = &shared.seg->host;
+    if (replaying)
+    {
+        // Mostrar la primera muestra enseguida, sin esperar al temporizador
+        ui_player_seek(&ui, &player, 0, &latest);
+        have_sample = 1;
+    }
+    else if (viewing)
+    {
+        ui.interval_ms = shared.seg->interval_ms;
+        have_sample = shm_attach_poll(&shared, &ui, &latest) && shared.have_sample;
+    }
+    else if (opts.record_path)
+        snprintf(ui.status, sizeof(ui.status), "grabando en %s", opts.record_path);
+
+    // Bucle de eventos: teclado, datos nuevos del muestreador y cambios de tamaño.
+    // Nada se hace por sondeo: cada cosa se atiende apenas ocurre.
+    enum
+    {
+        EV_STDIN,
+        EV_SAMPLES,
+        EV_WINCH,
+        EV_HOST,
+        EV_COUNT
+    };
+    struct pollfd fds[EV_COUNT] = {
+        {STDIN_FILENO, POLLIN, 0},
+        {replaying ? player.timer_fd : viewing ? shared.timer_fd : sampler.notify_pipe[0], POLLIN, 0},
+        {winch_fd, POLLIN, 0},
+        {host.event_fd, POLLIN, 0}, // Ignorado por poll si es -1
+    };
+
+    while (running && !stop_requested)
+    {
+        if (poll(fds, EV_COUNT, -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        int dirty = 0;
 
-        // --- HISTOGRAMA RAM ---
-        int graph_start_y = 32;
-        int graph_min_lines_needed = graph_start_y + 10 + 2;
-        if (LINES >= graph_min_lines_needed)
+        if (fds[EV_WINCH].revents)
         {
-            int oldest_idx_in_buffer = (history_data_count < HISTORY_CAPACITY) ? 0 : history_write_idx;
-            draw_memory_histogram(graph_start_y, 10, history, HISTORY_CAPACITY, oldest_idx_in_buffer, history_data_count);
+            winch_ack(winch_fd);
+            ui_handle_resize(&screen);
+            dirty = 1;
         }
 
-        // --- HEATMAP CPU ---
-        if (LINES > graph_min_lines_needed + 3)
+        if (fds[EV_HOST].revents && host_events_handle(&host))
+            dirty = 1;
+
+        if (fds[EV_STDIN].revents)
         {
-            int cpu_y = graph_start_y + 12;
-            int oldest_cpu_idx = (cpu_history_count < CPU_HISTORY_CAPACITY) ? 0 : cpu_history_idx;
-            double cpu_heatmap[CPU_HEATMAP_WIDTH];
-            int points = MIN(cpu_history_count, CPU_HEATMAP_WIDTH);
-            for (int i = 0; i < points; ++i)
+            int ch, query_changed = 0, interval_changed = 0;
+            while (running && (ch = getch()) != ERR)
             {
-                int idx = (oldest_cpu_idx + (cpu_history_count - points) + i + CPU_HISTORY_CAPACITY) % CPU_HISTORY_CAPACITY;
-                cpu_heatmap[i] = cpu_history[idx];
+                if (!replaying || !handle_player_key(&ui, &player, ch, &latest))
+                    running = handle_key(&ui, ch, &query_changed, &interval_changed);
+                dirty = 1;
             }
-            draw_cpu_heatmap(cpu_y, 10, cpu_heatmap, points);
+            if (replaying || viewing)
+                query_changed = interval_changed = 0; // El orden del top y el intervalo los fija la fuente
+            if (query_changed)
+                sampler_send_query(&sampler, &ui.proc_query);
+            if (interval_changed)
+                sampler_set_interval(&sampler, ui.interval_ms);
         }
 
-        // --- INFO SISTEMA ---
-        if (has_colors())
-            attron(COLOR_PAIR(4));
-        attron(A_BOLD);
-        mvprintw(LINES - 5, 0, "=== INFORMACION DEL SISTEMA ===");
-        attroff(A_BOLD);
-        if (has_colors())
-            attroff(COLOR_PAIR(4));
-        if (has_colors())
-            attron(COLOR_PAIR(6));
-        mvhline(LINES - 4, 0, ACS_HLINE, COLS);
-        if (has_colors())
-            attroff(COLOR_PAIR(6));
-        mvprintw(LINES - 3, 0, "CPUs: %d", get_cpu_count());
-        mvprintw(LINES - 2, 0, "Uptime: %.2f horas", get_uptime());
-
-        if (has_colors())
-            attron(COLOR_PAIR(7));
-        mvprintw(LINES - 1, 0, "Presiona 'q' para salir, 'r' para reiniciar historial");
-        if (has_colors())
-            attroff(COLOR_PAIR(7));
+        if (replaying)
+        {
+            if (fds[EV_SAMPLES].revents)
+            {
+                timer_ack(player.timer_fd);
+                if (ui_player_advance(&ui, &player, &latest) > 0)
+                    dirty = 1;
+            }
+            if (running && dirty)
+                screen_draw(&screen, &latest, &ui);
+            continue;
+        }
+        if (viewing)
+        {
+            if (fds[EV_SAMPLES].revents)
+            {
+                timer_ack(shared.timer_fd);
+                if (shm_attach_poll(&shared, &ui, &latest))
+                    dirty = 1;
+                have_sample = shared.have_sample;
+            }
+            if (running && dirty && have_sample)
+                screen_draw(&screen, &latest, &ui);
+            continue;
+        }
 
-        refresh();
+        if (fds[EV_SAMPLES].revents)
+            drain_fd(sampler.notify_pipe[0]);
+        int pipe_err = sampler_take_error(&sampler);
+        if (pipe_err)
+        {
+            snprintf(ui.status, sizeof(ui.status), "error entre hilos: %.60s", strerror(pipe_err));
+            dirty = 1;
+        }
 
-        int ch = getch();
-        if (ch == 'q' || ch == 'Q')
-            break;
-        else if (ch == 'r' || ch == 'R')
+        // Vaciar las colas: cada muestra nueva alimenta los historiales y la última se dibuja
+        const Sample *s;
+        while ((s = spsc_peek(&sampler.samples)) != NULL)
         {
-            memset(history, 0, sizeof(history));
-            history_write_idx = 0;
-            history_data_count = 0;
-            memset(cpu_history, 0, sizeof(cpu_history));
-            cpu_history_idx = 0;
-            cpu_history_count = 0;
+            if (!have_sample || s->seq != latest.seq)
+            {
+                ui_record_sample(&ui, s);
+                if (opts.record_path)
+                    recorder_append(&recorder, s);
+            }
+            latest = *s;
+            have_sample = 1;
+            spsc_consume(&sampler.samples);
+            dirty = 1;
         }
 
-        sleep(1);
+        if (running && dirty && have_sample)
+            screen_draw(&screen, &latest, &ui);
     }
 
+    screen_free(&screen);
     endwin();
+    if (winch_fd >= 0)
+        close(winch_fd);
+    host_events_close(&host);
+    if (replaying)
+    {
+        close(player.timer_fd);
+        recording_close(&player.rec);
+    }
+    else if (viewing)
+        shm_close(&shared);
+    else
+    {
+        sampler_stop(&sampler);
+        proc_table_free(&proc_table);
+        collector->close();
+        alert_engine_close(&alert_engine);
+    }
+    if (opts.record_path)
+    {
+        recorder_close(&recorder);
+        if (recorder.failed)
+            fprintf(stderr, "La grabación %s quedó incompleta por un error de escritura\n", opts.record_path);
+        else
+            printf("Grabadas %llu muestras en %s\n", recorder.samples, opts.record_path);
+    }
     printf("Monitor de sistema finalizado.\n");
     return 0;
 }